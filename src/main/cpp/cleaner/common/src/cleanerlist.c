@@ -0,0 +1,169 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <string.h>
+
+#include "cleanerlist.h"
+
+unsigned int readListNumber(const char * ptr) {
+    const unsigned char * p = (const unsigned char *) ptr;
+    return (unsigned int) p[0] | ((unsigned int) p[1] << 8) |
+            ((unsigned int) p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+int isBinaryList(const char * data, size_t size) {
+    return size >= BINARY_LIST_HEADER &&
+            memcmp(data, BINARY_LIST_MAGIC, 4) == 0 &&
+            readListNumber(data + 4) == BINARY_LIST_VERSION;
+}
+
+size_t getBinaryListCapacity(const char * data, size_t size) {
+    size_t count;
+    size_t limit;
+    if(!isBinaryList(data, size)) return 0;
+    count = readListNumber(data + 8);
+    // every entry takes at least its header and the terminating zero
+    limit = (size - BINARY_LIST_HEADER) / (BINARY_ENTRY_HEADER + 1);
+    return (count > limit) ? limit : count;
+}
+
+size_t indexBinaryList(char * data, size_t size, char ** index, size_t capacity) {
+    size_t position = BINARY_LIST_HEADER;
+    size_t count = getBinaryListCapacity(data, size);
+    size_t i;
+
+    if(count > capacity) count = capacity;
+    for(i = 0; i < count && position + BINARY_ENTRY_HEADER < size; i++) {
+        size_t length = readListNumber(data + position + 4);
+        if(length >= size - position - BINARY_ENTRY_HEADER ||
+                data[position + BINARY_ENTRY_HEADER + length] != 0) {
+            break;
+        }
+        // there are fewer separators than characters in the path,
+        // a larger depth means that the list is damaged
+        if(readListNumber(data + position) > length) {
+            break;
+        }
+        index[i] = data + position;
+        position += BINARY_ENTRY_HEADER + length + 1;
+    }
+    return i;
+}
+
+size_t decodeTextList(const char * data, size_t size, CleanerChar * text) {
+    const unsigned char * p = (const unsigned char *) data;
+    int bigEndian = 0;
+    size_t length;
+    size_t i;
+
+    if(size >= 2 && p[0] == 0xFF && p[1] == 0xFE) {
+        p += 2;
+        size -= 2;
+    } else if(size >= 2 && p[0] == 0xFE && p[1] == 0xFF) {
+        // Java charset "UNICODE" is big-endian with BOM
+        bigEndian = 1;
+        p += 2;
+        size -= 2;
+    }
+    length = size / 2;
+    for(i = 0; i < length; i++) {
+        text[i] = bigEndian ?
+            (CleanerChar) ((p[2 * i] << 8) | p[2 * i + 1]) :
+            (CleanerChar) (p[2 * i] | (p[2 * i + 1] << 8));
+    }
+    text[length] = 0;
+    return length;
+}
+
+size_t getLinesCapacity(const CleanerChar * text, size_t length) {
+    size_t lines = 1;
+    size_t i;
+    for(i = 0; i + 1 < length; i++) {
+        if(text[i] == '\r' && text[i + 1] == '\n') lines++;
+    }
+    return lines;
+}
+
+size_t splitTextList(CleanerChar * text, size_t length, CleanerChar ** lines, size_t capacity) {
+    size_t number = 0;
+    size_t start = 0;
+    size_t i;
+
+    for(i = 0; i <= length && number < capacity; i++) {
+        // a zero unit ends the text as it ends every line
+        int end = (i == length) || (text[i] == 0) ||
+                (text[i] == '\r' && i + 1 < length && text[i + 1] == '\n');
+        if(!end) continue;
+        if(i > start) {
+            lines[number++] = text + start;
+        }
+        if(i == length || text[i] == 0) break;
+        text[i] = 0;
+        start = i + 2;
+        i++;
+    }
+    return number;
+}
+
+unsigned int getPathDepth(const CleanerChar * path) {
+    unsigned int depth = 0;
+    const CleanerChar * ptr;
+    for(ptr = path; *ptr; ptr++) {
+        if((*ptr == '\\' || *ptr == '/') && *(ptr + 1)) {
+            depth++;
+        }
+    }
+    return depth;
+}
+
+unsigned int getUnixPathDepth(const char * path) {
+    unsigned int depth = 0;
+    const char * ptr;
+    for(ptr = path; *ptr; ptr++) {
+        if(*ptr == '/' && *(ptr + 1)) {
+            depth++;
+        }
+    }
+    return depth;
+}
+
+size_t orderDeepestFirst(const unsigned int * depths, const unsigned char * marked, size_t number,
+        unsigned int maxDepth, size_t * counts, size_t * order) {
+    size_t ordered = 0;
+    unsigned int d;
+    size_t i;
+
+    // counting sort, the bucket of depth d is at maxDepth - d
+    memset(counts, 0, sizeof(size_t) * (maxDepth + 2));
+    for(i = 0; i < number; i++) {
+        if(marked[i] && depths[i] <= maxDepth) {
+            counts[maxDepth - depths[i] + 1]++;
+            ordered++;
+        }
+    }
+    for(d = 1; d <= maxDepth + 1; d++) {
+        counts[d] += counts[d - 1];
+    }
+    for(i = 0; i < number; i++) {
+        if(marked[i] && depths[i] <= maxDepth) {
+            order[counts[maxDepth - depths[i]]++] = i;
+        }
+    }
+    return ordered;
+}
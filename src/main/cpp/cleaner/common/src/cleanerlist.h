@@ -0,0 +1,85 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// List parsing and scheduling shared by the Windows and the Unix cleaner.
+// Nothing here touches the file system or allocates memory, the callers
+// own all the buffers.
+
+#ifndef _cleanerlist_H
+#define _cleanerlist_H
+
+#include <stddef.h>
+
+// UTF-16 code unit of the text list, the same type as WCHAR on Windows
+#ifdef _WIN32
+#include <wchar.h>
+typedef wchar_t CleanerChar;
+#else
+typedef unsigned short CleanerChar;
+#endif
+
+// Binary list format :
+//   "NBCL", version, number of entries
+//   for every entry : depth, length, UTF-8 path terminated by zero
+//                     (not counted in the length)
+// All the numbers are 32-bit little-endian. The depth is the number of
+// separators in the path.
+#define BINARY_LIST_MAGIC   "NBCL"
+#define BINARY_LIST_VERSION 1
+#define BINARY_LIST_HEADER  12
+#define BINARY_ENTRY_HEADER 8
+
+unsigned int readListNumber(const char * ptr);
+
+int isBinaryList(const char * data, size_t size);
+
+// Upper bound of the entries of the binary list, the size of the index.
+size_t getBinaryListCapacity(const char * data, size_t size);
+
+// Points every index item to the header of an entry, the path is at
+// BINARY_ENTRY_HEADER. Stops at the first damaged entry.
+// Returns the number of the valid entries.
+size_t indexBinaryList(char * data, size_t size, char ** index, size_t capacity);
+
+// Decodes the UTF-16 text list with an optional BOM of either byte order.
+// The text needs size / 2 + 1 units, it is terminated by zero.
+// Returns the length of the text in units.
+size_t decodeTextList(const char * data, size_t size, CleanerChar * text);
+
+// Upper bound of the lines of the text, the size of the line array.
+size_t getLinesCapacity(const CleanerChar * text, size_t length);
+
+// Splits the text at CRLF in place, empty lines are skipped.
+// Returns the number of the lines.
+size_t splitTextList(CleanerChar * text, size_t length, CleanerChar ** lines, size_t capacity);
+
+// Number of separators in the path, a trailing one is not counted. The
+// separators are slash and backslash in the text list, only slash in a
+// Unix path.
+unsigned int getPathDepth(const CleanerChar * path);
+unsigned int getUnixPathDepth(const char * path);
+
+// Puts the indexes of the marked entries to order, the deepest first, so
+// that every directory is empty when its turn comes. Entries of the same
+// depth keep their order. The counts need maxDepth + 2 items.
+// Returns the number of the ordered entries.
+size_t orderDeepestFirst(const unsigned int * depths, const unsigned char * marked, size_t number,
+        unsigned int maxDepth, size_t * counts, size_t * order);
+
+#endif /* _cleanerlist_H */
@@ -0,0 +1,204 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Benchmark of the list core against the code it replaces in cleaner.exe :
+// the text list was split by searching for every separator from the start
+// of the rest and measuring the rest, and the directories were found by one
+// pass over the whole list per depth. Run by "make bench" of the Unix cleaner.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cleanerlist.h"
+
+#define ENTRIES   5000
+#define MAX_DEPTH 16
+#define RUNS      5
+
+static double currentSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static size_t textLength(const CleanerChar * text) {
+    const CleanerChar * ptr = text;
+    while (*ptr) {
+        ptr++;
+    }
+    return (size_t) (ptr - text);
+}
+
+static CleanerChar * search(const CleanerChar * text, const CleanerChar * pattern) {
+    for (; *text; text++) {
+        const CleanerChar * s1 = text;
+        const CleanerChar * s2 = pattern;
+        while (*s1 && *s2 && *s1 == *s2) {
+            s1++;
+            s2++;
+        }
+        if (!*s2) {
+            return (CleanerChar *) text;
+        }
+    }
+    return NULL;
+}
+
+// getLinesNumber and getLines of the old cleaner.exe
+static size_t splitReference(CleanerChar * text, CleanerChar *** list) {
+    static const CleanerChar separator[] = { '\r', '\n', 0 };
+    CleanerChar * ptr = text;
+    CleanerChar * next;
+    size_t number = 0;
+    size_t counter = 0;
+
+    while ((next = search(ptr, separator)) != NULL) {
+        ptr = next + 2;
+        number++;
+    }
+    if (textLength(ptr) > 0) {
+        number++;
+    }
+    *list = (CleanerChar **) calloc(number + 1, sizeof(CleanerChar *));
+    ptr = text;
+    while (counter < number) {
+        size_t length;
+        if ((next = search(ptr, separator)) != NULL) {
+            length = textLength(ptr) - textLength(next + 2) - 2;
+            next += 2;
+        } else {
+            length = textLength(ptr);
+            next = NULL;
+        }
+        (*list)[counter] = (CleanerChar *) calloc(length + 1, sizeof(CleanerChar));
+        memcpy((*list)[counter], ptr, length * sizeof(CleanerChar));
+        counter++;
+        if (next == NULL) {
+            break;
+        }
+        ptr = next;
+    }
+    return number;
+}
+
+// deleteDirectories of the old cleaner.exe, without deleting
+static size_t orderReference(const unsigned int * depths, const unsigned char * marked, size_t number,
+        unsigned int maxDepth, size_t * order) {
+    size_t ordered = 0;
+    unsigned int depth = maxDepth;
+    size_t i;
+    do {
+        for (i = 0; i < number; i++) {
+            if (marked[i] && depths[i] == depth) {
+                order[ordered++] = i;
+            }
+        }
+    } while ((depth--) > 0);
+    return ordered;
+}
+
+static char * createList(size_t * size) {
+    char * data = (char *) malloc((size_t) ENTRIES * 400);
+    size_t position = 0;
+    size_t i;
+    data[position++] = (char) 0xFE;
+    data[position++] = (char) 0xFF;
+    for (i = 0; i < ENTRIES; i++) {
+        char line[256];
+        size_t length;
+        size_t j;
+        unsigned int depth = 2 + (unsigned int) (i * 7 % (MAX_DEPTH - 1));
+        unsigned int d;
+        length = (size_t) snprintf(line, sizeof(line), "C:\\Program Files\\NetBeans");
+        for (d = 2; d < depth; d++) {
+            length += (size_t) snprintf(line + length, sizeof(line) - length, "\\dir%u", d);
+        }
+        length += (size_t) snprintf(line + length, sizeof(line) - length, "\\entry%lu\r\n", (unsigned long) i);
+        for (j = 0; j < length; j++) {
+            data[position++] = 0;
+            data[position++] = line[j];
+        }
+    }
+    *size = position;
+    return data;
+}
+
+int main(void) {
+    size_t size;
+    char * data = createList(&size);
+    CleanerChar * text = (CleanerChar *) malloc((size / 2 + 1) * sizeof(CleanerChar));
+    CleanerChar ** lines = NULL;
+    unsigned int * depths = (unsigned int *) malloc(ENTRIES * sizeof(unsigned int));
+    unsigned char * marked = (unsigned char *) malloc(ENTRIES);
+    size_t * order = (size_t *) malloc(ENTRIES * sizeof(size_t));
+    size_t counts[MAX_DEPTH + 2];
+    double started;
+    double splitOld = 0;
+    double splitNew = 0;
+    double orderOld = 0;
+    double orderNew = 0;
+    size_t number = 0;
+    size_t i;
+    int run;
+
+    for (run = 0; run < RUNS; run++) {
+        CleanerChar ** list;
+        size_t length = decodeTextList(data, size, text);
+        size_t capacity;
+
+        started = currentSeconds();
+        number = splitReference(text, &list);
+        splitOld += currentSeconds() - started;
+        for (i = 0; i < number; i++) {
+            free(list[i]);
+        }
+        free(list);
+
+        started = currentSeconds();
+        capacity = getLinesCapacity(text, length);
+        lines = (CleanerChar **) realloc(lines, capacity * sizeof(CleanerChar *));
+        number = splitTextList(text, length, lines, capacity);
+        splitNew += currentSeconds() - started;
+
+        for (i = 0; i < number; i++) {
+            depths[i] = getPathDepth(lines[i]);
+            marked[i] = (unsigned char) (i % 3 != 0);
+        }
+        started = currentSeconds();
+        orderReference(depths, marked, number, MAX_DEPTH, order);
+        orderOld += currentSeconds() - started;
+        started = currentSeconds();
+        orderDeepestFirst(depths, marked, number, MAX_DEPTH, counts, order);
+        orderNew += currentSeconds() - started;
+    }
+    printf("%lu entries, %lu bytes, %d runs\n", (unsigned long) number, (unsigned long) size, RUNS);
+    printf("  split, old            %9.3f ms\n", splitOld * 1000 / RUNS);
+    printf("  split, splitTextList  %9.3f ms\n", splitNew * 1000 / RUNS);
+    printf("  order, pass per depth %9.3f ms\n", orderOld * 1000 / RUNS);
+    printf("  order, counting sort  %9.3f ms\n", orderNew * 1000 / RUNS);
+    free(lines);
+    free(order);
+    free(marked);
+    free(depths);
+    free(text);
+    free(data);
+    return 0;
+}
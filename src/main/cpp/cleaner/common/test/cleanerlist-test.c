@@ -0,0 +1,231 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Unit tests of the list core of the cleaners, run by "make test" of the
+// Unix cleaner
+
+#include <stdio.h>
+#include <string.h>
+
+#include "cleanerlist.h"
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: %s failed\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+// the text list as the engine writes it : UTF-16 with BOM
+static size_t encode(const char * ascii, int bigEndian, int bom, char * data) {
+    size_t size = 0;
+    if (bom) {
+        data[size++] = bigEndian ? (char) 0xFE : (char) 0xFF;
+        data[size++] = bigEndian ? (char) 0xFF : (char) 0xFE;
+    }
+    for (; *ascii; ascii++) {
+        data[size++] = bigEndian ? 0 : *ascii;
+        data[size++] = bigEndian ? *ascii : 0;
+    }
+    return size;
+}
+
+static int equals(const CleanerChar * text, const char * ascii) {
+    while (*ascii && *text == (CleanerChar) *ascii) {
+        text++;
+        ascii++;
+    }
+    return *text == 0 && *ascii == 0;
+}
+
+static void testDecode(void) {
+    char data[64];
+    CleanerChar text[33];
+    size_t size;
+
+    size = encode("C:\\a", 1, 1, data);
+    CHECK(decodeTextList(data, size, text) == 4);
+    CHECK(equals(text, "C:\\a"));
+
+    size = encode("C:\\a", 0, 1, data);
+    CHECK(decodeTextList(data, size, text) == 4);
+    CHECK(equals(text, "C:\\a"));
+
+    size = encode("C:\\a", 0, 0, data);
+    CHECK(decodeTextList(data, size, text) == 4);
+    CHECK(equals(text, "C:\\a"));
+
+    // a dangling byte is dropped
+    size = encode("ab", 0, 1, data);
+    data[size++] = 'x';
+    CHECK(decodeTextList(data, size, text) == 2);
+    CHECK(equals(text, "ab"));
+
+    // non-ASCII units keep both bytes
+    data[0] = (char) 0xFE;
+    data[1] = (char) 0xFF;
+    data[2] = (char) 0x04;
+    data[3] = (char) 0x1F;
+    CHECK(decodeTextList(data, 4, text) == 1);
+    CHECK(text[0] == 0x041F);
+}
+
+static void testSplit(void) {
+    char data[256];
+    CleanerChar text[129];
+    CleanerChar * lines[8];
+    size_t length;
+    size_t capacity;
+
+    length = decodeTextList(data, encode("C:\\a\r\nC:\\a\\b\r\n\r\nC:\\c", 1, 1, data), text);
+    capacity = getLinesCapacity(text, length);
+    CHECK(capacity == 4);
+    CHECK(splitTextList(text, length, lines, capacity) == 3);
+    CHECK(equals(lines[0], "C:\\a"));
+    CHECK(equals(lines[1], "C:\\a\\b"));
+    CHECK(equals(lines[2], "C:\\c"));
+
+    // the trailing separator doesn't make an entry, a lone LF is a part of the name
+    length = decodeTextList(data, encode("a\nb\r\n", 1, 1, data), text);
+    CHECK(splitTextList(text, length, lines, getLinesCapacity(text, length)) == 1);
+    CHECK(equals(lines[0], "a\nb"));
+
+    length = decodeTextList(data, encode("a\r\nb\r\nc", 1, 1, data), text);
+    CHECK(splitTextList(text, length, lines, 2) == 2);
+    CHECK(equals(lines[1], "b"));
+
+    length = decodeTextList(data, encode("\r\n\r\n", 1, 1, data), text);
+    CHECK(splitTextList(text, length, lines, getLinesCapacity(text, length)) == 0);
+    CHECK(splitTextList(text, 0, lines, 1) == 0);
+}
+
+static size_t putEntry(char * data, size_t position, unsigned int depth, const char * path) {
+    size_t length = strlen(path);
+    unsigned int i;
+    for (i = 0; i < 4; i++) {
+        data[position + i] = (char) ((depth >> (8 * i)) & 0xFF);
+        data[position + 4 + i] = (char) ((length >> (8 * i)) & 0xFF);
+    }
+    memcpy(data + position + BINARY_ENTRY_HEADER, path, length + 1);
+    return position + BINARY_ENTRY_HEADER + length + 1;
+}
+
+static size_t putHeader(char * data, unsigned int number) {
+    unsigned int i;
+    memcpy(data, BINARY_LIST_MAGIC, 4);
+    for (i = 0; i < 4; i++) {
+        data[4 + i] = (char) ((BINARY_LIST_VERSION >> (8 * i)) & 0xFF);
+        data[8 + i] = (char) ((number >> (8 * i)) & 0xFF);
+    }
+    return BINARY_LIST_HEADER;
+}
+
+static void testBinaryList(void) {
+    char data[256];
+    char * index[8];
+    size_t size;
+
+    size = putHeader(data, 3);
+    size = putEntry(data, size, 1, "/tmp");
+    size = putEntry(data, size, 2, "/tmp/a");
+    size = putEntry(data, size, 3, "/tmp/a/b");
+    CHECK(isBinaryList(data, size));
+    CHECK(readListNumber(data + 8) == 3);
+    CHECK(getBinaryListCapacity(data, size) == 3);
+    CHECK(indexBinaryList(data, size, index, 8) == 3);
+    CHECK(strcmp(index[1] + BINARY_ENTRY_HEADER, "/tmp/a") == 0);
+    CHECK(readListNumber(index[2]) == 3);
+
+    // the index is never overrun
+    CHECK(indexBinaryList(data, size, index, 2) == 2);
+
+    // a truncated list keeps the complete entries
+    CHECK(indexBinaryList(data, size - 3, index, 8) == 2);
+
+    // the number of entries is bounded by the size
+    putHeader(data, 1000000);
+    CHECK(getBinaryListCapacity(data, size) <= (size - BINARY_LIST_HEADER) / (BINARY_ENTRY_HEADER + 1));
+    CHECK(indexBinaryList(data, size, index, 8) == 3);
+
+    // a depth larger than the path is damage
+    size = putHeader(data, 2);
+    size = putEntry(data, size, 1, "/tmp");
+    size = putEntry(data, size, 100, "/tmp/a");
+    CHECK(indexBinaryList(data, size, index, 8) == 1);
+
+    // missing terminator
+    size = putHeader(data, 1);
+    size = putEntry(data, size, 1, "/tmp");
+    data[size - 1] = 'x';
+    CHECK(indexBinaryList(data, size, index, 8) == 0);
+
+    memcpy(data, "NBCX", 4);
+    CHECK(!isBinaryList(data, size));
+    CHECK(getBinaryListCapacity(data, size) == 0);
+    CHECK(!isBinaryList(data, 4));
+}
+
+static void testDepth(void) {
+    CleanerChar path[32];
+    size_t i;
+    const char * ascii = "C:\\a/b\\c\\";
+    for (i = 0; ascii[i]; i++) {
+        path[i] = (CleanerChar) ascii[i];
+    }
+    path[i] = 0;
+    CHECK(getPathDepth(path) == 3);
+    path[0] = 0;
+    CHECK(getPathDepth(path) == 0);
+    CHECK(getUnixPathDepth("/tmp/a/b") == 3);
+    CHECK(getUnixPathDepth("/tmp/a/b/") == 3);
+    CHECK(getUnixPathDepth("/tmp/a\\b") == 2);
+    CHECK(getUnixPathDepth("a") == 0);
+}
+
+static void testOrder(void) {
+    unsigned int depths[] = { 1, 3, 2, 3, 0, 2, 5 };
+    unsigned char marked[] = { 1, 1, 1, 1, 1, 1, 0 };
+    size_t counts[8];
+    size_t order[7];
+    size_t expected[] = { 1, 3, 2, 5, 0, 4 };
+    size_t i;
+
+    CHECK(orderDeepestFirst(depths, marked, 7, 3, counts, order) == 6);
+    for (i = 0; i < 6; i++) {
+        CHECK(order[i] == expected[i]);
+    }
+    // nothing marked
+    memset(marked, 0, sizeof(marked));
+    CHECK(orderDeepestFirst(depths, marked, 7, 5, counts, order) == 0);
+    CHECK(orderDeepestFirst(depths, marked, 0, 0, counts, order) == 0);
+}
+
+int main(void) {
+    testDecode();
+    testSplit();
+    testBinaryList();
+    testDepth();
+    testOrder();
+    if (failures == 0) {
+        printf("cleanerlist tests passed\n");
+    }
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,420 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Native replacement of cleaner.sh, takes the same list file :
+//   cleaner <list> [pid]
+// The cleaner waits until the process <pid> (by default the parent process)
+// exits, at most PARENT_EXIT_TIMEOUT seconds.
+// The list contains one file or directory per line. It is read once and
+// deleted, then files and symlinks are deleted by a pool of workers and
+// directories afterwards, the deepest ones first. Every entry is tried
+// up to TRY_TIMES more times with WAIT_ON_ERROR seconds between the
+// attempts, as cleaner.sh does. The cleaner deletes itself at the end.
+//
+// The list can also be in the binary format of cleanerlist.h, which is
+// memory-mapped and used without parsing. The paths have no trailing
+// separator.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "cleanerlist.h"
+
+#define PARENT_EXIT_TIMEOUT 30
+#define PARENT_POLL_DELAY   50 // milliseconds
+#define WAIT_ON_ERROR  1
+#define TRY_TIMES      3
+
+#define MAXIMUM_THREADS       16
+#define THREADS_PER_PROCESSOR 4
+// entries taken by a worker at once, neighbours usually share the parent
+#define CHUNK_SIZE            64
+
+typedef struct _cleanerEntry {
+    char * path;
+    char * name;          // last component, within path
+    unsigned int depth;
+    int isDirectory;
+} CleanerEntry;
+
+typedef struct _cleanerJobs {
+    CleanerEntry * entries;
+    size_t number;
+    size_t next;
+    pthread_mutex_t lock;
+} CleanerJobs;
+
+// Worker state : descriptor of the last used parent directory
+typedef struct _parentDirectory {
+    char * path;
+    size_t length;
+    int fd;
+} ParentDirectory;
+
+static char * readList(const char * list, size_t * size) {
+    char * buf = NULL;
+    size_t length = 0;
+    size_t capacity = 0;
+    ssize_t n;
+    int fd = open(list, O_RDONLY);
+
+    if(fd < 0) return NULL;
+    do {
+        if(length + 1 >= capacity) {
+            char * tmp;
+            capacity = capacity ? capacity * 2 : 65536;
+            tmp = realloc(buf, capacity);
+            if(tmp == NULL) {
+                free(buf);
+                close(fd);
+                return NULL;
+            }
+            buf = tmp;
+        }
+        n = read(fd, buf + length, capacity - length - 1);
+        if(n > 0) length += (size_t) n;
+    } while(n > 0 || (n < 0 && errno == EINTR));
+    close(fd);
+    buf[length] = 0;
+    * size = length;
+    return buf;
+}
+
+// split the buffer in place, entries point into it
+static CleanerEntry * parseList(char * buf, size_t size, size_t * number) {
+    size_t lines = 1;
+    size_t i;
+    size_t count = 0;
+    char * ptr = buf;
+    CleanerEntry * entries;
+
+    for(i = 0; i < size; i++) {
+        if(buf[i] == '\n') lines++;
+    }
+    entries = calloc(lines, sizeof(CleanerEntry));
+    if(entries == NULL) return NULL;
+
+    while(ptr < buf + size) {
+        char * end = memchr(ptr, '\n', (size_t) (buf + size - ptr));
+        char * last;
+        size_t length;
+
+        if(end == NULL) end = buf + size;
+        * end = 0;
+        length = (size_t) (end - ptr);
+        if(length > 0 && ptr[length - 1] == '\r') ptr[--length] = 0;
+        // trailing separators do not change the entry
+        while(length > 1 && ptr[length - 1] == '/') ptr[--length] = 0;
+        if(length > 0) {
+            CleanerEntry * e = &entries[count++];
+            e->path = ptr;
+            e->name = ptr;
+            last = strrchr(ptr, '/');
+            if(last != NULL) e->name = last + 1;
+            e->depth = getUnixPathDepth(ptr);
+        }
+        ptr = end + 1;
+    }
+    * number = count;
+    return entries;
+}
+
+// entries point into the mapped list, nothing is copied. The depth is not
+// trusted : it is counted from the path, as the Windows cleaner does
+static CleanerEntry * parseBinaryList(char * map, size_t size, size_t * number) {
+    size_t capacity = getBinaryListCapacity(map, size);
+    char ** index = calloc(capacity + 1, sizeof(char *));
+    CleanerEntry * entries = calloc(capacity + 1, sizeof(CleanerEntry));
+    size_t count;
+    size_t i;
+
+    if(index == NULL || entries == NULL) {
+        free(index);
+        free(entries);
+        return NULL;
+    }
+    count = indexBinaryList(map, size, index, capacity);
+    for(i = 0; i < count; i++) {
+        CleanerEntry * e = &entries[i];
+        char * last;
+        e->path = index[i] + BINARY_ENTRY_HEADER;
+        e->depth = getUnixPathDepth(e->path);
+        last = strrchr(e->path, '/');
+        e->name = (last != NULL) ? last + 1 : e->path;
+    }
+    free(index);
+    * number = count;
+    return entries;
+}
+
+// descriptor of the parent directory of the entry, AT_FDCWD if it cannot be opened
+static int getParentDirectory(ParentDirectory * parent, CleanerEntry * e) {
+    size_t length = (size_t) (e->name - e->path);
+
+    if(length == 0) return AT_FDCWD;
+    if(parent->fd >= 0 && parent->length == length &&
+            memcmp(parent->path, e->path, length) == 0) {
+        return parent->fd;
+    }
+    if(parent->fd >= 0) close(parent->fd);
+    free(parent->path);
+    parent->path = malloc(length + 1);
+    parent->length = length;
+    parent->fd = -1;
+    if(parent->path == NULL) return AT_FDCWD;
+    memcpy(parent->path, e->path, length);
+    parent->path[length] = 0;
+    parent->fd = open(parent->path, O_RDONLY | O_DIRECTORY);
+    return parent->fd >= 0 ? parent->fd : AT_FDCWD;
+}
+
+static void deleteEntry(ParentDirectory * parent, CleanerEntry * e, int skipDirectories) {
+    int try = TRY_TIMES;
+
+    while(1) {
+        struct stat st;
+        int dirfd = getParentDirectory(parent, e);
+        const char * name = (dirfd == AT_FDCWD) ? e->path : e->name;
+        int result;
+
+        if(fstatat(dirfd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            // nothing to delete
+            return;
+        }
+        if(S_ISDIR(st.st_mode)) {
+            if(skipDirectories) {
+                e->isDirectory = 1;
+                return;
+            }
+            result = unlinkat(dirfd, name, AT_REMOVEDIR);
+        } else {
+            result = unlinkat(dirfd, name, 0);
+        }
+        if(result == 0 || errno == ENOENT || try-- <= 0) {
+            return;
+        }
+        sleep(WAIT_ON_ERROR);
+    }
+}
+
+static void * deleteFilesThread(void * ptr) {
+    CleanerJobs * jobs = (CleanerJobs *) ptr;
+    ParentDirectory parent;
+
+    parent.path = NULL;
+    parent.length = 0;
+    parent.fd = -1;
+    while(1) {
+        size_t start;
+        size_t end;
+        size_t i;
+
+        pthread_mutex_lock(&jobs->lock);
+        start = jobs->next;
+        jobs->next += CHUNK_SIZE;
+        pthread_mutex_unlock(&jobs->lock);
+        if(start >= jobs->number) break;
+
+        end = start + CHUNK_SIZE;
+        if(end > jobs->number) end = jobs->number;
+        for(i = start; i < end; i++) {
+            deleteEntry(&parent, &jobs->entries[i], 1);
+        }
+    }
+    if(parent.fd >= 0) close(parent.fd);
+    free(parent.path);
+    return NULL;
+}
+
+static void deleteDirectories(CleanerJobs * jobs) {
+    ParentDirectory parent;
+    unsigned int * depths;
+    unsigned char * marked;
+    size_t * counts;
+    size_t * order;
+    unsigned int maxDepth = 0;
+    size_t directories;
+    size_t i;
+
+    depths = malloc((jobs->number + 1) * sizeof(unsigned int));
+    marked = malloc(jobs->number + 1);
+    order = malloc((jobs->number + 1) * sizeof(size_t));
+    if(depths == NULL || marked == NULL || order == NULL) {
+        free(depths);
+        free(marked);
+        free(order);
+        return;
+    }
+    for(i = 0; i < jobs->number; i++) {
+        depths[i] = jobs->entries[i].depth;
+        marked[i] = (unsigned char) jobs->entries[i].isDirectory;
+        if(marked[i] && depths[i] > maxDepth) maxDepth = depths[i];
+    }
+    counts = malloc((maxDepth + 2) * sizeof(size_t));
+    directories = (counts != NULL) ?
+        orderDeepestFirst(depths, marked, jobs->number, maxDepth, counts, order) : 0;
+
+    parent.path = NULL;
+    parent.length = 0;
+    parent.fd = -1;
+    for(i = 0; i < directories; i++) {
+        deleteEntry(&parent, &jobs->entries[order[i]], 0);
+    }
+    if(parent.fd >= 0) close(parent.fd);
+    free(parent.path);
+    free(counts);
+    free(order);
+    free(marked);
+    free(depths);
+}
+
+static void deleteFiles(CleanerEntry * entries, size_t number) {
+    CleanerJobs jobs;
+    pthread_t threads[MAXIMUM_THREADS];
+    size_t threadsNumber = 0;
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t workers;
+    size_t i;
+
+    jobs.entries = entries;
+    jobs.number = number;
+    jobs.next = 0;
+    pthread_mutex_init(&jobs.lock, NULL);
+
+    workers = (processors > 0 ? (size_t) processors : 1) * THREADS_PER_PROCESSOR;
+    if(workers > MAXIMUM_THREADS) workers = MAXIMUM_THREADS;
+    if(workers > (number + CHUNK_SIZE - 1) / CHUNK_SIZE) {
+        workers = (number + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    }
+    for(i = 1; i < workers; i++) {
+        if(pthread_create(&threads[threadsNumber], NULL, &deleteFilesThread, &jobs) == 0) {
+            threadsNumber++;
+        }
+    }
+    deleteFilesThread(&jobs);
+    for(i = 0; i < threadsNumber; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&jobs.lock);
+
+    deleteDirectories(&jobs);
+}
+
+static int isProcessAlive(pid_t pid, pid_t parent) {
+    // reparenting means that the parent is gone even if it is not reaped yet
+    if(pid == parent && getppid() != parent) return 0;
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+static void waitForProcess(pid_t pid, pid_t parent) {
+    struct timespec delay;
+    long waited = 0;
+
+    if(pid <= 1) return;
+#if defined(__linux__) && defined(SYS_pidfd_open)
+    {
+        int fd = (int) syscall(SYS_pidfd_open, pid, 0);
+        if(fd >= 0) {
+            struct pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            while(poll(&pfd, 1, PARENT_EXIT_TIMEOUT * 1000) < 0 && errno == EINTR);
+            close(fd);
+            return;
+        }
+        if(errno == ESRCH) return;
+    }
+#endif
+    delay.tv_sec = 0;
+    delay.tv_nsec = PARENT_POLL_DELAY * 1000000L;
+    while(isProcessAlive(pid, parent) && waited < PARENT_EXIT_TIMEOUT * 1000L) {
+        nanosleep(&delay, NULL);
+        waited += PARENT_POLL_DELAY;
+    }
+}
+
+int main(int argc, char ** argv) {
+    pid_t parent = getppid();
+
+    if(argc == 2 || argc == 3) {
+        size_t size = 0;
+        size_t number = 0;
+        char * buf;
+        pid_t pid = (argc == 3) ? (pid_t) atol(argv[2]) : parent;
+
+        int fd;
+        struct stat st;
+
+        // wait for the installer to finish...
+        waitForProcess(pid, parent);
+
+        fd = open(argv[1], O_RDONLY);
+        if(fd >= 0 && fstat(fd, &st) == 0 && st.st_size >= BINARY_LIST_HEADER) {
+            char * map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(map != MAP_FAILED) {
+                if(isBinaryList(map, (size_t) st.st_size)) {
+                    CleanerEntry * entries;
+                    close(fd);
+                    fd = -1;
+                    unlink(argv[1]);
+                    entries = parseBinaryList(map, (size_t) st.st_size, &number);
+                    if(entries != NULL) {
+                        deleteFiles(entries, number);
+                        free(entries);
+                    }
+                }
+                munmap(map, (size_t) st.st_size);
+            }
+        }
+        if(fd < 0) {
+            // binary list is processed or there is no list at all
+            buf = NULL;
+        } else {
+            close(fd);
+            buf = readList(argv[1], &size);
+        }
+        if(buf != NULL) {
+            CleanerEntry * entries;
+            unlink(argv[1]);
+            entries = parseList(buf, size, &number);
+            if(entries != NULL) {
+                deleteFiles(entries, number);
+                free(entries);
+            }
+            free(buf);
+        }
+    }
+    unlink(argv[0]);
+    return 0;
+}
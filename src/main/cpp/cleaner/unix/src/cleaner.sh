@@ -18,6 +18,25 @@
 # under the License.
 # 
 
+# The native cleaner is shipped next to the script, without the .sh suffix.
+# It takes the same arguments and deletes the list and itself. The script
+# goes on only if the binary can't run here.
+runNativeCleaner() {
+	nativeCleaner=`echo "$0" | sed 's/\.sh$//'`
+	if [ "$nativeCleaner" != "$0" ] && [ -f "$nativeCleaner" ] && [ -n "$1" ] ; then
+		nativePid="$2"
+		if [ -z "$nativePid" ] ; then
+			nativePid="$PPID"
+		fi
+		chmod u+x "$nativeCleaner" > /dev/null 2>&1
+		if "$nativeCleaner" "$1" "$nativePid" > /dev/null 2>&1 ; then
+			rm -f "$0"
+			exit 0
+		fi
+		rm -f "$nativeCleaner" > /dev/null 2>&1
+	fi
+}
+
 deleteFiles() {
         testSymlinkErr=`test -L / > /dev/null`
         if [ -z "$testSymlinkErr" ] ; then
@@ -26,8 +45,21 @@ deleteFiles() {
             isSymlink=-h
         fi
 
-	#wait for main thread to finish...
-	sleep 3
+	#wait for the installer process to finish, at most 30 seconds
+	waitPid="$2"
+	if [ -z "$waitPid" ] ; then
+		waitPid="$PPID"
+	fi
+	waitDelay=1
+	waitTimes=30
+	if sleep 0.1 > /dev/null 2>&1 ; then
+		waitDelay=0.1
+		waitTimes=300
+	fi
+	while [ $waitTimes -gt 0 ] && [ "$waitPid" -gt 1 ] 2>/dev/null && kill -0 "$waitPid" > /dev/null 2>&1 ; do
+		sleep $waitDelay
+		waitTimes=`expr "$waitTimes" - 1`
+	done
 	waitOnError=1
 	tryTimes=3
 	list="$1"
@@ -89,4 +121,5 @@ deleteFiles() {
 	fi
 }
 
+runNativeCleaner "$@"
 deleteFiles "$@"
@@ -18,8 +18,11 @@
  */
 
 #include <windows.h>
+#include <tlhelp32.h>
 #include <wchar.h>
 
+#include "cleanerlist.h"
+
 
 /*
  * cleaner.exe
@@ -29,6 +32,8 @@
  * The command line syntax is:
  * 
  *    arg1:   File name containing a list of files/folders to delete.
+ *    arg2:   (optional) Id of the process to wait for before deleting. 
+ *            By default it is the parent process, i.e. the installer JVM.
  * 
  * Requirements for arg1:
  *  - The arg1 file name MUST be fully qualified. (or be in the same directory
@@ -44,29 +49,30 @@
  *          of 260 chars for a path name.
  *        - a UNC, e.g. "\\servername\sharename\foo\bar", subject to a
  *          restriction of 260 chars.
- *  - The list MUST be ordered so that the files in a folder are listed before 
- *    the folder itself. (it is not possible to delete a non-empty folder)
+ *  - Alternatively the file can be in the binary format, see cleanerlist.h.
+ *  - The order of the list does not matter. Folders are deleted after all 
+ *    the files, deepest first. (it is not possible to delete a non-empty folder)
  * 
  * Method of working:
  * 
  * 1. After launch the content of command line arg1 is read into memory 
- *    as one big string.
- * 2. The string is chopped into a list by separating at the LINE_SEPARATOR.
- * 3. Sleep for 2 seconds to allow the launching process (the JVM) to exit.
- * 4. Loop over the list of files/folder to delete. Each file-delete operation 
- *    is spawned into a thread of its own up to a maximum of 64 threads. 
- *    Therefore the delete operations happens in parallel rather than in sequence. 
- *    If 64 threads have been spawned then wait for a thread to exit before
- *    spawning a new one. (therefore never more than 64 threads)
- *    For each file delete operation do the following:
+ *    as one big string. (the binary list is memory-mapped instead)
+ * 2. The string is chopped into a list by separating at CRLF, in place.
+ *    (the binary list is only indexed) The parsing and the ordering of the
+ *    directories are done by the portable core in cleaner/common, which is
+ *    unit-tested on Linux with the Unix cleaner.
+ * 3. Wait for the launching process (the JVM) to exit, at most 30 seconds.
+ * 4. A fixed pool of worker threads (a few per processor, never more than 64)
+ *    takes the entries of the list one by one. For each entry:
  *       - Check to see if the file exists (by getting its attributes)
- *       - If file: delete file, if directory: delete directory (these are two 
- *            different calls in the Win32 API).
- *       - Attempt to delete each file/dir up to 15 times sleeping for 200 ms 
+ *       - If file: delete it, attempting up to 15 times sleeping for 200 ms 
  *            between each attempt.
- * 5. Wait for all file-delete threads to exit.
- * 6. Delete self, i.e. the "cleaner.exe" executable.
- * 7. End
+ *       - If directory: leave it for the next step.
+ * 5. Wait for all workers to exit.
+ * 6. Delete the directories, the deepest ones first, so that every directory
+ *    is already empty when it is deleted. The same retry rules apply.
+ * 7. Delete self, i.e. the "cleaner.exe" executable.
+ * 8. End
  *
  * The arg1 file is not deleted. However it can be part of the list itself 
  * if need be.
@@ -89,16 +95,22 @@
 //   MAX_ATTEMPTS : how many times to attempt to delete a file
 const DWORD SLEEP_DELAY   = 200;
 const DWORD MAX_ATTEMPTS   = 15;
-const DWORD THREAD_FINISHED = 100;
 
-// Number of milliseconds to sleep at launch of the application.
-const DWORD INITIAL_DELAY = 2000; // 2 seconds seems to be enough to finish java process
+// Maximum number of milliseconds to wait for the launching process to exit.
+const DWORD PARENT_EXIT_TIMEOUT = 30000;
+
+// Size of the pool of workers : should be less or equals to MAXIMUM_WAIT_OBJECTS
+#define MAXIMUM_THREADS MAXIMUM_WAIT_OBJECTS
+#define THREADS_PER_PROCESSOR 4
 
-const WCHAR * LINE_SEPARATOR = L"\r\n";
 const WCHAR * UNC_PREFIX     = L"\\\\?\\"; // Prefix for extended-length path in Win32 API
 const WCHAR * UNC_STD_PREFIX = L"\\\\";  // Prefix for UNC paths, for example: \\servername\share\foo\bar
 const DWORD UNC_PREFIX_LENGTH = 4;
 
+// Maximum length of an entry, the buffer has also space for the prefix
+#define MAX_ENTRY_LENGTH 32767
+#define ENTRY_BUFFER_LENGTH (MAX_ENTRY_LENGTH + 5)
+
 #ifdef _MSC_VER
 #define ZERO(x,y) SecureZeroMemory((x),(y));
 #else
@@ -135,156 +147,78 @@ WCHAR * search( const WCHAR * wcs1, const WCHAR * wcs2) {
 }
 
 
-typedef struct _list {
-    WCHAR * item;
-    struct _list * next;
-} LIST;
-
-
-WCHAR * toWCHAR(char * charBuffer, DWORD size) {
-    DWORD i=0;
-    WCHAR * buffer;
-    BOOL hasBOM        = (*charBuffer == '\xFF' && *(charBuffer+1) == '\xFE');
-    BOOL hasReverseBOM = (*charBuffer == '\xFE' && *(charBuffer+1) == '\xFF');
-    
-    char * realStringPtr = charBuffer;
-    if (hasBOM || hasReverseBOM) {
-        size-= 2;
-        realStringPtr+= 2;
-        if(hasReverseBOM) {
-            char c;
-            for (i = 0 ; i < size/2 ; i++) {
-                c = charBuffer [2 * i] ;
-                charBuffer [2 * i] = charBuffer [2 * i + 1] ;
-                charBuffer [2 * i + 1] = c;
-            }
-        }
-    }
-    
-    buffer = (WCHAR*) LocalAlloc(LPTR, sizeof(WCHAR) * (size/2+1));
-    ZERO(buffer, sizeof(WCHAR) * (size/2+1));
-    for(i=0;i<size/2;i++) {
-        realStringPtr[2*i] = (realStringPtr[2*i]) & 0xFF;
-        realStringPtr[2*i+1] = (realStringPtr[2*i+1])& 0xFF;
-        buffer [i] = ((unsigned char)realStringPtr[2*i]) + (((unsigned char)realStringPtr[2*i+1]) << 8);
-    }
-    
-    return buffer;
-}
-
 /*
- * Gets the number of lines in the input. 
- * (lines are expected to be separated by LINE_SEPARATOR) 
+ *  Reads the text list into memory and splits it into lines. 
+ *  The lines point into the text, which is freed by the caller.
  */
-DWORD getLinesNumber(WCHAR *str) {
-    DWORD result = 0;
-    WCHAR *ptr = str;
-    WCHAR *ptr2 = str;
-    DWORD sepLength = lstrlenW(LINE_SEPARATOR);
-    if(ptr!=NULL) {
-        while((ptr2 = search(ptr, LINE_SEPARATOR))!=NULL) {
-            ptr = ptr2 + sepLength;
-            result++;
-            
-            if(ptr==NULL)  break;
-        }
-        if(ptr!=NULL && lstrlenW(ptr) > 0) {
-            result ++;
+void readStringList(HANDLE fileHandle, WCHAR ** text, WCHAR *** list, DWORD *number) {
+    DWORD size = GetFileSize(fileHandle, NULL); // hope it much less than 2GB
+    DWORD read = 0;
+    char * charBuffer = (char*) LocalAlloc(LPTR, sizeof(char) * (size + 2));
+    
+    if(charBuffer != NULL && ReadFile(fileHandle, charBuffer, size, &read, 0) && read >=2) {
+        *text = (WCHAR*) LocalAlloc(LPTR, sizeof(WCHAR) * (read / 2 + 1));
+        if(*text != NULL) {
+            DWORD length = decodeTextList(charBuffer, read, *text);
+            DWORD capacity = getLinesCapacity(*text, length);
+            *list = (WCHAR**) LocalAlloc(LPTR, sizeof(WCHAR*) * capacity);
+            if(*list != NULL) {
+                *number = splitTextList(*text, length, *list, capacity);
+            }
         }
     }
-    return result;
+    if(charBuffer != NULL) LocalFree(charBuffer);
 }
 
 /*
- * Produces a string array, 'list', from 'str' by splitting the string
- * at each occurrence of LINE_SEPARATOR.
+ * Indexes the memory-mapped binary list, see cleanerlist.h. Nothing is 
+ * copied : 'entries' point to the headers of the entries within the mapped
+ * file. The depth is not trusted : the depth of a directory is counted 
+ * from its path.
  * 
- * [IN] str:      the input
- * [OUT] list:    string array
- * [OUT] number:  number of elements in 'list' 
- *
+ * Returns FALSE if the data is not a binary list.
  */
-void getLines(WCHAR *str, WCHAR *** list, DWORD * number) {
-    WCHAR *ptr = str;
-    WCHAR *ptr2 = NULL;
-    DWORD length = 0;
-    DWORD sepLength = lstrlenW(LINE_SEPARATOR);
-    DWORD counter = 0;
-    *number = getLinesNumber(str);
-    *list = (WCHAR**) LocalAlloc(LPTR, sizeof(WCHAR*) * (*number));
+BOOL readBinaryList(char * data, DWORD size, char *** entries, DWORD * number) {
+    DWORD capacity;
     
-    if(ptr!=NULL) {
-        while(counter < (*number)) {
-            DWORD i = 0 ;
-            if((ptr2 = search(ptr, LINE_SEPARATOR))!=NULL) {
-                ptr2 = search(ptr, LINE_SEPARATOR) + sepLength;
-                length = lstrlenW(ptr) - lstrlenW(ptr2) - sepLength;
-                (*list) [counter ] = (WCHAR*) LocalAlloc(LPTR, sizeof(WCHAR*)*(length+1));
-                ZERO((*list) [counter ], sizeof(WCHAR*)*(length+1));
-                for(i=0;i<length;i++) {
-                    (*list) [counter ][i]=ptr[i];
-                }
-                ptr = ptr2;
-            } else if((length = lstrlenW(ptr)) > 0) {
-                (*list)[counter ] = (WCHAR*) LocalAlloc(LPTR, sizeof(WCHAR*)*(length+1));
-                ZERO((*list) [counter ], sizeof(WCHAR*)*(length+1));
-                for(i=0;i<length;i++) {
-                    (*list) [counter ][i]=ptr[i];
-                }
-                ptr = NULL;
-            }
-            counter++;
-            if(ptr==NULL)  break;
-        }
+    if(!isBinaryList(data, size)) {
+        return FALSE;
     }
+    capacity = getBinaryListCapacity(data, size);
+    *entries = (char**) LocalAlloc(LPTR, sizeof(char*) * (capacity + 1));
+    *number = (*entries != NULL) ? indexBinaryList(data, size, *entries, capacity) : 0;
+    return TRUE;
 }
 
 /*
- *  Read file into memory. 
+ * Deletes the file or the directory. The path is already prefixed for the
+ * extended-length form if needed.
+ * If 'skipDirectories' is set then a directory is not deleted and TRUE is 
+ * returned, so that it could be deleted later when it is empty.
  */
-void readStringList(HANDLE fileHandle, WCHAR *** list, DWORD *number) {
-    DWORD size = GetFileSize(fileHandle, NULL); // hope it much less than 2GB
-    DWORD read = 0;
-    char * charBuffer = (char*) LocalAlloc(LPTR, sizeof(char) * (size + 2));
-    ZERO(charBuffer, sizeof(char) * (size + 2));
-    
-    if(ReadFile(fileHandle, charBuffer, size, &read, 0) && read >=2) {
-        WCHAR * buffer = toWCHAR(charBuffer, size + 2);
-        getLines(buffer, list, number);
-        LocalFree(buffer);
-    }
-    LocalFree(charBuffer);
-}
-
-void deleteFile(WCHAR * filePath) {
+BOOL deleteFile(WCHAR * file, BOOL skipDirectories) {
     BOOL canDelete = TRUE;
+    BOOL isDirectory = FALSE;
     DWORD count = 0 ;
     WIN32_FILE_ATTRIBUTE_DATA attrs;
-    DWORD filePathLength = lstrlenW(filePath);
-    DWORD prefixLength = (filePath == search(filePath, UNC_STD_PREFIX)) ? 0 : UNC_PREFIX_LENGTH;
-    DWORD length = filePathLength + prefixLength + 1;
-    WCHAR * file = (WCHAR*) LocalAlloc(LPTR, sizeof(WCHAR) * length);
-    DWORD i=0;
-    for(i=0;i<prefixLength;i++) {
-        file[i]=UNC_PREFIX[i];
-    }
-    for(i=0;i<filePathLength;i++) {
-        file[i+prefixLength] = filePath[i];
-    }
 
     // Implementation note:
     // GetFileAttributesExW() is used not only to get file attributes
     // but also as a way to check if the file/dir (still) exist.
 
     if(GetFileAttributesExW(file, GetFileExInfoStandard, &attrs)) {
-      if (attrs.dwFileAttributes & FILE_ATTRIBUTE_READONLY) { // if read-only attrib is set
+        isDirectory = (attrs.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ? TRUE : FALSE;
+        if (isDirectory && skipDirectories) {
+            return TRUE;
+        }
+        if (attrs.dwFileAttributes & FILE_ATTRIBUTE_READONLY) { // if read-only attrib is set
             if (SetFileAttributesW(file, FILE_ATTRIBUTE_NORMAL) == 0) { // remove read-only attrib
                 // The read-only attrib could not be deleted. No point in continuing.
                 canDelete = FALSE;
             }
         }
         if (canDelete) {
-            if (attrs.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            if (isDirectory) {
                 while ((!RemoveDirectoryW(file) || GetFileAttributesExW(file, GetFileExInfoStandard, &attrs)) &&
                         ((count++) < MAX_ATTEMPTS)) {
                     Sleep(SLEEP_DELAY);
@@ -297,36 +231,217 @@ void deleteFile(WCHAR * filePath) {
             }
         }
     }
-    LocalFree(file);
+    return FALSE;
 }
 
-DWORD WINAPI deleteFileThread(void * ptr) {
-    WCHAR * file = (WCHAR*) ptr;
-    deleteFile(file);
-    return THREAD_FINISHED;
+typedef struct _jobs {
+    WCHAR ** files;           // text list
+    char ** entries;          // binary list : entries in the mapped file
+    DWORD number;
+    BOOL * directories;       // entries left for the second pass
+    volatile LONG next;       // next entry to be taken by a worker
+} JOBS;
+
+typedef struct _listFile {
+    HANDLE file;
+    HANDLE mapping;
+    char * data;
+} LIST_FILE;
+
+/*
+ * Unmaps and closes the list, it is deleted when the last handle is closed.
+ */
+void closeListFile(LIST_FILE * list) {
+    if(list->data != NULL) {
+        UnmapViewOfFile(list->data);
+        list->data = NULL;
+    }
+    if(list->mapping != NULL) {
+        CloseHandle(list->mapping);
+        list->mapping = NULL;
+    }
+    if(list->file != INVALID_HANDLE_VALUE) {
+        CloseHandle(list->file);
+        list->file = INVALID_HANDLE_VALUE;
+    }
 }
 
-void getFreeIndexForNextThread(HANDLE * list, DWORD max, DWORD * counter) {
-    DWORD code = 0;
-    DWORD maxReached = 0;
+/*
+ * Puts the path of the entry to the buffer with the extended-length prefix
+ * if needed, so no allocation is done per entry.
+ * Returns the length of the path, 0 for an empty or too long entry.
+ */
+DWORD getEntryPath(JOBS * jobs, DWORD index, WCHAR * buffer) {
+    DWORD prefixLength = UNC_PREFIX_LENGTH;
+    DWORD length = 0;
+    DWORD i;
+    if(jobs->entries!=NULL) {
+        char * path = jobs->entries[index] + BINARY_ENTRY_HEADER;
+        DWORD pathLength = readListNumber(jobs->entries[index] + 4);
+        if(pathLength >= 2 && path[0]=='\\' && path[1]=='\\') prefixLength = 0;
+        if(pathLength > 0) {
+            length = MultiByteToWideChar(CP_UTF8, 0, path, pathLength, buffer + prefixLength, MAX_ENTRY_LENGTH);
+        }
+    } else if(jobs->files[index]!=NULL) {
+        WCHAR * path = jobs->files[index];
+        if(path == search(path, UNC_STD_PREFIX)) prefixLength = 0;
+        length = lstrlenW(path);
+        if(length > MAX_ENTRY_LENGTH) length = 0;
+        for(i=0;i<length;i++) {
+            buffer[i + prefixLength] = path[i];
+        }
+    }
+    if(length == 0) return 0;
+    for(i=0;i<prefixLength;i++) {
+        buffer[i] = UNC_PREFIX[i];
+    }
+    buffer[prefixLength + length] = 0;
+    return prefixLength + length;
+}
+
+/*
+ * Worker of the pool : takes the next entry from the list until the list 
+ * is exhausted. Directories are only marked.
+ */
+DWORD WINAPI deleteFilesThread(void * ptr) {
+    JOBS * jobs = (JOBS*) ptr;
+    LONG index;
+    WCHAR buffer[ENTRY_BUFFER_LENGTH];
+    while((index = InterlockedIncrement(&jobs->next) - 1) < (LONG) jobs->number) {
+        if(getEntryPath(jobs, index, buffer) > 0) {
+            jobs->directories[index] = deleteFile(buffer, TRUE);
+        }
+    }
+    return 0;
+}
+
+/*
+ * Deletes the directories marked by the workers, the deepest ones first.
+ */
+void deleteDirectories(JOBS * jobs) {
+    unsigned int * depths = (unsigned int*) LocalAlloc(LPTR, sizeof(unsigned int) * (jobs->number + 1));
+    unsigned char * marked = (unsigned char*) LocalAlloc(LPTR, sizeof(unsigned char) * (jobs->number + 1));
+    size_t * order = (size_t*) LocalAlloc(LPTR, sizeof(size_t) * (jobs->number + 1));
+    WCHAR * buffer = (WCHAR*) LocalAlloc(LPTR, sizeof(WCHAR) * ENTRY_BUFFER_LENGTH);
+    size_t * counts;
+    unsigned int maxDepth = 0;
+    size_t ordered;
+    DWORD i;
     
-    while(1) {
-        if((*counter)==max) {
-            maxReached = 1;
-            *counter = 0;
+    if(depths == NULL || marked == NULL || order == NULL || buffer == NULL) {
+        if(depths != NULL) LocalFree(depths);
+        if(marked != NULL) LocalFree(marked);
+        if(order != NULL) LocalFree(order);
+        if(buffer != NULL) LocalFree(buffer);
+        return;
+    }
+    for(i=0;i<jobs->number;i++) {
+        if(jobs->directories[i] && getEntryPath(jobs, i, buffer) > 0) {
+            marked[i] = 1;
+            depths[i] = getPathDepth(buffer);
+            if(depths[i] > maxDepth) maxDepth = depths[i];
+        }
+    }
+    counts = (size_t*) LocalAlloc(LPTR, sizeof(size_t) * (maxDepth + 2));
+    if(counts != NULL) {
+        ordered = orderDeepestFirst(depths, marked, jobs->number, maxDepth, counts, order);
+        for(i=0;i<ordered;i++) {
+            if(getEntryPath(jobs, (DWORD) order[i], buffer) > 0) {
+                deleteFile(buffer, FALSE);
+            }
         }
-        code = 0;
-        if(list[*counter]==INVALID_HANDLE_VALUE) {
-            break;
-        } else if(GetExitCodeThread(list[*counter], &code)!=0 && code==THREAD_FINISHED) {
-            break;
-        } else {
-            *counter = (*counter) + 1;
-            if((*counter)==max && maxReached == 1) {
-                *counter = WaitForMultipleObjects(max, list, FALSE, INFINITE) - WAIT_OBJECT_0;
+        LocalFree(counts);
+    }
+    LocalFree(buffer);
+    LocalFree(order);
+    LocalFree(marked);
+    LocalFree(depths);
+}
+
+/*
+ * Copies the paths of the directories marked in the binary list, so that 
+ * the list could be closed before the directories are deleted.
+ */
+WCHAR ** copyDirectoryEntries(JOBS * jobs) {
+    WCHAR ** files = (WCHAR**) LocalAlloc(LPTR, sizeof(WCHAR*) * (jobs->number + 1));
+    DWORD i;
+    if(files == NULL) return NULL;
+    
+    for(i=0;i<jobs->number;i++) {
+        if(jobs->directories[i]) {
+            char * path = jobs->entries[i] + BINARY_ENTRY_HEADER;
+            DWORD pathLength = readListNumber(jobs->entries[i] + 4);
+            int length = (pathLength > 0) ? MultiByteToWideChar(CP_UTF8, 0, path, pathLength, NULL, 0) : 0;
+            if(length > 0) {
+                files[i] = (WCHAR*) LocalAlloc(LPTR, sizeof(WCHAR) * (length + 1));
+                if(files[i] != NULL) {
+                    MultiByteToWideChar(CP_UTF8, 0, path, pathLength, files[i], length);
+                }
             }
         }
     }
+    return files;
+}
+
+/*
+ * Deletes all the entries of the list by a fixed pool of workers.
+ * The list is closed before the directories are deleted, it could be
+ * in one of them.
+ */
+void deleteFiles(WCHAR ** files, char ** entries, DWORD number, LIST_FILE * list) {
+    WCHAR ** copies = NULL;
+    HANDLE threads[MAXIMUM_THREADS];
+    DWORD threadsNumber = 0;
+    DWORD workers = 0;
+    DWORD dwThread;
+    DWORD i;
+    SYSTEM_INFO info;
+    JOBS jobs;
+    
+    ZERO(&jobs, sizeof(JOBS));
+    jobs.files = files;
+    jobs.entries = entries;
+    jobs.number = number;
+    jobs.directories = (BOOL*) LocalAlloc(LPTR, sizeof(BOOL) * (number + 1));
+    
+    // deleting is mostly waiting for the disk and for locked files, 
+    // so several workers per processor are used
+    GetSystemInfo(&info);
+    workers = info.dwNumberOfProcessors * THREADS_PER_PROCESSOR;
+    if(workers > MAXIMUM_THREADS) workers = MAXIMUM_THREADS;
+    if(workers > number) workers = number;
+    
+    for(i=0;i<workers;i++) {
+        HANDLE thread = CreateThread(NULL, 0, &deleteFilesThread, (LPVOID) &jobs, 0, &dwThread);
+        if(thread==NULL) break;
+        threads[threadsNumber++] = thread;
+    }
+    if(threadsNumber==0) {
+        deleteFilesThread(&jobs);
+    } else {
+        WaitForMultipleObjects(threadsNumber, threads, TRUE, INFINITE);
+        for(i=0;i<threadsNumber;i++) {
+            CloseHandle(threads[i]);
+        }
+    }
+    if(jobs.entries != NULL) {
+        copies = copyDirectoryEntries(&jobs);
+    }
+    if(copies != NULL) {
+        jobs.files = copies;
+        jobs.entries = NULL;
+        closeListFile(list);
+    } else if(jobs.entries == NULL) {
+        closeListFile(list);
+    }
+    deleteDirectories(&jobs);
+    if(copies != NULL) {
+        for(i=0;i<number;i++) {
+            if(copies[i]!=NULL) LocalFree(copies[i]);
+        }
+        LocalFree(copies);
+    }
+    LocalFree(jobs.directories);
 }
 
 /*
@@ -396,6 +511,64 @@ void removeItselfUsingCmd() {
     
 }
 
+/*
+ * Gets the id of the process which started the current one, 0 if not found.
+ */
+DWORD getParentProcessId() {
+    DWORD parentId = 0;
+    DWORD currentId = GetCurrentProcessId();
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if(snapshot != INVALID_HANDLE_VALUE) {
+        PROCESSENTRY32W entry;
+        entry.dwSize = sizeof(PROCESSENTRY32W);
+        if(Process32FirstW(snapshot, &entry)) {
+            do {
+                if(entry.th32ProcessID == currentId) {
+                    parentId = entry.th32ParentProcessID;
+                    break;
+                }
+            } while(Process32NextW(snapshot, &entry));
+        }
+        CloseHandle(snapshot);
+    }
+    return parentId;
+}
+
+/*
+ * Parses the process id argument, 0 if it is not a number.
+ */
+DWORD parseProcessId(WCHAR * str) {
+    DWORD result = 0;
+    WCHAR * ptr;
+    for(ptr = str; *ptr; ptr++) {
+        if(*ptr < L'0' || *ptr > L'9') return 0;
+        result = result * 10 + (*ptr - L'0');
+    }
+    return result;
+}
+
+/*
+ * Waits for the process to exit. Deletion can start right after that
+ * instead of guessing how long the process needs to finish.
+ */
+void waitForProcess(DWORD processId) {
+    HANDLE process;
+    if(processId == 0) return;
+    
+    process = OpenProcess(SYNCHRONIZE | PROCESS_QUERY_INFORMATION, FALSE, processId);
+    if(process != NULL) {
+        FILETIME creation, ownCreation, tmp1, tmp2, tmp3;
+        // the id could be reused if the process is already gone : 
+        // only a process started before the cleaner is waited for
+        if(GetProcessTimes(process, &creation, &tmp1, &tmp2, &tmp3) &&
+                GetProcessTimes(GetCurrentProcess(), &ownCreation, &tmp1, &tmp2, &tmp3) &&
+                CompareFileTime(&creation, &ownCreation) <= 0) {
+            WaitForSingleObject(process, PARENT_EXIT_TIMEOUT);
+        }
+        CloseHandle(process);
+    }
+}
+
 /*
  * Changes directory to the directory where the currently executing
  * executable is located.
@@ -422,63 +595,59 @@ void changeCurrentDirectory() {
     LocalFree(currentFile);
 }
 
-// should be less or equals to MAXIMUM_WAIT_OBJECTS
-#define MAXIMUM_THREADS MAXIMUM_WAIT_OBJECTS
-
 int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hi, PSTR pszCmdLine, int nCmdShow) {
     UNREFERENCED_PARAMETER(hInstance);
     UNREFERENCED_PARAMETER(hi);
     UNREFERENCED_PARAMETER(pszCmdLine);
     UNREFERENCED_PARAMETER(nCmdShow);
     int argumentsNumber = 0;
-    DWORD i=0;
-    DWORD  threadCounter = 0;
-    DWORD dwThread;
     WCHAR ** commandLine = CommandLineToArgvW(GetCommandLineW(), &argumentsNumber);
-    HANDLE * runningThreads = (HANDLE *) LocalAlloc(LPTR, sizeof(HANDLE) * MAXIMUM_THREADS);
+    DWORD parentId = getParentProcessId();
     
-    for(i=0;i<MAXIMUM_THREADS;i++) {
-        runningThreads[i] = INVALID_HANDLE_VALUE;
-    }
     changeCurrentDirectory();
     
-    if(argumentsNumber==2) {
+    if(argumentsNumber==2 || argumentsNumber==3) {
         WCHAR * filename = commandLine[1];
-        HANDLE fileList = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 0, OPEN_EXISTING, FILE_FLAG_DELETE_ON_CLOSE, 0);
-        if(fileList!=0) {
+        LIST_FILE list;
+        list.file = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 0, OPEN_EXISTING, FILE_FLAG_DELETE_ON_CLOSE, 0);
+        list.mapping = NULL;
+        list.data = NULL;
+        if(list.file!=INVALID_HANDLE_VALUE) {
             WCHAR ** files = NULL;
+            WCHAR * text = NULL;
+            char ** entries = NULL;
             DWORD number = 0;
-            DWORD allThreadsUsed=0;
-            readStringList(fileList, &files, &number);
-            CloseHandle(fileList);
+            DWORD size = GetFileSize(list.file, NULL);
+            list.mapping = (size >= BINARY_LIST_HEADER) ? CreateFileMappingW(list.file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+            list.data = (list.mapping != NULL) ? (char*) MapViewOfFile(list.mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
             
-            if(files!=NULL) {
-                Sleep(INITIAL_DELAY);
-                for(i=0;i<number;i++) {
-                    WCHAR * file = files[i];
-                    if(file!=NULL) {
-                        if(lstrlenW(file)>0)  {
-                            getFreeIndexForNextThread(runningThreads, MAXIMUM_THREADS, &threadCounter);
-                            runningThreads [threadCounter] = CreateThread( NULL, 0, &deleteFileThread, (LPVOID) file, 0, &dwThread );
-                            threadCounter++;
-                            if(threadCounter==MAXIMUM_THREADS) allThreadsUsed = 1;
-                        }
-                    }
-                }
-                
-                WaitForMultipleObjects(allThreadsUsed ? MAXIMUM_THREADS : threadCounter,
-                        runningThreads, TRUE, INFINITE);
+            if(list.data == NULL || !readBinaryList(list.data, size, &entries, &number)) {
+                if(list.data != NULL) UnmapViewOfFile(list.data);
+                if(list.mapping != NULL) CloseHandle(list.mapping);
+                list.data = NULL;
+                list.mapping = NULL;
+                readStringList(list.file, &text, &files, &number);
+                closeListFile(&list);
+            }
+            
+            if(files!=NULL || entries!=NULL) {
+                waitForProcess((argumentsNumber==3) ? parseProcessId(commandLine[2]) : parentId);
+                deleteFiles(files, entries, number, &list);
                 
-                for(i=0;i<number;i++) {
-                    if(files[i]!=NULL) LocalFree(files[i]);
+                if(files!=NULL) {
+                    LocalFree(files);
                 }
-                
-                LocalFree(files);
+                if(entries!=NULL) {
+                    LocalFree(entries);
+                }
+            }
+            if(text!=NULL) {
+                LocalFree(text);
             }
+            closeListFile(&list);
         }
     }
     LocalFree(commandLine);
-    LocalFree(runningThreads);
     //removeItself();
     removeItselfUsingCmd();
     return 0;
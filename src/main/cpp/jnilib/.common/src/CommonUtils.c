@@ -25,11 +25,261 @@
 
 #include "CommonUtils.h"
 
+// kind of the default charset of java, strings are converted natively
+// unless it is CHARSET_OTHER
+#define CHARSET_OTHER   0
+#define CHARSET_ASCII   1
+#define CHARSET_UTF8    2
+
+// code units 0x01..0x7F and U+00E9 are encoded to detect the charset
+#define CHARSET_PROBE_LENGTH 128
+
+// classes and methods used by the helpers on every call are resolved once
+// when the library is loaded, the installer classes are looked up on call
+// if they are not visible to the class loader of the library
+typedef struct _cachedIDs {
+    jclass    stringClass;
+    jmethodID stringFromBytes;
+    jmethodID stringFromChars;
+    jmethodID stringGetBytes;
+    
+    jclass    fileClass;
+    jmethodID fileConstructor;
+    jmethodID fileGetParentFile;
+    jmethodID fileExists;
+    jmethodID fileMkdirs;
+    
+    jclass    nativeExceptionClass;
+    jclass    logManagerClass;
+    jmethodID logManagerLog;
+    
+    int       defaultCharset;
+} CachedIDs;
+
+static CachedIDs cached;
+
+static jclass findGlobalClass(JNIEnv* jEnv, const char* name) {
+    jclass result = NULL;
+    jclass clazz = (*jEnv)->FindClass(jEnv, name);
+    
+    if (clazz != NULL) {
+        result = (jclass) (*jEnv)->NewGlobalRef(jEnv, clazz);
+        (*jEnv)->DeleteLocalRef(jEnv, clazz);
+    } else {
+        (*jEnv)->ExceptionClear(jEnv);
+    }
+    return result;
+}
+
+static int getDefaultCharset(JNIEnv* jEnv) {
+    int result = CHARSET_OTHER;
+    jchar probe[CHARSET_PROBE_LENGTH];
+    jbyte bytes[CHARSET_PROBE_LENGTH + 2];
+    jstring jProbe;
+    int i;
+    
+    for (i = 0; i < CHARSET_PROBE_LENGTH - 1; i++) {
+        probe[i] = (jchar) (i + 1);
+    }
+    probe[CHARSET_PROBE_LENGTH - 1] = 0xE9;
+    
+    jProbe = (*jEnv)->NewString(jEnv, probe, CHARSET_PROBE_LENGTH);
+    if (jProbe != NULL) {
+        jbyteArray jBytes = (jbyteArray) (*jEnv)->CallObjectMethod(jEnv, jProbe, cached.stringGetBytes);
+        
+        if (jBytes != NULL) {
+            jsize length = (*jEnv)->GetArrayLength(jEnv, jBytes);
+            
+            if (length >= CHARSET_PROBE_LENGTH && length <= CHARSET_PROBE_LENGTH + 1) {
+                (*jEnv)->GetByteArrayRegion(jEnv, jBytes, 0, length, bytes);
+                for (i = 0; i < CHARSET_PROBE_LENGTH - 1 && bytes[i] == i + 1; i++);
+                
+                if (i == CHARSET_PROBE_LENGTH - 1) {
+                    result = (length == CHARSET_PROBE_LENGTH + 1 &&
+                            (unsigned char) bytes[i] == 0xC3 &&
+                            (unsigned char) bytes[i + 1] == 0xA9) ? CHARSET_UTF8 : CHARSET_ASCII;
+                }
+            }
+            (*jEnv)->DeleteLocalRef(jEnv, jBytes);
+        }
+        (*jEnv)->DeleteLocalRef(jEnv, jProbe);
+    }
+    (*jEnv)->ExceptionClear(jEnv);
+    
+    return result;
+}
+
+static void releaseCachedIDs(JNIEnv* jEnv) {
+    if (cached.stringClass != NULL) {
+        (*jEnv)->DeleteGlobalRef(jEnv, cached.stringClass);
+    }
+    if (cached.fileClass != NULL) {
+        (*jEnv)->DeleteGlobalRef(jEnv, cached.fileClass);
+    }
+    if (cached.nativeExceptionClass != NULL) {
+        (*jEnv)->DeleteGlobalRef(jEnv, cached.nativeExceptionClass);
+    }
+    if (cached.logManagerClass != NULL) {
+        (*jEnv)->DeleteGlobalRef(jEnv, cached.logManagerClass);
+    }
+    ZERO(&cached, sizeof(CachedIDs));
+}
+
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* jVM, void* reserved) {
+    JNIEnv* jEnv = NULL;
+    
+    if ((*jVM)->GetEnv(jVM, (void**) &jEnv, JNI_VERSION_1_2) != JNI_OK) {
+        return JNI_ERR;
+    }
+    
+    cached.stringClass = findGlobalClass(jEnv, "java/lang/String");
+    cached.fileClass   = findGlobalClass(jEnv, "java/io/File");
+    if (cached.stringClass == NULL || cached.fileClass == NULL) {
+        releaseCachedIDs(jEnv);
+        return JNI_ERR;
+    }
+    cached.stringFromBytes   = (*jEnv)->GetMethodID(jEnv, cached.stringClass, "<init>", "([BII)V");
+    cached.stringFromChars   = (*jEnv)->GetMethodID(jEnv, cached.stringClass, "<init>", "([CII)V");
+    cached.stringGetBytes    = (*jEnv)->GetMethodID(jEnv, cached.stringClass, "getBytes", "()[B");
+    cached.fileConstructor   = (*jEnv)->GetMethodID(jEnv, cached.fileClass, "<init>", "(Ljava/lang/String;)V");
+    cached.fileGetParentFile = (*jEnv)->GetMethodID(jEnv, cached.fileClass, "getParentFile", "()Ljava/io/File;");
+    cached.fileExists        = (*jEnv)->GetMethodID(jEnv, cached.fileClass, "exists", "()Z");
+    cached.fileMkdirs        = (*jEnv)->GetMethodID(jEnv, cached.fileClass, "mkdirs", "()Z");
+    cached.defaultCharset    = getDefaultCharset(jEnv);
+    
+    cached.nativeExceptionClass = findGlobalClass(jEnv, "org/netbeans/installer/utils/exceptions/NativeException");
+    cached.logManagerClass      = findGlobalClass(jEnv, "org/netbeans/installer/utils/LogManager");
+    if (cached.logManagerClass != NULL) {
+        cached.logManagerLog = (*jEnv)->GetStaticMethodID(jEnv, cached.logManagerClass, "log", "(ILjava/lang/String;)V");
+        if (cached.logManagerLog == NULL) {
+            (*jEnv)->ExceptionClear(jEnv);
+        }
+    }
+    return JNI_VERSION_1_2;
+}
+
+JNIEXPORT void JNICALL JNI_OnUnload(JavaVM* jVM, void* reserved) {
+    JNIEnv* jEnv = NULL;
+    
+    if ((*jVM)->GetEnv(jVM, (void**) &jEnv, JNI_VERSION_1_2) == JNI_OK) {
+        releaseCachedIDs(jEnv);
+    }
+}
+
+// encodes the string without calling java when the default charset is UTF-8
+// or the string is ASCII only, chars should have room for three bytes per
+// code unit in the first case; returns 0 if java has to encode the string
+static int encodeNativeChars(JNIEnv* jEnv, jstring jString, jsize length, char* chars) {
+    const jchar* jChars;
+    size_t index = 0;
+    int result = 1;
+    jsize i;
+    
+    if (cached.defaultCharset == CHARSET_OTHER) {
+        return 0;
+    }
+    jChars = (*jEnv)->GetStringCritical(jEnv, jString, NULL);
+    if (jChars == NULL) {
+        return 0;
+    }
+    for (i = 0; i < length && result; i++) {
+        unsigned int c = jChars[i];
+        
+        if (c == 0) {
+            // the string is cut at the first zero as getBytes() result was
+            break;
+        } else if (c < 0x80) {
+            chars[index++] = (char) c;
+        } else if (cached.defaultCharset != CHARSET_UTF8) {
+            result = 0;
+        } else if (c < 0x800) {
+            chars[index++] = (char) (0xC0 | (c >> 6));
+            chars[index++] = (char) (0x80 | (c & 0x3F));
+        } else if (c >= 0xD800 && c <= 0xDBFF && i + 1 < length &&
+                jChars[i + 1] >= 0xDC00 && jChars[i + 1] <= 0xDFFF) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (jChars[++i] - 0xDC00);
+            chars[index++] = (char) (0xF0 | (c >> 18));
+            chars[index++] = (char) (0x80 | ((c >> 12) & 0x3F));
+            chars[index++] = (char) (0x80 | ((c >> 6) & 0x3F));
+            chars[index++] = (char) (0x80 | (c & 0x3F));
+        } else if (c >= 0xD800 && c <= 0xDFFF) {
+            // unpaired surrogate, replaced as the java encoder does
+            chars[index++] = '?';
+        } else {
+            chars[index++] = (char) (0xE0 | (c >> 12));
+            chars[index++] = (char) (0x80 | ((c >> 6) & 0x3F));
+            chars[index++] = (char) (0x80 | (c & 0x3F));
+        }
+    }
+    (*jEnv)->ReleaseStringCritical(jEnv, jString, jChars);
+    chars[index] = 0;
+    
+    return result;
+}
+
+// decodes valid UTF-8 or ASCII bytes to at most length code units,
+// returns -1 if java has to decode them
+static jsize decodeNativeChars(const char* chars, int length, jchar* jChars) {
+    const unsigned char* bytes = (const unsigned char*) chars;
+    jsize count = 0;
+    int i = 0;
+    
+    if (cached.defaultCharset == CHARSET_OTHER) {
+        return -1;
+    }
+    while (i < length) {
+        unsigned int c = bytes[i];
+        int n = 0;
+        int j;
+        
+        if (c < 0x80) {
+            jChars[count++] = (jchar) c;
+            i++;
+            continue;
+        }
+        if (cached.defaultCharset != CHARSET_UTF8) {
+            return -1;
+        }
+        if (c >= 0xC2 && c <= 0xDF) {
+            n = 1;
+            c &= 0x1F;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            n = 2;
+            c &= 0x0F;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            n = 3;
+            c &= 0x07;
+        }
+        if (n == 0 || i + n >= length) {
+            return -1;
+        }
+        for (j = 1; j <= n; j++) {
+            if ((bytes[i + j] & 0xC0) != 0x80) {
+                return -1;
+            }
+            c = (c << 6) | (bytes[i + j] & 0x3F);
+        }
+        if ((n == 2 && (c < 0x800 || (c >= 0xD800 && c <= 0xDFFF))) ||
+                (n == 3 && (c < 0x10000 || c > 0x10FFFF))) {
+            return -1;
+        }
+        if (c >= 0x10000) {
+            c -= 0x10000;
+            jChars[count++] = (jchar) (0xD800 + (c >> 10));
+            jChars[count++] = (jchar) (0xDC00 + (c & 0x3FF));
+        } else {
+            jChars[count++] = (jchar) c;
+        }
+        i += n + 1;
+    }
+    return count;
+}
+
 jbyteArray getStringBytes(JNIEnv* jEnv, jstring jString) {
     jbyteArray result = NULL;
     
     if (jString != NULL) {
-        jmethodID jGetBytesMethod = (*jEnv)->GetMethodID(jEnv, (*jEnv)->GetObjectClass(jEnv, jString), "getBytes", "()[B");
+        jmethodID jGetBytesMethod = cached.stringGetBytes;
         
         if (jGetBytesMethod != NULL) {
             jbyteArray jBuffer = (jbyteArray) (*jEnv)->CallObjectMethod(jEnv, jString, jGetBytesMethod);
@@ -56,15 +306,8 @@ jbyteArray getStringBytes(JNIEnv* jEnv, jstring jString) {
 jstring newStringFromJByteArray(JNIEnv* jEnv, jbyteArray jByteArray, int length) {
     jstring result = NULL;
     
-    jclass jStringClass = (*jEnv)->FindClass(jEnv, "java/lang/String");
-    if (jStringClass != NULL) {
-        jmethodID jStringConstructor = (*jEnv)->GetMethodID(jEnv, jStringClass, "<init>", "([BII)V");
-        
-        if (jStringConstructor != NULL) {
-            result = (jstring) (*jEnv)->NewObject(jEnv, jStringClass, jStringConstructor, jByteArray, 0, length);
-            //(*jEnv)->DeleteLocalRef(jEnv, stringConstructor);
-        }
-        (*jEnv)->DeleteLocalRef(jEnv, jStringClass);
+    if (cached.stringFromBytes != NULL) {
+        result = (jstring) (*jEnv)->NewObject(jEnv, cached.stringClass, cached.stringFromBytes, jByteArray, 0, length);
     }
     
     return result;
@@ -74,19 +317,17 @@ jstring newStringFromJByteArray(JNIEnv* jEnv, jbyteArray jByteArray, int length)
 jstring newStringFromJCharArray(JNIEnv* jEnv, jcharArray jCharArray, int length) {
     jstring result = NULL;
     
-    jclass jStringClass = (*jEnv)->FindClass(jEnv, "java/lang/String");
-    if (jStringClass != NULL) {
-        jmethodID jStringConstructor = (*jEnv)->GetMethodID(jEnv, jStringClass, "<init>", "([CII)V");
-        
-        if (jStringConstructor != NULL) {
-            result = (jstring) (*jEnv)->NewObject(jEnv, jStringClass, jStringConstructor, jCharArray, 0, length);            
-        }
-        (*jEnv)->DeleteLocalRef(jEnv, jStringClass);
+    if (cached.stringFromChars != NULL) {
+        result = (jstring) (*jEnv)->NewObject(jEnv, cached.stringClass, cached.stringFromChars, jCharArray, 0, length);
     }
     
     return result;
 }
 
+jobjectArray newStringArray(JNIEnv* jEnv, jsize length) {
+    return (*jEnv)->NewObjectArray(jEnv, length, cached.stringClass, NULL);
+}
+
 jstring getString(JNIEnv* jEnv, const char* chars) {
     return (jstring) getStringWithLength(jEnv, chars, (int) STRLEN(chars));
 }
@@ -102,12 +343,23 @@ jstring getStringWithLength(JNIEnv* jEnv, const char* chars, int length) {
         if (length == 0) {
             result = (*jEnv)->NewString(jEnv, (const jchar *) L"", 0);
         } else {
-            jbyteArray jByteArray = (*jEnv)->NewByteArray(jEnv, length);
+            jchar buffer[NATIVE_CHARS_BUFFER_SIZE];
+            jchar* jChars = (length <= NATIVE_CHARS_BUFFER_SIZE) ? buffer : (jchar*) MALLOC(sizeof(jchar) * length);
+            jsize count = (jChars != NULL) ? decodeNativeChars(chars, length, jChars) : -1;
             
-            if (jByteArray != NULL) {
-                (*jEnv)->SetByteArrayRegion(jEnv, jByteArray, 0, length, (jbyte*) chars);
-                result = newStringFromJByteArray(jEnv, jByteArray, length);
-                (*jEnv)->DeleteLocalRef(jEnv, jByteArray);
+            if (count >= 0) {
+                result = (*jEnv)->NewString(jEnv, jChars, count);
+            } else {
+                jbyteArray jByteArray = (*jEnv)->NewByteArray(jEnv, length);
+                
+                if (jByteArray != NULL) {
+                    (*jEnv)->SetByteArrayRegion(jEnv, jByteArray, 0, length, (jbyte*) chars);
+                    result = newStringFromJByteArray(jEnv, jByteArray, length);
+                    (*jEnv)->DeleteLocalRef(jEnv, jByteArray);
+                }
+            }
+            if (jChars != buffer) {
+                FREE(jChars);
             }
         }
     }
@@ -137,14 +389,13 @@ jstring getStringWithLengthW(JNIEnv* jEnv, const wchar_t* chars, int length) {
 }
 
 
-char* getChars(JNIEnv* jEnv, jstring jString) {
+static char* getCharsFromBytes(JNIEnv* jEnv, jstring jString) {
     char* result = NULL;
     
     jbyteArray jByteArray = getStringBytes(jEnv, jString);
     if (jByteArray != NULL) {
         jbyte* jBytes = (*jEnv)->GetByteArrayElements(jEnv, jByteArray, NULL);
         
-        long index = 0;
         if (jBytes != NULL) {
             int length = (int) STRLEN((char*) jBytes);
             
@@ -162,6 +413,45 @@ char* getChars(JNIEnv* jEnv, jstring jString) {
     return result;
 }
 
+// the result is put into buffer if it fits there, otherwise it is allocated
+static char* convertChars(JNIEnv* jEnv, jstring jString, char* buffer, size_t bufferSize) {
+    char* result = NULL;
+    
+    if (jString != NULL) {
+        size_t length = (size_t) (*jEnv)->GetStringLength(jEnv, jString);
+        size_t size = (cached.defaultCharset == CHARSET_UTF8) ? length * 3 + 1 : length + 1;
+        
+        result = (size <= bufferSize) ? buffer : (char*) MALLOC(sizeof(char) * size);
+        if (result != NULL && !encodeNativeChars(jEnv, jString, (jsize) length, result)) {
+            if (result != buffer) {
+                FREE(result);
+            }
+            result = NULL;
+            if (!(*jEnv)->ExceptionCheck(jEnv)) {
+                result = getCharsFromBytes(jEnv, jString);
+            }
+        }
+    }
+    
+    return result;
+}
+
+char* getChars(JNIEnv* jEnv, jstring jString) {
+    return convertChars(jEnv, jString, NULL, 0);
+}
+
+char* getNativeChars(JNIEnv* jEnv, jstring jString, NativeChars* nativeChars) {
+    nativeChars->chars = convertChars(jEnv, jString, nativeChars->buffer, sizeof(nativeChars->buffer));
+    return nativeChars->chars;
+}
+
+void releaseNativeChars(NativeChars* nativeChars) {
+    if (nativeChars->chars != nativeChars->buffer) {
+        FREE(nativeChars->chars);
+    }
+    nativeChars->chars = NULL;
+}
+
 char* getStringFromMethod(JNIEnv* jEnv, jobject object, const char* methodName) {
     char* result = NULL;
     
@@ -229,19 +519,28 @@ jint getIntFromMethod(JNIEnv* jEnv, jobject object, const char* methodName) {
 }
 
 void throwException(JNIEnv* jEnv, const char* message) {
-    jclass clazz = (*jEnv)->FindClass(jEnv, "org/netbeans/installer/utils/exceptions/NativeException");
+    jclass clazz = cached.nativeExceptionClass;
+    if (clazz == NULL) {
+        clazz = (*jEnv)->FindClass(jEnv, "org/netbeans/installer/utils/exceptions/NativeException");
+    }
     if (clazz != NULL) {
         (*jEnv)->ThrowNew(jEnv, clazz, message);
-        (*jEnv)->DeleteLocalRef(jEnv, clazz);
+        if (clazz != cached.nativeExceptionClass) {
+            (*jEnv)->DeleteLocalRef(jEnv, clazz);
+        }
     }
 }
 
 void writeLog(JNIEnv* jEnv, int level, const char* message) {
     const char* prefix = "[jni] ";
     
-    jclass clazz = (*jEnv)->FindClass(jEnv, "org/netbeans/installer/utils/LogManager");
+    jclass clazz = cached.logManagerClass;
+    if (clazz == NULL) {
+        clazz = (*jEnv)->FindClass(jEnv, "org/netbeans/installer/utils/LogManager");
+    }
     if (clazz != NULL) {
-        jmethodID method = (*jEnv)->GetStaticMethodID(jEnv, clazz, "log", "(ILjava/lang/String;)V");
+        jmethodID method = (clazz == cached.logManagerClass) ? cached.logManagerLog :
+            (*jEnv)->GetStaticMethodID(jEnv, clazz, "log", "(ILjava/lang/String;)V");
         if (method != NULL) {
             jstring jMessage = NULL;
             int prefix_length = STRLEN(prefix);
@@ -268,18 +567,20 @@ void writeLog(JNIEnv* jEnv, int level, const char* message) {
             FREE(string);
             //(*jEnv)->DeleteLocalRef(jEnv, method);
         }
-        (*jEnv)->DeleteLocalRef(jEnv, clazz);
+        if (clazz != cached.logManagerClass) {
+            (*jEnv)->DeleteLocalRef(jEnv, clazz);
+        }
     }
 }
 
 int createDirs(JNIEnv* jEnv, jstring jPath) {
     int result = 0;
-    jclass jFileClass = (*jEnv)->FindClass(jEnv, "java/io/File");
+    jclass jFileClass = cached.fileClass;
     if (jFileClass != NULL) {
-        jmethodID jFileConstructor     = (*jEnv)->GetMethodID(jEnv, jFileClass, "<init>", "(Ljava/lang/String;)V");
-        jmethodID jGetParentFileMethod = (*jEnv)->GetMethodID(jEnv, jFileClass, "getParentFile", "()Ljava/io/File;");
-        jmethodID jExistsMethod        = (*jEnv)->GetMethodID(jEnv, jFileClass, "exists", "()Z");
-        jmethodID jMkdirsMethod        = (*jEnv)->GetMethodID(jEnv, jFileClass, "mkdirs", "()Z");
+        jmethodID jFileConstructor     = cached.fileConstructor;
+        jmethodID jGetParentFileMethod = cached.fileGetParentFile;
+        jmethodID jExistsMethod        = cached.fileExists;
+        jmethodID jMkdirsMethod        = cached.fileMkdirs;
         
         if ((jFileConstructor != NULL) && (jGetParentFileMethod != NULL) && (jExistsMethod != NULL) && (jMkdirsMethod != NULL)) {            
             jobject jFile = (*jEnv)->NewObject(jEnv, jFileClass, jFileConstructor, jPath);
@@ -299,7 +600,6 @@ int createDirs(JNIEnv* jEnv, jstring jPath) {
                 (*jEnv)->DeleteLocalRef(jEnv, jFile);
             }
         }
-        (*jEnv)->DeleteLocalRef(jEnv, jFileClass);
     }
     return result;
 }
@@ -81,6 +81,14 @@
 #define LOG_ERROR    1
 #define LOG_CRITICAL 0
 
+// strings of up to this size are converted without allocation
+#define NATIVE_CHARS_BUFFER_SIZE 512
+
+typedef struct _nativeChars {
+    char* chars;
+    char buffer[NATIVE_CHARS_BUFFER_SIZE];
+} NativeChars;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -90,6 +98,9 @@ jbyteArray getStringBytes(JNIEnv* jEnv, jstring jString);
 jstring newStringFromJByteArray(JNIEnv* jEnv, jbyteArray jByteArray, int length);
 jstring newStringFromJCharArray(JNIEnv* jEnv, jcharArray jCharArray, int length);
 
+// array of java.lang.String, the class is cached by JNI_OnLoad
+jobjectArray newStringArray(JNIEnv* jEnv, jsize length);
+
 jstring getString (JNIEnv* jEnv, const char* chars);
 jstring getStringW(JNIEnv* jEnv, const wchar_t * chars);
 
@@ -100,6 +111,11 @@ jstring getStringWithLengthW(JNIEnv* jEnv, const wchar_t * chars, int length);
 char* getChars(JNIEnv* jEnv, jstring jString);
 wchar_t * getWideChars(JNIEnv *jEnv, jstring str);
 
+// like getChars() but short strings are kept in the buffer of nativeChars,
+// the result must be freed with releaseNativeChars()
+char* getNativeChars(JNIEnv* jEnv, jstring jString, NativeChars* nativeChars);
+void releaseNativeChars(NativeChars* nativeChars);
+
 char* getStringFromMethod(JNIEnv* jEnv, jobject object, const char* methodName);
 wchar_t* getWideStringFromMethod(JNIEnv* jEnv, jobject object, const char* methodName) ;
 
@@ -0,0 +1,169 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Benchmark of the string conversions of CommonUtils against the code
+// they replace, which went through String.getBytes() and
+// String(byte[],int,int). The mock JNIEnv does those in C, so only the
+// copies and the allocations are compared; the calls into a real VM add
+// to the old conversions only. Run by "make bench" of the jnilib.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/CommonUtils.h"
+#include "jnimock.h"
+
+#define STRINGS 1000
+#define RUNS    20
+
+static double currentSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// getChars of the old CommonUtils
+static char* getCharsReference(JNIEnv* jEnv, jstring jString) {
+    char* result = NULL;
+    jbyteArray jByteArray = getStringBytes(jEnv, jString);
+
+    if (jByteArray != NULL) {
+        jbyte* jBytes = (*jEnv)->GetByteArrayElements(jEnv, jByteArray, NULL);
+        if (jBytes != NULL) {
+            int length = (int) STRLEN((char*) jBytes);
+            result = (char*) MALLOC(sizeof(char) * (length + 1));
+            if (result != NULL) {
+                ZERO(result, length);
+                STRNCPY(result, (char*) jBytes, length);
+                result[length] = 0;
+            }
+            (*jEnv)->ReleaseByteArrayElements(jEnv, jByteArray, jBytes, JNI_ABORT);
+        }
+        (*jEnv)->DeleteLocalRef(jEnv, jByteArray);
+    }
+    return result;
+}
+
+// getStringWithLength of the old CommonUtils
+static jstring getStringReference(JNIEnv* jEnv, const char* chars, int length) {
+    jstring result = NULL;
+    jbyteArray jByteArray = (*jEnv)->NewByteArray(jEnv, length);
+
+    if (jByteArray != NULL) {
+        (*jEnv)->SetByteArrayRegion(jEnv, jByteArray, 0, length, (jbyte*) chars);
+        result = newStringFromJByteArray(jEnv, jByteArray, length);
+        (*jEnv)->DeleteLocalRef(jEnv, jByteArray);
+    }
+    return result;
+}
+
+// installation paths, every fourth one has a non-ASCII directory
+static void createPaths(jstring* strings, char** paths) {
+    int i;
+    for (i = 0; i < STRINGS; i++) {
+        jchar chars[128];
+        jsize length = 0;
+        char ascii[128];
+        int j;
+        jsize size;
+
+        snprintf(ascii, sizeof(ascii), "/home/user/netbeans-%d/platform/modules/ext/module%d.jar", i % 7, i);
+        for (j = 0; ascii[j]; j++) {
+            chars[length++] = (jchar) ascii[j];
+            if (i % 4 == 0 && j == 10) {
+                chars[length++] = 0x00E9;
+                chars[length++] = 0x4E2D;
+            }
+        }
+        strings[i] = newMockString(chars, length);
+        paths[i] = encodeMockString(chars, length, &size);
+    }
+}
+
+int main(void) {
+    JNIEnv* jEnv = loadMockLibrary(MOCK_CHARSET_UTF8);
+    jstring* strings = (jstring*) malloc(sizeof(jstring) * STRINGS);
+    char** paths = (char**) malloc(sizeof(char*) * STRINGS);
+    double toNativeOld = 0;
+    double toNativeNew = 0;
+    double toNativeBuffer = 0;
+    double toJavaOld = 0;
+    double toJavaNew = 0;
+    double started;
+    int run;
+    int i;
+
+    if (jEnv == NULL) {
+        fprintf(stderr, "JNI_OnLoad failed\n");
+        return 1;
+    }
+    createPaths(strings, paths);
+    for (run = 0; run < RUNS; run++) {
+        started = currentSeconds();
+        for (i = 0; i < STRINGS; i++) {
+            char* chars = getCharsReference(jEnv, strings[i]);
+            FREE(chars);
+        }
+        toNativeOld += currentSeconds() - started;
+
+        started = currentSeconds();
+        for (i = 0; i < STRINGS; i++) {
+            char* chars = getChars(jEnv, strings[i]);
+            FREE(chars);
+        }
+        toNativeNew += currentSeconds() - started;
+
+        started = currentSeconds();
+        for (i = 0; i < STRINGS; i++) {
+            NativeChars nativeChars;
+            getNativeChars(jEnv, strings[i], &nativeChars);
+            releaseNativeChars(&nativeChars);
+        }
+        toNativeBuffer += currentSeconds() - started;
+
+        started = currentSeconds();
+        for (i = 0; i < STRINGS; i++) {
+            deleteMockObject(getStringReference(jEnv, paths[i], (int) strlen(paths[i])));
+        }
+        toJavaOld += currentSeconds() - started;
+
+        started = currentSeconds();
+        for (i = 0; i < STRINGS; i++) {
+            deleteMockObject(getStringWithLength(jEnv, paths[i], (int) strlen(paths[i])));
+        }
+        toJavaNew += currentSeconds() - started;
+    }
+    printf("%d paths, %d runs, UTF-8\n", STRINGS, RUNS);
+    printf("  getChars, getBytes()          %9.3f ms\n", toNativeOld * 1000 / RUNS);
+    printf("  getChars                      %9.3f ms\n", toNativeNew * 1000 / RUNS);
+    printf("  getNativeChars                %9.3f ms\n", toNativeBuffer * 1000 / RUNS);
+    printf("  getStringWithLength, byte[]   %9.3f ms\n", toJavaOld * 1000 / RUNS);
+    printf("  getStringWithLength           %9.3f ms\n", toJavaNew * 1000 / RUNS);
+
+    for (i = 0; i < STRINGS; i++) {
+        deleteMockObject(strings[i]);
+        free(paths[i]);
+    }
+    free(strings);
+    free(paths);
+    unloadMockLibrary();
+    return 0;
+}
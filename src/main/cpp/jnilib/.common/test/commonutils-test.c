@@ -0,0 +1,247 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Unit tests of the string conversions of CommonUtils against a mock
+// JNIEnv, the reference is String.getBytes() of the mock. Run by
+// "make test" of the jnilib.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/CommonUtils.h"
+#include "jnimock.h"
+
+#define RANDOM_STRINGS 2000
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: %s failed\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+static jstring newAsciiString(const char* ascii) {
+    jchar chars[256];
+    jsize length = 0;
+    for (; *ascii; ascii++) {
+        chars[length++] = (jchar) (unsigned char) *ascii;
+    }
+    return newMockString(chars, length);
+}
+
+static int equalsMockString(jstring jString, const jchar* chars, jsize length) {
+    jsize stringLength;
+    const jchar* stringChars = getMockStringChars(jString, &stringLength);
+    return stringLength == length && memcmp(stringChars, chars, sizeof(jchar) * length) == 0;
+}
+
+// code units of every UTF-8 length, pairs and lone surrogates
+static jsize randomChars(jchar* chars, jsize capacity, int pairedOnly) {
+    jsize length = rand() % capacity;
+    jsize i;
+    for (i = 0; i < length; i++) {
+        switch (rand() % 6) {
+            case 0:
+                chars[i] = (jchar) (0x80 + rand() % 0x780);
+                break;
+            case 1:
+                chars[i] = (jchar) (0x800 + rand() % 0xD000);
+                break;
+            case 2:
+                if (i + 1 < length) {
+                    chars[i++] = (jchar) (0xD800 + rand() % 0x400);
+                    chars[i] = (jchar) (0xDC00 + rand() % 0x400);
+                } else {
+                    chars[i] = 'z';
+                }
+                break;
+            case 3:
+                chars[i] = pairedOnly ? 'y' : (jchar) (0xD800 + rand() % 0x800);
+                break;
+            default:
+                chars[i] = (jchar) (1 + rand() % 0x7F);
+                break;
+        }
+    }
+    return length;
+}
+
+static void testUtf8(void) {
+    JNIEnv* jEnv = loadMockLibrary(MOCK_CHARSET_UTF8);
+    jchar chars[64];
+    int i;
+
+    CHECK(jEnv != NULL);
+    for (i = 0; i < RANDOM_STRINGS; i++) {
+        jsize length = randomChars(chars, 64, 0);
+        jstring jString = newMockString(chars, length);
+        jsize size;
+        char* expected = encodeMockString(chars, length, &size);
+        char* result = getChars(jEnv, jString);
+
+        CHECK(result != NULL && strcmp(result, expected) == 0);
+        FREE(result);
+        free(expected);
+        deleteMockObject(jString);
+    }
+    // the strings never went through java
+    CHECK(mockCalls.getBytes == 0);
+    CHECK(mockCalls.criticals == RANDOM_STRINGS);
+
+    for (i = 0; i < RANDOM_STRINGS; i++) {
+        jsize length = randomChars(chars, 64, 1);
+        jsize size;
+        char* bytes = encodeMockString(chars, length, &size);
+        jstring jString = getStringWithLength(jEnv, bytes, size);
+
+        CHECK(jString != NULL && equalsMockString(jString, chars, length));
+        deleteMockObject(jString);
+        free(bytes);
+    }
+    CHECK(mockCalls.stringFromBytes == 0);
+    unloadMockLibrary();
+}
+
+static void testInvalidUtf8(void) {
+    // overlong, surrogate, above U+10FFFF, truncated, lone continuation
+    static const char* invalid[] = {
+        "\xC0\x80", "\xE0\x80\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "a\xE2\x82", "\x80", "\xFF"
+    };
+    JNIEnv* jEnv = loadMockLibrary(MOCK_CHARSET_UTF8);
+    size_t i;
+
+    for (i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        long calls = mockCalls.stringFromBytes;
+        jstring jString = getString(jEnv, invalid[i]);
+        CHECK(jString != NULL);
+        CHECK(mockCalls.stringFromBytes == calls + 1);
+        deleteMockObject(jString);
+    }
+    unloadMockLibrary();
+}
+
+static void testZeroAndEmpty(void) {
+    JNIEnv* jEnv = loadMockLibrary(MOCK_CHARSET_UTF8);
+    jchar withZero[] = { 'a', 0, 'b' };
+    jstring jString = newMockString(withZero, 3);
+    char* result = getChars(jEnv, jString);
+    jstring empty;
+
+    // cut at the zero as the C string of getBytes() was
+    CHECK(result != NULL && strcmp(result, "a") == 0);
+    FREE(result);
+    deleteMockObject(jString);
+
+    CHECK(getChars(jEnv, NULL) == NULL);
+    CHECK(getStringWithLength(jEnv, NULL, 0) == NULL);
+    empty = getString(jEnv, "");
+    CHECK(empty != NULL && equalsMockString(empty, withZero, 0));
+    deleteMockObject(empty);
+    unloadMockLibrary();
+}
+
+static void testNativeChars(void) {
+    JNIEnv* jEnv = loadMockLibrary(MOCK_CHARSET_UTF8);
+    NativeChars nativeChars;
+    char longPath[NATIVE_CHARS_BUFFER_SIZE + 2];
+    jchar longChars[NATIVE_CHARS_BUFFER_SIZE + 1];
+    size_t i;
+    jstring jString = newAsciiString("/usr/local/netbeans");
+    char* result = getNativeChars(jEnv, jString, &nativeChars);
+
+    CHECK(result == nativeChars.buffer);
+    CHECK(result != NULL && strcmp(result, "/usr/local/netbeans") == 0);
+    releaseNativeChars(&nativeChars);
+    CHECK(nativeChars.chars == NULL);
+    deleteMockObject(jString);
+
+    // too long for the buffer with three bytes per unit
+    for (i = 0; i < NATIVE_CHARS_BUFFER_SIZE + 1; i++) {
+        longChars[i] = 'x';
+        longPath[i] = 'x';
+    }
+    longPath[i] = 0;
+    jString = newMockString(longChars, NATIVE_CHARS_BUFFER_SIZE + 1);
+    result = getNativeChars(jEnv, jString, &nativeChars);
+    CHECK(result != NULL && result != nativeChars.buffer);
+    CHECK(result != NULL && strcmp(result, longPath) == 0);
+    releaseNativeChars(&nativeChars);
+    deleteMockObject(jString);
+    unloadMockLibrary();
+}
+
+static void testLatin1(void) {
+    JNIEnv* jEnv = loadMockLibrary(MOCK_CHARSET_LATIN1);
+    jchar accented[] = { 'c', 0xE9 };
+    jstring jString = newAsciiString("/opt/netbeans");
+    char* result = getChars(jEnv, jString);
+
+    // ASCII only strings are converted natively
+    CHECK(result != NULL && strcmp(result, "/opt/netbeans") == 0);
+    CHECK(mockCalls.getBytes == 0);
+    FREE(result);
+    deleteMockObject(jString);
+
+    jString = newMockString(accented, 2);
+    result = getChars(jEnv, jString);
+    CHECK(result != NULL && strcmp(result, "c\xE9") == 0);
+    CHECK(mockCalls.getBytes == 1);
+    FREE(result);
+    deleteMockObject(jString);
+
+    jString = getString(jEnv, "c\xE9");
+    CHECK(jString != NULL && equalsMockString(jString, accented, 2));
+    CHECK(mockCalls.stringFromBytes == 1);
+    deleteMockObject(jString);
+    unloadMockLibrary();
+}
+
+static void testOtherCharset(void) {
+    JNIEnv* jEnv = loadMockLibrary(MOCK_CHARSET_UTF16);
+    jstring jString = getString(jEnv, "abc");
+    char* result;
+
+    // nothing is converted natively
+    CHECK(mockCalls.stringFromBytes == 1);
+    deleteMockObject(jString);
+    jString = newAsciiString("abc");
+    result = getChars(jEnv, jString);
+    CHECK(mockCalls.getBytes == 1);
+    CHECK(mockCalls.criticals == 0);
+    FREE(result);
+    deleteMockObject(jString);
+    unloadMockLibrary();
+}
+
+int main(void) {
+    srand(48);
+    testUtf8();
+    testInvalidUtf8();
+    testZeroAndEmpty();
+    testNativeChars();
+    testLatin1();
+    testOtherCharset();
+    if (failures == 0) {
+        printf("commonutils tests passed\n");
+    }
+    return (failures == 0) ? 0 : 1;
+}
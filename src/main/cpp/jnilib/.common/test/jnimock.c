@@ -0,0 +1,328 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jnimock.h"
+
+#define MOCK_CLASS  0
+#define MOCK_STRING 1
+#define MOCK_BYTES  2
+
+typedef struct _mockObject {
+    int kind;
+    jsize length;
+    void* data;
+} MockObject;
+
+MockCalls mockCalls;
+
+static int charset;
+static struct JNINativeInterface_ functions;
+static struct JNIInvokeInterface_ invokeFunctions;
+static JNIEnv env = &functions;
+static JavaVM vm = &invokeFunctions;
+
+static MockObject stringClass = { MOCK_CLASS, 0, NULL };
+static MockObject fileClass   = { MOCK_CLASS, 0, NULL };
+
+// only the methods used by the conversions are told apart
+static char getBytesMethod;
+static char stringFromBytesMethod;
+static char otherMethod;
+
+static MockObject* newMockObject(int kind, jsize length, size_t size) {
+    MockObject* object = (MockObject*) malloc(sizeof(MockObject));
+    object->kind = kind;
+    object->length = length;
+    // one more item keeps the data terminated
+    object->data = calloc(size + 1, 1);
+    return object;
+}
+
+void deleteMockObject(jobject object) {
+    MockObject* mock = (MockObject*) object;
+    if (mock != NULL && mock->kind != MOCK_CLASS) {
+        free(mock->data);
+        free(mock);
+    }
+}
+
+jstring newMockString(const jchar* chars, jsize length) {
+    MockObject* object = newMockObject(MOCK_STRING, length, sizeof(jchar) * (length + 1));
+    memcpy(object->data, chars, sizeof(jchar) * length);
+    return (jstring) object;
+}
+
+const jchar* getMockStringChars(jstring jString, jsize* length) {
+    MockObject* object = (MockObject*) jString;
+    *length = object->length;
+    return (const jchar*) object->data;
+}
+
+char* encodeMockString(const jchar* chars, jsize length, jsize* size) {
+    unsigned char* bytes = (unsigned char*) calloc(sizeof(jchar) * 2 * length + 3, 1);
+    jsize count = 0;
+    jsize i;
+
+    if (charset == MOCK_CHARSET_UTF16) {
+        bytes[count++] = 0xFE;
+        bytes[count++] = 0xFF;
+    }
+    for (i = 0; i < length; i++) {
+        unsigned long c = chars[i];
+
+        if (charset == MOCK_CHARSET_UTF16) {
+            bytes[count++] = (unsigned char) (c >> 8);
+            bytes[count++] = (unsigned char) c;
+        } else if (charset == MOCK_CHARSET_LATIN1) {
+            bytes[count++] = (c < 0x100) ? (unsigned char) c : '?';
+        } else if (c < 0x80) {
+            bytes[count++] = (unsigned char) c;
+        } else if (c < 0x800) {
+            bytes[count++] = (unsigned char) (0xC0 | (c >> 6));
+            bytes[count++] = (unsigned char) (0x80 | (c & 0x3F));
+        } else if (c >= 0xD800 && c < 0xE000) {
+            if (c < 0xDC00 && i + 1 < length && chars[i + 1] >= 0xDC00 && chars[i + 1] < 0xE000) {
+                c = 0x10000 + ((c & 0x3FF) << 10) + (chars[++i] & 0x3FF);
+                bytes[count++] = (unsigned char) (0xF0 | (c >> 18));
+                bytes[count++] = (unsigned char) (0x80 | ((c >> 12) & 0x3F));
+                bytes[count++] = (unsigned char) (0x80 | ((c >> 6) & 0x3F));
+                bytes[count++] = (unsigned char) (0x80 | (c & 0x3F));
+            } else {
+                bytes[count++] = '?';
+            }
+        } else {
+            bytes[count++] = (unsigned char) (0xE0 | (c >> 12));
+            bytes[count++] = (unsigned char) (0x80 | ((c >> 6) & 0x3F));
+            bytes[count++] = (unsigned char) (0x80 | (c & 0x3F));
+        }
+    }
+    *size = count;
+    return (char*) bytes;
+}
+
+// malformed UTF-8 is replaced by U+FFFD byte by byte, that is enough to
+// tell the result from the native one
+static jsize decodeMockBytes(const unsigned char* bytes, jsize size, jchar* chars) {
+    jsize count = 0;
+    jsize i = 0;
+
+    while (i < size) {
+        unsigned long c = bytes[i];
+        int n = (c >= 0xC2 && c < 0xE0) ? 1 : (c >= 0xE0 && c < 0xF0) ? 2 : (c >= 0xF0 && c < 0xF5) ? 3 : 0;
+        int j;
+
+        if (charset != MOCK_CHARSET_UTF8 || c < 0x80) {
+            chars[count++] = (jchar) c;
+            i++;
+            continue;
+        }
+        for (j = 1; j <= n && i + j < size && (bytes[i + j] & 0xC0) == 0x80; j++) {
+            c = (c << 6) | (bytes[i + j] & 0x3F);
+        }
+        if (n == 0 || j <= n) {
+            chars[count++] = 0xFFFD;
+            i++;
+            continue;
+        }
+        c &= (n == 1) ? 0x7FF : (n == 2) ? 0xFFFF : 0x1FFFFF;
+        if (c >= 0x10000) {
+            chars[count++] = (jchar) (0xD800 + ((c - 0x10000) >> 10));
+            chars[count++] = (jchar) (0xDC00 + ((c - 0x10000) & 0x3FF));
+        } else {
+            chars[count++] = (jchar) c;
+        }
+        i += n + 1;
+    }
+    return count;
+}
+
+static jclass JNICALL mockFindClass(JNIEnv* jEnv, const char* name) {
+    if (strcmp(name, "java/lang/String") == 0) {
+        return (jclass) &stringClass;
+    }
+    if (strcmp(name, "java/io/File") == 0) {
+        return (jclass) &fileClass;
+    }
+    return NULL;
+}
+
+static jobject JNICALL mockNewGlobalRef(JNIEnv* jEnv, jobject object) {
+    return object;
+}
+
+static void JNICALL mockDeleteGlobalRef(JNIEnv* jEnv, jobject object) {
+}
+
+static void JNICALL mockDeleteLocalRef(JNIEnv* jEnv, jobject object) {
+    deleteMockObject(object);
+}
+
+static void JNICALL mockExceptionClear(JNIEnv* jEnv) {
+}
+
+static jboolean JNICALL mockExceptionCheck(JNIEnv* jEnv) {
+    return JNI_FALSE;
+}
+
+static jmethodID JNICALL mockGetMethodID(JNIEnv* jEnv, jclass clazz, const char* name, const char* signature) {
+    if (strcmp(name, "getBytes") == 0 && strcmp(signature, "()[B") == 0) {
+        return (jmethodID) &getBytesMethod;
+    }
+    if (strcmp(name, "<init>") == 0 && strcmp(signature, "([BII)V") == 0) {
+        return (jmethodID) &stringFromBytesMethod;
+    }
+    return (jmethodID) &otherMethod;
+}
+
+static jobject JNICALL mockCallObjectMethod(JNIEnv* jEnv, jobject object, jmethodID method, ...) {
+    MockObject* string = (MockObject*) object;
+    MockObject* result;
+    jsize size;
+    char* bytes;
+
+    if (method != (jmethodID) &getBytesMethod) {
+        return NULL;
+    }
+    mockCalls.getBytes++;
+    bytes = encodeMockString((const jchar*) string->data, string->length, &size);
+    result = newMockObject(MOCK_BYTES, size, size);
+    memcpy(result->data, bytes, size);
+    free(bytes);
+    return (jobject) result;
+}
+
+static jobject JNICALL mockNewObject(JNIEnv* jEnv, jclass clazz, jmethodID method, ...) {
+    MockObject* array;
+    MockObject* result;
+    jint offset;
+    jint length;
+    va_list args;
+
+    if (method != (jmethodID) &stringFromBytesMethod) {
+        return NULL;
+    }
+    mockCalls.stringFromBytes++;
+    va_start(args, method);
+    array = (MockObject*) va_arg(args, jbyteArray);
+    offset = va_arg(args, jint);
+    length = va_arg(args, jint);
+    va_end(args);
+
+    result = newMockObject(MOCK_STRING, 0, sizeof(jchar) * (length * 2 + 1));
+    result->length = decodeMockBytes((unsigned char*) array->data + offset, length, (jchar*) result->data);
+    return (jobject) result;
+}
+
+static jstring JNICALL mockNewString(JNIEnv* jEnv, const jchar* chars, jsize length) {
+    mockCalls.newString++;
+    return newMockString(chars, length);
+}
+
+static jsize JNICALL mockGetStringLength(JNIEnv* jEnv, jstring jString) {
+    return ((MockObject*) jString)->length;
+}
+
+static const jchar* JNICALL mockGetStringCritical(JNIEnv* jEnv, jstring jString, jboolean* isCopy) {
+    mockCalls.criticals++;
+    if (isCopy != NULL) {
+        *isCopy = JNI_FALSE;
+    }
+    return (const jchar*) ((MockObject*) jString)->data;
+}
+
+static void JNICALL mockReleaseStringCritical(JNIEnv* jEnv, jstring jString, const jchar* chars) {
+}
+
+static jsize JNICALL mockGetArrayLength(JNIEnv* jEnv, jarray array) {
+    return ((MockObject*) array)->length;
+}
+
+static jbyteArray JNICALL mockNewByteArray(JNIEnv* jEnv, jsize length) {
+    return (jbyteArray) newMockObject(MOCK_BYTES, length, length);
+}
+
+// a copy, as the VMs that move arrays make it
+static jbyte* JNICALL mockGetByteArrayElements(JNIEnv* jEnv, jbyteArray array, jboolean* isCopy) {
+    MockObject* object = (MockObject*) array;
+    jbyte* elements = (jbyte*) malloc(object->length + 1);
+    memcpy(elements, object->data, object->length + 1);
+    if (isCopy != NULL) {
+        *isCopy = JNI_TRUE;
+    }
+    return elements;
+}
+
+static void JNICALL mockReleaseByteArrayElements(JNIEnv* jEnv, jbyteArray array, jbyte* elements, jint mode) {
+    if (mode != JNI_ABORT) {
+        memcpy(((MockObject*) array)->data, elements, ((MockObject*) array)->length);
+    }
+    free(elements);
+}
+
+static void JNICALL mockGetByteArrayRegion(JNIEnv* jEnv, jbyteArray array, jsize start, jsize length, jbyte* buffer) {
+    memcpy(buffer, (jbyte*) ((MockObject*) array)->data + start, length);
+}
+
+static void JNICALL mockSetByteArrayRegion(JNIEnv* jEnv, jbyteArray array, jsize start, jsize length, const jbyte* buffer) {
+    memcpy((jbyte*) ((MockObject*) array)->data + start, buffer, length);
+}
+
+static jint JNICALL mockGetEnv(JavaVM* jVM, void** jEnv, jint version) {
+    *jEnv = (void*) &env;
+    return JNI_OK;
+}
+
+JNIEnv* loadMockLibrary(int mockCharset) {
+    charset = mockCharset;
+    functions.FindClass = mockFindClass;
+    functions.NewGlobalRef = mockNewGlobalRef;
+    functions.DeleteGlobalRef = mockDeleteGlobalRef;
+    functions.DeleteLocalRef = mockDeleteLocalRef;
+    functions.ExceptionClear = mockExceptionClear;
+    functions.ExceptionCheck = mockExceptionCheck;
+    functions.GetMethodID = mockGetMethodID;
+    functions.GetStaticMethodID = mockGetMethodID;
+    functions.CallObjectMethod = mockCallObjectMethod;
+    functions.NewObject = mockNewObject;
+    functions.NewString = mockNewString;
+    functions.GetStringLength = mockGetStringLength;
+    functions.GetStringCritical = mockGetStringCritical;
+    functions.ReleaseStringCritical = mockReleaseStringCritical;
+    functions.GetArrayLength = mockGetArrayLength;
+    functions.NewByteArray = mockNewByteArray;
+    functions.GetByteArrayElements = mockGetByteArrayElements;
+    functions.ReleaseByteArrayElements = mockReleaseByteArrayElements;
+    functions.GetByteArrayRegion = mockGetByteArrayRegion;
+    functions.SetByteArrayRegion = mockSetByteArrayRegion;
+    invokeFunctions.GetEnv = mockGetEnv;
+
+    if (JNI_OnLoad(&vm, NULL) == JNI_ERR) {
+        return NULL;
+    }
+    memset(&mockCalls, 0, sizeof(MockCalls));
+    return &env;
+}
+
+void unloadMockLibrary(void) {
+    JNI_OnUnload(&vm, NULL);
+}
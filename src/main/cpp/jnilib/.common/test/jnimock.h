@@ -0,0 +1,57 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// JNIEnv without a VM for the tests and the benchmark of CommonUtils.
+// Strings and byte arrays live in C memory, String.getBytes() and
+// String(byte[],int,int) are done in C in the charset of the mock.
+
+#ifndef _jnimock_H
+#define _jnimock_H
+
+#include <jni.h>
+
+// default charset of the mock java
+#define MOCK_CHARSET_UTF8   0
+#define MOCK_CHARSET_LATIN1 1
+// not ASCII compatible, CommonUtils leaves every conversion to java
+#define MOCK_CHARSET_UTF16  2
+
+// calls that show which way a string went
+typedef struct _mockCalls {
+    long getBytes;
+    long stringFromBytes;
+    long newString;
+    long criticals;
+} MockCalls;
+
+extern MockCalls mockCalls;
+
+// loads CommonUtils with JNI_OnLoad for the charset, resets mockCalls
+JNIEnv* loadMockLibrary(int charset);
+void unloadMockLibrary(void);
+
+jstring newMockString(const jchar* chars, jsize length);
+const jchar* getMockStringChars(jstring jString, jsize* length);
+void deleteMockObject(jobject object);
+
+// String.getBytes() of the mock java, the result has a terminating zero
+// that is not counted in the length
+char* encodeMockString(const jchar* chars, jsize length, jsize* size);
+
+#endif /* _jnimock_H */
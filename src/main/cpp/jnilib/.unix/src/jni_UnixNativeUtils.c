@@ -21,9 +21,16 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <pthread.h>
 
 #include "../../.common/src/CommonUtils.h"
 #include "jni_UnixNativeUtils.h"
@@ -39,13 +46,104 @@ jboolean statMode(const char *path, int *mode) {
     }
 }
 
+jboolean isModeChangeSupported(jint jChange) {
+    return jChange == MODE_CHANGE_SET || jChange == MODE_CHANGE_ADD || jChange == MODE_CHANGE_REMOVE;
+}
+
+int changeMode(int currentMode, jint jMode, jint jChange) {
+    switch (jChange) {
+        case MODE_CHANGE_SET:
+            currentMode |= (S_IRWXU | S_IRWXG | S_IRWXO);
+            currentMode &= jMode;
+            break;
+        case MODE_CHANGE_ADD:
+            currentMode |= jMode;
+            break;
+        case MODE_CHANGE_REMOVE:
+            currentMode &= ~jMode;
+            break;
+    }
+    return currentMode;
+}
+
+void throwUnsupportedModeChange(JNIEnv *jEnv, jint jChange) {
+    char msg[60];
+    snprintf(msg, sizeof(msg), "Selected change mode (%ld) is not supported", (long) jChange);
+    throwException(jEnv, msg);
+}
+
+#ifdef AT_FDCWD
+// directory of the previous path of a batch, files of one directory usually
+// come together so it is opened once and the files are changed relative to it
+typedef struct _batchDirectory {
+    char* path;
+    int fd;
+} BatchDirectory;
+
+int getBatchDirectory(BatchDirectory* dir, char* path, char** name) {
+    char* separator = strrchr(path, '/');
+    
+    if (separator == NULL || separator == path) {
+        *name = path;
+        return AT_FDCWD;
+    }
+    *separator = 0;
+    if (dir->path == NULL || strcmp(dir->path, path) != 0) {
+        if (dir->fd >= 0) {
+            close(dir->fd);
+        }
+        FREE(dir->path);
+        dir->fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dir->fd >= 0) {
+            dir->path = strdup(path);
+        }
+    }
+    *separator = '/';
+    
+    if (dir->fd < 0 || dir->path == NULL) {
+        *name = path;
+        return AT_FDCWD;
+    }
+    *name = separator + 1;
+    return dir->fd;
+}
+
+int setPermissionsInBatch(BatchDirectory* dir, char* path, jint jMode, jint jChange) {
+    struct stat sb;
+    char* name;
+    int fd = getBatchDirectory(dir, path, &name);
+    
+    if (fstatat(fd, name, &sb, 0) != 0 ||
+            fchmodat(fd, name, changeMode(sb.st_mode, jMode, jChange) & 07777, 0) != 0) {
+        return errno;
+    }
+    return 0;
+}
+#else
+typedef struct _batchDirectory {
+    char* path;
+    int fd;
+} BatchDirectory;
+
+int setPermissionsInBatch(BatchDirectory* dir, char* path, jint jMode, jint jChange) {
+    int currentMode = 0;
+    
+    if (!statMode(path, &currentMode) ||
+            chmod(path, changeMode(currentMode, jMode, jChange) & 07777) != 0) {
+        return errno;
+    }
+    return 0;
+}
+#endif
+
 
 JNIEXPORT jlong JNICALL Java_org_netbeans_installer_utils_system_UnixNativeUtils_getFreeSpace0(JNIEnv* jEnv, jobject jObject, jstring jPath) {
-    char* path   = getChars(jEnv, jPath);
+    NativeChars nativePath;
+    char* path   = getNativeChars(jEnv, jPath, &nativePath);
     jlong result = 0;
     
     struct statvfs fsstat;
-    if(memset(&fsstat, 0, sizeof(struct statvfs)) != NULL) {
+    if(path != NULL && memset(&fsstat, 0, sizeof(struct statvfs)) != NULL) {
         if(statvfs(path, &fsstat) == 0) {
             result = (jlong) fsstat.f_frsize;
             result *= (jlong) fsstat.f_bfree;
@@ -53,54 +151,480 @@ JNIEXPORT jlong JNICALL Java_org_netbeans_installer_utils_system_UnixNativeUtils
     }
     
     
-    FREE(path);
+    releaseNativeChars(&nativePath);
     return result;
 }
 
 
 JNIEXPORT void JNICALL Java_org_netbeans_installer_utils_system_UnixNativeUtils_setPermissions0(JNIEnv *jEnv, jobject jObject, jstring jPath, jint jMode, jint jChange) {
-    char* path = getChars(jEnv, jPath);    
+    NativeChars nativePath;
+    char* path = getNativeChars(jEnv, jPath, &nativePath);
     int currentMode = 0 ;
-    char * msg = NULL;
+    if(path == NULL) {
+        return;
+    }
     if(statMode(path, &currentMode)) {
-        switch (jChange) {
-            case MODE_CHANGE_SET:
-                currentMode |= (S_IRWXU | S_IRWXG | S_IRWXO);
-                currentMode &= jMode;
-                break;
-            case MODE_CHANGE_ADD:
-                currentMode |= jMode;
-                break;
-            case MODE_CHANGE_REMOVE:
-                currentMode &= ~jMode;
-                break;
-            default:     
-                msg = (char*) malloc(sizeof(char) * 60);
-                memset(msg, 0, sizeof(char) * 60);
-                sprintf(msg, "Selected change mode (%ld) is not supported", jChange);
-                throwException(jEnv, msg);
-                FREE(msg);
-                FREE(path);                
-                return;                
-        }
-        chmod(path, currentMode);
+        if (!isModeChangeSupported(jChange)) {
+            throwUnsupportedModeChange(jEnv, jChange);
+            releaseNativeChars(&nativePath);
+            return;
+        }
+        chmod(path, changeMode(currentMode, jMode, jChange));
     } else {
         throwException(jEnv, "Can`t get file current permissions");
     }
-    FREE(path);
+    releaseNativeChars(&nativePath);
+}
+
+
+JNIEXPORT jintArray JNICALL Java_org_netbeans_installer_utils_system_UnixNativeUtils_setPermissionsBatch0(JNIEnv *jEnv, jobject jObject, jobjectArray jPaths, jintArray jModes, jint jChange) {
+    jsize count = (*jEnv)->GetArrayLength(jEnv, jPaths);
+    jsize modesCount = (*jEnv)->GetArrayLength(jEnv, jModes);
+    jintArray jResult = NULL;
+    jint* modes = NULL;
+    jint* errors = NULL;
+    BatchDirectory dir;
+    jsize i;
+    
+    if (!isModeChangeSupported(jChange)) {
+        throwUnsupportedModeChange(jEnv, jChange);
+        return NULL;
+    }
+    // there is either a mode per path or one mode for all of them
+    if (modesCount != count && modesCount != 1) {
+        throwException(jEnv, "Number of modes doesn`t match the number of paths");
+        return NULL;
+    }
+    
+    jResult = (*jEnv)->NewIntArray(jEnv, count);
+    modes  = (jint*) MALLOC(sizeof(jint) * (modesCount + 1));
+    errors = (jint*) MALLOC(sizeof(jint) * (count + 1));
+    if (jResult == NULL || modes == NULL || errors == NULL) {
+        FREE(modes);
+        FREE(errors);
+        return NULL;
+    }
+    (*jEnv)->GetIntArrayRegion(jEnv, jModes, 0, modesCount, modes);
+    
+    dir.path = NULL;
+    dir.fd   = -1;
+    for (i = 0; i < count && !(*jEnv)->ExceptionCheck(jEnv); i++) {
+        jstring jPath = (jstring) (*jEnv)->GetObjectArrayElement(jEnv, jPaths, i);
+        NativeChars nativePath;
+        char* path;
+        
+        if (jPath == NULL) {
+            errors[i] = EINVAL;
+            continue;
+        }
+        path = getNativeChars(jEnv, jPath, &nativePath);
+        errors[i] = (path == NULL) ? ENOMEM :
+            setPermissionsInBatch(&dir, path, modes[modesCount == 1 ? 0 : i], jChange);
+        releaseNativeChars(&nativePath);
+        (*jEnv)->DeleteLocalRef(jEnv, jPath);
+    }
+    if (dir.fd >= 0) {
+        close(dir.fd);
+    }
+    FREE(dir.path);
+    
+    if (!(*jEnv)->ExceptionCheck(jEnv)) {
+        (*jEnv)->SetIntArrayRegion(jEnv, jResult, 0, count, errors);
+    }
+    FREE(modes);
+    FREE(errors);
+    return jResult;
+}
+
+#ifdef AT_FDCWD
+// state of applyTreePermissions0, shared by the threads walking the subtrees
+typedef struct _treeWalk {
+    int fileMode;
+    int dirMode;
+    jint change;
+    uid_t uid;
+    gid_t gid;
+    char** execGlobs;
+    int execGlobsNumber;
+    
+    int rootFd;
+    char* root;
+    char** subtrees;
+    int subtreesNumber;
+    int nextSubtree;
+    
+    pthread_mutex_t lock;
+    jlong files;
+    jlong directories;
+    jlong errors;
+    int errorCodes[TREE_MAX_ERRORS];
+    char* errorPaths[TREE_MAX_ERRORS];
+} TreeWalk;
+
+typedef struct _treeWorker {
+    TreeWalk* walk;
+    jlong files;
+    jlong directories;
+    char path[PATH_MAX];
+} TreeWorker;
+
+void addTreeError(TreeWalk* walk, const char* path, int error) {
+    pthread_mutex_lock(&walk->lock);
+    if (walk->errors < TREE_MAX_ERRORS) {
+        walk->errorCodes[walk->errors] = error;
+        walk->errorPaths[walk->errors] = strdup(path);
+    }
+    walk->errors++;
+    pthread_mutex_unlock(&walk->lock);
+}
+
+// globs with a slash are matched against the path relative to the root,
+// the others against the file name
+jboolean matchesExecGlob(TreeWalk* walk, const char* relativePath, const char* name) {
+    int i;
+    for (i = 0; i < walk->execGlobsNumber; i++) {
+        const char* glob = walk->execGlobs[i];
+        if (strchr(glob, '/') != NULL ?
+                fnmatch(glob, relativePath, FNM_PATHNAME) == 0 :
+                fnmatch(glob, name, 0) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// the mode is changed through a descriptor of the entry checked by fstatat,
+// so that an entry replaced in the meantime, e.g. by a symbolic link, is not
+// changed instead
+int changeTreeEntryMode(int dirFd, const char* name, struct stat* sb, int newMode, int flags) {
+    struct stat current;
+    int error = 0;
+    int fd = openat(dirFd, name, O_RDONLY | O_NONBLOCK | O_CLOEXEC |
+            ((flags & AT_SYMLINK_NOFOLLOW) ? O_NOFOLLOW : 0));
+    
+    if (fd < 0) {
+        // an unreadable entry can't be opened by a user other than root, who
+        // can change only the own files anyway
+        if (errno == EACCES && geteuid() != 0) {
+            return (fchmodat(dirFd, name, newMode, 0) == 0) ? 0 : errno;
+        }
+        return errno;
+    }
+    if (fstat(fd, &current) != 0) {
+        error = errno;
+    } else if (current.st_dev != sb->st_dev || current.st_ino != sb->st_ino) {
+        error = ENOENT;
+    } else if (fchmod(fd, newMode) != 0) {
+        error = errno;
+    }
+    close(fd);
+    return error;
+}
+
+// flags are those of the fstatat of the entry, the root is followed if it
+// is a symbolic link, the entries below it are not
+void applyTreeEntry(TreeWorker* worker, int dirFd, const char* name, struct stat* sb, int flags) {
+    TreeWalk* walk = worker->walk;
+    const char* relativePath = worker->path + strlen(walk->root);
+    int mode = S_ISDIR(sb->st_mode) ? walk->dirMode : walk->fileMode;
+    
+    while (*relativePath == '/') {
+        relativePath++;
+    }
+    // links, devices, pipes and sockets are left alone
+    if (mode != -1 && (S_ISREG(sb->st_mode) || S_ISDIR(sb->st_mode))) {
+        int newMode;
+        if (S_ISREG(sb->st_mode) && walk->change != MODE_CHANGE_REMOVE &&
+                matchesExecGlob(walk, relativePath, name)) {
+            // executable where readable
+            mode |= (mode & (S_IRUSR | S_IRGRP | S_IROTH)) >> 2;
+        }
+        newMode = changeMode(sb->st_mode, mode, walk->change) & 07777;
+        if (newMode != (int) (sb->st_mode & 07777)) {
+            int error = changeTreeEntryMode(dirFd, name, sb, newMode, flags);
+            if (error != 0) {
+                addTreeError(walk, worker->path, error);
+            }
+        }
+    }
+    if ((walk->uid != (uid_t) -1 && walk->uid != sb->st_uid) ||
+            (walk->gid != (gid_t) -1 && walk->gid != sb->st_gid)) {
+        if (fchownat(dirFd, name, walk->uid, walk->gid, flags) != 0) {
+            addTreeError(walk, worker->path, errno);
+        }
+    }
+}
+
+// worker->path holds the path of the entry, directories are changed after
+// their content so that a restrictive mode doesn't stop the walk
+void walkTreeEntry(TreeWorker* worker, int dirFd, const char* name) {
+    TreeWalk* walk = worker->walk;
+    struct stat sb;
+    
+    if (fstatat(dirFd, name, &sb, AT_SYMLINK_NOFOLLOW) != 0) {
+        addTreeError(walk, worker->path, errno);
+        return;
+    }
+    if (S_ISDIR(sb.st_mode)) {
+        int fd = openat(dirFd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        DIR* dir = (fd < 0) ? NULL : fdopendir(fd);
+        
+        if (dir == NULL) {
+            addTreeError(walk, worker->path, errno);
+            if (fd >= 0) {
+                close(fd);
+            }
+        } else {
+            size_t length = strlen(worker->path);
+            struct dirent* entry;
+            
+            while ((entry = readdir(dir)) != NULL) {
+                size_t nameLength = strlen(entry->d_name);
+                if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+                    continue;
+                }
+                if (length + nameLength + 2 > PATH_MAX) {
+                    addTreeError(walk, worker->path, ENAMETOOLONG);
+                    continue;
+                }
+                worker->path[length] = '/';
+                memcpy(worker->path + length + 1, entry->d_name, nameLength + 1);
+                walkTreeEntry(worker, fd, entry->d_name);
+                worker->path[length] = 0;
+            }
+            closedir(dir);
+        }
+        worker->directories++;
+    } else {
+        worker->files++;
+    }
+    applyTreeEntry(worker, dirFd, name, &sb, AT_SYMLINK_NOFOLLOW);
 }
 
+void* walkTreeWorker(void* param) {
+    TreeWorker* worker = (TreeWorker*) param;
+    TreeWalk* walk = worker->walk;
+    size_t rootLength = strlen(walk->root);
+    
+    for (;;) {
+        int index;
+        
+        pthread_mutex_lock(&walk->lock);
+        index = walk->nextSubtree++;
+        pthread_mutex_unlock(&walk->lock);
+        if (index >= walk->subtreesNumber) {
+            break;
+        }
+        if (rootLength + strlen(walk->subtrees[index]) + 2 > PATH_MAX) {
+            addTreeError(walk, walk->root, ENAMETOOLONG);
+            continue;
+        }
+        sprintf(worker->path, "%s/%s", walk->root, walk->subtrees[index]);
+        walkTreeEntry(worker, walk->rootFd, walk->subtrees[index]);
+    }
+    return NULL;
+}
+
+// top-level entries of the root are distributed over several threads
+void walkTree(TreeWalk* walk) {
+    TreeWorker* workers = NULL;
+    pthread_t threads[TREE_MAX_THREADS];
+    int created = 0;
+    int threadsNumber = 1;
+    int capacity = 0;
+    int i;
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    struct stat sb;
+    DIR* dir = NULL;
+    
+    if (fstatat(AT_FDCWD, walk->root, &sb, 0) != 0) {
+        addTreeError(walk, walk->root, errno);
+        return;
+    }
+    if (S_ISDIR(sb.st_mode)) {
+        walk->rootFd = open(walk->root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        dir = (walk->rootFd < 0) ? NULL : fdopendir(walk->rootFd);
+        if (dir == NULL) {
+            addTreeError(walk, walk->root, errno);
+            if (walk->rootFd >= 0) {
+                close(walk->rootFd);
+            }
+            walk->rootFd = -1;
+        } else {
+            struct dirent* entry;
+            while ((entry = readdir(dir)) != NULL) {
+                if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+                    continue;
+                }
+                if (walk->subtreesNumber == capacity) {
+                    char** subtrees;
+                    capacity = (capacity == 0) ? 64 : capacity * 2;
+                    subtrees = (char**) realloc(walk->subtrees, sizeof(char*) * capacity);
+                    if (subtrees == NULL) {
+                        addTreeError(walk, walk->root, ENOMEM);
+                        break;
+                    }
+                    walk->subtrees = subtrees;
+                }
+                walk->subtrees[walk->subtreesNumber] = strdup(entry->d_name);
+                if (walk->subtrees[walk->subtreesNumber] != NULL) {
+                    walk->subtreesNumber++;
+                }
+            }
+        }
+    }
+    
+    if (processors > TREE_MAX_THREADS) {
+        processors = TREE_MAX_THREADS;
+    }
+    if (processors > walk->subtreesNumber) {
+        processors = walk->subtreesNumber;
+    }
+    if (processors > 1) {
+        threadsNumber = (int) processors;
+    }
+    workers = (TreeWorker*) calloc(threadsNumber, sizeof(TreeWorker));
+    if (workers == NULL) {
+        addTreeError(walk, walk->root, ENOMEM);
+    } else {
+        for (i = 0; i < threadsNumber; i++) {
+            workers[i].walk = walk;
+        }
+        // the current thread is the first worker
+        for (i = 1; i < threadsNumber; i++) {
+            if (pthread_create(&threads[created], NULL, walkTreeWorker, &workers[i]) != 0) {
+                break;
+            }
+            created++;
+        }
+        walkTreeWorker(&workers[0]);
+        for (i = 0; i < created; i++) {
+            pthread_join(threads[i], NULL);
+        }
+        
+        for (i = 0; i < threadsNumber; i++) {
+            walk->files += workers[i].files;
+            walk->directories += workers[i].directories;
+        }
+        if (strlen(walk->root) < PATH_MAX) {
+            strcpy(workers[0].path, walk->root);
+            if (S_ISDIR(sb.st_mode)) {
+                walk->directories++;
+            } else {
+                walk->files++;
+            }
+            applyTreeEntry(&workers[0], AT_FDCWD, walk->root, &sb, 0);
+        }
+        free(workers);
+    }
+    
+    if (dir != NULL) {
+        closedir(dir);
+    }
+    for (i = 0; i < walk->subtreesNumber; i++) {
+        free(walk->subtrees[i]);
+    }
+    free(walk->subtrees);
+}
+
+JNIEXPORT jobjectArray JNICALL Java_org_netbeans_installer_utils_system_UnixNativeUtils_applyTreePermissions0(JNIEnv *jEnv, jobject jObject, jstring jRoot, jint jFileMode, jint jDirMode, jobjectArray jExecGlobs, jint jChange, jint jUid, jint jGid, jlongArray jCounts) {
+    jobjectArray jErrors = NULL;
+    TreeWalk walk;
+    int errorsNumber;
+    int i;
+    
+    if (!isModeChangeSupported(jChange)) {
+        throwUnsupportedModeChange(jEnv, jChange);
+        return NULL;
+    }
+    
+    memset(&walk, 0, sizeof(TreeWalk));
+    walk.fileMode = jFileMode;
+    walk.dirMode  = jDirMode;
+    walk.change   = jChange;
+    walk.uid      = (uid_t) jUid;
+    walk.gid      = (gid_t) jGid;
+    walk.rootFd   = -1;
+    walk.root     = getChars(jEnv, jRoot);
+    if (walk.root == NULL) {
+        return NULL;
+    }
+    if (jExecGlobs != NULL) {
+        jsize count = (*jEnv)->GetArrayLength(jEnv, jExecGlobs);
+        walk.execGlobs = (char**) calloc(count + 1, sizeof(char*));
+        for (i = 0; walk.execGlobs != NULL && i < count; i++) {
+            jstring jGlob = (jstring) (*jEnv)->GetObjectArrayElement(jEnv, jExecGlobs, i);
+            if (jGlob != NULL) {
+                char* glob = getChars(jEnv, jGlob);
+                if (glob != NULL) {
+                    walk.execGlobs[walk.execGlobsNumber++] = glob;
+                }
+                (*jEnv)->DeleteLocalRef(jEnv, jGlob);
+            }
+        }
+    }
+    pthread_mutex_init(&walk.lock, NULL);
+    
+    walkTree(&walk);
+    
+    pthread_mutex_destroy(&walk.lock);
+    for (i = 0; i < walk.execGlobsNumber; i++) {
+        FREE(walk.execGlobs[i]);
+    }
+    FREE(walk.execGlobs);
+    
+    if (jCounts != NULL && (*jEnv)->GetArrayLength(jEnv, jCounts) >= 3) {
+        jlong counts[3];
+        counts[0] = walk.files;
+        counts[1] = walk.directories;
+        counts[2] = walk.errors;
+        (*jEnv)->SetLongArrayRegion(jEnv, jCounts, 0, 3, counts);
+    }
+    
+    // only the first TREE_MAX_ERRORS errors are reported as "<path>: <error>"
+    errorsNumber = (walk.errors < TREE_MAX_ERRORS) ? (int) walk.errors : TREE_MAX_ERRORS;
+    jErrors = newStringArray(jEnv, errorsNumber);
+    for (i = 0; i < errorsNumber; i++) {
+        if (jErrors != NULL && walk.errorPaths[i] != NULL && !(*jEnv)->ExceptionCheck(jEnv)) {
+            const char* description = strerror(walk.errorCodes[i]);
+            char* message = (char*) malloc(strlen(walk.errorPaths[i]) + strlen(description) + 3);
+            if (message != NULL) {
+                jstring jMessage;
+                sprintf(message, "%s: %s", walk.errorPaths[i], description);
+                jMessage = getString(jEnv, message);
+                if (jMessage != NULL) {
+                    (*jEnv)->SetObjectArrayElement(jEnv, jErrors, i, jMessage);
+                    (*jEnv)->DeleteLocalRef(jEnv, jMessage);
+                }
+                FREE(message);
+            }
+        }
+        FREE(walk.errorPaths[i]);
+    }
+    FREE(walk.root);
+    
+    return jErrors;
+}
+#else
+JNIEXPORT jobjectArray JNICALL Java_org_netbeans_installer_utils_system_UnixNativeUtils_applyTreePermissions0(JNIEnv *jEnv, jobject jObject, jstring jRoot, jint jFileMode, jint jDirMode, jobjectArray jExecGlobs, jint jChange, jint jUid, jint jGid, jlongArray jCounts) {
+    throwException(jEnv, "Changing permissions of a tree is not supported on this platform");
+    return NULL;
+}
+#endif
+
 
 JNIEXPORT jint JNICALL Java_org_netbeans_installer_utils_system_UnixNativeUtils_getPermissions0(JNIEnv *jEnv, jobject jObject, jstring jPath) {
-    char* path = getChars(jEnv, jPath);
-    int currentMode;
-    if(statMode(path, &currentMode)) {
-        return currentMode & (S_IRWXU | S_IRWXG | S_IRWXO);
+    NativeChars nativePath;
+    char* path = getNativeChars(jEnv, jPath, &nativePath);
+    int currentMode = 0;
+    if(path != NULL && statMode(path, &currentMode)) {
+        currentMode &= (S_IRWXU | S_IRWXG | S_IRWXO);
     } else {
         throwException(jEnv, "Can`t get file current permissions");
     }
     
-    FREE(path);
+    releaseNativeChars(&nativePath);
+    return currentMode;
 }
 
 JNIEXPORT jboolean JNICALL Java_org_netbeans_installer_utils_system_UnixNativeUtils_isCurrentUserAdmin0 (JNIEnv *jEnv, jobject jObject) {
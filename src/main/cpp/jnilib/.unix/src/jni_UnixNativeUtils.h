@@ -40,6 +40,9 @@ extern "C" {
 #define MODE_CHANGE_SET 1L
 #define MODE_CHANGE_ADD 2L
 #define MODE_CHANGE_REMOVE 4L
+
+#define TREE_MAX_ERRORS  100
+#define TREE_MAX_THREADS 8
         
     
 
@@ -59,6 +62,22 @@ JNIEXPORT jlong JNICALL Java_org_netbeans_installer_utils_system_UnixNativeUtils
 JNIEXPORT void JNICALL Java_org_netbeans_installer_utils_system_UnixNativeUtils_setPermissions0
   (JNIEnv *, jobject, jstring, jint, jint);
 
+/*
+ * Class:     org_netbeans_installer_utils_system_UnixNativeUtils
+ * Method:    setPermissionsBatch0
+ * Signature: ([Ljava/lang/String;[II)[I
+ */
+JNIEXPORT jintArray JNICALL Java_org_netbeans_installer_utils_system_UnixNativeUtils_setPermissionsBatch0
+  (JNIEnv *, jobject, jobjectArray, jintArray, jint);
+
+/*
+ * Class:     org_netbeans_installer_utils_system_UnixNativeUtils
+ * Method:    applyTreePermissions0
+ * Signature: (Ljava/lang/String;II[Ljava/lang/String;III[J)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_org_netbeans_installer_utils_system_UnixNativeUtils_applyTreePermissions0
+  (JNIEnv *, jobject, jstring, jint, jint, jobjectArray, jint, jint, jint, jlongArray);
+
 /*
  * Class:     org_netbeans_installer_utils_system_UnixNativeUtils
  * Method:    getPermissions0
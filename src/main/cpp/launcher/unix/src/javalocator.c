@@ -0,0 +1,737 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Native replacement of the java searching part of launcher.sh :
+// searchJavaEnvironment, searchJavaSystemDefault, searchJavaSystemPaths
+// and verifyJVM/verifyJavaHome with the compatibility checks.
+//
+// Every line printed to stdout is a quoted assignment so the launcher can
+// simply eval the output :
+//   LAUNCHER_JAVA_EXE='/usr/lib/jvm/jdk/bin/java'
+//   LAUNCHER_JAVA='/usr/lib/jvm/jdk'
+//   LAUNCHER_JAVA_VERSION='17.0.2'
+//   LAUNCHER_JAVA_OSARCH='amd64'
+// Debug messages go to stderr, paths in them are never evaluated.
+// Exit code is 0 if compatible java was found, 1 if not, 2 on wrong usage.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glob.h>
+#include <regex.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "processrunner.h"
+
+#define EXIT_FOUND     0
+#define EXIT_NOT_FOUND 1
+#define EXIT_USAGE     2
+
+#define VERIFY_OK           1
+#define VERIFY_NOJAVA       2
+#define VERIFY_UNCOMPATIBLE 3
+
+#define MAX_COMPATIBLE    64
+#define MAX_LOCATIONS     256
+#define MAX_LINKS         40
+#define MAX_OUTPUT_LENGTH 65536
+#define JAVA_PROBE_TIMEOUT 10000 // as JAVA_VERIFICATION_PROCESS_TIMEOUT of the Windows launcher
+
+typedef struct _javaCompatible {
+    const char * minVersion;
+    const char * maxVersion;
+    const char * vendor;
+    const char * osName;
+    const char * osArch;
+} JavaCompatible;
+
+typedef struct _locatorOptions {
+    const char * classpath;
+    const char * testClass;
+    const char * suffixes;
+    const char * envVariables;
+    const char * privateDir;
+    int systemDefault;
+    int debug;
+    const char * locations[MAX_LOCATIONS];
+    int locationsNumber;
+    JavaCompatible compatible[MAX_COMPATIBLE];
+    int compatibleNumber;
+} LocatorOptions;
+
+static LocatorOptions options;
+static char * foundJavaExe = NULL;
+static char * foundJava = NULL;
+static char * foundJavaVersion = NULL;
+static char * foundJavaOsArch = NULL;
+
+static void debug(const char * message, const char * value) {
+    if (options.debug) {
+        fprintf(stderr, "# %s%s\n", message, (value != NULL) ? value : "");
+    }
+}
+
+static void * xmalloc(size_t size) {
+    void * ptr = calloc(1, size);
+    if (ptr == NULL) {
+        fprintf(stderr, "javalocator: out of memory\n");
+        exit(EXIT_USAGE);
+    }
+    return ptr;
+}
+
+static char * concat(const char * a, const char * b, const char * c) {
+    size_t la = strlen(a);
+    size_t lb = strlen(b);
+    size_t lc = strlen(c);
+    char * res = (char *) xmalloc(la + lb + lc + 1);
+    memcpy(res, a, la);
+    memcpy(res + la, b, lb);
+    memcpy(res + la + lb, c, lc);
+    return res;
+}
+
+static char * dirName(const char * path) {
+    const char * slash = strrchr(path, '/');
+    char * res;
+    if (slash == NULL) {
+        return strdup(".");
+    }
+    while (slash > path && *(slash - 1) == '/') {
+        slash--;
+    }
+    if (slash == path) {
+        return strdup("/");
+    }
+    res = (char *) xmalloc(slash - path + 1);
+    memcpy(res, path, slash - path);
+    return res;
+}
+
+static void removeEndSlashes(char * path) {
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == '/') {
+        path[--len] = 0;
+    }
+}
+
+static int isSymlink(const char * path) {
+    struct stat st;
+    return lstat(path, &st) == 0 && S_ISLNK(st.st_mode);
+}
+
+static int isDirectory(const char * path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static int isFile(const char * path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+// same as normalizePath in launcher.sh : removes /./, XXX/../ and duplicate separators
+static char * normalizePath(const char * path) {
+    size_t len = strlen(path);
+    char * res = (char *) xmalloc(len + 2);
+    const char * ptr = path;
+    size_t out = 0;
+    size_t root = (*path == '/') ? 1 : 0;
+
+    if (root) {
+        res[out++] = '/';
+    }
+    while (*ptr != 0) {
+        const char * end;
+        size_t segment;
+        while (*ptr == '/') {
+            ptr++;
+        }
+        for (end = ptr; *end != 0 && *end != '/'; end++) {
+        }
+        segment = end - ptr;
+        if (segment == 0) {
+            break;
+        }
+        if (segment == 1 && ptr[0] == '.') {
+            // skip
+        } else if (segment == 2 && ptr[0] == '.' && ptr[1] == '.' && out > root
+                && !(out - root >= 2 && res[out - 1] == '.' && res[out - 2] == '.'
+                     && (out - 2 == root || res[out - 3] == '/'))) {
+            // drop the previous segment
+            while (out > root && res[out - 1] != '/') {
+                out--;
+            }
+            if (out > root) {
+                out--;
+            }
+            res[out] = 0;
+        } else {
+            if (out > root) {
+                res[out++] = '/';
+            }
+            memcpy(res + out, ptr, segment);
+            out += segment;
+            res[out] = 0;
+        }
+        ptr = end;
+    }
+    if (out == 0) {
+        res[out++] = '.';
+    }
+    res[out] = 0;
+    return res;
+}
+
+// same as resolveSymlink in launcher.sh : follow the chain of links of the path itself
+static char * resolveSymlink(const char * path) {
+    char * current = strdup(path);
+    char link[PATH_MAX];
+    int counter = 0;
+
+    while (isSymlink(current) && counter++ < MAX_LINKS) {
+        ssize_t len = readlink(current, link, sizeof(link) - 1);
+        char * next;
+        if (len <= 0) {
+            break;
+        }
+        link[len] = 0;
+        if (link[0] == '/') {
+            next = normalizePath(link);
+        } else {
+            char * parent = dirName(current);
+            char * joined = concat(parent, "/", link);
+            next = normalizePath(joined);
+            free(joined);
+            free(parent);
+        }
+        free(current);
+        current = next;
+    }
+    return current;
+}
+
+// return 0 on no java, 1 on jre, 2 on jdk
+static int checkJavaHierarchy(const char * java) {
+    int hierarchy = 0;
+    if (*java != 0 && (isDirectory(java) || isSymlink(java))) {
+        char * bin = concat(java, "/", "bin");
+        if (isDirectory(bin) || isSymlink(bin)) {
+            char * javac = concat(bin, "/", "javac");
+            char * javaExe = concat(bin, "/", "java");
+            if (isFile(javac) || isSymlink(javac)) {
+                hierarchy = 2;
+            } else if (isFile(javaExe) || isSymlink(javaExe)) {
+                hierarchy = 1;
+            }
+            free(javac);
+            free(javaExe);
+        }
+        free(bin);
+    }
+    debug((hierarchy == 0) ? "... no java there" : ((hierarchy == 1) ? "... JRE there" : "... JDK there"), NULL);
+    return hierarchy;
+}
+
+// substitute all the matches of the extended regexp, \1..\9 are allowed in the replacement
+static char * substitute(const char * string, const char * pattern, const char * replacement) {
+    regex_t re;
+    regmatch_t match[10];
+    const char * ptr = string;
+    size_t capacity = strlen(string) * 2 + 16;
+    size_t out = 0;
+    char * res;
+    int flags = 0;
+
+    if (regcomp(&re, pattern, REG_EXTENDED) != 0) {
+        return strdup(string);
+    }
+    res = (char *) xmalloc(capacity);
+    while (*ptr != 0 && regexec(&re, ptr, 10, match, flags) == 0) {
+        const char * rep = replacement;
+        size_t needed = match[0].rm_so + strlen(replacement) + strlen(ptr) + 1;
+        if (out + needed >= capacity) {
+            capacity = (out + needed) * 2;
+            res = (char *) realloc(res, capacity);
+        }
+        memcpy(res + out, ptr, match[0].rm_so);
+        out += match[0].rm_so;
+        while (*rep != 0) {
+            if (rep[0] == '\\' && rep[1] >= '1' && rep[1] <= '9') {
+                regmatch_t * group = &match[rep[1] - '0'];
+                if (group->rm_so >= 0) {
+                    memcpy(res + out, ptr + group->rm_so, group->rm_eo - group->rm_so);
+                    out += group->rm_eo - group->rm_so;
+                }
+                rep += 2;
+            } else {
+                res[out++] = *rep++;
+            }
+        }
+        if (match[0].rm_eo == 0) {
+            // empty match, copy one char to avoid looping
+            res[out++] = *ptr++;
+        } else {
+            ptr += match[0].rm_eo;
+        }
+        flags = REG_NOTBOL;
+    }
+    if (out + strlen(ptr) + 1 >= capacity) {
+        capacity = out + strlen(ptr) + 1;
+        res = (char *) realloc(res, capacity);
+    }
+    strcpy(res + out, ptr);
+    regfree(&re);
+    return res;
+}
+
+// same as formatVersion in launcher.sh
+static char * formatVersion(const char * version) {
+    static const char * patterns[][2] = {
+        { "-ea", "" },
+        { "-rc[0-9]*", "" },
+        { "-beta[0-9]*", "" },
+        { "-preview[0-9]*", "" },
+        { "-dp[0-9]*", "" },
+        { "-alpha[0-9]*", "" },
+        { "-fcs", "" },
+        { "_", "." },
+        { "-", "." },
+        { "^(([0-9][0-9]*)\\.([0-9][0-9]*)\\.([0-9][0-9]*))\\.b([0-9][0-9]*)", "\\1.0.\\5" },
+        { "\\.b([0-9][0-9]*)", ".\\1" }
+    };
+    char * res = strdup(version);
+    size_t i;
+    for (i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+        char * next = substitute(res, patterns[i][0], patterns[i][1]);
+        free(res);
+        res = next;
+    }
+    return res;
+}
+
+static long long nextVersionValue(const char ** ptr) {
+    const char * start = *ptr;
+    const char * end = start;
+    long long value = 0;
+    int number = 1;
+    while (*end != 0 && *end != '.') {
+        if (*end < '0' || *end > '9') {
+            number = 0;
+        }
+        end++;
+    }
+    if (number && end > start) {
+        value = strtoll(start, NULL, 10);
+    }
+    *ptr = (*end == '.') ? end + 1 : end;
+    return value;
+}
+
+// same as compareVersions in launcher.sh : -1 less, 0 equal, 1 more
+static int compareVersions(const char * version1, const char * version2) {
+    char * formatted1 = formatVersion(version1);
+    char * formatted2 = formatVersion(version2);
+    const char * current1 = formatted1;
+    const char * current2 = formatted2;
+    int result = 0;
+
+    while (1) {
+        long long value1 = nextVersionValue(&current1);
+        long long value2 = nextVersionValue(&current2);
+        if (value1 > value2) {
+            result = 1;
+            break;
+        } else if (value2 > value1) {
+            result = -1;
+            break;
+        }
+        if (*current1 == 0 && *current2 == 0) {
+            break;
+        }
+    }
+    free(formatted1);
+    free(formatted2);
+    return result;
+}
+
+// same as sed "s/${pattern}//" changing the value
+static int matchesPattern(const char * value, const char * pattern) {
+    regex_t re;
+    int result;
+    if (regcomp(&re, pattern, REG_NOSUB) != 0) {
+        return 0;
+    }
+    result = (regexec(&re, value, 0, NULL, 0) == 0);
+    regfree(&re);
+    return result;
+}
+
+// run the test class and get its output
+static char * runJavaProbe(const char * javaExe) {
+    char * argv[5];
+    ProcessOutput output;
+    int exitCode;
+    int result;
+
+    argv[0] = (char *) javaExe;
+    argv[1] = (char *) "-classpath";
+    argv[2] = (char *) options.classpath;
+    argv[3] = (char *) options.testClass;
+    argv[4] = NULL;
+    result = runProcess(argv, JAVA_PROBE_TIMEOUT, MAX_OUTPUT_LENGTH, &output, &exitCode);
+    if (result != PROCESS_OK) {
+        debug((result == PROCESS_TIMEOUT) ? "... java verification timed out : " : "... can't run ", javaExe);
+        freeProcessOutput(&output);
+        return NULL;
+    }
+    return output.buffer;
+}
+
+// split the output into the first five lines
+static int getOutputLines(char * output, char ** lines, int number) {
+    char * ptr = output;
+    int i;
+    for (i = 0; i < number; i++) {
+        char * eol;
+        lines[i] = ptr;
+        eol = strchr(ptr, '\n');
+        if (eol == NULL) {
+            ptr += strlen(ptr);
+        } else {
+            *eol = 0;
+            if (eol > ptr && *(eol - 1) == '\r') {
+                *(eol - 1) = 0;
+            }
+            ptr = eol + 1;
+        }
+        if (*lines[i] == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int isJavaCompatible(const char * javaVersion, const char * vendor, const char * osName, const char * osArch) {
+    int i;
+    for (i = 0; i < options.compatibleNumber; i++) {
+        JavaCompatible * jc = &options.compatible[i];
+        int comp = 1;
+        debug("Min Java Version : ", jc->minVersion);
+        debug("Max Java Version : ", jc->maxVersion);
+        debug("Java Vendor      : ", jc->vendor);
+        debug("Java OS Name     : ", jc->osName);
+        debug("Java OS Arch     : ", jc->osArch);
+        if (*jc->minVersion != 0 && compareVersions(javaVersion, jc->minVersion) < 0) {
+            comp = 0;
+        }
+        if (*jc->maxVersion != 0 && compareVersions(javaVersion, jc->maxVersion) > 0) {
+            comp = 0;
+        }
+        if (*jc->vendor != 0 && !matchesPattern(vendor, jc->vendor)) {
+            debug("... vendor incompatible", NULL);
+            comp = 0;
+        }
+        if (*jc->osName != 0 && !matchesPattern(osName, jc->osName)) {
+            debug("... osname incompatible", NULL);
+            comp = 0;
+        }
+        if (*jc->osArch != 0 && !matchesPattern(osArch, jc->osArch)) {
+            debug("... osarch incompatible", NULL);
+            comp = 0;
+        }
+        debug("       compatible = ", comp ? "[1]" : "[0]");
+        if (comp) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int verifyJavaHome(const char * location) {
+    int result = VERIFY_NOJAVA;
+    char * copy = strdup(location);
+    char * java;
+    const char * pointer = options.suffixes;
+
+    removeEndSlashes(copy);
+    debug("... verify    : ", copy);
+    java = resolveSymlink(copy);
+    free(copy);
+    debug("... real path : ", java);
+
+    if (checkJavaHierarchy(java) == 0) {
+        free(java);
+        return result;
+    }
+    while (*pointer != 0 && foundJavaExe == NULL) {
+        const char * end = strchr(pointer, ':');
+        size_t length = (end == NULL) ? strlen(pointer) : (size_t) (end - pointer);
+        char * suffix = strndup(pointer, length);
+        char * javaExe = concat(java, "/", suffix);
+        pointer += length;
+        if (*pointer == ':') {
+            pointer++;
+        }
+        if (length > 0 && access(javaExe, X_OK) == 0) {
+            char * output;
+            char * lines[5];
+            debug("Executing java verification command : ", javaExe);
+            output = runJavaProbe(javaExe);
+            if (output != NULL && getOutputLines(output, lines, 5)) {
+                // version is the part of java.vm.version starting with java.version, if any
+                char * javaVersion = strstr(lines[1], lines[0]);
+                char * cut;
+                if (javaVersion == NULL) {
+                    javaVersion = lines[0];
+                }
+                debug("       executable = ", javaExe);
+                debug("      javaVersion = ", lines[0]);
+                debug("    javaVmVersion = ", lines[1]);
+                debug("           vendor = ", lines[2]);
+                debug("           osname = ", lines[3]);
+                debug("           osarch = ", lines[4]);
+                // remove build number
+                javaVersion = strdup(javaVersion);
+                if ((cut = strchr(javaVersion, '-')) != NULL) {
+                    *cut = 0;
+                }
+                if ((cut = strchr(javaVersion, ' ')) != NULL) {
+                    *cut = 0;
+                }
+                result = VERIFY_UNCOMPATIBLE;
+                if (*javaVersion != 0) {
+                    debug(" checking java version = ", javaVersion);
+                    if (isJavaCompatible(javaVersion, lines[2], lines[3], lines[4])) {
+                        foundJavaExe = strdup(javaExe);
+                        foundJava = strdup(java);
+                        foundJavaVersion = strdup(javaVersion);
+                        foundJavaOsArch = strdup(lines[4]);
+                        result = VERIFY_OK;
+                    }
+                }
+                free(javaVersion);
+            }
+            free(output);
+        }
+        free(javaExe);
+        free(suffix);
+    }
+    free(java);
+    return result;
+}
+
+static int verifyJVM(const char * location) {
+    char * javaTryPath = normalizePath(location);
+    int result = verifyJavaHome(javaTryPath);
+    if (result != VERIFY_OK) {
+        int saved = result;
+        char * privatePath = concat(javaTryPath, "/", options.privateDir);
+        result = verifyJavaHome(privatePath);
+        if (result == VERIFY_NOJAVA) {
+            result = saved;
+        }
+        free(privatePath);
+    }
+    free(javaTryPath);
+    return result;
+}
+
+static void searchJavaEnvironment(void) {
+    const char * pointer = options.envVariables;
+    while (*pointer != 0 && foundJavaExe == NULL) {
+        const char * end = strchr(pointer, ':');
+        size_t length = (end == NULL) ? strlen(pointer) : (size_t) (end - pointer);
+        char * name = strndup(pointer, length);
+        const char * value = getenv(name);
+        pointer += length;
+        if (*pointer == ':') {
+            pointer++;
+        }
+        if (value != NULL && *value != 0) {
+            debug("EnvVar ", name);
+            verifyJVM(value);
+        }
+        free(name);
+    }
+}
+
+static char * findOnPath(const char * name) {
+    const char * path = getenv("PATH");
+    const char * pointer = (path == NULL) ? "" : path;
+    while (*pointer != 0) {
+        const char * end = strchr(pointer, ':');
+        size_t length = (end == NULL) ? strlen(pointer) : (size_t) (end - pointer);
+        char * dir = (length == 0) ? strdup(".") : strndup(pointer, length);
+        char * file = concat(dir, "/", name);
+        free(dir);
+        pointer += length;
+        if (*pointer == ':') {
+            pointer++;
+        }
+        if (isFile(file) && access(file, X_OK) == 0) {
+            return file;
+        }
+        free(file);
+    }
+    return NULL;
+}
+
+static void searchJavaSystemDefault(void) {
+    char * javaBin;
+    if (foundJavaExe != NULL) {
+        return;
+    }
+    debug("... check default java in the path", NULL);
+    javaBin = findOnPath("java");
+    if (javaBin != NULL) {
+        char * real;
+        char * parent;
+        char * home;
+        char * realHome;
+        debug("... java in path found: ", javaBin);
+        real = resolveSymlink(javaBin);
+        debug("... java real path: ", real);
+        parent = dirName(real);
+        home = dirName(parent);
+        debug("... java home path: ", home);
+        realHome = resolveSymlink(home);
+        debug("... java home real path: ", realHome);
+        verifyJVM(realHome);
+        free(realHome);
+        free(home);
+        free(parent);
+        free(real);
+        free(javaBin);
+    }
+}
+
+static void searchJavaSystemPaths(void) {
+    int i;
+    for (i = 0; i < options.locationsNumber && foundJavaExe == NULL; i++) {
+        glob_t items;
+        size_t j;
+        debug("... next location ", options.locations[i]);
+        // sorted as ls -d does
+        if (glob(options.locations[i], 0, NULL, &items) != 0) {
+            continue;
+        }
+        for (j = 0; j < items.gl_pathc && foundJavaExe == NULL; j++) {
+            char * item = strdup(items.gl_pathv[j]);
+            removeEndSlashes(item);
+            if (isDirectory(item) || isSymlink(item)) {
+                debug("... checking item : ", item);
+                verifyJVM(item);
+            }
+            free(item);
+        }
+        globfree(&items);
+    }
+}
+
+static void printShellVariable(const char * name, const char * value) {
+    printf("%s='", name);
+    while (*value != 0) {
+        if (*value == '\'') {
+            fputs("'\\''", stdout);
+        } else {
+            putchar(*value);
+        }
+        value++;
+    }
+    printf("'\n");
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: javalocator --classpath <path> --class <name> [options]\n"
+            "  --suffixes <list>       colon-separated java executables relative to java home\n"
+            "  --env <list>            colon-separated environment variables to check\n"
+            "  --system-default        check the java found on the PATH\n"
+            "  --location <pattern>    glob of a system location, can be repeated\n"
+            "  --compatible <min> <max> <vendor> <osname> <osarch>\n"
+            "                          compatibility entry, can be repeated\n"
+            "  --private-dir <name>    subdirectory checked as private jre (jre or Home)\n"
+            "  --debug                 print debug messages to stderr\n");
+    exit(EXIT_USAGE);
+}
+
+int main(int argc, char ** argv) {
+    int i;
+    options.suffixes = "bin/java:";
+    options.envVariables = "";
+    options.privateDir = "jre";
+
+    for (i = 1; i < argc; i++) {
+        const char * arg = argv[i];
+        if (strcmp(arg, "--classpath") == 0 && i + 1 < argc) {
+            options.classpath = argv[++i];
+        } else if (strcmp(arg, "--class") == 0 && i + 1 < argc) {
+            options.testClass = argv[++i];
+        } else if (strcmp(arg, "--suffixes") == 0 && i + 1 < argc) {
+            options.suffixes = argv[++i];
+        } else if (strcmp(arg, "--env") == 0 && i + 1 < argc) {
+            options.envVariables = argv[++i];
+        } else if (strcmp(arg, "--private-dir") == 0 && i + 1 < argc) {
+            options.privateDir = argv[++i];
+        } else if (strcmp(arg, "--system-default") == 0) {
+            options.systemDefault = 1;
+        } else if (strcmp(arg, "--debug") == 0) {
+            options.debug = 1;
+        } else if (strcmp(arg, "--location") == 0 && i + 1 < argc) {
+            if (options.locationsNumber < MAX_LOCATIONS) {
+                options.locations[options.locationsNumber++] = argv[i + 1];
+            }
+            i++;
+        } else if (strcmp(arg, "--compatible") == 0 && i + 5 < argc) {
+            if (options.compatibleNumber < MAX_COMPATIBLE) {
+                JavaCompatible * jc = &options.compatible[options.compatibleNumber++];
+                jc->minVersion = argv[i + 1];
+                jc->maxVersion = argv[i + 2];
+                jc->vendor     = argv[i + 3];
+                jc->osName     = argv[i + 4];
+                jc->osArch     = argv[i + 5];
+            }
+            i += 5;
+        } else {
+            usage();
+        }
+    }
+    if (options.classpath == NULL || options.testClass == NULL) {
+        usage();
+    }
+
+    searchJavaEnvironment();
+    if (options.systemDefault) {
+        searchJavaSystemDefault();
+    }
+    searchJavaSystemPaths();
+
+    if (foundJavaExe == NULL) {
+        return EXIT_NOT_FOUND;
+    }
+    printShellVariable("LAUNCHER_JAVA_EXE", foundJavaExe);
+    printShellVariable("LAUNCHER_JAVA", foundJava);
+    printShellVariable("LAUNCHER_JAVA_VERSION", foundJavaVersion);
+    printShellVariable("LAUNCHER_JAVA_OSARCH", foundJavaOsArch);
+    return EXIT_FOUND;
+}
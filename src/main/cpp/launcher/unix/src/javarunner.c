@@ -0,0 +1,323 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Runs the main class of the installer in this process : libjvm.so of the
+// found java is loaded and the VM is created with the invocation API, so
+// launcher.sh doesn't need to build and eval a java command line.
+//
+//   javarunner [--remove-dir <dir>] <java home> [jvm options] -classpath <classpath> <main class> [arguments]
+//
+// launcher.sh execs the runner, so the shell doesn't wait for it and the
+// extraction directory given by --remove-dir is removed by the runner on exit.
+// The output of the application goes to the inherited stdout/stderr.
+// Exit code is the one of the application or 1 if the main method failed
+// with an exception. If the VM can't be loaded or created, <java home>/bin/java
+// is executed with the same arguments instead.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <glob.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <jni.h>
+
+#include "treedelete.h"
+
+#define EXIT_EXCEPTION 1
+#define EXIT_USAGE     2
+
+#define THREAD_STACK_SIZE (8 * 1024 * 1024)
+
+typedef jint (JNICALL * CreateJavaVMFunction)(JavaVM **, void **, void *);
+
+typedef struct _runnerOptions {
+    const char * removeDir;
+    const char * javaHome;
+    JavaVMOption * jvmOptions;
+    int jvmOptionsNumber;
+    char * mainClass;
+    char ** arguments;
+    int argumentsNumber;
+} RunnerOptions;
+
+static const char * JVM_LIBRARIES [] = {
+    "/lib/server/libjvm.so",
+    "/lib/client/libjvm.so",
+    "/lib/*/server/libjvm.so",
+    "/lib/*/client/libjvm.so",
+    "/jre/lib/*/server/libjvm.so",
+    "/jre/lib/*/client/libjvm.so",
+    NULL
+};
+
+// launcher options of java that the VM accepts only as --name=value
+static const char * JOINED_OPTIONS [] = {
+    "--add-modules",
+    "--add-opens",
+    "--add-exports",
+    "--add-reads",
+    "--module-path",
+    "--upgrade-module-path",
+    "--limit-modules",
+    NULL
+};
+
+static RunnerOptions options;
+
+static void * xmalloc(size_t size) {
+    void * ptr = calloc(1, size);
+    if (ptr == NULL) {
+        fprintf(stderr, "javarunner: out of memory\n");
+        exit(EXIT_USAGE);
+    }
+    return ptr;
+}
+
+static char * concat(const char * a, const char * b, const char * c) {
+    size_t la = strlen(a);
+    size_t lb = strlen(b);
+    size_t lc = strlen(c);
+    char * res = (char *) xmalloc(la + lb + lc + 1);
+    memcpy(res, a, la);
+    memcpy(res + la, b, lb);
+    memcpy(res + la + lb, c, lc);
+    return res;
+}
+
+static int isJoinedOption(const char * arg) {
+    int i;
+    for (i = 0; JOINED_OPTIONS[i] != NULL; i++) {
+        if (strcmp(arg, JOINED_OPTIONS[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int parseArguments(int argc, char ** argv) {
+    int i = 1;
+    if (argc > 2 && strcmp(argv[1], "--remove-dir") == 0) {
+        options.removeDir = argv[2];
+        i = 3;
+    }
+    if (argc < i + 2) {
+        return 0;
+    }
+    options.javaHome = argv[i++];
+    // there is at most one VM option per argument
+    options.jvmOptions = (JavaVMOption *) xmalloc(sizeof(JavaVMOption) * argc);
+    while (i < argc && argv[i][0] == '-') {
+        const char * arg = argv[i++];
+        char * option;
+        if (strcmp(arg, "-classpath") == 0 || strcmp(arg, "-cp") == 0) {
+            if (i == argc) {
+                return 0;
+            }
+            option = concat("-Djava.class.path=", argv[i++], "");
+        } else if (isJoinedOption(arg) && i < argc) {
+            option = concat(arg, "=", argv[i++]);
+        } else {
+            option = concat(arg, "", "");
+        }
+        options.jvmOptions[options.jvmOptionsNumber++].optionString = option;
+    }
+    if (i == argc) {
+        return 0;
+    }
+    options.mainClass = concat(argv[i++], "", "");
+    options.arguments = argv + i;
+    options.argumentsNumber = argc - i;
+    return 1;
+}
+
+static void * loadJVMLibrary(const char * javaHome) {
+    void * jvm = NULL;
+    int i;
+    for (i = 0; JVM_LIBRARIES[i] != NULL && jvm == NULL; i++) {
+        char * pattern = concat(javaHome, JVM_LIBRARIES[i], "");
+        glob_t found;
+        if (glob(pattern, 0, NULL, &found) == 0) {
+            size_t j;
+            for (j = 0; j < found.gl_pathc && jvm == NULL; j++) {
+                jvm = dlopen(found.gl_pathv[j], RTLD_NOW | RTLD_GLOBAL);
+                if (jvm == NULL) {
+                    fprintf(stderr, "javarunner: %s\n", dlerror());
+                }
+            }
+        }
+        globfree(&found);
+        free(pattern);
+    }
+    return jvm;
+}
+
+// strings are decoded by the platform charset as the java launcher does
+static jstring newPlatformString(JNIEnv * env, jclass stringClass, jmethodID constructor, const char * value) {
+    jsize length = (jsize) strlen(value);
+    jbyteArray bytes = (*env)->NewByteArray(env, length);
+    jstring result = NULL;
+    if (bytes != NULL) {
+        (*env)->SetByteArrayRegion(env, bytes, 0, length, (const jbyte *) value);
+        result = (jstring) (*env)->NewObject(env, stringClass, constructor, bytes);
+        (*env)->DeleteLocalRef(env, bytes);
+    }
+    return result;
+}
+
+static jobjectArray newArguments(JNIEnv * env) {
+    jclass stringClass = (*env)->FindClass(env, "java/lang/String");
+    jmethodID constructor = NULL;
+    jobjectArray result = NULL;
+    int i;
+    if (stringClass != NULL) {
+        constructor = (*env)->GetMethodID(env, stringClass, "<init>", "([B)V");
+    }
+    if (constructor != NULL) {
+        result = (*env)->NewObjectArray(env, options.argumentsNumber, stringClass, NULL);
+    }
+    for (i = 0; result != NULL && i < options.argumentsNumber; i++) {
+        jstring arg = newPlatformString(env, stringClass, constructor, options.arguments[i]);
+        if (arg == NULL) {
+            return NULL;
+        }
+        (*env)->SetObjectArrayElement(env, result, i, arg);
+        (*env)->DeleteLocalRef(env, arg);
+    }
+    return result;
+}
+
+static void * runMainClass(void * param) {
+    CreateJavaVMFunction createJavaVM = (CreateJavaVMFunction) param;
+    JavaVMInitArgs args;
+    JavaVM * vm = NULL;
+    JNIEnv * env = NULL;
+    jclass mainClass;
+    jmethodID mainMethod = NULL;
+    jobjectArray arguments = NULL;
+    long exitCode = EXIT_EXCEPTION;
+    char * ptr;
+
+    args.version = JNI_VERSION_1_2;
+    args.nOptions = options.jvmOptionsNumber;
+    args.options = options.jvmOptions;
+    args.ignoreUnrecognized = JNI_FALSE;
+    if (createJavaVM(&vm, (void **) &env, &args) != JNI_OK) {
+        return NULL;
+    }
+
+    for (ptr = options.mainClass; *ptr != '\0'; ptr++) {
+        if (*ptr == '.') {
+            *ptr = '/';
+        }
+    }
+    mainClass = (*env)->FindClass(env, options.mainClass);
+    if (mainClass != NULL) {
+        mainMethod = (*env)->GetStaticMethodID(env, mainClass, "main", "([Ljava/lang/String;)V");
+    }
+    if (mainMethod != NULL) {
+        arguments = newArguments(env);
+    }
+    if (arguments != NULL) {
+        (*env)->CallStaticVoidMethod(env, mainClass, mainMethod, arguments);
+    }
+    if ((*env)->ExceptionOccurred(env) != NULL) {
+        (*env)->ExceptionDescribe(env);
+    } else if (arguments != NULL) {
+        exitCode = 0;
+    }
+
+    // waits for all non-daemon threads, System.exit() ends the process directly
+    (*vm)->DetachCurrentThread(vm);
+    (*vm)->DestroyJavaVM(vm);
+    return (void *) (exitCode + 1);
+}
+
+// the jars may still be open, that doesn't matter for unlinking them
+static void removeDirectory(void) {
+    if (options.removeDir != NULL) {
+        // one thread, the process is exiting
+        deleteTree(options.removeDir, 1);
+    }
+}
+
+// bin/java is run in a child process only if there is a directory to remove after it
+static void executeJava(char ** argv, int javaHomeIndex) {
+    char * javaExe = concat(options.javaHome, "/bin/java", "");
+    char ** javaArgv = argv + javaHomeIndex;
+    pid_t pid = 0;
+    int status;
+
+    javaArgv[0] = javaExe;
+    if (options.removeDir != NULL) {
+        pid = fork();
+    }
+    if (pid == 0) {
+        execv(javaExe, javaArgv);
+        fprintf(stderr, "javarunner: can't execute %s\n", javaExe);
+        _exit(EXIT_USAGE);
+    } else if (pid < 0) {
+        fprintf(stderr, "javarunner: can't execute %s\n", javaExe);
+        exit(EXIT_USAGE);
+    }
+    status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+        // interrupted by a signal, wait again
+    }
+    exit(WIFSIGNALED(status) ? 128 + WTERMSIG(status) : WEXITSTATUS(status));
+}
+
+int main(int argc, char ** argv) {
+    void * jvm;
+    void * createJavaVM = NULL;
+    pthread_t thread;
+    pthread_attr_t attr;
+    void * result = NULL;
+
+    if (!parseArguments(argc, argv)) {
+        fprintf(stderr, "Usage: javarunner [--remove-dir <dir>] <java home> [jvm options] -classpath <classpath> <main class> [arguments]\n");
+        return EXIT_USAGE;
+    }
+    // also run when System.exit() ends the process
+    atexit(removeDirectory);
+
+    jvm = loadJVMLibrary(options.javaHome);
+    if (jvm != NULL) {
+        createJavaVM = dlsym(jvm, "JNI_CreateJavaVM");
+    }
+    if (createJavaVM == NULL) {
+        executeJava(argv, (options.removeDir != NULL) ? 3 : 1);
+    }
+
+    // the VM is not created on the primordial thread, as the java launcher does
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, THREAD_STACK_SIZE);
+    if (pthread_create(&thread, &attr, runMainClass, createJavaVM) == 0) {
+        pthread_join(thread, &result);
+    }
+    pthread_attr_destroy(&attr);
+    if (result == NULL) {
+        executeJava(argv, (options.removeDir != NULL) ? 3 : 1);
+    }
+    return (int) ((long) result - 1);
+}
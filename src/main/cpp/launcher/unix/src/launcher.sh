@@ -30,10 +30,12 @@ ARG_HELP="--help"
 ARG_SILENT="--silent"
 ARG_NOSPACECHECK="--nospacecheck"
 ARG_LOCALE="--locale"
+ARG_INPROCESS_JVM="--in-process-jvm"
 
 USE_DEBUG_OUTPUT=0
 PERFORM_FREE_SPACE_CHECK=1
 SILENT_MODE=0
+INPROCESS_JVM=0
 EXTRACT_ONLY=0
 SHOW_HELP_ONLY=0
 LOCAL_OVERRIDDEN=0
@@ -41,6 +43,11 @@ APPEND_CP=
 PREPEND_CP=
 LAUNCHER_APP_ARGUMENTS=
 LAUNCHER_JVM_ARGUMENTS=
+MEMORY_RULE_HEAP_PERCENT=
+MEMORY_RULE_HEAP_MIN=
+MEMORY_RULE_HEAP_MAX=
+MEMORY_RULE_PROCESSORS=
+MEMORY_RULE_GC=
 ERROR_OK=0
 ERROR_TEMP_DIRECTORY=2
 ERROR_TEST_JVM_FILE=3
@@ -142,7 +149,7 @@ debugLauncherArguments() {
 }
 isLauncherCommandArgument() {
 	case "$1" in
-	    $ARG_VERBOSE | $ARG_NOSPACECHECK | $ARG_OUTPUT | $ARG_HELP | $ARG_JAVAHOME | $ARG_TEMPDIR | $ARG_EXTRACT | $ARG_SILENT | $ARG_LOCALE | $ARG_CLASSPATHP | $ARG_CLASSPATHA)
+	    $ARG_VERBOSE | $ARG_NOSPACECHECK | $ARG_OUTPUT | $ARG_HELP | $ARG_JAVAHOME | $ARG_TEMPDIR | $ARG_EXTRACT | $ARG_SILENT | $ARG_LOCALE | $ARG_CLASSPATHP | $ARG_CLASSPATHA | $ARG_INPROCESS_JVM)
 	    	echo 1
 		;;
 	    *)
@@ -196,6 +203,9 @@ parseCommandLineArguments() {
 				LAUNCHER_EXTRACT_DIR="$CURRENT_DIRECTORY"				
 			fi
 			;;
+		$ARG_INPROCESS_JVM)
+			INPROCESS_JVM=1
+			;;
 		$ARG_SILENT)
 			SILENT_MODE=1
 			parseJvmAppArgument "$1"
@@ -542,7 +552,11 @@ exitProgram() {
 	if [ 0 -eq $EXTRACT_ONLY ] ; then
 	    if [ -n "$LAUNCHER_EXTRACT_DIR" ] && [ -d "$LAUNCHER_EXTRACT_DIR" ]; then		
 		debug "Removing directory $LAUNCHER_EXTRACT_DIR"
-		rm -rf "$LAUNCHER_EXTRACT_DIR" > /dev/null 2>&1
+		# the native tree tool deletes the files in parallel, see deleteTree
+		if [ -z "$LAUNCHER_TREE_TOOL" ] || [ ! -x "$LAUNCHER_TREE_TOOL" ] || \
+			! "$LAUNCHER_TREE_TOOL" --delete-tree "$LAUNCHER_EXTRACT_DIR" > /dev/null 2>&1 ; then
+			rm -rf "$LAUNCHER_EXTRACT_DIR" > /dev/null 2>&1
+		fi
 	    fi
 	fi
 	debug "exitCode = $1"
@@ -627,6 +641,12 @@ createTempDirectory() {
 extractJVMData() {
 	debug "Extracting testJVM file data..."
         extractTestJVMFile
+	debug "Extracting native java locator..."
+	extractJavaLocator
+	debug "Extracting native java runner..."
+	extractJavaRunner
+	debug "Extracting native tree tool..."
+	extractTreeTool
 	debug "Extracting bundled JVMs ..."
 	extractJVMFiles        
 	debug "Extracting JVM data done"
@@ -670,6 +690,36 @@ extractTestJVMFile() {
         
 }
 
+extractJavaLocator() {
+	# optional resource, follows the testJVM file in the bundled data
+	if [ -n "$JAVA_LOCATOR_TYPE" ] ; then
+		LAUNCHER_JAVA_LOCATOR=`resolveResourcePath "JAVA_LOCATOR"`
+		extractResource "JAVA_LOCATOR"
+		chmod +x "$LAUNCHER_JAVA_LOCATOR" > /dev/null 2>&1
+		debug "... java locator : $LAUNCHER_JAVA_LOCATOR"
+	fi
+}
+
+extractJavaRunner() {
+	# optional resource, follows the java locator in the bundled data
+	if [ -n "$JAVA_RUNNER_TYPE" ] ; then
+		LAUNCHER_JAVA_RUNNER=`resolveResourcePath "JAVA_RUNNER"`
+		extractResource "JAVA_RUNNER"
+		chmod +x "$LAUNCHER_JAVA_RUNNER" > /dev/null 2>&1
+		debug "... java runner : $LAUNCHER_JAVA_RUNNER"
+	fi
+}
+
+extractTreeTool() {
+	# optional resource, follows the java runner in the bundled data
+	if [ -n "$TREE_TOOL_TYPE" ] ; then
+		LAUNCHER_TREE_TOOL=`resolveResourcePath "TREE_TOOL"`
+		extractResource "TREE_TOOL"
+		chmod +x "$LAUNCHER_TREE_TOOL" > /dev/null 2>&1
+		debug "... tree tool : $LAUNCHER_TREE_TOOL"
+	fi
+}
+
 installJVM() {
 	message "$MSG_PREPARE_JVM"	
 	jvmFile=`resolveRelativity "$1"`
@@ -680,12 +730,29 @@ installJVM() {
 		message "$MSG_ERROR_EXTRACT_JVM"
 		exitProgram $ERROR_JVM_EXTRACTION
 	fi
-        chmod +x "$jvmFile" > /dev/null  2>&1
 	jvmFileEscaped=`escapeString "$jvmFile"`
         jvmDirEscaped=`escapeString "$jvmDir"`
 	cd "$jvmDir"
-        runCommand "$jvmFileEscaped"
-	ERROR_CODE=$?
+	if [ "`od -An -tx1 -N2 "$jvmFile" 2>/dev/null | tr -d ' '`" = "1f8b" ] ; then
+		# tar.gz archive is streamed into the directory, no self-extractor to run
+		debug "JVM archive : tar.gz"
+		# the status of a pipe is that of tar, gzip leaves its own in a file
+		gzipStatusFile="$jvmFile.status"
+		{ gzip -dc "$jvmFile" ; echo $? > "$gzipStatusFile" ; } | tar xf -
+		ERROR_CODE=$?
+		if [ $ERROR_CODE -eq 0 ] ; then
+			# 2 is only a warning of gzip, like trailing garbage after the archive
+			case "`cat "$gzipStatusFile" 2>/dev/null`" in
+				0|2) ERROR_CODE=0 ;;
+				*) ERROR_CODE=1 ;;
+			esac
+		fi
+		rm -f "$gzipStatusFile" > /dev/null 2>&1
+	else
+		chmod +x "$jvmFile" > /dev/null  2>&1
+		runCommand "$jvmFileEscaped"
+		ERROR_CODE=$?
+	fi
 
         cd "$CURRENT_DIRECTORY"
 
@@ -1024,6 +1091,65 @@ searchJavaSystemPaths() {
 	fi
 }
 
+searchJavaNative() {
+	# search java in the environment, on the path and in the system locations 
+	# by one call of the native locator instead of the sed/awk based verifyJVM
+	javaLocatorUsed=0
+	if [ -z "$LAUNCHER_JAVA_EXE" ] && [ -n "$LAUNCHER_JAVA_LOCATOR" ] && [ -x "$LAUNCHER_JAVA_LOCATOR" ] ; then
+		debug "... search java using $LAUNCHER_JAVA_LOCATOR"
+		if [ 1 -eq $isMacOSX ] ; then
+			privateJavaDir="Home"
+		else
+			privateJavaDir="jre"
+		fi
+		set -- "$LAUNCHER_JAVA_LOCATOR" --classpath "$TEST_JVM_CLASSPATH" --class "$TEST_JVM_CLASS" \
+			--suffixes "$POSSIBLE_JAVA_EXE_SUFFIX" --env "$POSSIBLE_JAVA_ENV" \
+			--private-dir "$privateJavaDir" --system-default
+		if [ 1 -eq $USE_DEBUG_OUTPUT ] ; then
+			set -- "$@" --debug
+		fi
+
+		javaCounter=0
+		while [ $javaCounter -lt $JAVA_LOCATION_NUMBER ] ; do
+			fileType=`resolveResourceType "JAVA_LOCATION_$javaCounter"`
+			if [ $fileType -ne 0 ] ; then # bundled JVMs have already been proceeded
+				argJavaHome=`resolveResourcePath "JAVA_LOCATION_$javaCounter"`
+				set -- "$@" --location "$argJavaHome"
+			fi
+			javaCounter=`expr "$javaCounter" + 1`
+		done
+
+		javaCompCounter=0
+		while [ $javaCompCounter -lt $JAVA_COMPATIBLE_PROPERTIES_NUMBER ] ; do
+			setJavaCompatibilityProperties_$javaCompCounter
+			set -- "$@" --compatible "$JAVA_COMP_VERSION_MIN" "$JAVA_COMP_VERSION_MAX" \
+				"$JAVA_COMP_VENDOR" "$JAVA_COMP_OSNAME" "$JAVA_COMP_OSARCH"
+			javaCompCounter=`expr "$javaCompCounter" + 1`
+		done
+
+		# debug messages of the locator come on stderr, they are only shown
+		locatorLog=/dev/null
+		if [ 1 -eq $USE_DEBUG_OUTPUT ] ; then
+			locatorLog="$LAUNCHER_EXTRACT_DIR/javalocator.log"
+		fi
+		locatorOutput=`"$@" 2>"$locatorLog"`
+		locatorResult=$?
+		if [ 1 -eq $USE_DEBUG_OUTPUT ] ; then
+			if [ -s "$locatorLog" ] ; then
+				out "`cat "$locatorLog"`"
+			fi
+			rm -f "$locatorLog" > /dev/null 2>&1
+		fi
+		if [ $locatorResult -eq 0 ] || [ $locatorResult -eq 1 ] ; then
+			javaLocatorUsed=1
+			# output contains only quoted LAUNCHER_JAVA* assignments
+			eval "$locatorOutput"
+		else
+			debug "... java locator failed with code $locatorResult, fallback to the shell search"
+		fi
+	fi
+}
+
 searchJavaUserDefined() {
 	if [ -z "$LAUNCHER_JAVA_EXE" ] ; then
         	if [ -n "$LAUNCHER_JAVA" ] ; then
@@ -1048,7 +1174,22 @@ searchJavaInstallFolder() {
 
         if [ -d "$installFolder" ] ; then
             #copy nested JRE to temp folder
-            cp -r "$installFolder" "$tempJreFolder"
+            #hard links are enough : removing the installation keeps the linked files
+            #the native tree tool links, clones or copies in parallel file by file, see copyTree
+            copied=0
+            if [ -n "$LAUNCHER_TREE_TOOL" ] && [ -x "$LAUNCHER_TREE_TOOL" ] ; then
+                if "$LAUNCHER_TREE_TOOL" --copy-tree "$installFolder" "$tempJreFolder" > /dev/null 2>&1 ; then
+                    copied=1
+                else
+                    debug "... native copy of nested JRE failed, use cp"
+                    rm -rf "$tempJreFolder" > /dev/null 2>&1
+                fi
+            fi
+            if [ 0 -eq $copied ] && ! cp -R -l "$installFolder" "$tempJreFolder" > /dev/null 2>&1 ; then
+                debug "... could not link nested JRE, copy it"
+                rm -rf "$tempJreFolder" > /dev/null 2>&1
+                cp -R -p "$installFolder" "$tempJreFolder"
+            fi
 
             verifyJVM "$tempJreFolder"
         fi
@@ -1064,9 +1205,12 @@ searchJava() {
                 searchJavaInstallFolder
 		searchJavaUserDefined
 		installBundledJVMs
-		searchJavaEnvironment
-		searchJavaSystemDefault
-		searchJavaSystemPaths
+		searchJavaNative
+		if [ 0 -eq $javaLocatorUsed ] ; then
+			searchJavaEnvironment
+			searchJavaSystemDefault
+			searchJavaSystemPaths
+		fi
                 if [ 1 -eq $isMacOSX ] ; then
                     searchJavaOnMacOs
                 fi
@@ -1323,6 +1467,8 @@ verifyJavaHome() {
 				if [ $comp -eq 1 ] ; then
 				        LAUNCHER_JAVA_EXE="$javaExe"
 					LAUNCHER_JAVA="$java"
+					LAUNCHER_JAVA_VERSION="$javaVersion"
+					LAUNCHER_JAVA_OSARCH="$osarch"
 					verifyResult=$VERIFY_OK
 		    		fi
 				debug "       compatible = [$comp]"
@@ -1572,6 +1718,7 @@ prepareJVMArguments() {
 	 debug "... jvm argument [$jvmArgCounter] [initial]  : $arg"
 	 arg=`resolveString "$arg"`
 	 debug "... jvm argument [$jvmArgCounter] [resolved] : $arg"
+	 readMemoryRule "$arg"
 	 arg=`escapeString "$arg"`
 	 debug "... jvm argument [$jvmArgCounter] [escaped] : $arg"
 	 LAUNCHER_JVM_ARGUMENTS="$LAUNCHER_JVM_ARGUMENTS $arg"	
@@ -1586,9 +1733,151 @@ prepareJVMArguments() {
             LAUNCHER_JVM_ARGUMENTS="$LAUNCHER_JVM_ARGUMENTS -Dnetbeans.default_cachedir_root=\"${DEFAULT_CACHEDIR_ROOT}\""	
     fi
 
+    setMemoryArguments
     debug "Final JVM arguments : $LAUNCHER_JVM_ARGUMENTS"            
 }
 
+readMemoryRule() {
+	case "$1" in
+	    -Dnbi.launcher.jvm.heap.percent=*)
+		MEMORY_RULE_HEAP_PERCENT=`echo "$1" | sed "s/^[^=]*=//;s/[^0-9].*//"`;;
+	    -Dnbi.launcher.jvm.heap.min=*)
+		MEMORY_RULE_HEAP_MIN=`echo "$1" | sed "s/^[^=]*=//;s/[^0-9].*//"`;;
+	    -Dnbi.launcher.jvm.heap.max=*)
+		MEMORY_RULE_HEAP_MAX=`echo "$1" | sed "s/^[^=]*=//;s/[^0-9].*//"`;;
+	    -Dnbi.launcher.jvm.processors=*)
+		MEMORY_RULE_PROCESSORS=`echo "$1" | sed "s/^[^=]*=//;s/[^0-9].*//"`
+		MEMORY_RULE_PROCESSORS="${MEMORY_RULE_PROCESSORS:-0}";;
+	    -Dnbi.launcher.jvm.gc=*)
+		MEMORY_RULE_GC=`echo "$1" | sed "s/^[^=]*=//"`;;
+	esac
+}
+
+getAvailableMemory() {
+	# in megabytes, physical memory limited by the cgroup (v2 or v1) of the launcher
+	pages=`getconf _PHYS_PAGES 2>/dev/null`
+	pageSize=`getconf PAGESIZE 2>/dev/null`
+	memory=`awk 'END { print int(pages * size / 1048576) }' pages="${pages:-0}" size="${pageSize:-0}" < /dev/null`
+	cgroupPath=`sed -n "s/^0:://p" /proc/self/cgroup 2>/dev/null`
+	for limitFile in "/sys/fs/cgroup$cgroupPath/memory.max" /sys/fs/cgroup/memory.max /sys/fs/cgroup/memory/memory.limit_in_bytes ; do
+		if [ -r "$limitFile" ] ; then
+			# "max" or a huge number if there is no limit
+			memory=`awk '{ m = memory + 0; if ($1 ~ /^[0-9]+$/ && ($1 / 1048576 < m || m == 0)) { m = int($1 / 1048576) } print m; exit }' memory="$memory" "$limitFile" 2>/dev/null`
+			break
+		fi
+	done
+	echo "${memory:-0}"
+}
+
+getAvailableProcessors() {
+	# processors of the affinity mask limited by the cgroup CPU quota
+	processors=`nproc 2>/dev/null`
+	if [ -z "$processors" ] ; then
+		processors=`getconf _NPROCESSORS_ONLN 2>/dev/null`
+	fi
+	cgroupPath=`sed -n "s/^0:://p" /proc/self/cgroup 2>/dev/null`
+	quota=""
+	for quotaFile in "/sys/fs/cgroup$cgroupPath/cpu.max" /sys/fs/cgroup/cpu.max ; do
+		if [ -r "$quotaFile" ] ; then
+			quota=`cat "$quotaFile" 2>/dev/null`
+			break
+		fi
+	done
+	if [ -z "$quota" ] && [ -r /sys/fs/cgroup/cpu/cpu.cfs_quota_us ] ; then
+		quota="`cat /sys/fs/cgroup/cpu/cpu.cfs_quota_us 2>/dev/null` `cat /sys/fs/cgroup/cpu/cpu.cfs_period_us 2>/dev/null`"
+	fi
+	echo "$quota" | awk '{ p = processors + 0; if ($1 ~ /^[0-9]+$/ && $2 > 0) { q = int(($1 + $2 - 1) / $2); if (q > 0 && (q < p || p == 0)) { p = q } } if (p < 1) { p = 1 } print p }' processors="$processors"
+}
+
+hasJvmArgument() {
+	# the arguments are split but not expanded, -Dx=* must not match file names
+	set -f
+	for jvmArg in $LAUNCHER_JVM_ARGUMENTS ; do
+		case "$jvmArg" in
+		    $1)
+			set +f
+			echo 1
+			return
+			;;
+		esac
+	done
+	set +f
+	echo 0
+}
+
+isActiveProcessorCountSupported() {
+	# the option exists since 10 and was backported to 8u191, older JVMs refuse to start with it
+	if [ -z "$LAUNCHER_JAVA_VERSION" ] ; then
+		echo 0
+	elif [ 0 -eq `ifVersionLess "$LAUNCHER_JAVA_VERSION" "10"` ] ; then
+		echo 1
+	elif [ 0 -eq `ifVersionLess "$LAUNCHER_JAVA_VERSION" "1.8.0_191"` ] && [ 1 -eq `ifVersionLess "$LAUNCHER_JAVA_VERSION" "1.9"` ] ; then
+		echo 1
+	else
+		echo 0
+	fi
+}
+
+setMemoryArguments() {
+	# the payload declares the heap, processors and GC rules as -Dnbi.launcher.jvm.* properties,
+	# JVM options set by the payload itself or by the user with -J are kept as they are
+	if [ -z "$MEMORY_RULE_HEAP_PERCENT$MEMORY_RULE_HEAP_MIN$MEMORY_RULE_HEAP_MAX$MEMORY_RULE_PROCESSORS$MEMORY_RULE_GC" ] ; then
+		return
+	fi
+	memory=`getAvailableMemory`
+	processors=`getAvailableProcessors`
+	debug "Available memory, MB : $memory"
+	debug "Available processors : $processors"
+
+	heapMin="${MEMORY_RULE_HEAP_MIN:-0}"
+	if [ 0 -eq `hasJvmArgument "-Xmx*"` ] && [ 0 -eq `hasJvmArgument "-XX:MaxRAMPercentage=*"` ] ; then
+		heap=`awk 'END { h = int(memory * percent / 100); if (max > 0 && (h == 0 || h > max)) { h = max } if (h > 0 && h < min) { h = min } print h }' memory="$memory" percent="${MEMORY_RULE_HEAP_PERCENT:-0}" min="$heapMin" max="${MEMORY_RULE_HEAP_MAX:-0}" < /dev/null`
+		case "$LAUNCHER_JAVA_OSARCH" in
+			x86|i[3-6]86)
+				# what a 32-bit JVM can still reserve in one piece
+				if [ "$heap" -gt 1200 ] ; then
+					debug "... maximum heap limited for a 32-bit JVM"
+					heap=1200
+				fi
+				;;
+		esac
+		if [ "$heap" -gt 0 ] ; then
+			LAUNCHER_JVM_ARGUMENTS="$LAUNCHER_JVM_ARGUMENTS -Xmx${heap}m"
+			if [ "$heapMin" -gt "$heap" ] ; then
+				heapMin="$heap"
+			fi
+		fi
+	else
+		# the initial heap could exceed the maximum one set there
+		heapMin=0
+	fi
+	if [ "$heapMin" -gt 0 ] && [ 0 -eq `hasJvmArgument "-Xms*"` ] ; then
+		LAUNCHER_JVM_ARGUMENTS="$LAUNCHER_JVM_ARGUMENTS -Xms${heapMin}m"
+	fi
+	if [ -n "$MEMORY_RULE_PROCESSORS" ] && [ 0 -eq `hasJvmArgument "-XX:ActiveProcessorCount=*"` ] ; then
+		if [ 1 -eq `isActiveProcessorCountSupported` ] ; then
+			# 0 means all available processors
+			activeProcessors="$processors"
+			if [ "$MEMORY_RULE_PROCESSORS" -gt 0 ] && [ "$MEMORY_RULE_PROCESSORS" -lt "$processors" ] ; then
+				activeProcessors="$MEMORY_RULE_PROCESSORS"
+			fi
+			LAUNCHER_JVM_ARGUMENTS="$LAUNCHER_JVM_ARGUMENTS -XX:ActiveProcessorCount=$activeProcessors"
+		else
+			debug "... no -XX:ActiveProcessorCount in this JVM, processors rule skipped"
+		fi
+	fi
+	if [ -n "$MEMORY_RULE_GC" ] && [ 0 -eq `hasJvmArgument "-XX:+Use*GC"` ] ; then
+		# <gc for a small machine>,<gc otherwise>, the JVM draws the same line for a server class machine
+		gc=`echo "$MEMORY_RULE_GC" | sed "s/.*,//"`
+		if [ "$memory" -lt 1792 ] || [ "$processors" -lt 2 ] ; then
+			gc=`echo "$MEMORY_RULE_GC" | sed "s/,.*//"`
+		fi
+		if [ -n "$gc" ] ; then
+			LAUNCHER_JVM_ARGUMENTS="$LAUNCHER_JVM_ARGUMENTS -XX:+Use$gc"
+		fi
+	fi
+}
+
 prepareAppArguments() {
     debug "Prepare Application arguments... "    
 
@@ -1643,6 +1932,18 @@ executeMainClass() {
 	launcherJavaExeEscaped=`escapeString "$LAUNCHER_JAVA_EXE"`
 	tmpdirEscaped=`escapeString "$LAUNCHER_JVM_TEMP_DIR"`
 	
+	if [ 1 -eq $INPROCESS_JVM ] && [ -n "$LAUNCHER_JAVA_RUNNER" ] && [ -x "$LAUNCHER_JAVA_RUNNER" ] ; then
+		# the runner loads libjvm.so of the found java and creates the VM itself.
+		# It replaces this shell, so it removes the extraction directory on exit
+		debug "... running main class in-process with $LAUNCHER_JAVA_RUNNER"
+		launcherJavaRunnerEscaped=`escapeString "$LAUNCHER_JAVA_RUNNER"`
+		launcherJavaHomeEscaped=`escapeString "$LAUNCHER_JAVA"`
+		extractDirEscaped=`escapeString "$LAUNCHER_EXTRACT_DIR"`
+		command="$launcherJavaRunnerEscaped --remove-dir $extractDirEscaped $launcherJavaHomeEscaped $LAUNCHER_JVM_ARGUMENTS -Djava.io.tmpdir=$tmpdirEscaped -classpath $classpathEscaped $mainClassEscaped $LAUNCHER_APP_ARGUMENTS"
+		runCommand "exec $command"
+		# reached only if the shell survives a failed exec
+		exitProgram $?
+	fi
 	command="$launcherJavaExeEscaped $LAUNCHER_JVM_ARGUMENTS -Djava.io.tmpdir=$tmpdirEscaped -classpath $classpathEscaped $mainClassEscaped $LAUNCHER_APP_ARGUMENTS"
 
 	debug "Running command : $command"
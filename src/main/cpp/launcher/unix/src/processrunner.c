@@ -0,0 +1,224 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// POSIX counterpart of readProcessStream in the Windows launcher : the
+// runner blocks in poll() on the output pipe and, where the kernel has
+// pidfd_open, on the process itself instead of sleeping between checks.
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+
+#include "processrunner.h"
+
+#define INITIAL_CAPACITY 4096
+#define READ_CHUNK       16384
+// reads after the exit, a grandchild may still write to the pipe
+#define MAX_DRAIN_READS  64
+// without pidfd the exit is checked this often once the pipe is closed
+#define EXIT_CHECK_INTERVAL 10
+
+static long currentMillis(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// amortised growth, the output is copied only log(n) times
+static int appendOutput(ProcessOutput * output, const char * data, size_t length, size_t maxLength) {
+    if (output->length + length > maxLength) {
+        length = maxLength - output->length;
+    }
+    if (length == 0) {
+        return 1;
+    }
+    if (output->length + length + 1 > output->capacity) {
+        size_t capacity = output->capacity;
+        char * buffer;
+        while (capacity < output->length + length + 1) {
+            capacity *= 2;
+        }
+        buffer = (char *) realloc(output->buffer, capacity);
+        if (buffer == NULL) {
+            return 0;
+        }
+        output->buffer = buffer;
+        output->capacity = capacity;
+    }
+    memcpy(output->buffer + output->length, data, length);
+    output->length += length;
+    output->buffer[output->length] = 0;
+    return 1;
+}
+
+// 1 if something was read, -1 if nothing is ready, 0 on end of file
+static int readOutput(int fd, ProcessOutput * output, size_t maxLength) {
+    char chunk[READ_CHUNK];
+    ssize_t bytesRead;
+    do {
+        bytesRead = read(fd, chunk, sizeof(chunk));
+    } while (bytesRead < 0 && errno == EINTR);
+    if (bytesRead > 0) {
+        appendOutput(output, chunk, (size_t) bytesRead, maxLength);
+        return 1;
+    }
+    return (bytesRead < 0 && errno == EAGAIN) ? -1 : 0;
+}
+
+static long remainingTime(long timeout, long started) {
+    long elapsed;
+    if (timeout < 0) {
+        return -1;
+    }
+    elapsed = currentMillis() - started;
+    return (elapsed >= timeout) ? 0 : (timeout - elapsed);
+}
+
+int runProcess(char * const argv[], long timeout, size_t maxLength, ProcessOutput * output, int * exitCode) {
+    int fds[2];
+    int pidfd = -1;
+    int pipeOpen = 1;
+    int exited = 0;
+    int reaped = 0;
+    int status = 0;
+    int result = PROCESS_OK;
+    long started;
+    pid_t pid;
+    int i;
+
+    * exitCode = -1;
+    output->length = 0;
+    output->capacity = INITIAL_CAPACITY;
+    output->buffer = (char *) calloc(1, output->capacity);
+    if (output->buffer == NULL) {
+        return PROCESS_ERROR;
+    }
+    if (pipe(fds) != 0) {
+        return PROCESS_ERROR;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return PROCESS_ERROR;
+    }
+    if (pid == 0) {
+        int devnull = open("/dev/null", O_RDWR);
+        dup2(fds[1], 1);
+        if (devnull >= 0) {
+            dup2(devnull, 0);
+            dup2(devnull, 2);
+        }
+        close(fds[0]);
+        close(fds[1]);
+        execv(argv[0], argv);
+        _exit(127);
+    }
+    close(fds[1]);
+#ifdef SYS_pidfd_open
+    // the exit is seen even if a grandchild keeps the pipe open
+    pidfd = (int) syscall(SYS_pidfd_open, pid, 0);
+#endif
+
+    started = currentMillis();
+    while (!exited) {
+        struct pollfd pfds[2];
+        nfds_t number = 0;
+        long wait = remainingTime(timeout, started);
+        int ready;
+
+        if (pipeOpen) {
+            pfds[number].fd = fds[0];
+            pfds[number++].events = POLLIN;
+        }
+        if (pidfd >= 0) {
+            pfds[number].fd = pidfd;
+            pfds[number++].events = POLLIN;
+        }
+        if (number == 0) {
+            // the pipe is closed and there is no pidfd : check the exit now and then
+            if (waitpid(pid, &status, WNOHANG) == pid) {
+                exited = reaped = 1;
+            } else if (wait == 0) {
+                result = PROCESS_TIMEOUT;
+                break;
+            } else {
+                poll(NULL, 0, (wait < 0 || wait > EXIT_CHECK_INTERVAL) ? EXIT_CHECK_INTERVAL : (int) wait);
+            }
+            continue;
+        }
+        ready = poll(pfds, number, (wait > (long) 0x7fffffff) ? 0x7fffffff : (int) wait);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            result = PROCESS_ERROR;
+            break;
+        }
+        if (ready == 0) {
+            result = PROCESS_TIMEOUT;
+            break;
+        }
+        if (pipeOpen && pfds[0].revents != 0) {
+            pipeOpen = (readOutput(fds[0], output, maxLength) != 0);
+        }
+        if (pidfd >= 0 && pfds[number - 1].revents != 0) {
+            exited = 1;
+        }
+    }
+    // what is already in the pipe belongs to the output
+    for (i = 0; result == PROCESS_OK && pipeOpen && i < MAX_DRAIN_READS; i++) {
+        int state = readOutput(fds[0], output, maxLength);
+        if (state <= 0) {
+            break;
+        }
+    }
+    if (result != PROCESS_OK) {
+        kill(pid, SIGKILL);
+    }
+    close(fds[0]);
+    if (pidfd >= 0) {
+        close(pidfd);
+    }
+    if (!reaped) {
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+        }
+    }
+    if (result == PROCESS_OK) {
+        * exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    }
+    return result;
+}
+
+void freeProcessOutput(ProcessOutput * output) {
+    free(output->buffer);
+    output->buffer = NULL;
+    output->length = 0;
+    output->capacity = 0;
+}
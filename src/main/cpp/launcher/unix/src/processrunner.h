@@ -0,0 +1,46 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _processrunner_H
+#define _processrunner_H
+
+#include <stddef.h>
+
+#define PROCESS_OK      0
+#define PROCESS_TIMEOUT 1
+#define PROCESS_ERROR   2
+
+// growable buffer, the content is always zero-terminated
+typedef struct _processOutput {
+    char * buffer;
+    size_t length;
+    size_t capacity;
+} ProcessOutput;
+
+// Runs argv[0] with stdin and stderr on /dev/null and collects its stdout.
+// The timeout in milliseconds is counted from the start but fires only while
+// the process is silent, as in the Windows launcher. Output above maxLength
+// is read and dropped. The process is killed on timeout. Without pidfd_open
+// (Linux before 5.3 and other systems) the exit is seen when the pipe closes.
+// The output has to be freed whatever the result is.
+int runProcess(char * const argv[], long timeout, size_t maxLength, ProcessOutput * output, int * exitCode);
+
+void freeProcessOutput(ProcessOutput * output);
+
+#endif /* _processrunner_H */
@@ -0,0 +1,363 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// POSIX counterpart of copyDirectoryTree in the Windows launcher : the
+// structure is created first, then the files are copied by a pool of
+// threads. A file is hard linked if allowed, otherwise cloned where the
+// file system can share blocks, otherwise copied in the kernel or through
+// a large buffer into a preallocated target.
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+#include "treecopy.h"
+
+#define MAX_COPY_THREADS 8
+#define COPY_BUFFER_SIZE (1024 * 1024)
+#define INITIAL_ENTRIES  256
+
+typedef struct _copyEntry {
+    char * source;
+    char * target;
+    struct stat status;
+} CopyEntry;
+
+typedef struct _copyList {
+    CopyEntry * entries;
+    size_t number;
+    size_t capacity;
+} CopyList;
+
+typedef struct _copyJobs {
+    CopyList * files;
+    int flags;
+    size_t next;
+    int failed;
+    pthread_mutex_t lock;
+} CopyJobs;
+
+static char * joinPath(const char * dir, const char * name) {
+    size_t dirLength = strlen(dir);
+    size_t nameLength = strlen(name);
+    char * path = (char *) malloc(dirLength + nameLength + 2);
+    if (path != NULL) {
+        memcpy(path, dir, dirLength);
+        path[dirLength] = '/';
+        memcpy(path + dirLength + 1, name, nameLength + 1);
+    }
+    return path;
+}
+
+static int addEntry(CopyList * list, char * source, char * target, const struct stat * status) {
+    if (source == NULL || target == NULL) {
+        free(source);
+        free(target);
+        return 0;
+    }
+    if (list->number == list->capacity) {
+        size_t capacity = (list->capacity == 0) ? INITIAL_ENTRIES : list->capacity * 2;
+        CopyEntry * entries = (CopyEntry *) realloc(list->entries, capacity * sizeof(CopyEntry));
+        if (entries == NULL) {
+            free(source);
+            free(target);
+            return 0;
+        }
+        list->entries = entries;
+        list->capacity = capacity;
+    }
+    list->entries[list->number].source = source;
+    list->entries[list->number].target = target;
+    list->entries[list->number].status = * status;
+    list->number++;
+    return 1;
+}
+
+static void freeList(CopyList * list) {
+    size_t i;
+    for (i = 0; i < list->number; i++) {
+        free(list->entries[i].source);
+        free(list->entries[i].target);
+    }
+    free(list->entries);
+}
+
+static void setTimes(int fd, const char * path, const struct stat * status) {
+    struct timespec times[2];
+    times[0] = status->st_atim;
+    times[1] = status->st_mtim;
+    if (fd >= 0) {
+        futimens(fd, times);
+    } else {
+        utimensat(AT_FDCWD, path, times, AT_SYMLINK_NOFOLLOW);
+    }
+}
+
+static int copySymlink(const char * source, const char * target, const struct stat * status) {
+    char * link = (char *) malloc(status->st_size + 1);
+    ssize_t length;
+    int result = 0;
+    if (link == NULL) {
+        return 0;
+    }
+    length = readlink(source, link, status->st_size + 1);
+    if (length >= 0 && length <= status->st_size) {
+        link[length] = 0;
+        result = (symlink(link, target) == 0);
+    }
+    free(link);
+    return result;
+}
+
+// the directories go before their children, they are created right away
+static int collectEntries(const char * source, const char * target, CopyList * dirs, CopyList * files) {
+    DIR * dir;
+    struct dirent * entry;
+    int result = 1;
+
+    if (mkdir(target, S_IRWXU) != 0) {
+        return 0;
+    }
+    dir = opendir(source);
+    if (dir == NULL) {
+        return 0;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        struct stat status;
+        char * entrySource;
+        char * entryTarget;
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        entrySource = joinPath(source, entry->d_name);
+        entryTarget = joinPath(target, entry->d_name);
+        if (entrySource == NULL || entryTarget == NULL || lstat(entrySource, &status) != 0) {
+            free(entrySource);
+            free(entryTarget);
+            result = 0;
+            continue;
+        }
+        if (S_ISDIR(status.st_mode)) {
+            if (addEntry(dirs, entrySource, entryTarget, &status)) {
+                CopyEntry * added = &dirs->entries[dirs->number - 1];
+                result = collectEntries(added->source, added->target, dirs, files) && result;
+            } else {
+                result = 0;
+            }
+        } else if (S_ISREG(status.st_mode)) {
+            result = addEntry(files, entrySource, entryTarget, &status) && result;
+        } else if (S_ISLNK(status.st_mode)) {
+            result = copySymlink(entrySource, entryTarget, &status) && result;
+            if (result) {
+                setTimes(-1, entryTarget, &status);
+            }
+            free(entrySource);
+            free(entryTarget);
+        } else {
+            // devices, sockets and pipes have no place in a copied tree
+            free(entrySource);
+            free(entryTarget);
+        }
+    }
+    closedir(dir);
+    return result;
+}
+
+static int copyContent(int in, int out, off_t size) {
+    char * buffer;
+    off_t copied = 0;
+#ifdef SYS_copy_file_range
+    // done in the kernel, the file system may share or offload the blocks
+    while (copied < size) {
+        long written = syscall(SYS_copy_file_range, in, NULL, out, NULL, (size_t) (size - copied), 0);
+        if (written <= 0) {
+            break;
+        }
+        copied += written;
+    }
+    if (copied == size) {
+        return 1;
+    }
+    if (copied > 0 && (lseek(in, copied, SEEK_SET) < 0 || lseek(out, copied, SEEK_SET) < 0)) {
+        return 0;
+    }
+#endif
+    buffer = (char *) malloc(COPY_BUFFER_SIZE);
+    if (buffer == NULL) {
+        return 0;
+    }
+    while (1) {
+        ssize_t bytesRead = read(in, buffer, COPY_BUFFER_SIZE);
+        ssize_t offset = 0;
+        if (bytesRead < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytesRead <= 0) {
+            free(buffer);
+            return (bytesRead == 0);
+        }
+        while (offset < bytesRead) {
+            ssize_t written = write(out, buffer + offset, bytesRead - offset);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                free(buffer);
+                return 0;
+            }
+            offset += written;
+        }
+    }
+}
+
+static int copyFile(const CopyEntry * entry, int flags) {
+    int in;
+    int out;
+    int result = 0;
+
+    if ((flags & TREE_COPY_LINK) && link(entry->source, entry->target) == 0) {
+        return 1;
+    }
+    in = open(entry->source, O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return 0;
+    }
+    out = open(entry->target, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (out < 0) {
+        close(in);
+        return 0;
+    }
+#ifdef FICLONE
+    if ((flags & TREE_COPY_CLONE) && ioctl(out, FICLONE, in) == 0) {
+        result = 1;
+    }
+#endif
+    if (!result) {
+        // one extent instead of growing the file write by write
+        if (entry->status.st_size > 0) {
+            posix_fallocate(out, 0, entry->status.st_size);
+        }
+        result = copyContent(in, out, entry->status.st_size);
+    }
+    if (result) {
+        result = (fchmod(out, entry->status.st_mode & 07777) == 0);
+        setTimes(out, NULL, &entry->status);
+    }
+    close(in);
+    if (close(out) != 0) {
+        result = 0;
+    }
+    return result;
+}
+
+static void * copyWorker(void * data) {
+    CopyJobs * jobs = (CopyJobs *) data;
+    while (1) {
+        size_t index;
+        int result;
+        pthread_mutex_lock(&jobs->lock);
+        index = jobs->next++;
+        pthread_mutex_unlock(&jobs->lock);
+        if (index >= jobs->files->number) {
+            break;
+        }
+        result = copyFile(&jobs->files->entries[index], jobs->flags);
+        if (!result) {
+            pthread_mutex_lock(&jobs->lock);
+            jobs->failed = 1;
+            pthread_mutex_unlock(&jobs->lock);
+        }
+    }
+    return NULL;
+}
+
+static void copyFiles(CopyJobs * jobs, int threads) {
+    pthread_t workers[MAX_COPY_THREADS];
+    int started = 0;
+    int i;
+
+    if (threads <= 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (processors > 0) ? (int) processors : 1;
+    }
+    if (threads > MAX_COPY_THREADS) {
+        threads = MAX_COPY_THREADS;
+    }
+    if ((size_t) threads > jobs->files->number) {
+        threads = (int) jobs->files->number;
+    }
+    // the calling thread is one of the workers
+    for (i = 1; i < threads; i++) {
+        if (pthread_create(&workers[started], NULL, copyWorker, jobs) == 0) {
+            started++;
+        }
+    }
+    copyWorker(jobs);
+    for (i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+}
+
+int copyTree(const char * source, const char * target, int flags, int threads) {
+    CopyList dirs;
+    CopyList files;
+    CopyJobs jobs;
+    struct stat status;
+    size_t i;
+
+    memset(&dirs, 0, sizeof(dirs));
+    memset(&files, 0, sizeof(files));
+    memset(&jobs, 0, sizeof(jobs));
+    if (stat(source, &status) != 0 || !S_ISDIR(status.st_mode) ||
+            !addEntry(&dirs, strdup(source), strdup(target), &status)) {
+        return TREE_COPY_ERROR;
+    }
+    jobs.files = &files;
+    jobs.flags = flags;
+    if (!collectEntries(source, target, &dirs, &files)) {
+        jobs.failed = 1;
+    }
+    pthread_mutex_init(&jobs.lock, NULL);
+    copyFiles(&jobs, threads);
+    pthread_mutex_destroy(&jobs.lock);
+
+    // the directories were writable while they were filled, children first
+    for (i = dirs.number; i > 0; i--) {
+        CopyEntry * dir = &dirs.entries[i - 1];
+        if (chmod(dir->target, dir->status.st_mode & 07777) != 0) {
+            jobs.failed = 1;
+        }
+        setTimes(-1, dir->target, &dir->status);
+    }
+    freeList(&dirs);
+    freeList(&files);
+    return jobs.failed ? TREE_COPY_ERROR : TREE_COPY_OK;
+}
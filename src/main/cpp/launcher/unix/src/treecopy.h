@@ -0,0 +1,39 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _treecopy_H
+#define _treecopy_H
+
+#define TREE_COPY_OK    0
+#define TREE_COPY_ERROR 1
+
+// files may be hard links of the source
+#define TREE_COPY_LINK  1
+// files may share the blocks of the source (FICLONE), the content is still private
+#define TREE_COPY_CLONE 2
+
+// Copies the directory source to target, which must not exist. Regular files
+// are linked, cloned or copied depending on the flags and on what the file
+// system allows, always falling back to a plain copy with a preallocated
+// target. Files are processed by up to threads workers, 0 picks the number of
+// processors. Symbolic links are copied as links, other special files are
+// skipped. Modes and modification times are kept.
+int copyTree(const char * source, const char * target, int flags, int threads);
+
+#endif /* _treecopy_H */
@@ -0,0 +1,344 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// POSIX counterpart of deleteDirectory in the Windows launcher. The tree
+// is walked with directory descriptors : every directory is opened by
+// openat() relative to its parent and its files are handed to the workers
+// as one job, which unlinks them with unlinkat() relative to the same
+// descriptor. No path is built for a file unless it has to be retried.
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "treedelete.h"
+
+#define DELETE_TREE_MAX_WORKERS 8
+// the walker runs jobs itself above that, it bounds the open descriptors
+#define MAX_QUEUED_JOBS 64
+#define INITIAL_NAMES   16
+// as the Windows launcher : 20 rounds in 2 seconds for the whole tree
+#define RETRY_ROUNDS 20
+#define RETRY_DELAY  100 // milliseconds
+
+typedef struct _pathList {
+    char ** paths;
+    size_t number;
+    size_t capacity;
+} PathList;
+
+// the files of one directory
+typedef struct _deleteJob {
+    int fd;
+    char * path;
+    char ** names;
+    size_t number;
+    size_t capacity;
+    struct _deleteJob * next;
+} DeleteJob;
+
+typedef struct _deleteJobs {
+    DeleteJob * first;
+    DeleteJob * last;
+    size_t queued;
+    int walked;
+    PathList failed;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+} DeleteJobs;
+
+static char * joinPath(const char * dir, const char * name) {
+    size_t dirLength = strlen(dir);
+    size_t nameLength = strlen(name);
+    char * path = (char *) malloc(dirLength + nameLength + 2);
+    if (path != NULL) {
+        memcpy(path, dir, dirLength);
+        path[dirLength] = '/';
+        memcpy(path + dirLength + 1, name, nameLength + 1);
+    }
+    return path;
+}
+
+static int addPath(PathList * list, char * path) {
+    if (path == NULL) {
+        return 0;
+    }
+    if (list->number == list->capacity) {
+        size_t capacity = (list->capacity == 0) ? INITIAL_NAMES : list->capacity * 2;
+        char ** paths = (char **) realloc(list->paths, capacity * sizeof(char *));
+        if (paths == NULL) {
+            free(path);
+            return 0;
+        }
+        list->paths = paths;
+        list->capacity = capacity;
+    }
+    list->paths[list->number++] = path;
+    return 1;
+}
+
+static void freePaths(PathList * list) {
+    size_t i;
+    for (i = 0; i < list->number; i++) {
+        free(list->paths[i]);
+    }
+    free(list->paths);
+    list->paths = NULL;
+    list->number = list->capacity = 0;
+}
+
+static int addName(DeleteJob * job, const char * name) {
+    char * copy;
+    if (job->number == job->capacity) {
+        size_t capacity = (job->capacity == 0) ? INITIAL_NAMES : job->capacity * 2;
+        char ** names = (char **) realloc(job->names, capacity * sizeof(char *));
+        if (names == NULL) {
+            return 0;
+        }
+        job->names = names;
+        job->capacity = capacity;
+    }
+    copy = strdup(name);
+    if (copy == NULL) {
+        return 0;
+    }
+    job->names[job->number++] = copy;
+    return 1;
+}
+
+static void runJob(DeleteJobs * jobs, DeleteJob * job) {
+    size_t i;
+    for (i = 0; i < job->number; i++) {
+        if (unlinkat(job->fd, job->names[i], 0) != 0 && errno != ENOENT) {
+            // remember for the retry rounds, only now the path is needed
+            pthread_mutex_lock(&jobs->lock);
+            addPath(&jobs->failed, joinPath(job->path, job->names[i]));
+            pthread_mutex_unlock(&jobs->lock);
+        }
+        free(job->names[i]);
+    }
+    close(job->fd);
+    free(job->names);
+    free(job);
+}
+
+// NULL once the walk is over and the queue is empty
+static DeleteJob * takeJob(DeleteJobs * jobs, int wait) {
+    DeleteJob * job;
+    pthread_mutex_lock(&jobs->lock);
+    while (wait && jobs->first == NULL && !jobs->walked) {
+        pthread_cond_wait(&jobs->ready, &jobs->lock);
+    }
+    job = jobs->first;
+    if (job != NULL) {
+        jobs->first = job->next;
+        if (jobs->first == NULL) {
+            jobs->last = NULL;
+        }
+        jobs->queued--;
+    }
+    pthread_mutex_unlock(&jobs->lock);
+    return job;
+}
+
+static void * deleteWorker(void * data) {
+    DeleteJobs * jobs = (DeleteJobs *) data;
+    DeleteJob * job;
+    while ((job = takeJob(jobs, 1)) != NULL) {
+        runJob(jobs, job);
+    }
+    return NULL;
+}
+
+static void queueJob(DeleteJobs * jobs, DeleteJob * job, int workers) {
+    int full;
+    if (workers == 0) {
+        runJob(jobs, job);
+        return;
+    }
+    pthread_mutex_lock(&jobs->lock);
+    if (jobs->last != NULL) {
+        jobs->last->next = job;
+    } else {
+        jobs->first = job;
+    }
+    jobs->last = job;
+    full = (++jobs->queued > MAX_QUEUED_JOBS);
+    pthread_cond_signal(&jobs->ready);
+    pthread_mutex_unlock(&jobs->lock);
+    if (full && (job = takeJob(jobs, 0)) != NULL) {
+        runJob(jobs, job);
+    }
+}
+
+// fd is owned by the walk, the directories are listed before their children
+static void walkDirectory(DeleteJobs * jobs, int fd, const char * path, PathList * dirs, int workers) {
+    DIR * dir = fdopendir(fd);
+    struct dirent * entry;
+    DeleteJob * job;
+
+    if (dir == NULL) {
+        close(fd);
+        return;
+    }
+    job = (DeleteJob *) calloc(1, sizeof(DeleteJob));
+    while ((entry = readdir(dir)) != NULL) {
+        int isDirectory;
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+#ifdef DT_DIR
+        if (entry->d_type != DT_UNKNOWN) {
+            isDirectory = (entry->d_type == DT_DIR);
+        } else
+#endif
+        {
+            struct stat status;
+            isDirectory = (fstatat(dirfd(dir), entry->d_name, &status, AT_SYMLINK_NOFOLLOW) == 0 &&
+                    S_ISDIR(status.st_mode));
+        }
+        if (isDirectory) {
+            char * childPath = joinPath(path, entry->d_name);
+            int childFd = openat(dirfd(dir), entry->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (addPath(dirs, childPath) && childFd >= 0) {
+                walkDirectory(jobs, childFd, childPath, dirs, workers);
+            } else if (childFd >= 0) {
+                close(childFd);
+            }
+        } else if (job == NULL || !addName(job, entry->d_name)) {
+            // no memory for the job, the file is left for the retry rounds
+            pthread_mutex_lock(&jobs->lock);
+            addPath(&jobs->failed, joinPath(path, entry->d_name));
+            pthread_mutex_unlock(&jobs->lock);
+        }
+    }
+    if (job != NULL && job->number > 0) {
+        job->fd = dup(dirfd(dir));
+        job->path = (char *) path;
+    }
+    if (job != NULL && job->number > 0 && job->fd >= 0) {
+        queueJob(jobs, job, workers);
+    } else if (job != NULL) {
+        size_t i;
+        for (i = 0; i < job->number; i++) {
+            pthread_mutex_lock(&jobs->lock);
+            addPath(&jobs->failed, joinPath(path, job->names[i]));
+            pthread_mutex_unlock(&jobs->lock);
+            free(job->names[i]);
+        }
+        free(job->names);
+        free(job);
+    }
+    closedir(dir);
+}
+
+static int getWorkersNumber(int threads) {
+    if (threads <= 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (processors > 0) ? (int) processors * 2 : 2;
+    }
+    return (threads > DELETE_TREE_MAX_WORKERS) ? DELETE_TREE_MAX_WORKERS : threads;
+}
+
+int deleteTree(const char * path, int threads) {
+    DeleteJobs jobs;
+    PathList dirs;
+    pthread_t workers[DELETE_TREE_MAX_WORKERS];
+    int started = 0;
+    int workersNumber = getWorkersNumber(threads);
+    int round = 0;
+    size_t pending;
+    size_t i;
+    int fd;
+
+    fd = open(path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        // a link or a file, which can be deleted right away
+        return (unlink(path) == 0 || errno == ENOENT) ? TREE_DELETE_OK : TREE_DELETE_ERROR;
+    }
+    memset(&jobs, 0, sizeof(jobs));
+    memset(&dirs, 0, sizeof(dirs));
+    pthread_mutex_init(&jobs.lock, NULL);
+    pthread_cond_init(&jobs.ready, NULL);
+
+    // the calling thread walks, a single worker would only wait for it
+    for (i = 0; workersNumber > 1 && i < (size_t) workersNumber; i++) {
+        if (pthread_create(&workers[started], NULL, deleteWorker, &jobs) == 0) {
+            started++;
+        }
+    }
+    if (addPath(&dirs, strdup(path))) {
+        walkDirectory(&jobs, fd, dirs.paths[0], &dirs, started);
+    } else {
+        close(fd);
+    }
+    pthread_mutex_lock(&jobs.lock);
+    jobs.walked = 1;
+    pthread_cond_broadcast(&jobs.ready);
+    pthread_mutex_unlock(&jobs.lock);
+    deleteWorker(&jobs);
+    for (i = 0; i < (size_t) started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    // children first : the directories were listed before their children
+    for (round = 0; ; round++) {
+        struct timespec delay;
+        pending = 0;
+        for (i = 0; i < jobs.failed.number; i++) {
+            if (jobs.failed.paths[i] != NULL) {
+                if (unlink(jobs.failed.paths[i]) == 0 || errno == ENOENT) {
+                    free(jobs.failed.paths[i]);
+                    jobs.failed.paths[i] = NULL;
+                } else {
+                    pending++;
+                }
+            }
+        }
+        for (i = dirs.number; i > 0; i--) {
+            if (dirs.paths[i - 1] != NULL) {
+                if (rmdir(dirs.paths[i - 1]) == 0 || errno == ENOENT) {
+                    free(dirs.paths[i - 1]);
+                    dirs.paths[i - 1] = NULL;
+                } else {
+                    pending++;
+                }
+            }
+        }
+        if (pending == 0 || round == RETRY_ROUNDS) {
+            break;
+        }
+        delay.tv_sec = 0;
+        delay.tv_nsec = RETRY_DELAY * 1000000L;
+        nanosleep(&delay, NULL);
+    }
+
+    freePaths(&jobs.failed);
+    freePaths(&dirs);
+    pthread_cond_destroy(&jobs.ready);
+    pthread_mutex_destroy(&jobs.lock);
+    return (pending == 0) ? TREE_DELETE_OK : TREE_DELETE_ERROR;
+}
@@ -0,0 +1,34 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _treedelete_H
+#define _treedelete_H
+
+#define TREE_DELETE_OK    0
+#define TREE_DELETE_ERROR 1
+
+// Deletes the directory with everything in it. A symbolic link or a file is
+// simply unlinked, a missing path is not an error. Files are unlinked relative
+// to their directory by up to threads workers, 0 picks a few per processor.
+// Directories are removed afterwards, children first. Entries that can't be
+// deleted are retried together, with one short sleep per round for the whole
+// tree instead of one per entry.
+int deleteTree(const char * path, int threads);
+
+#endif /* _treedelete_H */
@@ -0,0 +1,48 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// File tree helper of launcher.sh, the native replacement of its cp and rm :
+//   treetool --copy-tree <source> <target>  copies the nested JRE, see copyTree
+//   treetool --delete-tree <dir>            removes the extraction directory, see deleteTree
+// Nothing is printed. Exit code is 0 on success, 1 on failure, 2 on wrong usage.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "treecopy.h"
+#include "treedelete.h"
+
+#define EXIT_OK     0
+#define EXIT_FAILED 1
+#define EXIT_USAGE  2
+
+int main(int argc, char ** argv) {
+    if (argc == 4 && strcmp(argv[1], "--copy-tree") == 0) {
+        // links are safe, removing the installation leaves the linked files
+        return (copyTree(argv[2], argv[3], TREE_COPY_LINK | TREE_COPY_CLONE, 0) == TREE_COPY_OK) ?
+            EXIT_OK : EXIT_FAILED;
+    }
+    if (argc == 3 && strcmp(argv[1], "--delete-tree") == 0) {
+        return (deleteTree(argv[2], 0) == TREE_DELETE_OK) ? EXIT_OK : EXIT_FAILED;
+    }
+    fprintf(stderr,
+            "Usage: treetool --copy-tree <source> <target>\n"
+            "       treetool --delete-tree <dir>\n");
+    return EXIT_USAGE;
+}
@@ -0,0 +1,78 @@
+#!/bin/sh
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+# Runs javarunner against a local JDK :
+#   javarunner-test.sh <javarunner> <jdk home>
+
+RUNNER="$1"
+JDK="$2"
+WORK=`mktemp -d "${TMPDIR:-/tmp}/javarunner-test.XXXXXX"`
+FAILED=0
+
+fail() {
+	echo "FAILED: $1"
+	FAILED=1
+}
+
+mkdir -p "$WORK/classes" "$WORK/extract dir/lib"
+cat > "$WORK/RunnerTest.java" <<JAVA
+public class RunnerTest {
+    public static void main(String[] args) {
+        StringBuilder sb = new StringBuilder();
+        for (String arg : args) {
+            sb.append('[').append(arg).append(']');
+        }
+        System.out.println("args " + sb);
+        System.out.println("property " + System.getProperty("runner.test"));
+        if (args.length > 0 && args[0].equals("exit")) {
+            System.exit(Integer.parseInt(args[1]));
+        }
+        if (args.length > 0 && args[0].equals("throw")) {
+            throw new IllegalStateException("expected");
+        }
+    }
+}
+JAVA
+"$JDK/bin/javac" -d "$WORK/classes" "$WORK/RunnerTest.java" || exit 1
+
+out=`"$RUNNER" "$JDK" -Drunner.test=value -classpath "$WORK/classes" RunnerTest "a b" c`
+[ $? -eq 0 ] || fail "exit code of a normal run"
+echo "$out" | grep -q "^args \[a b\]\[c\]$" || fail "arguments : $out"
+echo "$out" | grep -q "^property value$" || fail "jvm option : $out"
+
+"$RUNNER" "$JDK" -classpath "$WORK/classes" RunnerTest exit 7 > /dev/null
+[ $? -eq 7 ] || fail "exit code of System.exit()"
+
+"$RUNNER" "$JDK" -classpath "$WORK/classes" RunnerTest throw > /dev/null 2>&1
+[ $? -eq 1 ] || fail "exit code of an exception"
+
+"$RUNNER" "$JDK" -classpath "$WORK/classes" > /dev/null 2>&1
+[ $? -eq 2 ] || fail "usage error"
+
+touch "$WORK/extract dir/lib/app.jar"
+"$RUNNER" --remove-dir "$WORK/extract dir" "$JDK" -classpath "$WORK/classes" RunnerTest exit 3 > /dev/null
+[ $? -eq 3 ] || fail "exit code with --remove-dir"
+[ ! -d "$WORK/extract dir" ] || fail "--remove-dir after System.exit()"
+
+mkdir -p "$WORK/extract dir"
+"$RUNNER" --remove-dir "$WORK/extract dir" "$JDK" -classpath "$WORK/classes" RunnerTest > /dev/null
+[ ! -d "$WORK/extract dir" ] || fail "--remove-dir after main"
+
+rm -rf "$WORK"
+[ $FAILED -eq 0 ] && echo "javarunner tests passed"
+exit $FAILED
@@ -0,0 +1,138 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Benchmark of runProcess against the polling loop it replaces : the
+// old pump checked the pipe and the exit every millisecond, run by "make bench"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "../src/processrunner.h"
+
+#define SHORT_RUNS 200
+#define LARGE_RUNS 5
+
+typedef int (* RunFunction)(char * const argv[], ProcessOutput * output, int * exitCode);
+
+static double currentSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double cpuSeconds(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+            usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static int runWaiting(char * const argv[], ProcessOutput * output, int * exitCode) {
+    return runProcess(argv, 30000, (size_t) 1 << 30, output, exitCode);
+}
+
+// the reference : Sleep(1) polling, output appended per chunk
+static int runPolling(char * const argv[], ProcessOutput * output, int * exitCode) {
+    int fds[2];
+    int status = 0;
+    int exited = 0;
+    pid_t pid;
+    char chunk[16384];
+
+    output->buffer = (char *) calloc(1, 1);
+    output->length = 0;
+    output->capacity = 1;
+    if (pipe(fds) != 0) {
+        return PROCESS_ERROR;
+    }
+    pid = fork();
+    if (pid == 0) {
+        dup2(fds[1], 1);
+        close(fds[0]);
+        close(fds[1]);
+        execv(argv[0], argv);
+        _exit(127);
+    }
+    close(fds[1]);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    while (1) {
+        ssize_t bytesRead = read(fds[0], chunk, sizeof(chunk));
+        if (bytesRead > 0) {
+            char * buffer = (char *) malloc(output->length + bytesRead + 1);
+            memcpy(buffer, output->buffer, output->length);
+            memcpy(buffer + output->length, chunk, bytesRead);
+            free(output->buffer);
+            output->buffer = buffer;
+            output->length += bytesRead;
+            output->buffer[output->length] = 0;
+            continue;
+        }
+        if (bytesRead == 0 || exited) {
+            break;
+        }
+        if (waitpid(pid, &status, WNOHANG) == pid) {
+            exited = 1;
+            continue;
+        }
+        usleep(1000);
+    }
+    close(fds[0]);
+    if (!exited) {
+        waitpid(pid, &status, 0);
+    }
+    * exitCode = WEXITSTATUS(status);
+    return PROCESS_OK;
+}
+
+static void measure(const char * name, RunFunction run, char * const argv[], int runs) {
+    double started = currentSeconds();
+    double cpu = cpuSeconds();
+    size_t length = 0;
+    int i;
+    for (i = 0; i < runs; i++) {
+        ProcessOutput output;
+        int exitCode;
+        run(argv, &output, &exitCode);
+        length = output.length;
+        freeProcessOutput(&output);
+    }
+    printf("  %-8s %9.3f ms/run  %9.3f ms cpu/run  (%lu bytes)\n", name,
+            (currentSeconds() - started) * 1000 / runs, (cpuSeconds() - cpu) * 1000 / runs, (unsigned long) length);
+}
+
+int main(void) {
+    char * shortArgv[] = { (char *) "/bin/sh", (char *) "-c", (char *) "echo 17.0.2", NULL };
+    char * largeArgv[] = { (char *) "/bin/sh", (char *) "-c", (char *) "head -c 16777216 /dev/zero", NULL };
+
+    printf("short output, %d runs\n", SHORT_RUNS);
+    measure("polling", runPolling, shortArgv, SHORT_RUNS);
+    measure("waiting", runWaiting, shortArgv, SHORT_RUNS);
+    printf("16M output, %d runs\n", LARGE_RUNS);
+    measure("polling", runPolling, largeArgv, LARGE_RUNS);
+    measure("waiting", runWaiting, largeArgv, LARGE_RUNS);
+    return 0;
+}
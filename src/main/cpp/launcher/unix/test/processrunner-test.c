@@ -0,0 +1,163 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Unit tests of runProcess, run by "make test"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/syscall.h>
+
+#include "../src/processrunner.h"
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: %s failed\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+static long currentMillis(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int runShell(const char * script, long timeout, size_t maxLength, ProcessOutput * output, int * exitCode) {
+    char * argv[4];
+    argv[0] = (char *) "/bin/sh";
+    argv[1] = (char *) "-c";
+    argv[2] = (char *) script;
+    argv[3] = NULL;
+    return runProcess(argv, timeout, maxLength, output, exitCode);
+}
+
+static void testOutputAndExitCode(void) {
+    ProcessOutput output;
+    int exitCode;
+    CHECK(runShell("printf 'hello\\nworld'; exit 3", 5000, 1024, &output, &exitCode) == PROCESS_OK);
+    CHECK(exitCode == 3);
+    CHECK(output.length == 11);
+    CHECK(strcmp(output.buffer, "hello\nworld") == 0);
+    freeProcessOutput(&output);
+}
+
+static void testEmptyOutput(void) {
+    ProcessOutput output;
+    int exitCode;
+    CHECK(runShell("exit 0", 5000, 1024, &output, &exitCode) == PROCESS_OK);
+    CHECK(exitCode == 0);
+    CHECK(output.length == 0);
+    CHECK(output.buffer != NULL && output.buffer[0] == 0);
+    freeProcessOutput(&output);
+}
+
+static void testGrowingBuffer(void) {
+    ProcessOutput output;
+    int exitCode;
+    size_t i;
+    int zeros = 1;
+    CHECK(runShell("head -c 1000000 /dev/zero", 5000, 4 * 1024 * 1024, &output, &exitCode) == PROCESS_OK);
+    CHECK(output.length == 1000000);
+    CHECK(output.capacity >= output.length + 1);
+    for (i = 0; i < output.length; i++) {
+        zeros = zeros && (output.buffer[i] == 0);
+    }
+    CHECK(zeros);
+    freeProcessOutput(&output);
+}
+
+static void testOutputLimit(void) {
+    ProcessOutput output;
+    int exitCode;
+    // the rest is read and dropped, so the writer is not blocked
+    CHECK(runShell("head -c 1000000 /dev/zero | tr '\\0' x", 5000, 1000, &output, &exitCode) == PROCESS_OK);
+    CHECK(exitCode == 0);
+    CHECK(output.length == 1000);
+    CHECK(output.buffer[999] == 'x' && output.buffer[1000] == 0);
+    freeProcessOutput(&output);
+}
+
+static void testTimeout(void) {
+    ProcessOutput output;
+    int exitCode;
+    long started = currentMillis();
+    CHECK(runShell("echo started; exec sleep 10", 300, 1024, &output, &exitCode) == PROCESS_TIMEOUT);
+    CHECK(currentMillis() - started < 5000);
+    CHECK(strcmp(output.buffer, "started\n") == 0);
+    freeProcessOutput(&output);
+}
+
+static void testNoTimeout(void) {
+    ProcessOutput output;
+    int exitCode;
+    CHECK(runShell("sleep 0.2; echo done", -1, 1024, &output, &exitCode) == PROCESS_OK);
+    CHECK(strcmp(output.buffer, "done\n") == 0);
+    freeProcessOutput(&output);
+}
+
+static void testMissingExecutable(void) {
+    ProcessOutput output;
+    int exitCode;
+    char * argv[2];
+    argv[0] = (char *) "/nonexistent/java";
+    argv[1] = NULL;
+    CHECK(runProcess(argv, 5000, 1024, &output, &exitCode) == PROCESS_OK);
+    CHECK(exitCode == 127);
+    freeProcessOutput(&output);
+}
+
+static void testKilledBySignal(void) {
+    ProcessOutput output;
+    int exitCode;
+    CHECK(runShell("kill -9 $$", 5000, 1024, &output, &exitCode) == PROCESS_OK);
+    CHECK(exitCode == 128 + 9);
+    freeProcessOutput(&output);
+}
+
+static void testGrandchildKeepsPipe(void) {
+#ifdef SYS_pidfd_open
+    ProcessOutput output;
+    int exitCode;
+    long started = currentMillis();
+    // the exit of the child is seen through pidfd, the pipe stays open
+    CHECK(runShell("sleep 3 & echo done", 5000, 1024, &output, &exitCode) == PROCESS_OK);
+    CHECK(currentMillis() - started < 2000);
+    CHECK(strcmp(output.buffer, "done\n") == 0);
+    freeProcessOutput(&output);
+#endif
+}
+
+int main(void) {
+    testOutputAndExitCode();
+    testEmptyOutput();
+    testGrowingBuffer();
+    testOutputLimit();
+    testTimeout();
+    testNoTimeout();
+    testMissingExecutable();
+    testKilledBySignal();
+    testGrandchildKeepsPipe();
+    if (failures == 0) {
+        printf("processrunner tests passed\n");
+    }
+    return (failures == 0) ? 0 : 1;
+}
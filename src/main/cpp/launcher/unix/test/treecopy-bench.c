@@ -0,0 +1,142 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Benchmark of copyTree against spawning cp on a JRE sized tree, run by
+// "make bench". The page cache is warm, so the numbers show the cost of
+// the copy itself rather than of the disk.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "../src/treecopy.h"
+
+#define DIRS          40
+#define FILES_PER_DIR 50
+#define RUNS          3
+
+static char root[] = "/tmp/treecopy-bench-XXXXXX";
+
+static double currentSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 2000 files from 1K to 256K and one 64M file, close to a stripped JRE
+static void createSource(void) {
+    char name[4096];
+    char * data = (char *) malloc(64 * 1024 * 1024);
+    int i;
+    int j;
+    memset(data, 'j', 64 * 1024 * 1024);
+    snprintf(name, sizeof(name), "%s/jre", root);
+    mkdir(name, 0755);
+    for (i = 0; i < DIRS; i++) {
+        snprintf(name, sizeof(name), "%s/jre/dir%d", root, i);
+        mkdir(name, 0755);
+        for (j = 0; j < FILES_PER_DIR; j++) {
+            int fd;
+            snprintf(name, sizeof(name), "%s/jre/dir%d/file%d", root, i, j);
+            fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd >= 0) {
+                if (write(fd, data, 1024 << (j % 9)) < 0) {
+                    perror(name);
+                }
+                close(fd);
+            }
+        }
+    }
+    snprintf(name, sizeof(name), "%s/jre/modules", root);
+    i = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (i >= 0) {
+        if (write(i, data, 64 * 1024 * 1024) < 0) {
+            perror(name);
+        }
+        close(i);
+    }
+    free(data);
+}
+
+static void removeTarget(void) {
+    char command[256];
+    snprintf(command, sizeof(command), "rm -rf %s/copy", root);
+    if (system(command) != 0) {
+        fprintf(stderr, "can't remove %s/copy\n", root);
+    }
+}
+
+static void measureCommand(const char * name, const char * options) {
+    char command[256];
+    double total = 0;
+    int i;
+    snprintf(command, sizeof(command), "cp %s %s/jre %s/copy", options, root, root);
+    for (i = 0; i < RUNS; i++) {
+        double started = currentSeconds();
+        if (system(command) != 0) {
+            fprintf(stderr, "%s failed\n", command);
+        }
+        total += currentSeconds() - started;
+        removeTarget();
+    }
+    printf("  %-16s %9.1f ms\n", name, total * 1000 / RUNS);
+}
+
+static void measureCopyTree(const char * name, int flags, int threads) {
+    char source[256];
+    char target[256];
+    double total = 0;
+    int i;
+    snprintf(source, sizeof(source), "%s/jre", root);
+    snprintf(target, sizeof(target), "%s/copy", root);
+    for (i = 0; i < RUNS; i++) {
+        double started = currentSeconds();
+        if (copyTree(source, target, flags, threads) != TREE_COPY_OK) {
+            fprintf(stderr, "copyTree failed\n");
+        }
+        total += currentSeconds() - started;
+        removeTarget();
+    }
+    printf("  %-16s %9.1f ms\n", name, total * 1000 / RUNS);
+}
+
+int main(void) {
+    char command[256];
+    if (mkdtemp(root) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+    createSource();
+    printf("%d files in %d directories, %d runs\n", DIRS * FILES_PER_DIR + 1, DIRS + 1, RUNS);
+    measureCommand("cp -R -p", "-R -p");
+    measureCopyTree("copy, 1 thread", 0, 1);
+    measureCopyTree("copy", 0, 0);
+    measureCopyTree("clone", TREE_COPY_CLONE, 0);
+    measureCommand("cp -R -l", "-R -l");
+    measureCopyTree("link", TREE_COPY_LINK, 0);
+    snprintf(command, sizeof(command), "rm -rf %s", root);
+    if (system(command) != 0) {
+        fprintf(stderr, "can't remove %s\n", root);
+    }
+    return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Unit tests of copyTree, run by "make test"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "../src/treecopy.h"
+
+static int failures = 0;
+static char root[] = "/tmp/treecopy-test-XXXXXX";
+
+#define CHECK(condition) do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: %s failed\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+static char * path(const char * name) {
+    static char buffers[4][4096];
+    static int next = 0;
+    char * buffer = buffers[next++ % 4];
+    snprintf(buffer, sizeof(buffers[0]), "%s/%s", root, name);
+    return buffer;
+}
+
+static void writeFile(const char * name, const char * content, size_t length, mode_t mode) {
+    int fd = open(path(name), O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if (fd >= 0) {
+        if (write(fd, content, length) != (ssize_t) length) {
+            failures++;
+        }
+        close(fd);
+        chmod(path(name), mode);
+    }
+}
+
+static int sameContent(const char * name1, const char * name2) {
+    FILE * file1 = fopen(path(name1), "rb");
+    FILE * file2 = fopen(path(name2), "rb");
+    int result = (file1 != NULL && file2 != NULL);
+    while (result) {
+        int c1 = fgetc(file1);
+        int c2 = fgetc(file2);
+        if (c1 != c2) {
+            result = 0;
+        }
+        if (c1 == EOF) {
+            break;
+        }
+    }
+    if (file1 != NULL) {
+        fclose(file1);
+    }
+    if (file2 != NULL) {
+        fclose(file2);
+    }
+    return result;
+}
+
+static void createSource(void) {
+    char * large = (char *) malloc(3 * 1024 * 1024 + 17);
+    size_t i;
+    for (i = 0; i < 3 * 1024 * 1024 + 17; i++) {
+        large[i] = (char) (i * 31 + 7);
+    }
+    mkdir(path("jre"), 0755);
+    mkdir(path("jre/bin"), 0755);
+    mkdir(path("jre/lib"), 0755);
+    mkdir(path("jre/lib/empty"), 0700);
+    mkdir(path("jre/lib/server"), 0555);
+    writeFile("jre/bin/java", "#!/bin/sh\necho java\n", 20, 0755);
+    writeFile("jre/lib/modules", large, 3 * 1024 * 1024 + 17, 0644);
+    writeFile("jre/lib/empty.txt", "", 0, 0600);
+    symlink("../bin/java", path("jre/lib/java-link"));
+    free(large);
+    // written last, the directory is read-only
+    chmod(path("jre/lib/server"), 0755);
+    writeFile("jre/lib/server/libjvm.so", "elf", 3, 0755);
+    chmod(path("jre/lib/server"), 0555);
+}
+
+static void checkCopy(const char * target, int linked) {
+    char name[256];
+    struct stat source;
+    struct stat copy;
+    char link[64];
+    ssize_t length;
+
+    snprintf(name, sizeof(name), "%s/bin/java", target);
+    CHECK(sameContent("jre/bin/java", name));
+    CHECK(stat(path("jre/bin/java"), &source) == 0 && stat(path(name), &copy) == 0);
+    CHECK((copy.st_mode & 07777) == 0755);
+    CHECK(copy.st_mtime == source.st_mtime);
+    CHECK(linked ? (copy.st_ino == source.st_ino) : (copy.st_ino != source.st_ino));
+
+    snprintf(name, sizeof(name), "%s/lib/modules", target);
+    CHECK(sameContent("jre/lib/modules", name));
+    CHECK(stat(path(name), &copy) == 0 && copy.st_size == 3 * 1024 * 1024 + 17);
+
+    snprintf(name, sizeof(name), "%s/lib/empty.txt", target);
+    CHECK(stat(path(name), &copy) == 0 && copy.st_size == 0 && (copy.st_mode & 07777) == 0600);
+
+    snprintf(name, sizeof(name), "%s/lib/empty", target);
+    CHECK(stat(path(name), &copy) == 0 && S_ISDIR(copy.st_mode) && (copy.st_mode & 07777) == 0700);
+
+    snprintf(name, sizeof(name), "%s/lib/server", target);
+    CHECK(stat(path(name), &copy) == 0 && (copy.st_mode & 07777) == 0555);
+    snprintf(name, sizeof(name), "%s/lib/server/libjvm.so", target);
+    CHECK(sameContent("jre/lib/server/libjvm.so", name));
+
+    snprintf(name, sizeof(name), "%s/lib/java-link", target);
+    CHECK(lstat(path(name), &copy) == 0 && S_ISLNK(copy.st_mode));
+    length = readlink(path(name), link, sizeof(link) - 1);
+    CHECK(length == 11 && strncmp(link, "../bin/java", 11) == 0);
+}
+
+static void testCopy(void) {
+    CHECK(copyTree(path("jre"), path("copy"), 0, 0) == TREE_COPY_OK);
+    checkCopy("copy", 0);
+}
+
+static void testCopySingleThread(void) {
+    CHECK(copyTree(path("jre"), path("single"), 0, 1) == TREE_COPY_OK);
+    checkCopy("single", 0);
+}
+
+static void testClone(void) {
+    // shared blocks or a plain copy, the files are never the same
+    CHECK(copyTree(path("jre"), path("clone"), TREE_COPY_CLONE, 0) == TREE_COPY_OK);
+    checkCopy("clone", 0);
+}
+
+static void testLink(void) {
+    CHECK(copyTree(path("jre"), path("link"), TREE_COPY_LINK, 0) == TREE_COPY_OK);
+    checkCopy("link", 1);
+}
+
+static void testExistingTarget(void) {
+    mkdir(path("existing"), 0755);
+    CHECK(copyTree(path("jre"), path("existing"), 0, 0) == TREE_COPY_ERROR);
+}
+
+static void testMissingSource(void) {
+    CHECK(copyTree(path("missing"), path("target"), 0, 0) == TREE_COPY_ERROR);
+    CHECK(access(path("target"), F_OK) != 0);
+}
+
+int main(void) {
+    char command[256];
+    if (mkdtemp(root) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+    createSource();
+    testCopy();
+    testCopySingleThread();
+    testClone();
+    testLink();
+    testExistingTarget();
+    testMissingSource();
+    snprintf(command, sizeof(command), "chmod -R u+w %s && rm -rf %s", root, root);
+    if (system(command) != 0) {
+        fprintf(stderr, "can't remove %s\n", root);
+    }
+    if (failures == 0) {
+        printf("treecopy tests passed\n");
+    }
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Benchmark of deleteTree against the recursive walk it replaces, which
+// built the full path of every entry, and against spawning rm -rf.
+// Run by "make bench".
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "../src/treedelete.h"
+
+#define DIRS          100
+#define FILES_PER_DIR 200
+#define RUNS          3
+
+static char root[] = "/tmp/treedelete-bench-XXXXXX";
+static char tree[256];
+
+static double currentSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void createTree(void) {
+    char name[512];
+    int i;
+    int j;
+    mkdir(tree, 0755);
+    for (i = 0; i < DIRS; i++) {
+        snprintf(name, sizeof(name), "%s/dir%d", tree, i);
+        mkdir(name, 0755);
+        for (j = 0; j < FILES_PER_DIR; j++) {
+            int fd;
+            snprintf(name, sizeof(name), "%s/dir%d/file%d.class", tree, i, j);
+            fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd >= 0) {
+                if (write(fd, "cafebabe", 8) < 0) {
+                    perror(name);
+                }
+                close(fd);
+            }
+        }
+    }
+}
+
+// the reference : one thread, full paths and stat for every entry
+static void deleteRecursively(const char * path) {
+    DIR * dir = opendir(path);
+    struct dirent * entry;
+    if (dir == NULL) {
+        return;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        char child[4096];
+        struct stat status;
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+        if (lstat(child, &status) == 0 && S_ISDIR(status.st_mode)) {
+            deleteRecursively(child);
+        } else {
+            unlink(child);
+        }
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+static void measure(const char * name, int method) {
+    double total = 0;
+    int i;
+    for (i = 0; i < RUNS; i++) {
+        double started;
+        char command[512];
+        createTree();
+        started = currentSeconds();
+        if (method == 0) {
+            snprintf(command, sizeof(command), "rm -rf %s", tree);
+            if (system(command) != 0) {
+                fprintf(stderr, "%s failed\n", command);
+            }
+        } else if (method == 1) {
+            deleteRecursively(tree);
+        } else if (deleteTree(tree, (method == 2) ? 1 : 0) != TREE_DELETE_OK) {
+            fprintf(stderr, "deleteTree failed\n");
+        }
+        total += currentSeconds() - started;
+    }
+    printf("  %-18s %9.1f ms\n", name, total * 1000 / RUNS);
+}
+
+int main(void) {
+    if (mkdtemp(root) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(tree, sizeof(tree), "%s/tree", root);
+    printf("%d files in %d directories, %d runs\n", DIRS * FILES_PER_DIR, DIRS + 1, RUNS);
+    measure("rm -rf", 0);
+    measure("recursive, paths", 1);
+    measure("deleteTree, 1", 2);
+    measure("deleteTree", 3);
+    rmdir(root);
+    return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Unit tests of deleteTree, run by "make test"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "../src/treedelete.h"
+
+static int failures = 0;
+static char root[] = "/tmp/treedelete-test-XXXXXX";
+
+#define CHECK(condition) do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: %s failed\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+static char * path(const char * name) {
+    static char buffers[4][4096];
+    static int next = 0;
+    char * buffer = buffers[next++ % 4];
+    snprintf(buffer, sizeof(buffers[0]), "%s/%s", root, name);
+    return buffer;
+}
+
+static void createFile(const char * name) {
+    int fd = open(path(name), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        close(fd);
+    } else {
+        failures++;
+    }
+}
+
+static int exists(const char * name) {
+    struct stat status;
+    return lstat(path(name), &status) == 0;
+}
+
+static void testTree(void) {
+    char name[256];
+    int i;
+    int j;
+    mkdir(path("tree"), 0755);
+    for (i = 0; i < 20; i++) {
+        snprintf(name, sizeof(name), "tree/dir%d", i);
+        mkdir(path(name), 0755);
+        snprintf(name, sizeof(name), "tree/dir%d/sub", i);
+        mkdir(path(name), 0755);
+        for (j = 0; j < 100; j++) {
+            snprintf(name, sizeof(name), "tree/dir%d/file%d", i, j);
+            createFile(name);
+            snprintf(name, sizeof(name), "tree/dir%d/sub/file%d", i, j);
+            createFile(name);
+        }
+    }
+    mkdir(path("tree/empty"), 0755);
+    createFile("tree/top.jar");
+    CHECK(deleteTree(path("tree"), 0) == TREE_DELETE_OK);
+    CHECK(!exists("tree"));
+}
+
+static void testSingleThread(void) {
+    mkdir(path("single"), 0755);
+    mkdir(path("single/a"), 0755);
+    createFile("single/a/b");
+    createFile("single/c");
+    CHECK(deleteTree(path("single"), 1) == TREE_DELETE_OK);
+    CHECK(!exists("single"));
+}
+
+static void testLinksAreNotFollowed(void) {
+    mkdir(path("outside"), 0755);
+    createFile("outside/kept");
+    mkdir(path("links"), 0755);
+    symlink(path("outside"), path("links/dir-link"));
+    symlink(path("outside/kept"), path("links/file-link"));
+    symlink(path("missing"), path("links/dangling"));
+    CHECK(deleteTree(path("links"), 0) == TREE_DELETE_OK);
+    CHECK(!exists("links"));
+    CHECK(exists("outside/kept"));
+}
+
+static void testRootLink(void) {
+    symlink(path("outside"), path("root-link"));
+    CHECK(deleteTree(path("root-link"), 0) == TREE_DELETE_OK);
+    CHECK(!exists("root-link"));
+    CHECK(exists("outside/kept"));
+}
+
+static void testFile(void) {
+    createFile("file");
+    CHECK(deleteTree(path("file"), 0) == TREE_DELETE_OK);
+    CHECK(!exists("file"));
+}
+
+static void testMissing(void) {
+    CHECK(deleteTree(path("missing"), 0) == TREE_DELETE_OK);
+}
+
+static void testDeepTree(void) {
+    char name[4096];
+    size_t length;
+    int i;
+    strcpy(name, "deep");
+    mkdir(path(name), 0755);
+    for (i = 0; i < 200; i++) {
+        length = strlen(name);
+        snprintf(name + length, sizeof(name) - length, "/d%d", i % 10);
+        if (mkdir(path(name), 0755) != 0) {
+            break;
+        }
+    }
+    CHECK(deleteTree(path("deep"), 0) == TREE_DELETE_OK);
+    CHECK(!exists("deep"));
+}
+
+static void testUndeletable(void) {
+    // only root can delete from a read-only directory
+    if (geteuid() == 0) {
+        return;
+    }
+    mkdir(path("locked"), 0755);
+    mkdir(path("locked/ro"), 0755);
+    createFile("locked/ro/file");
+    chmod(path("locked/ro"), 0555);
+    CHECK(deleteTree(path("locked"), 0) == TREE_DELETE_ERROR);
+    CHECK(exists("locked/ro/file"));
+    chmod(path("locked/ro"), 0755);
+    CHECK(deleteTree(path("locked"), 0) == TREE_DELETE_OK);
+}
+
+int main(void) {
+    char command[256];
+    if (mkdtemp(root) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+    testTree();
+    testSingleThread();
+    testLinksAreNotFollowed();
+    testRootLink();
+    testFile();
+    testMissing();
+    testDeepTree();
+    testUndeletable();
+    snprintf(command, sizeof(command), "chmod -R u+w %s && rm -rf %s", root, root);
+    if (system(command) != 0) {
+        fprintf(stderr, "can't remove %s\n", root);
+    }
+    if (failures == 0) {
+        printf("treedelete tests passed\n");
+    }
+    return (failures == 0) ? 0 : 1;
+}
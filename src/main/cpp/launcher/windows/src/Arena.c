@@ -0,0 +1,189 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <string.h>
+#ifndef _WIN32
+#include <stdlib.h>
+#endif
+#include "Arena.h"
+
+#ifdef _WIN32
+#define SYSTEM_ALLOC(size) LocalAlloc(LPTR, (size))
+#define SYSTEM_FREE(ptr)   LocalFree(ptr)
+#else
+#define SYSTEM_ALLOC(size) calloc(1, (size))
+#define SYSTEM_FREE(ptr)   free(ptr)
+#endif
+
+#define BLOCK_DATA(block) (((char *) (block)) + ARENA_HEADER_SIZE)
+
+ArenaBlock * newArenaBlock(DWORD size) {
+    ArenaBlock * block = (ArenaBlock *) SYSTEM_ALLOC(ARENA_HEADER_SIZE + size);
+    if(block!=NULL) {
+        block->size = size;
+        block->used = 0;
+        block->next = NULL;
+    }
+    return block;
+}
+
+Arena * newArena(DWORD blockSize) {
+    Arena * arena = (Arena *) SYSTEM_ALLOC(sizeof(Arena));
+    if(arena==NULL) return NULL;
+    arena->blockSize = blockSize;
+    arena->blocks = newArenaBlock(blockSize);
+    if(arena->blocks==NULL) {
+        SYSTEM_FREE(arena);
+        return NULL;
+    }
+    arena->first = arena->blocks;
+    return arena;
+}
+
+void * arenaAlloc(Arena * arena, DWORD size) {
+    ArenaBlock * block;
+    char * result;
+    
+    if(arena==NULL) return NULL;
+    block = arena->blocks;
+    size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    if(block==NULL || block->size - block->used < size) {
+        if(size > arena->blockSize / 4 && block!=NULL) {
+            // big chunk gets its own block, the current one is still used for small ones
+            ArenaBlock * big = newArenaBlock(size);
+            if(big==NULL) return NULL;
+            big->used = size;
+            big->next = block->next;
+            block->next = big;
+            return BLOCK_DATA(big);
+        }
+        block = newArenaBlock(size > arena->blockSize ? size : arena->blockSize);
+        if(block==NULL) return NULL;
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+    result = BLOCK_DATA(block) + block->used;
+    block->used += size;
+    return result;
+}
+
+char * arenaCopyA(Arena * arena, const char * str) {
+    char * result;
+    DWORD length;
+    if(str==NULL) return NULL;
+    length = (DWORD) strlen(str);
+    result = (char *) arenaAlloc(arena, length + 1);
+    if(result!=NULL) {
+        memcpy(result, str, length);
+    }
+    return result;
+}
+
+WCHAR * arenaCopyW(Arena * arena, const WCHAR * str) {
+    WCHAR * result;
+    DWORD length = 0;
+    if(str==NULL) return NULL;
+    while(str[length]!=0) length++;
+    result = (WCHAR *) arenaAlloc(arena, sizeof(WCHAR) * (length + 1));
+    if(result!=NULL) {
+        memcpy(result, str, sizeof(WCHAR) * length);
+    }
+    return result;
+}
+
+char * arenaAppendA(Arena * arena, const char * initial, const char * addString) {
+    DWORD initialLength = (initial==NULL) ? 0 : (DWORD) strlen(initial);
+    DWORD addLength = (addString==NULL) ? 0 : (DWORD) strlen(addString);
+    char * result = (char *) arenaAlloc(arena, initialLength + addLength + 1);
+    if(result!=NULL) {
+        if(initialLength > 0) memcpy(result, initial, initialLength);
+        if(addLength > 0) memcpy(result + initialLength, addString, addLength);
+    }
+    return result;
+}
+
+char * arenaDWORDtoCHAR(Arena * arena, DWORD value, DWORD fillZeros) {
+    DWORD digits = 0;
+    DWORD tmpValue = value;
+    DWORD i;
+    char * str;
+    
+    do {
+        digits++;
+        tmpValue = tmpValue / 10;
+    } while(tmpValue!=0);
+    if(digits < fillZeros) {
+        digits = fillZeros;
+    }
+    str = (char *) arenaAlloc(arena, digits + 1);
+    if(str!=NULL) {
+        tmpValue = value;
+        for(i = 0; i < digits; i++) {
+            str[digits - i - 1] = '0' + (char) (tmpValue % 10);
+            tmpValue = tmpValue / 10;
+        }
+    }
+    return str;
+}
+
+void resetArena(Arena * arena) {
+    ArenaBlock * block;
+    if(arena==NULL) return;
+    block = arena->blocks;
+    while(block!=NULL) {
+        ArenaBlock * next = block->next;
+        if(block!=arena->first) {
+            SYSTEM_FREE(block);
+        }
+        block = next;
+    }
+    if(arena->first!=NULL) {
+        memset(BLOCK_DATA(arena->first), 0, arena->first->used);
+        arena->first->used = 0;
+        arena->first->next = NULL;
+    }
+    arena->blocks = arena->first;
+}
+
+void freeArena(Arena ** arena) {
+    if(*arena!=NULL) {
+        ArenaBlock * block = (*arena)->blocks;
+        while(block!=NULL) {
+            ArenaBlock * next = block->next;
+            SYSTEM_FREE(block);
+            block = next;
+        }
+        SYSTEM_FREE(*arena);
+        *arena = NULL;
+    }
+}
+
+void mergeArena(Arena * arena, Arena ** other) {
+    ArenaBlock * last;
+    if(arena==NULL || *other==NULL) return;
+    last = (*other)->blocks;
+    while(last->next!=NULL) {
+        last = last->next;
+    }
+    // behind the current block, which keeps serving the allocations of arena
+    last->next = arena->blocks->next;
+    arena->blocks->next = (*other)->blocks;
+    SYSTEM_FREE(*other);
+    *other = NULL;
+}
@@ -0,0 +1,81 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef _Arena_H
+#define	_Arena_H
+
+// Nothing here needs more than the C runtime, so that the allocator builds
+// and is measured on other systems too (see the Unix launcher "make bench")
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <stddef.h>
+#include <wchar.h>
+typedef unsigned int DWORD;
+typedef wchar_t WCHAR;
+#endif
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+// Bump allocator for data living until the arena is freed or reset.
+// Allocations are zeroed and are never freed one by one : never call
+// FREE for the pointers returned here. An arena is not thread-safe.
+    
+#define ARENA_BLOCK_SIZE   65536
+#define ARENA_SCRATCH_SIZE 4096
+#define ARENA_ALIGNMENT    8
+    
+    typedef struct _arenaBlock {
+        struct _arenaBlock * next;
+        DWORD size;
+        DWORD used;
+    } ArenaBlock;
+    
+    // the data of a block starts after the header rounded up to the alignment
+#define ARENA_HEADER_SIZE ((sizeof(ArenaBlock) + ARENA_ALIGNMENT - 1) & ~((size_t) ARENA_ALIGNMENT - 1))
+    
+    typedef struct _arena {
+        ArenaBlock * blocks;
+        ArenaBlock * first;
+        DWORD blockSize;
+    } Arena;
+    
+    // NULL if there is no memory, arenaAlloc returns NULL for a NULL arena
+    Arena * newArena(DWORD blockSize);
+    void * arenaAlloc(Arena * arena, DWORD size);
+    char * arenaCopyA(Arena * arena, const char * str);
+    WCHAR * arenaCopyW(Arena * arena, const WCHAR * str);
+    char * arenaAppendA(Arena * arena, const char * initial, const char * addString);
+    char * arenaDWORDtoCHAR(Arena * arena, DWORD value, DWORD fillZeros);
+    
+    // release everything but the first block, to reuse the arena for temporary data
+    void resetArena(Arena * arena);
+    void freeArena(Arena ** arena);
+    // moves the blocks of other to arena, the data stays until arena is freed.
+    // Nothing is moved if arena is NULL
+    void mergeArena(Arena * arena, Arena ** other);
+    
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _Arena_H */
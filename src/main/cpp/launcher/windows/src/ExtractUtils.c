@@ -28,6 +28,8 @@
 #include "JavaUtils.h"
 #include "RegistryUtils.h"
 #include "ExtractUtils.h"
+#include "Inflate.h"
+#include "Arena.h"
 #include "Launcher.h"
 #include "Main.h"
 
@@ -389,8 +391,421 @@ void extractDataToFile(LauncherProperties * props, WCHAR *output, int64t * fileS
     }
 }
 
+DWORD isGzipFile(WCHAR * path) {
+    unsigned char magic[2];
+    DWORD read = 0;
+    HANDLE hFile = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+    if(hFile==INVALID_HANDLE_VALUE) return 0;
+    if(!ReadFile(hFile, magic, 2, &read, 0)) read = 0;
+    CloseHandle(hFile);
+    return (read==2 && magic[0]==0x1f && magic[1]==0x8b);
+}
+
+ULONGLONG parseTarNumber(char * field, DWORD length) {
+    ULONGLONG result = 0;
+    DWORD i = 0;
+    if(((unsigned char) field[0]) & 0x80) {
+        // base-256 encoding for big values
+        result = ((unsigned char) field[0]) & 0x7f;
+        for(i = 1; i < length; i++) {
+            result = (result << 8) | ((unsigned char) field[i]);
+        }
+        return result;
+    }
+    while(i < length && (field[i]==' ' || field[i]=='\0')) i++;
+    for(; i < length && field[i]>='0' && field[i]<='7'; i++) {
+        result = (result << 3) + (field[i] - '0');
+    }
+    return result;
+}
+
+// convert entry name to the path within the directory, NULL if it goes outside
+WCHAR * getTarEntryPath(TarExtraction * tar, char * name) {
+    WCHAR * relative = NULL;
+    WCHAR * result = NULL;
+    WCHAR * ptr;
+    WCHAR * segment;
+    DWORD length = getLengthA(name);
+    DWORD wlength;
+    
+    while(name[0]=='.' && name[1]=='/') {
+        name += 2;
+        length -= 2;
+    }
+    if(length==0 || name[0]=='/' || name[0]=='\\') return NULL;
+    
+    wlength = MultiByteToWideChar(CP_UTF8, 0, name, length, NULL, 0);
+    relative = newpWCHAR(wlength + 1);
+    MultiByteToWideChar(CP_UTF8, 0, name, length, relative, wlength);
+    
+    segment = relative;
+    for(ptr = relative; ; ptr++) {
+        if(*ptr==L'/' || *ptr==L'\\' || *ptr==0) {
+            if((ptr - segment)==2 && segment[0]==L'.' && segment[1]==L'.') {
+                FREE(relative);
+                return NULL;
+            }
+            if(*ptr==0) break;
+            *ptr = L'\\';
+            segment = ptr + 1;
+        } else if(*ptr==L':') {
+            FREE(relative);
+            return NULL;
+        }
+    }
+    // strip trailing separator of directory entries
+    wlength = getLengthW(relative);
+    while(wlength > 0 && relative[wlength - 1]==L'\\') {
+        relative[--wlength] = 0;
+    }
+    if(wlength > 0) {
+        result = appendStringW(appendStringW(appendStringW(NULL, tar->directory), FILE_SEP), relative);
+    }
+    FREE(relative);
+    return result;
+}
+
+void createTarDirectories(TarExtraction * tar, WCHAR * path, DWORD includeLast) {
+    DWORD start = getLengthW(tar->directory) + 1;
+    DWORD length = getLengthW(path);
+    DWORD i;
+    for(i = start; i <= length; i++) {
+        if(path[i]==L'\\' || (includeLast && path[i]==0)) {
+            WCHAR c = path[i];
+            path[i] = 0;
+            if(!CreateDirectoryW(path, NULL) && GetLastError()!=ERROR_ALREADY_EXISTS) {
+                writeErrorA(tar->props, OUTPUT_LEVEL_DEBUG, 1, "Error! Can`t create directory : ", path, GetLastError());
+            }
+            path[i] = c;
+        }
+    }
+}
+
+void startTarEntry(TarExtraction * tar) {
+    char * h = tar->header;
+    char * name = NULL;
+    WCHAR * path = NULL;
+    DWORD sum = 0;
+    DWORD i;
+    
+    for(i = 0; i < TAR_BLOCK_SIZE; i++) {
+        sum += (i >= 148 && i < 156) ? ' ' : (unsigned char) h[i];
+    }
+    if(sum == 8 * ' ') {
+        // empty block marks the end of the archive
+        tar->finished = 1;
+        return;
+    }
+    if(sum != (DWORD) parseTarNumber(h + 148, 8)) {
+        writeMessageA(tar->props, OUTPUT_LEVEL_DEBUG, 1, "... wrong tar header checksum", 1);
+        tar->props->status = ERROR_INTEGRITY;
+        return;
+    }
+    
+    tar->type = h[156];
+    tar->remaining = parseTarNumber(h + 124, 12);
+    tar->padding = (DWORD) ((TAR_BLOCK_SIZE - (tar->remaining % TAR_BLOCK_SIZE)) % TAR_BLOCK_SIZE);
+    
+    if(tar->type=='L' || tar->type=='K' || tar->type=='x') {
+        // long name or link target of the next entry
+        if(tar->remaining > 65536) {
+            tar->props->status = ERROR_INTEGRITY;
+            return;
+        }
+        tar->meta = newpChar((DWORD) tar->remaining + 1);
+        tar->metaLength = 0;
+        return;
+    }
+    
+    if(tar->longName!=NULL) {
+        name = tar->longName;
+        tar->longName = NULL;
+    } else {
+        DWORD nameLength = 0;
+        DWORD prefixLength = 0;
+        while(nameLength < 100 && h[nameLength]) nameLength++;
+        if(memcmp(h + 257, "ustar", 5)==0) {
+            while(prefixLength < 155 && h[345 + prefixLength]) prefixLength++;
+        }
+        name = newpChar(prefixLength + nameLength + 2);
+        if(prefixLength > 0) {
+            memcpy(name, h + 345, prefixLength);
+            name[prefixLength++] = '/';
+        }
+        memcpy(name + prefixLength, h, nameLength);
+    }
+    
+    if(tar->type=='g') {
+        FREE(name);
+        return;
+    }
+    path = getTarEntryPath(tar, name);
+    if(path==NULL) {
+        writeMessageA(tar->props, OUTPUT_LEVEL_DEBUG, 1, "... skip entry outside of the directory : ", 0);
+        writeMessageA(tar->props, OUTPUT_LEVEL_DEBUG, 1, name, 1);
+    } else if(tar->type=='5') {
+        createTarDirectories(tar, path, 1);
+        tar->entries++;
+    } else if(tar->type=='0' || tar->type=='\0' || tar->type=='7') {
+        createTarDirectories(tar, path, 0);
+        tar->file = CreateFileW(path, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+        if(tar->file==INVALID_HANDLE_VALUE) {
+            writeErrorA(tar->props, OUTPUT_LEVEL_DEBUG, 1, "Error! Can`t create file : ", path, GetLastError());
+            tar->props->status = ERROR_INPUTOUPUT;
+        } else if(tar->remaining > 0) {
+            // let the file system reserve the space at once
+            LARGE_INTEGER size;
+            size.QuadPart = (LONGLONG) tar->remaining;
+            if(SetFilePointerEx(tar->file, size, NULL, FILE_BEGIN)) {
+                SetEndOfFile(tar->file);
+                size.QuadPart = 0;
+                SetFilePointerEx(tar->file, size, NULL, FILE_BEGIN);
+            }
+        }
+        tar->entries++;
+    } else if(tar->type=='1') {
+        WCHAR * target = NULL;
+        char linkName[101];
+        memcpy(linkName, h + 157, 100);
+        linkName[100] = 0;
+        target = getTarEntryPath(tar, (tar->longLink!=NULL) ? tar->longLink : linkName);
+        createTarDirectories(tar, path, 0);
+        if(target==NULL || !CopyFileW(target, path, FALSE)) {
+            writeErrorA(tar->props, OUTPUT_LEVEL_DEBUG, 1, "Error! Can`t create hard link : ", path, GetLastError());
+            tar->props->status = ERROR_INPUTOUPUT;
+        }
+        FREE(target);
+        tar->entries++;
+    } else {
+        // symbolic links, devices and the like are not needed for the JVM on windows
+        writeMessageA(tar->props, OUTPUT_LEVEL_DEBUG, 0, "... skip tar entry : ", 0);
+        writeMessageW(tar->props, OUTPUT_LEVEL_DEBUG, 0, path, 1);
+    }
+    FREE(tar->longLink);
+    FREE(path);
+    FREE(name);
+}
+
+void finishTarEntry(TarExtraction * tar) {
+    if(tar->file!=INVALID_HANDLE_VALUE) {
+        CloseHandle(tar->file);
+        tar->file = INVALID_HANDLE_VALUE;
+    }
+    if(tar->meta!=NULL) {
+        if(tar->type=='L') {
+            FREE(tar->longName);
+            tar->longName = tar->meta;
+            tar->meta = NULL;
+        } else if(tar->type=='K') {
+            FREE(tar->longLink);
+            tar->longLink = tar->meta;
+            tar->meta = NULL;
+        } else {
+            // pax records : "<length> <key>=<value>\n"
+            DWORD position = 0;
+            while(position < tar->metaLength) {
+                DWORD recordLength = 0;
+                DWORD i = position;
+                while(i < tar->metaLength && tar->meta[i]>='0' && tar->meta[i]<='9') {
+                    recordLength = recordLength * 10 + (tar->meta[i++] - '0');
+                }
+                if(recordLength==0 || position + recordLength > tar->metaLength) break;
+                if(tar->meta[i]==' ' && recordLength > (i - position) + 7 &&
+                        memcmp(tar->meta + i + 1, "path=", 5)==0) {
+                    DWORD valueLength = recordLength - (i - position) - 7;
+                    FREE(tar->longName);
+                    tar->longName = newpChar(valueLength + 1);
+                    memcpy(tar->longName, tar->meta + i + 6, valueLength);
+                } else if(tar->meta[i]==' ' && recordLength > (i - position) + 11 &&
+                        memcmp(tar->meta + i + 1, "linkpath=", 9)==0) {
+                    DWORD valueLength = recordLength - (i - position) - 11;
+                    FREE(tar->longLink);
+                    tar->longLink = newpChar(valueLength + 1);
+                    memcpy(tar->longLink, tar->meta + i + 10, valueLength);
+                }
+                position += recordLength;
+            }
+            FREE(tar->meta);
+        }
+        tar->metaLength = 0;
+    }
+}
+
+DWORD writeTarData(void * context, char * buf, DWORD size) {
+    TarExtraction * tar = (TarExtraction *) context;
+    while(size > 0 && !tar->finished && isOK(tar->props)) {
+        DWORD n;
+        if(tar->remaining > 0) {
+            n = (tar->remaining < size) ? (DWORD) tar->remaining : size;
+            if(tar->file!=INVALID_HANDLE_VALUE) {
+                DWORD written = 0;
+                char * ptr = buf;
+                DWORD left = n;
+                while(left > 0) {
+                    if(!WriteFile(tar->file, ptr, left, &written, 0) || written==0) {
+                        tar->props->status = ERROR_INPUTOUPUT;
+                        return 0;
+                    }
+                    ptr += written;
+                    left -= written;
+                }
+            } else if(tar->meta!=NULL) {
+                memcpy(tar->meta + tar->metaLength, buf, n);
+                tar->metaLength += n;
+            }
+            tar->remaining -= n;
+            if(tar->remaining==0) {
+                finishTarEntry(tar);
+            }
+        } else if(tar->padding > 0) {
+            n = (tar->padding < size) ? tar->padding : size;
+            tar->padding -= n;
+        } else {
+            n = TAR_BLOCK_SIZE - tar->headerLength;
+            if(n > size) n = size;
+            memcpy(tar->header + tar->headerLength, buf, n);
+            tar->headerLength += n;
+            if(tar->headerLength==TAR_BLOCK_SIZE) {
+                tar->headerLength = 0;
+                startTarEntry(tar);
+                if(tar->remaining==0 && !tar->finished) {
+                    finishTarEntry(tar);
+                }
+            }
+        }
+        buf += n;
+        size -= n;
+    }
+    return isOK(tar->props);
+}
+
+// expand tar.gz data into the directory without any external process
+void expandTarGz(LauncherProperties * props, InflateReadFunc read, void * readContext, WCHAR * directory) {
+    TarExtraction tar;
+    InflateStream * stream;
+    DWORD result;
+    
+    ZERO(&tar, sizeof(TarExtraction));
+    tar.props = props;
+    tar.directory = directory;
+    tar.file = INVALID_HANDLE_VALUE;
+    
+    stream = newInflateStream(read, readContext, &writeTarData, &tar);
+    if(stream==NULL) {
+        writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "... not enough memory to inflate the archive", 1);
+        props->status = EXIT_CODE_SYSTEM_ERROR;
+        return;
+    }
+    result = gunzipData(stream);
+    
+    finishTarEntry(&tar);
+    FREE(tar.longName);
+    FREE(tar.longLink);
+    FREE(stream);
+    
+    writeDWORD(props, OUTPUT_LEVEL_DEBUG, 0, "... extracted tar entries : ", tar.entries, 1);
+    if(isOK(props) && (result!=INFLATE_OK || !tar.finished)) {
+        writeDWORD(props, OUTPUT_LEVEL_DEBUG, 1, "... corrupted archive, inflate error ", result, 1);
+        props->status = ERROR_INTEGRITY;
+    }
+}
+
+void extractTarGzArchive(LauncherProperties * props, WCHAR * archive, WCHAR * directory) {
+    HANDLE hFile = CreateFileW(archive, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    
+    if(hFile==INVALID_HANDLE_VALUE) {
+        writeErrorA(props, OUTPUT_LEVEL_DEBUG, 1, "Error! Can`t open file : ", archive, GetLastError());
+        props->status = ERROR_INPUTOUPUT;
+        return;
+    }
+    expandTarGz(props, &readFromHandle, hFile, directory);
+    CloseHandle(hFile);
+}
+
+// the directory a bundled JVM archive is expanded to
+WCHAR * getArchiveDirectory(WCHAR * archive) {
+    return appendStringW(getParentDirectory(archive), L"\\_jvm");
+}
+
+// reads the bytes of one bundled file, first those already in the rest of bytes
+DWORD readFromPayload(void * context, char * buf, DWORD size) {
+    PayloadReader * reader = (PayloadReader *) context;
+    LauncherProperties * props = reader->props;
+    SizedString * rest = props->restOfBytes;
+    DWORD read = 0;
+    
+    if(compare(reader->remaining, size) < 0) {
+        size = reader->remaining->Low;
+    }
+    if(size==0 || !isOK(props)) return 0;
+    
+    if(rest->length > 0) {
+        read = (rest->length < size) ? rest->length : size;
+        memcpy(buf, rest->bytes, read);
+        modifyRestBytes(rest, read);
+    } else {
+        if((reader->counter++) % 20 == 0 && isTerminated(props)) return 0;
+        if(!ReadFile(props->handler, buf, size, &read, 0)) {
+            read = 0;
+        }
+        addProgressPosition(props, read);
+    }
+    update_crc32(&reader->crc32, buf, read);
+    minus(reader->remaining, read);
+    return read;
+}
+
+// checks the magic bytes of the next bundled file, they stay in the rest of bytes
+DWORD isGzipPayload(LauncherProperties * props, int64t * fileLength) {
+    SizedString * rest = props->restOfBytes;
+    
+    if(compare(fileLength, 2) < 0) return 0;
+    while(rest->length < 2) {
+        char buf[2];
+        DWORD read = 0;
+        if(!ReadFile(props->handler, buf, 2 - rest->length, &read, 0) || read==0) {
+            return 0;
+        }
+        addProgressPosition(props, read);
+        rest->bytes = appendStringN(rest->bytes, rest->length, buf, read);
+        rest->length += read;
+    }
+    return ((unsigned char) rest->bytes[0])==0x1f && ((unsigned char) rest->bytes[1])==0x8b;
+}
+
+// expands the tar.gz bundled file while it is read, the archive itself is never written
+void extractTarGzPayload(LauncherProperties * props, int64t * fileLength, DWORD expectedCRC, WCHAR * directory) {
+    PayloadReader reader;
+    int64t * remaining = newint64_t(fileLength->Low, fileLength->High);
+    
+    reader.props = props;
+    reader.remaining = remaining;
+    reader.crc32 = -1L;
+    reader.counter = 0;
+    
+    expandTarGz(props, &readFromPayload, &reader, directory);
+    if(isOK(props) && compare(remaining, 0) > 0) {
+        // the gzip data ended before the file did, the rest belongs to the file anyway
+        char * buf = newpChar(props->bufsize);
+        while(readFromPayload(&reader, buf, props->bufsize) > 0);
+        FREE(buf);
+    }
+    if(isOK(props) && !isTerminated(props) && compare(remaining, 0) > 0) {
+        writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "Can`t read data from file : not enought data", 1);
+        props->status = ERROR_INTEGRITY;
+    }
+    reader.crc32 = ~reader.crc32;
+    if(isOK(props) && reader.crc32!=expectedCRC) {
+        writeDWORD(props, OUTPUT_LEVEL_DEBUG, 0, "expected CRC : ", expectedCRC, 1);
+        writeDWORD(props, OUTPUT_LEVEL_DEBUG, 0, "real     CRC : ", reader.crc32, 1);
+        props->status = ERROR_INTEGRITY;
+    }
+    FREE(remaining);
+}
+
 //returns : ERROR_OK, ERROR_INTEGRITY, ERROR_FREE_SPACE
-void extractFileToDir(LauncherProperties * props, WCHAR ** resultFile) {
+// with expandArchive a tar.gz file is expanded to its archive directory instead
+void extractFileToDir(LauncherProperties * props, LauncherResource * file, DWORD expandArchive) {
     WCHAR * fileName = NULL;
     int64t * fileLength = NULL;
     DWORD crc = 0;
@@ -403,6 +818,7 @@ void extractFileToDir(LauncherProperties * props, WCHAR ** resultFile) {
     readNumberWithDebug( props, &crc, "CRC32");
     
     if(!isOK(props)) return;
+    props->payloadHash = updateHash(props->payloadHash, &crc, sizeof(DWORD));
     
     if(fileName!=NULL) {
         DWORD i=0;
@@ -421,19 +837,35 @@ void extractFileToDir(LauncherProperties * props, WCHAR ** resultFile) {
         
         checkFreeSpace(props, dir, fileLength);
         FREE(dir);
-        if(isOK(props)) {
+        if(isOK(props) && expandArchive && isGzipPayload(props, fileLength)) {
+            WCHAR * archiveDir = getArchiveDirectory(fileName);
+            writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "   ... expanding archive to ", 0);
+            writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, archiveDir, 1);
+            createDirectory(props, archiveDir);
+            if(isOK(props)) {
+                extractTarGzPayload(props, fileLength, crc, archiveDir);
+            }
+            writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "   ... expansion finished", 1);
+            FREE(archiveDir);
+            file->path = moveToArenaW(props->arena, fileName);
+            file->length = *fileLength;
+            file->crc = crc;
+            file->expanded = 1;
+        } else if(isOK(props)) {
             writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "   ... starting data extraction", 1);
             writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "   ... output file is ", 0);
             writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, fileName, 1);
             extractDataToFile(props, fileName, fileLength, crc);
             writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "   ... extraction finished", 1);
-            *resultFile = fileName;
+            file->path = moveToArenaW(props->arena, fileName);
+            file->length = *fileLength;
+            file->crc = crc;
         } else {
             writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "   ... data extraction canceled", 1);
         }
     } else {
         writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0,  "Error! File name can`t be null. Seems to be integrity error!", 1);
-        *resultFile = NULL;
+        file->path = NULL;
         props -> status = ERROR_INTEGRITY;
     }
     FREE(fileLength);
@@ -441,6 +873,58 @@ void extractFileToDir(LauncherProperties * props, WCHAR ** resultFile) {
 }
 
 
+// skip bytes of the payload without decoding them
+void skipPayloadBytes(LauncherProperties * props, DWORD length) {
+    SizedString * rest = props->restOfBytes;
+    DWORD fromRest = (length < rest->length) ? length : rest->length;
+    
+    if(fromRest > 0) {
+        modifyRestBytes(rest, fromRest);
+        length -= fromRest;
+    }
+    if(length > 0) {
+        LARGE_INTEGER distance;
+        distance.QuadPart = length;
+        if(!SetFilePointerEx(props->handler, distance, NULL, FILE_CURRENT)) {
+            props->status = ERROR_INTEGRITY;
+            return;
+        }
+        addProgressPosition(props, length);
+    }
+}
+
+// read the values of one locale, keep them if the locale matches
+void readI18NLocaleValues(LauncherProperties * props, Arena * scratch, DWORD numberOfProperties, DWORD isLocaleMatches) {
+    DWORD i;
+    for(i=0;i<numberOfProperties;i++) {
+        // read property value as UNICODE
+        
+        WCHAR * value = NULL;
+        char * label = arenaAppendA(scratch, "value ", arenaDWORDtoCHAR(scratch, i + 1, 0));
+        label = arenaAppendA(scratch, label, "/");
+        label = arenaAppendA(scratch, label, arenaDWORDtoCHAR(scratch, numberOfProperties, 0));
+        readStringWithDebugW(props, &value, label);
+        resetArena(scratch);
+        
+        if(!isOK(props)) break;
+        if(isLocaleMatches) {
+            //it is a know property
+            props->i18nMessages->strings[i] = arenaCopyW(props->arena, value);
+        }
+        FREE(value);
+    }
+}
+
+DWORD isI18NLocaleMatches(WCHAR * currentLocale, WCHAR * localeName) {
+    // default locale has no name
+    return (localeName==NULL) ?  1 : searchW(currentLocale, localeName) != NULL;
+}
+
+// Two layouts of the i18n section are supported :
+//   <locales> <properties> <names...> then <locale> <values...> for every locale
+//   0 <locales> <properties> <names...> then <locale> <block length> for every locale
+//     and then the blocks of <values...> in the same order, lengths are in bytes
+// with the second one the blocks of other locales are skipped, not decoded
 void loadI18NStrings(LauncherProperties * props) {
     DWORD i=0;
     DWORD j=0;
@@ -448,9 +932,17 @@ void loadI18NStrings(LauncherProperties * props) {
     
     DWORD numberOfLocales = 0;
     DWORD numberOfProperties = 0;
+    DWORD isIndexed = 0;
+    Arena * scratch = props->scratch;
     
     readNumberWithDebug(props, &numberOfLocales, "number of locales");
     if(!isOK(props)) return;
+    if(numberOfLocales==0) {
+        // no locale at all is invalid, so zero marks the indexed layout
+        isIndexed = 1;
+        readNumberWithDebug(props, &numberOfLocales, "number of indexed locales");
+        if(!isOK(props)) return;
+    }
     if(numberOfLocales==0) {
         props->status = ERROR_INTEGRITY;
         return ;
@@ -464,29 +956,48 @@ void loadI18NStrings(LauncherProperties * props) {
         return ;
     }
     
-    props->i18nMessages = (I18NStrings * ) LocalAlloc(LPTR, sizeof(I18NStrings) * numberOfProperties);
+    // the strings live until exit : all of them are in the launcher arena
+    props->i18nMessages = (I18NStrings * ) arenaAlloc(props->arena, sizeof(I18NStrings));
+    if(props->i18nMessages==NULL) {
+        props->status = EXIT_CODE_SYSTEM_ERROR;
+        return;
+    }
     
+    props->i18nMessages->properties = (char **) arenaAlloc(props->arena, sizeof(char *) * numberOfProperties);
+    props->i18nMessages->strings = (WCHAR **) arenaAlloc(props->arena, sizeof(WCHAR *) * numberOfProperties);
+    if(props->i18nMessages->properties==NULL || props->i18nMessages->strings==NULL) {
+        props->status = EXIT_CODE_SYSTEM_ERROR;
+        return;
+    }
     props->I18N_PROPERTIES_NUMBER = numberOfProperties;
-    props->i18nMessages->properties = newppChar(props->I18N_PROPERTIES_NUMBER);
-    props->i18nMessages->strings = newppWCHAR(props->I18N_PROPERTIES_NUMBER);
     
+    // debug labels are built in the scratch arena, reset after every read
     for(i=0; isOK(props) && i<numberOfProperties;i++) {
         // read property name as ASCII
-        char * propName = NULL;
-        char * number = DWORDtoCHARN(i,2);
-        props->i18nMessages->properties[i] = NULL;
-        props->i18nMessages->strings[i] = NULL;
-        propName = appendString(NULL, "property name ");
+        char * propName = arenaAppendA(scratch, "property name ", arenaDWORDtoCHAR(scratch, i, 2));
+        char * name = NULL;
         
-        propName = appendString(propName, number);
-        FREE(number);
-        
-        readStringWithDebugA(props, & (props->i18nMessages->properties[i]), propName);
-        FREE(propName);
+        readStringWithDebugA(props, &name, propName);
+        props->i18nMessages->properties[i] = arenaCopyA(props->arena, name);
+        FREE(name);
+        resetArena(scratch);
     }
     if(isOK(props)) {
-        
-        DWORD isLocaleMatches;
+        // map the names to the launcher property ids once, lookups are by id then
+        props->i18nMessages->indexes = (DWORD *) arenaAlloc(props->arena, sizeof(DWORD) * I18N_PROPERTIES_COUNT);
+        if(props->i18nMessages->indexes==NULL) {
+            props->status = EXIT_CODE_SYSTEM_ERROR;
+            return;
+        }
+        for(i=0;i<numberOfProperties;i++) {
+            DWORD id = getI18nPropertyId(props->i18nMessages->properties[i]);
+            if(id != I18N_UNKNOWN_PROPERTY) {
+                props->i18nMessages->indexes[id] = i + 1;
+            }
+        }
+    }
+    
+    if(isOK(props)) {
         WCHAR * localeName;
         WCHAR * currentLocale = getLocaleName();
         
@@ -500,132 +1011,99 @@ void loadI18NStrings(LauncherProperties * props) {
             currentLocale = appendStringW(NULL, props->userDefinedLocale);
         }
         
-        for(j=0;j<numberOfLocales;j++) { //  for all locales in file...
-            // read locale name as UNICODE ..
-            // it should be like en_US or smth like that
-            localeName = NULL;
-            readStringWithDebugW(props, &localeName, "locale name");
-            if(!isOK(props)) break;
+        if(isIndexed) {
+            DWORD * blockLengths = (DWORD *) LocalAlloc(LPTR, sizeof(DWORD) * numberOfLocales);
+            DWORD * blockMatches = (DWORD *) LocalAlloc(LPTR, sizeof(DWORD) * numberOfLocales);
             
-            isLocaleMatches = (localeName==NULL) ?  1 :
-                searchW(currentLocale, localeName) != NULL;
-                
-                //read properties names and value
-                for(i=0;i<numberOfProperties;i++) {
-                    // read property value as UNICODE
-                    
-                    WCHAR * value = NULL;
-                    char * s1 =  DWORDtoCHAR(i + 1);
-                    char * s2 =  DWORDtoCHAR(numberOfProperties);
-                    char * s3 = appendString(NULL , "value ");
-                    s3 = appendString(s3 , s1);
-                    s3 = appendString(s3, "/");
-                    s3 = appendString(s3, s2);
-                    FREE(s1);
-                    FREE(s2);
-                    readStringWithDebugW(props, &value, s3);
-                    
-                    FREE(s3);
-                    if(!isOK(props)) break;
-                    if(isLocaleMatches) {
-                        //it is a know property
-                        FREE(props->i18nMessages->strings[i]);
-                        props->i18nMessages->strings[i] = appendStringW(NULL, value);
-                    }
-                    FREE(value);
+            // the directory first : names and block sizes only
+            for(j=0;j<numberOfLocales && isOK(props);j++) {
+                localeName = NULL;
+                readStringWithDebugW(props, &localeName, "locale name");
+                if(!isOK(props)) break;
+                readNumberWithDebug(props, &blockLengths[j], "locale block length");
+                blockMatches[j] = isI18NLocaleMatches(currentLocale, localeName);
+                FREE(localeName);
+            }
+            for(j=0;j<numberOfLocales && isOK(props);j++) {
+                if(blockMatches[j]) {
+                    readI18NLocaleValues(props, scratch, numberOfProperties, 1);
+                } else {
+                    skipPayloadBytes(props, blockLengths[j]);
                 }
+            }
+            FREE(blockLengths);
+            FREE(blockMatches);
+        } else {
+            for(j=0;j<numberOfLocales;j++) { //  for all locales in file...
+                // read locale name as UNICODE ..
+                // it should be like en_US or smth like that
+                localeName = NULL;
+                readStringWithDebugW(props, &localeName, "locale name");
+                if(!isOK(props)) break;
+                
+                readI18NLocaleValues(props, scratch, numberOfProperties,
+                        isI18NLocaleMatches(currentLocale, localeName));
                 FREE(localeName);
+            }
         }
         FREE(currentLocale);
     }
 }
 
-LauncherResource * newLauncherResource() {
-    LauncherResource * file = (LauncherResource *) LocalAlloc(LPTR, sizeof(LauncherResource));
-    file->path=NULL;
-    file->resolved=NULL;
-    file->type=0;
-    return file;
-}
-WCHARList * newWCHARList(DWORD number) {
-    WCHARList * list = (WCHARList*) LocalAlloc(LPTR, sizeof(WCHARList));
-    list->size  = number;
-    if(number>0) {
-        DWORD i=0;
-        list->items = newppWCHAR(number);
-        for(i=0;i<number;i++) {
-            list->items[i] = NULL;
-        }
-    } else {
-        list->items = NULL;
-    }
-    return list;
+// resources and lists live until exit : they are in the launcher arena with their strings,
+// nothing of them is freed one by one. NULL if there is no memory
+LauncherResource * newLauncherResource(Arena * arena) {
+    return (LauncherResource *) arenaAlloc(arena, sizeof(LauncherResource));
 }
 
-void freeWCHARList(WCHARList ** plist) {
-    WCHARList * list;
-    list = * plist;
-    if(list!=NULL) {
-        DWORD i=0;
-        if(list->items!=NULL) {
-            for(i=0;i<list->size;i++) {
-                FREE(list->items[i]);
-            }
-            FREE(list->items);
-        }
-        FREE(*plist);
-    }
-}
-
-LauncherResourceList * newLauncherResourceList(DWORD number) {
-    LauncherResourceList * list = (LauncherResourceList*) LocalAlloc(LPTR, sizeof(LauncherResourceList));
-    list->size  = number;
-    if(number > 0) {
-        DWORD i=0;
-        
-        list->items = (LauncherResource**) LocalAlloc(LPTR, sizeof(LauncherResource*) * number);
-        for(i=0;i<number;i++) {
-            list->items[i] = NULL;
-        }
-    } else {
-        list->items = NULL;
+WCHARList * newWCHARList(Arena * arena, DWORD number) {
+    WCHARList * list = (WCHARList*) arenaAlloc(arena, sizeof(WCHARList));
+    if(list!=NULL && number > 0) {
+        list->items = (WCHAR **) arenaAlloc(arena, sizeof(WCHAR *) * number);
+        if(list->items==NULL) return NULL;
     }
+    if(list!=NULL) list->size = number;
     return list;
 }
 
-void freeLauncherResource(LauncherResource ** file) {
-    if(*file!=NULL) {
-        FREE((*file)->path);
-        FREE((*file)->resolved);
-        FREE(*file);
-        
+LauncherResourceList * newLauncherResourceList(Arena * arena, DWORD number) {
+    LauncherResourceList * list = (LauncherResourceList*) arenaAlloc(arena, sizeof(LauncherResourceList));
+    if(list!=NULL && number > 0) {
+        list->items = (LauncherResource **) arenaAlloc(arena, sizeof(LauncherResource *) * number);
+        if(list->items==NULL) return NULL;
     }
+    if(list!=NULL) list->size = number;
+    return list;
 }
 
 
-void extractLauncherResource(LauncherProperties * props, LauncherResource ** file, char * name) {
-    char * typeStr = appendString(appendString(NULL, name), " type");
-    * file = newLauncherResource();
+void extractLauncherResource(LauncherProperties * props, LauncherResource ** file, char * name, DWORD expandArchive) {
+    char * typeStr = arenaAppendA(props->scratch, name, " type");
+    * file = newLauncherResource(props->arena);
+    if(*file==NULL) {
+        props->status = EXIT_CODE_SYSTEM_ERROR;
+        return;
+    }
     
     readNumberWithDebug( props, & ((*file)->type) , typeStr);
     
     if(isOK(props)) {
-        FREE(typeStr);
-        
         if((*file)->type==0) { //bundled
             writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1,  "... file is bundled", 1);
-            extractFileToDir(props, & ((*file)->path));
+            extractFileToDir(props, *file, expandArchive);
             if(!isOK(props)) {
                 writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1,  "Error extracting file!", 1);
                 return;
             } else {
-                (*file)->resolved = appendStringW(NULL, (*file)->path);
+                (*file)->resolved = arenaCopyW(props->arena, (*file)->path);
                 writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "file was succesfully extracted to ", 0);
                 writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0,  (*file)->path, 1);
             }
         } else {
+            WCHAR * path = NULL;
             writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1,  "... file is external", 1);
-            readStringWithDebugW(props, & ((*file)->path), name);
+            readStringWithDebugW(props, &path, name);
+            (*file)->path = moveToArenaW(props->arena, path);
             if(!isOK(props)) {
                 writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "Error reading ", 1);
                 writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, name, 1);
@@ -634,49 +1112,67 @@ void extractLauncherResource(LauncherProperties * props, LauncherResource ** fil
     }  else {
         writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "Error reading ", 0);
         writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, typeStr, 0);
-        FREE(typeStr);
     }
 }
 
 void readWCHARList(LauncherProperties * props, WCHARList ** list, char * name) {
     DWORD number = 0;
     DWORD i =0;
-    char * numberStr = appendString(appendString(NULL, "number of "), name);
+    char * numberStr = arenaAppendA(props->scratch, "number of ", name);
+    char * nextStr = NULL;
     
     * list = NULL;
     readNumberWithDebug(props, &number, numberStr);
-    FREE(numberStr);
     
     if(!isOK(props)) return;
     
-    * list = newWCHARList(number);
+    * list = newWCHARList(props->arena, number);
+    if(*list==NULL) {
+        props->status = EXIT_CODE_SYSTEM_ERROR;
+        return;
+    }
+    nextStr = arenaAppendA(props->scratch, "next item in ", name);
     for(i=0;i < (*list)->size ;i++) {
-        char * nextStr = appendString(appendString(NULL, "next item in "), name);
-        readStringWithDebugW(props, &((*list)->items[i]), nextStr);
-        FREE(nextStr);
+        WCHAR * item = NULL;
+        readStringWithDebugW(props, &item, nextStr);
+        (*list)->items[i] = moveToArenaW(props->arena, item);
         if(!isOK(props)) return;
     }
 }
-void readLauncherResourceList(LauncherProperties * props,  LauncherResourceList ** list, char * name) {
+void readLauncherResourceList(LauncherProperties * props,  LauncherResourceList ** list, char * name, DWORD expandArchives) {
     DWORD num = 0;
     DWORD i=0;
-    char * numberStr = appendString(appendString(NULL, "number of "), name);
+    char * numberStr = arenaAppendA(props->scratch, "number of ", name);
     readNumberWithDebug(props, &num, numberStr);
-    FREE(numberStr);
     if(!isOK(props)) return;
     
-    * list = newLauncherResourceList(num);
+    * list = newLauncherResourceList(props->arena, num);
+    if(*list==NULL) {
+        props->status = EXIT_CODE_SYSTEM_ERROR;
+        return;
+    }
     for(i=0;i<(*list)->size;i++) {
-        extractLauncherResource(props, & ((*list)->items[i]), "launcher resource");
+        extractLauncherResource(props, & ((*list)->items[i]), "launcher resource", expandArchives);
         if(!isOK(props)) {
-            char * str = appendString(appendString(NULL, "Error processing "), name);
-            writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, str, 1);
-            FREE(str);
+            writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "Error processing ", 0);
+            writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, name, 1);
             break;
         }
     }
 }
 
+JavaVersion * moveJavaVersionToArena(Arena * arena, JavaVersion * version) {
+    JavaVersion * result = NULL;
+    if(version!=NULL) {
+        result = (JavaVersion *) arenaAlloc(arena, sizeof(JavaVersion));
+        if(result!=NULL) {
+            CopyMemory(result, version, sizeof(JavaVersion));
+        }
+        FREE(version);
+    }
+    return result;
+}
+
 void readLauncherProperties(LauncherProperties * props) {
     DWORD i=0;
     char * str = NULL;
@@ -700,34 +1196,45 @@ void readLauncherProperties(LauncherProperties * props) {
     
     
     if ( props->compatibleJavaNumber > 0 ) {
-        props->compatibleJava = (JavaCompatible **) LocalAlloc(LPTR, sizeof(JavaCompatible *) * props->compatibleJavaNumber);
+        props->compatibleJava = (JavaCompatible **) arenaAlloc(props->arena, sizeof(JavaCompatible *) * props->compatibleJavaNumber);
+        if(props->compatibleJava==NULL) {
+            props->status = EXIT_CODE_SYSTEM_ERROR;
+            return;
+        }
         for(i=0;i<props->compatibleJavaNumber;i++) {
             
-            props->compatibleJava [i] = newJavaCompatible() ;
+            props->compatibleJava [i] = newJavaCompatible(props->arena) ;
+            if(props->compatibleJava[i]==NULL) {
+                props->status = EXIT_CODE_SYSTEM_ERROR;
+                return;
+            }
             
             readStringWithDebugA(props, &str, "min java version");
             if(!isOK(props)) return;
-            props->compatibleJava[i]->minVersion = getJavaVersionFromString(str, &props->status);
+            props->compatibleJava[i]->minVersion = moveJavaVersionToArena(props->arena, getJavaVersionFromString(str, &props->status));
             FREE(str);
             if(!isOK(props)) return;
             
             str = NULL;
             readStringWithDebugA(props, &str, "max java version");
             if(!isOK(props)) return;
-            props->compatibleJava[i]->maxVersion = getJavaVersionFromString(str, &props->status);
+            props->compatibleJava[i]->maxVersion = moveJavaVersionToArena(props->arena, getJavaVersionFromString(str, &props->status));
             FREE(str);
             if(!isOK(props)) return;
             
-            readStringWithDebugA(props, &(props->compatibleJava[i]->vendor) ,
-                    "vendor");
+            str = NULL;
+            readStringWithDebugA(props, &str, "vendor");
+            props->compatibleJava[i]->vendor = moveToArenaA(props->arena, str);
             if(!isOK(props)) return;
             
-            readStringWithDebugA(props, &(props->compatibleJava[i]->osName) ,
-                    "os name");
+            str = NULL;
+            readStringWithDebugA(props, &str, "os name");
+            props->compatibleJava[i]->osName = moveToArenaA(props->arena, str);
             if(!isOK(props)) return;
             
-            readStringWithDebugA(props, &(props->compatibleJava[i]->osArch) ,
-                    "os arch");
+            str = NULL;
+            readStringWithDebugA(props, &str, "os arch");
+            props->compatibleJava[i]->osArch = moveToArenaA(props->arena, str);
             if(!isOK(props)) return;
             
         }
@@ -740,22 +1247,26 @@ void extractJVMData(LauncherProperties * props) {
     if(isOK(props)) {
         
         writeMessageA(props, OUTPUT_LEVEL_NORMAL, 0, "Extracting JVM data... ", 1);
-        extractLauncherResource(props,  &(props->testJVMFile), "testJVM file");
+        extractLauncherResource(props,  &(props->testJVMFile), "testJVM file", 0);
         if(!isOK(props)) {
             writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "Error extracting testJVM file!", 1);
             return ;
         }
         
-        readLauncherResourceList(props, &(props->jvms), "JVMs");
+        // bundled JVMs are installed only if there is no java set by the user,
+        // then a JVM archive goes straight to its directory
+        readLauncherResourceList(props, &(props->jvms), "JVMs", props->userDefinedJavaHome==NULL);
+        resetArena(props->scratch);
     }
 }
 
 void extractData(LauncherProperties *props) {
     if(isOK(props)) {
         writeMessageA(props, OUTPUT_LEVEL_NORMAL, 0, "Extracting Bundled data... ", 1);
-        readLauncherResourceList(props,  &(props->jars), "bundled and external files");
+        readLauncherResourceList(props,  &(props->jars), "bundled and external files", 0);
         if(isOK(props)) {
-            readLauncherResourceList(props,  &(props->other), "other data");
+            readLauncherResourceList(props,  &(props->other), "other data", 0);
         }
+        resetArena(props->scratch);
     }
 }
@@ -31,18 +31,48 @@ extern "C" {
     
     extern const DWORD STUB_FILL_SIZE;
     
+#define TAR_BLOCK_SIZE 512
+    
+    typedef struct _tarExtraction {
+        LauncherProperties * props;
+        WCHAR * directory;
+        char header[TAR_BLOCK_SIZE];
+        DWORD headerLength;
+        ULONGLONG remaining;
+        DWORD padding;
+        char type;
+        HANDLE file;
+        char * meta;
+        DWORD metaLength;
+        char * longName;
+        char * longLink;
+        DWORD entries;
+        DWORD finished;
+    } TarExtraction;
+    
+    // a bundled file read straight from the payload, see readFromPayload
+    typedef struct _payloadReader {
+        LauncherProperties * props;
+        int64t * remaining;
+        DWORD crc32;
+        DWORD counter;
+    } PayloadReader;
+    
     void skipStub(LauncherProperties * props);
     
     void loadI18NStrings(LauncherProperties * props);
     
-    WCHARList * newWCHARList(DWORD number) ;
+    // the lists are in the arena, never freed one by one
+    WCHARList * newWCHARList(Arena * arena, DWORD number) ;
     void readLauncherProperties(LauncherProperties * props);    
-    void freeWCHARList(WCHARList ** plist);
-    void freeLauncherResource(LauncherResource ** file);
     
     void extractJVMData(LauncherProperties * props);
     void extractData(LauncherProperties *props);
     
+    DWORD isGzipFile(WCHAR * path);
+    WCHAR * getArchiveDirectory(WCHAR * archive);
+    void extractTarGzArchive(LauncherProperties * props, WCHAR * archive, WCHAR * directory);
+    
 #ifdef	__cplusplus
 }
 #endif
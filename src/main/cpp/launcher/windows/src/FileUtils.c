@@ -31,6 +31,7 @@ HANDLE stderrHandle = INVALID_HANDLE_VALUE;
 
 DWORD newLine = 1;
 const WCHAR * FILE_SEP = L"\\";
+const DWORD CRC_READ_BUFSIZE = 65536;
 
 const long CRC32_TABLE[256] = {
     0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f, 0xe963a535,
@@ -72,58 +73,92 @@ const long CRC32_TABLE[256] = {
     0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
+void appendTimeStamp(StringBuilder * result) {
+    SYSTEMTIME t;	
+    char * yearStr;
+    char * monthStr;
+    char * dayStr;
+    char * hourStr;
+    char * minuteStr;
+    char * secondStr;
+    char * msStr;
+    GetLocalTime(&t);
+    yearStr = word2charN(t.wYear,2);
+    monthStr = word2charN(t.wMonth,2);
+    dayStr = word2charN(t.wDay,2);
+    hourStr = word2charN(t.wHour,2);
+    minuteStr = word2charN(t.wMinute,2);
+    secondStr = word2charN(t.wSecond,2);
+    msStr = word2charN(t.wMilliseconds,3);
+    
+    // [yyyy-MM-dd HH:mm:ss.SSS]> 
+    appendToBuilderN(result, "[", 1);
+    appendToBuilder(result, yearStr);
+    appendToBuilderN(result, "-", 1);
+    appendToBuilder(result, monthStr);
+    appendToBuilderN(result, "-", 1);
+    appendToBuilder(result, dayStr);
+    appendToBuilderN(result, " ", 1);
+    appendToBuilder(result, hourStr);
+    appendToBuilderN(result, ":", 1);
+    appendToBuilder(result, minuteStr);
+    appendToBuilderN(result, ":", 1);
+    appendToBuilder(result, secondStr);
+    appendToBuilderN(result, ".", 1);
+    appendToBuilder(result, msStr);
+    appendToBuilderN(result, "]> ", 3);
+
+    FREE(yearStr);
+    FREE(monthStr);
+    FREE(dayStr);
+
+    FREE(hourStr);
+    FREE(minuteStr);
+    FREE(secondStr);
+    FREE(msStr);
+}
+
 void writeTimeStamp(HANDLE hd, DWORD need) {
     DWORD written;
     if(need==1) {
-        SYSTEMTIME t;	
-        char * yearStr;
-        char * monthStr;
-        char * dayStr;
-        char * hourStr;
-        char * minuteStr;
-        char * secondStr;
-        char * msStr;
-        char * result = NULL;
-        GetLocalTime(&t);
-        yearStr = word2charN(t.wYear,2);
-        monthStr = word2charN(t.wMonth,2);
-        dayStr = word2charN(t.wDay,2);
-        hourStr = word2charN(t.wHour,2);
-        minuteStr = word2charN(t.wMinute,2);
-        secondStr = word2charN(t.wSecond,2);
-        msStr = word2charN(t.wMilliseconds,3);
-        
-        result = appendString(NULL, "[");
-        result = appendString(result, yearStr);
-        result = appendString(result, "-");
-        result = appendString(result, monthStr);
-        result = appendString(result, "-");
-        result = appendString(result, dayStr);
-        result = appendString(result, " ");
-        result = appendString(result, hourStr);
-        result = appendString(result, ":");
-        result = appendString(result, minuteStr);
-        result = appendString(result, ":");
-        result = appendString(result, secondStr);
-        result = appendString(result, ".");
-        result = appendString(result, msStr);
-        result = appendString(result, "]> ");
-
-        WriteFile(hd, result, sizeof(char) * getLengthA(result), & written, NULL);
-        FREE(result);
-        FREE(yearStr);
-        FREE(monthStr);
-        FREE(dayStr);
-
-        FREE(hourStr);
-        FREE(minuteStr);
-        FREE(secondStr);
-        FREE(msStr);
+        StringBuilder result;
+        initStringBuilder(&result, 32);
+        appendTimeStamp(&result);
+        WriteFile(hd, result.buffer, sizeof(char) * result.length, & written, NULL);
+        freeStringBuilder(&result);
+    }
+}
+
+// messages of a helper thread are kept in its own buffers and written
+// by the main thread with writeDeferredOutput, so the lines don`t mix
+void deferMessage(LauncherProperties * props, DWORD isErr, const char * message, DWORD needEndOfLine) {
+    StringBuilder * sb = (isErr) ? props->deferredErrors : props->deferredOutput;
+    if(sb->length==0 || sb->buffer[sb->length - 1]=='\n') {
+        appendTimeStamp(sb);
+    }
+    appendToBuilder(sb, message);
+    while((needEndOfLine--)>0) {
+        appendToBuilderN(sb, "\r\n", 2);
+    }
+}
+
+void writeDeferredOutput(LauncherProperties * props, StringBuilder * sb, DWORD isErr) {
+    if(sb!=NULL && sb->length>0) {
+        HANDLE hd = (isErr) ? props->stderrHandle : props->stdoutHandle;
+        DWORD written;
+        if(!newLine) {
+            WriteFile(hd, "\r\n", 2, & written, NULL);
+        }
+        WriteFile(hd, sb->buffer, sizeof(char) * sb->length, & written, NULL);
+        flushHandle(hd);
+        newLine = (sb->buffer[sb->length - 1]=='\n') ? 1 : 0;
     }
 }
 
 void writeMessageA(LauncherProperties * props, DWORD level, DWORD isErr,  const char * message, DWORD needEndOfLine) {
-    if(level>=props->outputLevel) {
+    if(level>=props->outputLevel && props->deferredOutput!=NULL) {
+        deferMessage(props, isErr, message, needEndOfLine);
+    } else if(level>=props->outputLevel) {
         HANDLE hd = (isErr) ? props->stderrHandle : props->stdoutHandle;
         DWORD written;
         writeTimeStamp(hd, newLine);
@@ -202,19 +237,20 @@ void checkFreeSpace(LauncherProperties * props, WCHAR * tmpDir, int64t * size) {
         
         if(!result) {            
             WCHAR * available = NULL;
-            WCHAR * str = NULL;
+            StringBuilderW str;
             WCHAR * required = NULL;
             available = int64ttoWCHAR(space);
             required  = int64ttoWCHAR(size);
-            str = appendStringW(str, L"Not enough free space in ");
-            str = appendStringW(str, tmpDir);
-            str = appendStringW(str, L", available=");
-            str = appendStringW(str, available);
-            str = appendStringW(str, L", required=");
-            str = appendStringW(str, required);
-
-            writeMessageW(props, OUTPUT_LEVEL_DEBUG, 1, str, 1);
-            FREE(str);
+            initStringBuilderW(&str, MAX_PATH);
+            appendToBuilderW(&str, L"Not enough free space in ");
+            appendToBuilderW(&str, tmpDir);
+            appendToBuilderW(&str, L", available=");
+            appendToBuilderW(&str, available);
+            appendToBuilderW(&str, L", required=");
+            appendToBuilderW(&str, required);
+
+            writeMessageW(props, OUTPUT_LEVEL_DEBUG, 1, str.buffer, 1);
+            freeStringBuilderW(&str);
             FREE(available);
             FREE(required);
             props->status = ERROR_FREESPACE;
@@ -239,6 +275,64 @@ DWORD isDirectory(WCHAR *path) {
         return 0;
     }
 }
+DirectoryListing * newDirectoryListing() {
+    DirectoryListing * listing = (DirectoryListing *) LocalAlloc(LPTR, sizeof(DirectoryListing));
+    listing->directories = newStringSet(16);
+    listing->files = newStringSet(256);
+    return listing;
+}
+
+void listDirectoryFiles(DirectoryListing * listing, WCHAR * directory) {
+    WIN32_FIND_DATAW FindFileData;
+    HANDLE hFind;
+    StringBuilderW path;
+    DWORD directoryLength;
+    
+    initStringBuilderW(&path, MAX_PATH);
+    appendToBuilderW(&path, directory);
+    appendToBuilderNW(&path, L"\\*", 2);
+    hFind = FindFirstFileExW(path.buffer, FindExInfoBasic, &FindFileData, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+    directoryLength = path.length - 1;
+    if (hFind != INVALID_HANDLE_VALUE) {
+        do {
+            if(!(FindFileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+                path.length = directoryLength;
+                appendToBuilderW(&path, FindFileData.cFileName);
+                CharLowerBuffW(path.buffer, path.length);
+                addStringToSet(listing->files, path.buffer);
+            }
+        } while (FindNextFileW(hFind, &FindFileData) != 0);
+        FindClose(hFind);
+    }
+    freeStringBuilderW(&path);
+}
+
+// checks many files with one enumeration of each parent directory
+DWORD fileExistsInListing(DirectoryListing * listing, WCHAR * path) {
+    WCHAR * key = appendStringW(NULL, path);
+    WCHAR * directory;
+    DWORD result;
+    
+    CharLowerBuffW(key, getLengthW(key));
+    directory = (searchW(key, FILE_SEP)!=NULL) ? getParentDirectory(key) : NULL;
+    if(directory!=NULL && addStringToSet(listing->directories, directory)) {
+        listDirectoryFiles(listing, directory);
+    }
+    result = isStringInSet(listing->files, key);
+    FREE(directory);
+    FREE(key);
+    // relative parts, short names and the like are not in the listing
+    return result || fileExists(path);
+}
+
+void freeDirectoryListing(DirectoryListing ** listing) {
+    if((*listing)!=NULL) {
+        freeStringSet(&((*listing)->directories));
+        freeStringSet(&((*listing)->files));
+        FREE((*listing));
+    }
+}
+
 WCHAR * getParentDirectory(WCHAR * dir) {
     WCHAR * ptr = dir;
     WCHAR * res = NULL;
@@ -273,6 +367,54 @@ WCHAR * normalizePath(WCHAR * dir) {
     return directory;
 }
 
+// get the key which is the same for all the names of one physical location :
+// volume serial and file index if the location exists (links and junctions are followed),
+// the full lowercase path without trailing separators otherwise
+WCHAR * getLocationKey(WCHAR * path) {
+    WCHAR * key = NULL;
+    WCHAR * full = normalizePath(path);
+    DWORD len = GetFullPathNameW(full, 0, NULL, NULL);
+    HANDLE hFile;
+    if(len > 0) {
+        WCHAR * buf = newpWCHAR(len + 1);
+        if(GetFullPathNameW(full, len + 1, buf, NULL) > 0) {
+            FREE(full);
+            full = buf;
+        } else {
+            FREE(buf);
+        }
+    }
+    
+    hFile = CreateFileW(full, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    if(hFile != INVALID_HANDLE_VALUE) {
+        BY_HANDLE_FILE_INFORMATION info;
+        if(GetFileInformationByHandle(hFile, &info)) {
+            WCHAR * number = DWORDtoWCHAR(info.dwVolumeSerialNumber);
+            key = appendStringW(appendStringW(NULL, L"#"), number);
+            FREE(number);
+            number = DWORDtoWCHAR(info.nFileIndexHigh);
+            key = appendStringW(appendStringW(key, L":"), number);
+            FREE(number);
+            number = DWORDtoWCHAR(info.nFileIndexLow);
+            key = appendStringW(appendStringW(key, L":"), number);
+            FREE(number);
+        }
+        CloseHandle(hFile);
+    }
+    if(key==NULL) {
+        len = getLengthW(full);
+        while(len > 0 && full[len - 1]=='\\' && !(len==3 && full[1]==':')) {
+            full[--len] = 0;
+        }
+        CharLowerBuffW(full, len);
+        key = full;
+    } else {
+        FREE(full);
+    }
+    return key;
+}
+
 void createDirectory(LauncherProperties * props, WCHAR * directory) {
     
     WCHAR * parent;
@@ -412,10 +554,234 @@ void createTempDirectory(LauncherProperties * props, WCHAR * argTempDir, DWORD c
 }
 
 
+// create the directory structure and collect the files to copy
+void collectTreeFiles(LauncherProperties * props, WCHAR * source, WCHAR * destination, CopyTreeJobs * jobs,
+        StringListEntry ** sources, StringListEntry ** destinations) {
+    WIN32_FIND_DATAW FindFileData;
+    HANDLE hFind;
+    WCHAR * DirSpec;
+    StringBuilderW sourceChild;
+    StringBuilderW destinationChild;
+    DWORD sourceLength;
+    DWORD destinationLength;
+    
+    if(!CreateDirectoryW(destination, NULL) && GetLastError()!=ERROR_ALREADY_EXISTS) {
+        writeErrorA(props, OUTPUT_LEVEL_DEBUG, 1, "Error! Can`t create directory : ", destination, GetLastError());
+        props->status = ERROR_INPUTOUPUT;
+        return;
+    }
+    DirSpec = appendStringW(appendStringW(NULL, source), L"\\*");
+    initStringBuilderW(&sourceChild, MAX_PATH);
+    appendToBuilderW(&sourceChild, source);
+    appendToBuilderW(&sourceChild, FILE_SEP);
+    sourceLength = sourceChild.length;
+    initStringBuilderW(&destinationChild, MAX_PATH);
+    appendToBuilderW(&destinationChild, destination);
+    appendToBuilderW(&destinationChild, FILE_SEP);
+    destinationLength = destinationChild.length;
+    hFind = FindFirstFileExW(DirSpec, FindExInfoBasic, &FindFileData, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        writeErrorA(props, OUTPUT_LEVEL_DEBUG, 1, "Error! Can`t find file with pattern : ", DirSpec, GetLastError());
+        props->status = ERROR_INPUTOUPUT;
+    } else {
+        do {
+            if(lstrcmpW(FindFileData.cFileName, L".")!=0 &&
+                    lstrcmpW(FindFileData.cFileName, L"..")!=0) {
+                sourceChild.length = sourceLength;
+                appendToBuilderW(&sourceChild, FindFileData.cFileName);
+                destinationChild.length = destinationLength;
+                appendToBuilderW(&destinationChild, FindFileData.cFileName);
+                if(FindFileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+                    collectTreeFiles(props, sourceChild.buffer, destinationChild.buffer, jobs, sources, destinations);
+                } else {
+                    * sources = addStringToList(* sources, sourceChild.buffer);
+                    * destinations = addStringToList(* destinations, destinationChild.buffer);
+                    jobs->number++;
+                }
+            }
+        } while (isOK(props) && FindNextFileW(hFind, &FindFileData) != 0);
+        FindClose(hFind);
+    }
+    FREE(DirSpec);
+    freeStringBuilderW(&sourceChild);
+    freeStringBuilderW(&destinationChild);
+}
+
+DWORD WINAPI copyTreeWorker(void * ptr) {
+    CopyTreeJobs * jobs = (CopyTreeJobs *) ptr;
+    while(!jobs->failed) {
+        LONG index = InterlockedIncrement(&jobs->next) - 1;
+        if(index >= (LONG) jobs->number) break;
+        // CopyFile preallocates the target and clones blocks where the file system supports it
+        if(!CopyFileW(jobs->sources[index], jobs->destinations[index], FALSE)) {
+            if(InterlockedCompareExchange(&jobs->failed, 1, 0)==0) {
+                jobs->error = GetLastError();
+                jobs->failedFile = jobs->sources[index];
+            }
+        }
+    }
+    return 0;
+}
+
+// Copy the directory tree by a pool of workers.
+// Hard links are not used : the copy must stay usable while the original is deleted,
+// and windows does not allow to delete any link of a running executable.
+void copyDirectoryTree(LauncherProperties * props, WCHAR * source, WCHAR * destination) {
+    StringListEntry * sources = NULL;
+    StringListEntry * destinations = NULL;
+    StringListEntry * s;
+    StringListEntry * d;
+    CopyTreeJobs jobs;
+    HANDLE threads[MAXIMUM_WAIT_OBJECTS];
+    DWORD threadsNumber = 0;
+    DWORD workers;
+    DWORD i;
+    SYSTEM_INFO info;
+    
+    ZERO(&jobs, sizeof(CopyTreeJobs));
+    if(!fileExists(destination)) {
+        createDirectory(props, destination);
+        if(!isOK(props)) return;
+    }
+    collectTreeFiles(props, source, destination, &jobs, &sources, &destinations);
+    if(isOK(props) && jobs.number > 0) {
+        jobs.sources = (WCHAR **) LocalAlloc(LPTR, sizeof(WCHAR *) * jobs.number);
+        jobs.destinations = (WCHAR **) LocalAlloc(LPTR, sizeof(WCHAR *) * jobs.number);
+        for(i = 0, s = sources, d = destinations; s!=NULL; s = s->next, d = d->next, i++) {
+            jobs.sources[i] = s->string;
+            jobs.destinations[i] = d->string;
+        }
+        
+        // copying is mostly waiting for the disk, keep a few requests in flight
+        GetSystemInfo(&info);
+        workers = info.dwNumberOfProcessors * 2;
+        if(workers > jobs.number) workers = jobs.number;
+        if(workers > MAXIMUM_WAIT_OBJECTS) workers = MAXIMUM_WAIT_OBJECTS;
+        writeDWORD(props, OUTPUT_LEVEL_DEBUG, 0, "... files to copy : ", jobs.number, 1);
+        
+        for(i = 1; i < workers; i++) {
+            DWORD threadId;
+            HANDLE thread = CreateThread(NULL, 0, &copyTreeWorker, (LPVOID) &jobs, 0, &threadId);
+            if(thread==NULL) break;
+            threads[threadsNumber++] = thread;
+        }
+        copyTreeWorker(&jobs);
+        if(threadsNumber > 0) {
+            WaitForMultipleObjects(threadsNumber, threads, TRUE, INFINITE);
+            for(i = 0; i < threadsNumber; i++) {
+                CloseHandle(threads[i]);
+            }
+        }
+        if(jobs.failed) {
+            writeErrorA(props, OUTPUT_LEVEL_DEBUG, 1, "Error! Can`t copy file : ", jobs.failedFile, jobs.error);
+            props->status = ERROR_INPUTOUPUT;
+        }
+        FREE(jobs.sources);
+        FREE(jobs.destinations);
+    }
+    freeStringList(&sources);
+    freeStringList(&destinations);
+}
+
+// walk the tree : files are queued for the workers, directories are listed before their children
+void collectTreeEntries(LauncherProperties * props, StringBuilderW * path, DeleteTreeJobs * jobs,
+        StringListEntry ** files, StringListEntry ** dirs) {
+    WIN32_FIND_DATAW FindFileData;
+    HANDLE hFind;
+    DWORD length = path->length;
+    
+    appendToBuilderNW(path, L"\\*", 2);
+    hFind = FindFirstFileExW(path->buffer, FindExInfoBasic, &FindFileData, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        writeErrorA(props, OUTPUT_LEVEL_DEBUG, 1, "Error! Can`t find file with pattern : ", path->buffer, GetLastError());
+    } else {
+        do {
+            DWORD nameLength = getLengthW(FindFileData.cFileName);
+            if(lstrcmpW(FindFileData.cFileName, L".")==0 ||
+                    lstrcmpW(FindFileData.cFileName, L"..")==0) {
+                continue;
+            }
+            // the path buffer is shared by the whole walk, only the tail is changed
+            path->length = length;
+            if(!reserveStringBuilderW(path, nameLength + 3)) {
+                path->buffer[length] = 0;
+                writeErrorA(props, OUTPUT_LEVEL_DEBUG, 1, "Error! Not enough memory for the path of an entry in : ", path->buffer, ERROR_NOT_ENOUGH_MEMORY);
+                continue;
+            }
+            appendToBuilderNW(path, L"\\", 1);
+            appendToBuilderNW(path, FindFileData.cFileName, nameLength);
+            if(FindFileData.dwFileAttributes & FILE_ATTRIBUTE_READONLY) {
+                SetFileAttributesW(path->buffer, FILE_ATTRIBUTE_NORMAL);
+            }
+            if(FindFileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+                * dirs = addStringToList(* dirs, path->buffer);
+                // junction : remove the link itself, never walk into its target
+                if(!(FindFileData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+                    collectTreeEntries(props, path, jobs, files, dirs);
+                }
+            } else {
+                * files = addStringToList(* files, path->buffer);
+                jobs->filesNumber++;
+            }
+        } while (FindNextFileW(hFind, &FindFileData) != 0);
+        FindClose(hFind);
+    }
+    path->length = length;
+    path->buffer[length] = 0;
+}
+
+DWORD WINAPI deleteTreeWorker(void * ptr) {
+    DeleteTreeJobs * jobs = (DeleteTreeJobs *) ptr;
+    while(1) {
+        LONG index = InterlockedIncrement(&jobs->next) - 1;
+        if(index >= (LONG) jobs->filesNumber) break;
+        if(!DeleteFileW(jobs->files[index])) {
+            // remember for the retry pass
+            jobs->failed[index] = 1;
+        }
+    }
+    return 0;
+}
+
+void deleteTreeFiles(DeleteTreeJobs * jobs) {
+    HANDLE threads[MAXIMUM_WAIT_OBJECTS];
+    DWORD threadsNumber = 0;
+    DWORD workers;
+    DWORD i;
+    SYSTEM_INFO info;
+    
+    GetSystemInfo(&info);
+    workers = info.dwNumberOfProcessors * 2;
+    if(workers > DELETE_TREE_MAX_WORKERS) workers = DELETE_TREE_MAX_WORKERS;
+    if(workers > jobs->filesNumber / DELETE_TREE_FILES_PER_WORKER) {
+        workers = jobs->filesNumber / DELETE_TREE_FILES_PER_WORKER;
+    }
+    jobs->next = 0;
+    for(i = 1; i < workers; i++) {
+        DWORD threadId;
+        HANDLE thread = CreateThread(NULL, 0, &deleteTreeWorker, (LPVOID) jobs, 0, &threadId);
+        if(thread==NULL) break;
+        threads[threadsNumber++] = thread;
+    }
+    deleteTreeWorker(jobs);
+    if(threadsNumber > 0) {
+        WaitForMultipleObjects(threadsNumber, threads, TRUE, INFINITE);
+        for(i = 0; i < threadsNumber; i++) {
+            CloseHandle(threads[i]);
+        }
+    }
+}
+
 void deleteDirectory(LauncherProperties * props, WCHAR * dir) {
     DWORD attrs = GetFileAttributesW(dir);
-    DWORD dwError;
-    DWORD count = 0 ;
+    DWORD count = 0;
+    DWORD pending;
+    DWORD i;
+    StringListEntry * files = NULL;
+    StringListEntry * dirs = NULL;
+    StringListEntry * entry;
+    DeleteTreeJobs jobs;
+    
     if(attrs==INVALID_FILE_ATTRIBUTES) {
         writeErrorA(props, OUTPUT_LEVEL_DEBUG, 1, "Error! Can`t get attributes of the dir : ", dir, GetLastError());
         return;
@@ -424,45 +790,64 @@ void deleteDirectory(LauncherProperties * props, WCHAR * dir) {
         writeErrorA(props, OUTPUT_LEVEL_DEBUG, 1, "Error! Can`t set attributes of the dir : ", dir, GetLastError());
     }
     
-    
+    ZERO(&jobs, sizeof(DeleteTreeJobs));
     if(attrs & FILE_ATTRIBUTE_DIRECTORY) {
-        WIN32_FIND_DATAW FindFileData;
-        HANDLE hFind = INVALID_HANDLE_VALUE;
-        
-        WCHAR * DirSpec = appendStringW(appendStringW(NULL, dir), L"\\*" );
-        
-        // Find the first file in the directory.
-        hFind = FindFirstFileW(DirSpec, &FindFileData);
+        StringBuilderW path;
+        initStringBuilderW(&path, getLengthW(dir) + MAX_PATH);
+        // entries deeper than MAX_PATH can be reached only by the extended-length form
+        if(dir[0]!=0 && dir[1]==L':' && dir[2]==L'\\') {
+            appendToBuilderW(&path, L"\\\\?\\");
+        }
+        appendToBuilderW(&path, dir);
+        // lists are filled from the head, so every directory comes before its parent
+        // and the root directory is the last one
+        dirs = addStringToList(dirs, dir);
+        collectTreeEntries(props, &path, &jobs, &files, &dirs);
+        freeStringBuilderW(&path);
         
-        if (hFind == INVALID_HANDLE_VALUE) {
-            writeErrorA(props, OUTPUT_LEVEL_DEBUG, 1, "Error! Can`t file with pattern ", DirSpec, GetLastError());
+        jobs.files = (WCHAR **) LocalAlloc(LPTR, sizeof(WCHAR *) * (jobs.filesNumber + 1));
+        jobs.failed = (BYTE *) LocalAlloc(LPTR, sizeof(BYTE) * (jobs.filesNumber + 1));
+        for(i = 0, entry = files; entry!=NULL; entry = entry->next) {
+            jobs.files[i++] = entry->string;
         }
-        else {
-            // List all the other files in the directory.
-            while (FindNextFileW(hFind, &FindFileData) != 0) {
-                if(lstrcmpW(FindFileData.cFileName, L".")!=0 &&
-                        lstrcmpW(FindFileData.cFileName, L"..")!=0 ) {
-                    WCHAR * child = appendStringW(appendStringW(appendStringW(NULL, dir), FILE_SEP), FindFileData.cFileName);
-                    deleteDirectory(props, child);
-                    FREE(child);
-                }
+        deleteTreeFiles(&jobs);
+    } else {
+        jobs.files = (WCHAR **) LocalAlloc(LPTR, sizeof(WCHAR *));
+        jobs.failed = (BYTE *) LocalAlloc(LPTR, sizeof(BYTE));
+        jobs.files[0] = dir;
+        jobs.filesNumber = 1;
+        jobs.failed[0] = !DeleteFileW(dir);
+    }
+    
+    // retry everything that failed in rounds, 20 rounds in 2 seconds for the whole tree
+    do {
+        pending = 0;
+        for(i = 0; i < jobs.filesNumber; i++) {
+            if(jobs.failed[i]) {
+                jobs.failed[i] = !DeleteFileW(jobs.files[i]);
+                pending += jobs.failed[i];
             }
-            
-            dwError = GetLastError();
-            FindClose(hFind);
-            if (dwError != ERROR_NO_MORE_FILES) {
-                writeErrorA(props, OUTPUT_LEVEL_DEBUG, 1, "Error! Can`t find file with pattern : ", DirSpec, dwError);
+        }
+        for(entry = dirs; entry!=NULL; entry = entry->next) {
+            if(entry->string!=NULL) {
+                if(RemoveDirectoryW(entry->string) || GetLastError()==ERROR_FILE_NOT_FOUND) {
+                    FREE(entry->string);
+                } else {
+                    pending++;
+                }
             }
         }
-        
-        // 20 tries in 2 seconds to delete the directory
-        while(!RemoveDirectoryW(dir) && count++ < 20) Sleep(100);
-        FREE(DirSpec);
-    }
-    else {
-        // 20 tries in 2 seconds to delete the file
-        while(!DeleteFileW(dir) && count++ < 20) Sleep(100);
+        if(pending==0) break;
+        Sleep(100);
+    } while(count++ < 20);
+    
+    if(pending > 0) {
+        writeDWORD(props, OUTPUT_LEVEL_DEBUG, 1, "... entries not deleted : ", pending, 1);
     }
+    FREE(jobs.files);
+    FREE(jobs.failed);
+    freeStringList(&files);
+    freeStringList(&dirs);
 }
 
 
@@ -591,3 +976,32 @@ int64t * getFileSize(WCHAR * path) {
 void update_crc32(DWORD * crc, char *ptr, DWORD size) {    
     while( size-- )  *crc = CRC32_TABLE[(unsigned char) (*crc^*ptr++)] ^ (*crc>>8);
 }
+
+// returns 1 if the file has the given length and CRC32
+DWORD isFileIntact(WCHAR * path, int64t * length, DWORD expectedCRC) {
+    WIN32_FILE_ATTRIBUTE_DATA attrs;
+    HANDLE file;
+    char * buf;
+    DWORD crc32 = -1L;
+    DWORD read = 0;
+    DWORD result = 0;
+    
+    if(!GetFileAttributesExW(path, GetFileExInfoStandard, &attrs) ||
+            attrs.nFileSizeLow != length->Low || attrs.nFileSizeHigh != length->High) {
+        return 0;
+    }
+    file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(file == INVALID_HANDLE_VALUE) {
+        return 0;
+    }
+    buf = newpChar(CRC_READ_BUFSIZE);
+    if(buf != NULL) {
+        while((result = ReadFile(file, buf, CRC_READ_BUFSIZE, &read, NULL)) && read > 0) {
+            update_crc32(&crc32, buf, read);
+        }
+        result = result && (~crc32 == expectedCRC);
+        FREE(buf);
+    }
+    CloseHandle(file);
+    return result;
+}
@@ -32,9 +32,39 @@ extern "C" {
 #define OUTPUT_LEVEL_NORMAL 1
     
     
+    typedef struct _copyTreeJobs {
+        WCHAR ** sources;
+        WCHAR ** destinations;
+        DWORD number;
+        volatile LONG next;
+        volatile LONG failed;
+        DWORD error;
+        WCHAR * failedFile;
+    } CopyTreeJobs;
+    
+    typedef struct _deleteTreeJobs {
+        WCHAR ** files;
+        BYTE * failed;
+        DWORD filesNumber;
+        volatile LONG next;
+    } DeleteTreeJobs;
+    
+    // files of the directories listed so far, lower-cased full paths
+    typedef struct _directoryListing {
+        StringSet * directories;
+        StringSet * files;
+    } DirectoryListing;
+    
+#define DELETE_TREE_MAX_WORKERS 8
+#define DELETE_TREE_FILES_PER_WORKER 64
+    
     extern const WCHAR * FILE_SEP;
     extern const long CRC32_TABLE[256];
     void update_crc32(DWORD * crc32, char * buf, DWORD size);
+    DWORD isFileIntact(WCHAR * path, int64t * length, DWORD expectedCRC);
+    DirectoryListing * newDirectoryListing();
+    DWORD fileExistsInListing(DirectoryListing * listing, WCHAR * path);
+    void freeDirectoryListing(DirectoryListing ** listing);
     int64t * getFreeSpace(WCHAR *path);
     int64t * getFileSize(WCHAR * path);
     void checkFreeSpace(LauncherProperties * props, WCHAR * tmpDir, int64t * size);
@@ -42,6 +72,7 @@ extern "C" {
     void createDirectory(LauncherProperties * props, WCHAR * directory);
     void createTempDirectory(LauncherProperties * props, WCHAR * argTempDir, DWORD createRndSubDir);
     void deleteDirectory(LauncherProperties * props,WCHAR * dir);
+    void copyDirectoryTree(LauncherProperties * props, WCHAR * source, WCHAR * destination);
     WCHAR * getExePath();
     WCHAR * getExeName();
     WCHAR * getExeDirectory();
@@ -58,8 +89,10 @@ extern "C" {
     void writeDWORD(LauncherProperties * props,DWORD level,    DWORD isErr,  const char  * message, DWORD value, DWORD needEndOfLine);
     void writeint64t(LauncherProperties * props,DWORD level,   DWORD isErr,  const char  * message, int64t * value, DWORD needEndOfLine);
     
+    void writeDeferredOutput(LauncherProperties * props, StringBuilder * sb, DWORD isErr);
     void flushHandle(HANDLE hd);
     DWORD fileExists(WCHAR * path);
+    WCHAR * getLocationKey(WCHAR * path);
     
     #ifdef	__cplusplus
 }
@@ -0,0 +1,364 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Streaming inflater for the deflate (RFC 1951) and gzip (RFC 1952) formats,
+// used to restore the compressed files without running external tools.
+
+#include "Inflate.h"
+#include "FileUtils.h"
+#include "StringUtils.h"
+
+static const WORD LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const BYTE LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const WORD DISTANCE_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const BYTE DISTANCE_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const BYTE CODE_LENGTHS_ORDER[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+InflateStream * newInflateStream(InflateReadFunc read, void * readContext, InflateWriteFunc write, void * writeContext) {
+    InflateStream * stream = (InflateStream *) LocalAlloc(LPTR, sizeof(InflateStream));
+    if(stream == NULL) {
+        return NULL;
+    }
+    stream->read = read;
+    stream->readContext = readContext;
+    stream->write = write;
+    stream->writeContext = writeContext;
+    stream->crc32 = -1L;
+    return stream;
+}
+
+static BYTE nextByte(InflateStream * s) {
+    if(s->inputPosition == s->inputLength) {
+        s->inputPosition = 0;
+        s->inputLength = (s->error == INFLATE_OK) ? s->read(s->readContext, s->input, INFLATE_INPUT_SIZE) : 0;
+        if(s->inputLength == 0) {
+            if(s->error == INFLATE_OK) s->error = INFLATE_ERROR_READ;
+            return 0;
+        }
+    }
+    return (BYTE) s->input[s->inputPosition++];
+}
+
+static DWORD getBits(InflateStream * s, DWORD number) {
+    DWORD value;
+    while(s->bitCount < number) {
+        s->bitBuffer |= ((DWORD) nextByte(s)) << s->bitCount;
+        s->bitCount += 8;
+    }
+    value = s->bitBuffer & ((1UL << number) - 1);
+    s->bitBuffer >>= number;
+    s->bitCount -= number;
+    return value;
+}
+
+static void alignToByte(InflateStream * s) {
+    s->bitBuffer = 0;
+    s->bitCount = 0;
+}
+
+static void flushWindow(InflateStream * s, DWORD length) {
+    if(length > 0 && s->error == INFLATE_OK) {
+        update_crc32(&s->crc32, s->window, length);
+        if(!s->write(s->writeContext, s->window, length)) {
+            s->error = INFLATE_ERROR_WRITE;
+        }
+    }
+}
+
+static void putByte(InflateStream * s, BYTE b) {
+    s->window[s->windowPosition++] = (char) b;
+    s->total++;
+    if(s->windowPosition == INFLATE_WINDOW_SIZE) {
+        flushWindow(s, INFLATE_WINDOW_SIZE);
+        s->windowPosition = 0;
+    }
+}
+
+static void buildTree(InflateTree * t, const BYTE * lengths, DWORD number) {
+    WORD offsets[16];
+    DWORD i;
+    WORD sum = 0;
+    for(i = 0; i < 16; i++) t->counts[i] = 0;
+    for(i = 0; i < number; i++) t->counts[lengths[i]]++;
+    t->counts[0] = 0;
+    for(i = 0; i < 16; i++) {
+        offsets[i] = sum;
+        sum += t->counts[i];
+    }
+    for(i = 0; i < number; i++) {
+        if(lengths[i]) t->symbols[offsets[lengths[i]]++] = (WORD) i;
+    }
+}
+
+// canonical codes are read bit by bit, shorter codes have smaller values
+static int decodeSymbol(InflateStream * s, InflateTree * t) {
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    int length;
+    for(length = 1; length < 16; length++) {
+        int count = t->counts[length];
+        code |= (int) getBits(s, 1);
+        if(code - first < count) {
+            return t->symbols[index + code - first];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    s->error = INFLATE_ERROR_DATA;
+    return -1;
+}
+
+static void buildFixedTrees(InflateStream * s) {
+    BYTE lengths[288];
+    DWORD i;
+    for(i = 0; i < 144; i++) lengths[i] = 8;
+    for(; i < 256; i++) lengths[i] = 9;
+    for(; i < 280; i++) lengths[i] = 7;
+    for(; i < 288; i++) lengths[i] = 8;
+    buildTree(&s->literals, lengths, 288);
+    for(i = 0; i < 30; i++) lengths[i] = 5;
+    buildTree(&s->distances, lengths, 30);
+}
+
+static void buildDynamicTrees(InflateStream * s) {
+    BYTE lengths[288 + 32];
+    DWORD hlit = getBits(s, 5) + 257;
+    DWORD hdist = getBits(s, 5) + 1;
+    DWORD hclen = getBits(s, 4) + 4;
+    DWORD i;
+    DWORD number = 0;
+
+    ZERO(lengths, sizeof(lengths));
+    for(i = 0; i < hclen; i++) {
+        lengths[CODE_LENGTHS_ORDER[i]] = (BYTE) getBits(s, 3);
+    }
+    buildTree(&s->literals, lengths, 19);
+
+    ZERO(lengths, sizeof(lengths));
+    while(number < hlit + hdist && s->error == INFLATE_OK) {
+        int symbol = decodeSymbol(s, &s->literals);
+        DWORD repeat = 0;
+        BYTE value = 0;
+        if(symbol < 0) return;
+        if(symbol < 16) {
+            lengths[number++] = (BYTE) symbol;
+            continue;
+        } else if(symbol == 16) {
+            if(number == 0) {
+                s->error = INFLATE_ERROR_DATA;
+                return;
+            }
+            value = lengths[number - 1];
+            repeat = getBits(s, 2) + 3;
+        } else if(symbol == 17) {
+            repeat = getBits(s, 3) + 3;
+        } else {
+            repeat = getBits(s, 7) + 11;
+        }
+        if(number + repeat > hlit + hdist) {
+            s->error = INFLATE_ERROR_DATA;
+            return;
+        }
+        while(repeat--) lengths[number++] = value;
+    }
+    buildTree(&s->literals, lengths, hlit);
+    buildTree(&s->distances, lengths + hlit, hdist);
+}
+
+static void inflateHuffmanBlock(InflateStream * s) {
+    while(s->error == INFLATE_OK) {
+        int symbol = decodeSymbol(s, &s->literals);
+        if(symbol < 0) return;
+        if(symbol < 256) {
+            putByte(s, (BYTE) symbol);
+        } else if(symbol == 256) {
+            return;
+        } else {
+            DWORD length;
+            DWORD distance;
+            int distSymbol;
+            symbol -= 257;
+            if(symbol >= 29) {
+                s->error = INFLATE_ERROR_DATA;
+                return;
+            }
+            length = LENGTH_BASE[symbol] + getBits(s, LENGTH_EXTRA[symbol]);
+            distSymbol = decodeSymbol(s, &s->distances);
+            if(distSymbol < 0 || distSymbol >= 30) {
+                s->error = INFLATE_ERROR_DATA;
+                return;
+            }
+            distance = DISTANCE_BASE[distSymbol] + getBits(s, DISTANCE_EXTRA[distSymbol]);
+            if(distance > s->total || distance > INFLATE_WINDOW_SIZE) {
+                s->error = INFLATE_ERROR_DATA;
+                return;
+            }
+            while(length--) {
+                putByte(s, (BYTE) s->window[(s->windowPosition - distance) & (INFLATE_WINDOW_SIZE - 1)]);
+            }
+        }
+    }
+}
+
+static void inflateStoredBlock(InflateStream * s) {
+    DWORD length;
+    DWORD invLength;
+    alignToByte(s);
+    length = nextByte(s);
+    length |= ((DWORD) nextByte(s)) << 8;
+    invLength = nextByte(s);
+    invLength |= ((DWORD) nextByte(s)) << 8;
+    if(length != (~invLength & 0xFFFF)) {
+        s->error = INFLATE_ERROR_DATA;
+        return;
+    }
+    while(length-- && s->error == INFLATE_OK) {
+        putByte(s, nextByte(s));
+    }
+}
+
+DWORD inflateData(InflateStream * s) {
+    DWORD last = 0;
+    while(!last && s->error == INFLATE_OK) {
+        DWORD type;
+        last = getBits(s, 1);
+        type = getBits(s, 2);
+        if(type == 0) {
+            inflateStoredBlock(s);
+        } else if(type == 1) {
+            buildFixedTrees(s);
+            inflateHuffmanBlock(s);
+        } else if(type == 2) {
+            buildDynamicTrees(s);
+            inflateHuffmanBlock(s);
+        } else {
+            s->error = INFLATE_ERROR_DATA;
+        }
+    }
+    flushWindow(s, s->windowPosition);
+    s->windowPosition = 0;
+    return s->error;
+}
+
+DWORD gunzipData(InflateStream * s) {
+    BYTE flags;
+    DWORD i;
+    DWORD crc = 0;
+    DWORD size = 0;
+
+    if(nextByte(s) != 0x1F || nextByte(s) != 0x8B || nextByte(s) != 8) {
+        if(s->error == INFLATE_OK) s->error = INFLATE_ERROR_DATA;
+        return s->error;
+    }
+    flags = nextByte(s);
+    // mtime, xfl, os
+    for(i = 0; i < 6; i++) nextByte(s);
+    if(flags & 4) { // FEXTRA
+        DWORD extra = nextByte(s);
+        extra |= ((DWORD) nextByte(s)) << 8;
+        while(extra-- && s->error == INFLATE_OK) nextByte(s);
+    }
+    if(flags & 8) { // FNAME
+        while(nextByte(s) != 0 && s->error == INFLATE_OK);
+    }
+    if(flags & 16) { // FCOMMENT
+        while(nextByte(s) != 0 && s->error == INFLATE_OK);
+    }
+    if(flags & 2) { // FHCRC
+        nextByte(s);
+        nextByte(s);
+    }
+    if(s->error != INFLATE_OK) return s->error;
+
+    inflateData(s);
+    if(s->error != INFLATE_OK) return s->error;
+
+    alignToByte(s);
+    for(i = 0; i < 4; i++) crc |= ((DWORD) nextByte(s)) << (i * 8);
+    for(i = 0; i < 4; i++) size |= ((DWORD) nextByte(s)) << (i * 8);
+    if(s->error == INFLATE_OK && (crc != ~s->crc32 || size != s->total)) {
+        s->error = INFLATE_ERROR_CRC;
+    }
+    return s->error;
+}
+
+DWORD readFromHandle(void * context, char * buf, DWORD size) {
+    DWORD read = 0;
+    if(!ReadFile((HANDLE) context, buf, size, &read, NULL)) {
+        return 0;
+    }
+    return read;
+}
+
+DWORD writeToHandle(void * context, char * buf, DWORD size) {
+    DWORD written = 0;
+    while(size > 0) {
+        if(!WriteFile((HANDLE) context, buf, size, &written, NULL) || written == 0) {
+            return 0;
+        }
+        buf += written;
+        size -= written;
+    }
+    return 1;
+}
+
+DWORD gunzipFile(WCHAR * input, WCHAR * output) {
+    DWORD result;
+    InflateStream * stream;
+    HANDLE hRead = CreateFileW(input, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    HANDLE hWrite;
+    if(hRead == INVALID_HANDLE_VALUE) {
+        return INFLATE_ERROR_READ;
+    }
+    hWrite = CreateFileW(output, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(hWrite == INVALID_HANDLE_VALUE) {
+        CloseHandle(hRead);
+        return INFLATE_ERROR_WRITE;
+    }
+    stream = newInflateStream(readFromHandle, (void *) hRead, writeToHandle, (void *) hWrite);
+    if(stream == NULL) {
+        result = INFLATE_ERROR_MEMORY;
+    } else {
+        result = gunzipData(stream);
+        FREE(stream);
+    }
+    CloseHandle(hRead);
+    CloseHandle(hWrite);
+    if(result != INFLATE_OK) {
+        DeleteFileW(output);
+    }
+    return result;
+}
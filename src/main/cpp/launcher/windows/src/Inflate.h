@@ -0,0 +1,88 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _Inflate_H
+#define	_Inflate_H
+
+#include <windows.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define INFLATE_OK          0
+#define INFLATE_ERROR_DATA  1
+#define INFLATE_ERROR_READ  2
+#define INFLATE_ERROR_WRITE 3
+#define INFLATE_ERROR_CRC   4
+#define INFLATE_ERROR_MEMORY 5
+
+#define INFLATE_WINDOW_SIZE 32768
+#define INFLATE_INPUT_SIZE  65536
+
+    // return number of bytes read, 0 at the end of the input
+    typedef DWORD (*InflateReadFunc)(void * context, char * buf, DWORD size);
+    // return 0 on error
+    typedef DWORD (*InflateWriteFunc)(void * context, char * buf, DWORD size);
+
+    typedef struct _inflateTree {
+        WORD counts[16];
+        WORD symbols[288];
+    } InflateTree;
+
+    typedef struct _inflateStream {
+        InflateReadFunc read;
+        void * readContext;
+        InflateWriteFunc write;
+        void * writeContext;
+        char input[INFLATE_INPUT_SIZE];
+        DWORD inputPosition;
+        DWORD inputLength;
+        DWORD bitBuffer;
+        DWORD bitCount;
+        char window[INFLATE_WINDOW_SIZE];
+        DWORD windowPosition;
+        DWORD total;
+        DWORD crc32;
+        DWORD error;
+        InflateTree literals;
+        InflateTree distances;
+    } InflateStream;
+
+    // NULL if there is no memory
+    InflateStream * newInflateStream(InflateReadFunc read, void * readContext, InflateWriteFunc write, void * writeContext);
+
+    // raw deflate data
+    DWORD inflateData(InflateStream * stream);
+
+    // gzip member: header, deflate data, crc and size check
+    DWORD gunzipData(InflateStream * stream);
+
+    // output is deleted if the input can`t be inflated
+    DWORD gunzipFile(WCHAR * input, WCHAR * output);
+
+    DWORD readFromHandle(void * context, char * buf, DWORD size);
+
+    DWORD writeToHandle(void * context, char * buf, DWORD size);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _Inflate_H */
@@ -25,6 +25,8 @@
 #include "SystemUtils.h"
 #include "FileUtils.h"
 #include "ProcessUtils.h"
+#include "Inflate.h"
+#include "ExtractUtils.h"
 #include "Launcher.h"
 #include "Main.h"
 
@@ -36,6 +38,8 @@ const WCHAR * UNPACK200_EXE_SUFFIX = L"\\bin\\unpack200.exe";
 const WCHAR * JAVA_LIB_SUFFIX = L"\\lib";
 const WCHAR * PACK_GZ_SUFFIX  = L".pack.gz";
 const WCHAR * JAR_PACK_GZ_SUFFIX = L".jar.pack.gz";
+const WCHAR * GZ_SUFFIX  = L".gz";
+const WCHAR * JAR_GZ_SUFFIX = L".jar.gz";
 const WCHAR * PATH_ENV = L"PATH";
 
 const DWORD JVM_EXTRACTION_TIMEOUT = 180000;  //180sec
@@ -287,6 +291,7 @@ void getJavaProperties(WCHAR * location, LauncherProperties * props, JavaPropert
     
     if(fileExists(javaExecutable) && testJavaClass!=NULL && isDirectory(libDirectory)) {
         WCHAR * command = NULL;
+        StringBuilderW commandBuilder;
         HANDLE hRead;
         HANDLE hWrite;
         
@@ -294,10 +299,12 @@ void getJavaProperties(WCHAR * location, LauncherProperties * props, JavaPropert
         // <location>\bin\java.exe exists
 
         
-        appendCommandLineArgument(&command, javaExecutable);
-        appendCommandLineArgument(&command, L"-classpath");
-        appendCommandLineArgument(&command, props->testJVMFile->resolved);
-        appendCommandLineArgument(&command, testJavaClass);
+        initStringBuilderW(&commandBuilder, MAX_PATH);
+        appendCommandLineArgument(&commandBuilder, javaExecutable);
+        appendCommandLineArgument(&commandBuilder, L"-classpath");
+        appendCommandLineArgument(&commandBuilder, props->testJVMFile->resolved);
+        appendCommandLineArgument(&commandBuilder, testJavaClass);
+        command = finishStringBuilderW(&commandBuilder);
         
         
         CreatePipe(&hRead, &hWrite, NULL, 0);
@@ -339,38 +346,36 @@ char * getJavaVersionFormatted(const JavaProperties * javaProps) {
             char * majorStr = long2char(version->major);
             char * minorStr = long2char(version->minor);
             char * microStr = long2char(version->micro);
-            result = appendString(result, majorStr);
-            result = appendString(result, ".");
-            result = appendString(result, minorStr);
-            result = appendString(result, ".");
-            result = appendString(result, microStr);
+            StringBuilder sb;
+            initStringBuilder(&sb, 32 + getLengthA(version->build));
+            appendToBuilder(&sb, majorStr);
+            appendToBuilderN(&sb, ".", 1);
+            appendToBuilder(&sb, minorStr);
+            appendToBuilderN(&sb, ".", 1);
+            appendToBuilder(&sb, microStr);
             FREE(majorStr);
             FREE(minorStr);
             FREE(microStr);
             
             if(version->update!=0) {
                 char * updateStr = long2charN(version->update, 2);
-                result = appendString(result, "_");
-                result = appendString(result, updateStr);
+                appendToBuilderN(&sb, "_", 1);
+                appendToBuilder(&sb, updateStr);
                 FREE(updateStr);
             }
             if(getLengthA(version->build) > 0) {
-                result = appendString(result, "-");
-                result = appendString(result, version->build);
+                appendToBuilderN(&sb, "-", 1);
+                appendToBuilder(&sb, version->build);
             }
+            result = finishStringBuilder(&sb);
         }
     }
     return result;
 }
 
 
-JavaCompatible * newJavaCompatible() {
-    JavaCompatible * props = (JavaCompatible *) LocalAlloc(LPTR, sizeof(JavaCompatible));
-    props->minVersion = NULL;
-    props->maxVersion = NULL;
-    props->vendor = NULL;
-    props->osName = NULL;
-    return props;
+JavaCompatible * newJavaCompatible(Arena * arena) {
+    return (JavaCompatible *) arenaAlloc(arena, sizeof(JavaCompatible));
 }
 
 void freeJavaProperties(JavaProperties ** props) {
@@ -527,7 +532,14 @@ void searchJavaFromEnvVariables(LauncherProperties * props) {
 
 
 
-void unpackJars(LauncherProperties * props, WCHAR * jvmDir, WCHAR * startDir, WCHAR * unpack200exe) {
+DWORD endsWith(WCHAR * str, const WCHAR * suffix) {
+    DWORD length = getLengthW(str);
+    DWORD suffixLength = getLengthW(suffix);
+    return (length >= suffixLength) && (lstrcmpiW(str + length - suffixLength, suffix) == 0);
+}
+
+// collect all packed jars in the tree, they are restored later by the pool of workers
+void collectPackedJars(LauncherProperties * props, WCHAR * startDir, StringListEntry ** files, DWORD * number) {
     DWORD attrs;
     DWORD dwError;
     
@@ -542,6 +554,14 @@ void unpackJars(LauncherProperties * props, WCHAR * jvmDir, WCHAR * startDir, WC
         HANDLE hFind = INVALID_HANDLE_VALUE;
         
         WCHAR * DirSpec = appendStringW(appendStringW(NULL, startDir), L"\\*" );
+        StringBuilderW child;
+        DWORD parentLength;
+        
+        // children paths share the "<startDir>\" prefix, only the name is replaced
+        initStringBuilderW(&child, MAX_PATH);
+        appendToBuilderW(&child, startDir);
+        appendToBuilderW(&child, FILE_SEP);
+        parentLength = child.length;
         
         // Find the first file in the directory.
         hFind = FindFirstFileW(DirSpec, &FindFileData);
@@ -557,43 +577,19 @@ void unpackJars(LauncherProperties * props, WCHAR * jvmDir, WCHAR * startDir, WC
             while (FindNextFileW(hFind, &FindFileData) != 0 && isOK(props)) {
                 if(lstrcmpW(FindFileData.cFileName, L".")!=0 &&
                         lstrcmpW(FindFileData.cFileName, L"..")!=0) {
-                    WCHAR * child = NULL;
-                    
-                    child = appendStringW(appendStringW(appendStringW(NULL, startDir), FILE_SEP), FindFileData.cFileName);
-                    if(isDirectory(child)) {
+                    child.length = parentLength;
+                    appendToBuilderW(&child, FindFileData.cFileName);
+                    if(FindFileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
                         writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... directory : ", 0);
-                        writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, child, 1);
-                        unpackJars(props, jvmDir, child, unpack200exe);
-                    } else  if(searchW(FindFileData.cFileName, JAR_PACK_GZ_SUFFIX)!=NULL) {
-                        WCHAR * jarName = appendStringW(appendStringW(
-                                appendStringW(NULL, startDir), FILE_SEP),
-                                appendStringNW(NULL, 0, FindFileData.cFileName,
-                                getLengthW(FindFileData.cFileName) - getLengthW(PACK_GZ_SUFFIX)));
-                        WCHAR * unpackCommand = NULL;
+                        writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, child.buffer, 1);
+                        collectPackedJars(props, child.buffer, files, number);
+                    } else if(endsWith(FindFileData.cFileName, JAR_PACK_GZ_SUFFIX) ||
+                            endsWith(FindFileData.cFileName, JAR_GZ_SUFFIX)) {
                         writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... packed jar : ", 0);
-                        writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, child, 1);
-                        writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... jar name : ", 0);
-                        writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, jarName, 1);
-                        
-                        
-                        appendCommandLineArgument(&unpackCommand, unpack200exe);
-                        appendCommandLineArgument(&unpackCommand, L"-r"); // remove input file
-                        appendCommandLineArgument(&unpackCommand, child);
-                        appendCommandLineArgument(&unpackCommand, jarName);
-                        
-                        executeCommand(props, unpackCommand, NULL, UNPACK200_EXTRACTION_TIMEOUT, props->stdoutHandle, props->stderrHandle, NORMAL_PRIORITY_CLASS);
-                        FREE(unpackCommand);
-                        if(!isOK(props)) {
-                            if(props->status==ERROR_PROCESS_TIMEOUT) {
-                                writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "... could not unpack file : timeout", 1);
-                            } else {
-                                writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "... an error occured unpacking the file", 1);
-                            }
-                            props->exitCode = props->status;
-                        }
-                        FREE(jarName);
+                        writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, child.buffer, 1);
+                        * files = addStringToList(* files, child.buffer);
+                        (* number)++;
                     }
-                    FREE(child);
                 }
             }
             
@@ -604,14 +600,170 @@ void unpackJars(LauncherProperties * props, WCHAR * jvmDir, WCHAR * startDir, WC
             }
         }
         FREE(DirSpec);
+        freeStringBuilderW(&child);
+    }
+}
+
+// restore one jar : *.jar.pack.gz by unpack200, *.jar.gz in-process
+void restoreJar(LauncherProperties * props, WCHAR * packed, WCHAR * unpack200exe) {
+    DWORD isPack200 = endsWith(packed, JAR_PACK_GZ_SUFFIX);
+    const WCHAR * suffix = isPack200 ? PACK_GZ_SUFFIX : GZ_SUFFIX;
+    WCHAR * jarName = appendStringNW(NULL, 0, packed, getLengthW(packed) - getLengthW(suffix));
+    WCHAR * unpackCommand = NULL;
+    StringBuilderW commandBuilder;
+    
+    writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... jar name : ", 0);
+    writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, jarName, 1);
+    
+    if(!isPack200) {
+        DWORD result = gunzipFile(packed, jarName);
+        if(result==INFLATE_OK) {
+            DeleteFileW(packed);
+        } else {
+            writeDWORD(props, OUTPUT_LEVEL_DEBUG, 1, "... could not inflate the file, error ", result, 1);
+            props->status = ERROR_BUNDLED_JVM_EXTRACTION;
+            props->exitCode = props->status;
+        }
+    } else if(unpack200exe==NULL) {
+        writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "... no unpack200 command", 1);
+        props->status = ERROR_BUNDLED_JVM_EXTRACTION;
+        props->exitCode = props->status;
+    } else {
+        initStringBuilderW(&commandBuilder, MAX_PATH);
+        appendCommandLineArgument(&commandBuilder, unpack200exe);
+        appendCommandLineArgument(&commandBuilder, L"-r"); // remove input file
+        appendCommandLineArgument(&commandBuilder, packed);
+        appendCommandLineArgument(&commandBuilder, jarName);
+        unpackCommand = finishStringBuilderW(&commandBuilder);
+        
+        executeCommand(props, unpackCommand, NULL, UNPACK200_EXTRACTION_TIMEOUT, props->stdoutHandle, props->stderrHandle, NORMAL_PRIORITY_CLASS);
+        FREE(unpackCommand);
+        if(!isOK(props)) {
+            if(props->status==ERROR_PROCESS_TIMEOUT) {
+                writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "... could not unpack file : timeout", 1);
+            } else {
+                writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "... an error occured unpacking the file", 1);
+            }
+            props->exitCode = props->status;
+        }
+    }
+    FREE(jarName);
+}
+
+DWORD WINAPI unpackJarsWorker(void * ptr) {
+    UnpackJarsWorker * worker = (UnpackJarsWorker *) ptr;
+    UnpackJarsJobs * jobs = worker->jobs;
+    LauncherProperties * props = &worker->props;
+    
+    while(!jobs->failed && !isTerminated(props)) {
+        LONG index = InterlockedIncrement(&jobs->next) - 1;
+        if(index >= (LONG) jobs->number) break;
+        restoreJar(props, jobs->files[index], jobs->unpack200exe);
+        if(!isOK(props)) {
+            // the first failure is reported, others stop taking new files
+            if(InterlockedCompareExchange(&jobs->failed, 1, 0)==0) {
+                jobs->status = props->status;
+                jobs->exitCode = props->exitCode;
+            }
+        }
+    }
+    if(props->status==ERROR_USER_TERMINATED && InterlockedCompareExchange(&jobs->failed, 1, 0)==0) {
+        jobs->status = props->status;
+        jobs->exitCode = props->exitCode;
+    }
+    return 0;
+}
+
+void unpackJars(LauncherProperties * props, WCHAR * jvmDir, WCHAR * unpack200exe) {
+    StringListEntry * list = NULL;
+    StringListEntry * entry;
+    UnpackJarsJobs jobs;
+    UnpackJarsWorker * pool;
+    HANDLE threads[MAXIMUM_WAIT_OBJECTS];
+    DWORD threadsNumber = 0;
+    DWORD workers;
+    DWORD i;
+    SYSTEM_INFO info;
+    
+    ZERO(&jobs, sizeof(UnpackJarsJobs));
+    collectPackedJars(props, jvmDir, &list, &jobs.number);
+    if(!isOK(props) || jobs.number==0) {
+        freeStringList(&list);
+        return;
+    }
+    
+    jobs.props = props;
+    jobs.unpack200exe = unpack200exe;
+    jobs.status = ERROR_OK;
+    jobs.files = (WCHAR **) LocalAlloc(LPTR, sizeof(WCHAR *) * jobs.number);
+    for(i = 0, entry = list; entry!=NULL; entry = entry->next) {
+        jobs.files[i++] = entry->string;
+    }
+    
+    // each restoration is single-threaded cpu work, use all the cores
+    GetSystemInfo(&info);
+    workers = info.dwNumberOfProcessors;
+    if(workers < 1) workers = 1;
+    if(workers > jobs.number) workers = jobs.number;
+    if(workers > MAXIMUM_WAIT_OBJECTS) workers = MAXIMUM_WAIT_OBJECTS;
+    writeDWORD(props, OUTPUT_LEVEL_DEBUG, 0, "... packed jars : ", jobs.number, 1);
+    writeDWORD(props, OUTPUT_LEVEL_DEBUG, 0, "... unpacking workers : ", workers, 1);
+    
+    pool = (UnpackJarsWorker *) LocalAlloc(LPTR, sizeof(UnpackJarsWorker) * workers);
+    if(pool==NULL) {
+        props->status = ERROR_BUNDLED_JVM_EXTRACTION;
+        props->exitCode = props->status;
+        FREE(jobs.files);
+        freeStringList(&list);
+        return;
+    }
+    for(i = 0; i < workers; i++) {
+        pool[i].jobs = &jobs;
+        // own copy to have separate status and exit code
+        CopyMemory(&pool[i].props, props, sizeof(LauncherProperties));
+        pool[i].props.status = ERROR_OK;
+        // nothing is allocated by the workers
+        pool[i].props.arena = NULL;
+        pool[i].props.scratch = NULL;
+        initStringBuilder(&pool[i].output, 0);
+        initStringBuilder(&pool[i].errors, 0);
+        pool[i].props.deferredOutput = &pool[i].output;
+        pool[i].props.deferredErrors = &pool[i].errors;
+    }
+    for(i = 1; i < workers; i++) {
+        DWORD threadId;
+        HANDLE thread = CreateThread(NULL, 0, &unpackJarsWorker, (LPVOID) &pool[i], 0, &threadId);
+        if(thread==NULL) break;
+        threads[threadsNumber++] = thread;
     }
+    // current thread is a worker as well
+    unpackJarsWorker(&pool[0]);
     
+    if(threadsNumber > 0) {
+        WaitForMultipleObjects(threadsNumber, threads, TRUE, INFINITE);
+        for(i = 0; i < threadsNumber; i++) {
+            CloseHandle(threads[i]);
+        }
+    }
+    for(i = 0; i < workers; i++) {
+        writeDeferredOutput(props, &pool[i].output, 0);
+        writeDeferredOutput(props, &pool[i].errors, 1);
+        freeStringBuilder(&pool[i].output);
+        freeStringBuilder(&pool[i].errors);
+    }
+    FREE(pool);
+    if(jobs.failed) {
+        props->status = jobs.status;
+        props->exitCode = jobs.exitCode;
+    }
+    FREE(jobs.files);
+    freeStringList(&list);
 }
+
 void installJVM(LauncherProperties * props, LauncherResource *jvm) {
     WCHAR * command = NULL;
-    WCHAR * jvmDir = getParentDirectory(jvm->resolved);
+    WCHAR * jvmDir = getArchiveDirectory(jvm->resolved);
     
-    jvmDir = appendStringW(jvmDir, L"\\_jvm");
     createDirectory(props, jvmDir);
     if(!isOK(props)) {
         writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "... cannot create dir for JVM extraction :", 0);
@@ -620,12 +772,27 @@ void installJVM(LauncherProperties * props, LauncherResource *jvm) {
         return;
     }
     
-    appendCommandLineArgument(&command, jvm->resolved);
-    appendCommandLineArgument(&command, L"-d");
-    appendCommandLineArgument(&command, jvmDir);
-    
-    executeCommand(props, command, jvmDir, JVM_EXTRACTION_TIMEOUT, props->stdoutHandle, props->stderrHandle, NORMAL_PRIORITY_CLASS);
-    FREE(command);
+    if(jvm->expanded) {
+        writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... JVM archive was expanded from the payload", 1);
+    } else if(isGzipFile(jvm->resolved)) {
+        // tar.gz archive is expanded in-process, no self-extractor to run
+        writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... extracting JVM archive", 1);
+        extractTarGzArchive(props, jvm->resolved, jvmDir);
+        if(!isOK(props)) {
+            writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "... could not extract JVM archive", 1);
+            props->status = ERROR_BUNDLED_JVM_EXTRACTION;
+        }
+    } else {
+        StringBuilderW commandBuilder;
+        initStringBuilderW(&commandBuilder, MAX_PATH);
+        appendCommandLineArgument(&commandBuilder, jvm->resolved);
+        appendCommandLineArgument(&commandBuilder, L"-d");
+        appendCommandLineArgument(&commandBuilder, jvmDir);
+        command = finishStringBuilderW(&commandBuilder);
+        
+        executeCommand(props, command, jvmDir, JVM_EXTRACTION_TIMEOUT, props->stdoutHandle, props->stderrHandle, NORMAL_PRIORITY_CLASS);
+        FREE(command);
+    }
     if(!isOK(props)) {
         if(props->status==ERROR_PROCESS_TIMEOUT) {
             writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "... could not extract JVM : timeout", 1);
@@ -635,19 +802,24 @@ void installJVM(LauncherProperties * props, LauncherResource *jvm) {
         props->exitCode = props->status;
     } else {
         WCHAR * unpack200exe = appendStringW(appendStringW(NULL, jvmDir), UNPACK200_EXE_SUFFIX);
-        if(fileExists(unpack200exe)) {
-            unpackJars(props, jvmDir, jvmDir, unpack200exe);
-        } else {
-            writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "... no unpack200 command", 1);
-            props->status = ERROR_BUNDLED_JVM_EXTRACTION;
-        }
+        // unpack200 is required only if there are pack200 files
+        unpackJars(props, jvmDir, fileExists(unpack200exe) ? unpack200exe : NULL);
         if(!isOK(props)) {
             writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "Could not unpack200 the JVM jars", 1);
         }
         FREE(unpack200exe);
     }
-    FREE(jvm->resolved);
-    jvm->resolved = jvmDir;
+    jvm->resolved = moveToArenaW(props->arena, jvmDir);
+}
+
+DWORD hasBundledJVMs(LauncherProperties * props) {
+    DWORD i;
+    for(i=0;props->jvms!=NULL && i<props->jvms->size; i++) {
+        if(props->jvms->items[i]->type==0) {
+            return 1;
+        }
+    }
+    return 0;
 }
 
 void installBundledJVMs(LauncherProperties * props) {
@@ -686,7 +858,6 @@ void searchJavaInstallationFolder(LauncherProperties * props) {
     char installationFolder [MAX_PATH]= "";
     int i;
     int end = (int) (pch - executablePath);
-    printf("%i", end);
     for(i = 0; i < end; i++) {
         installationFolder[i] = executablePath[i];
     }
@@ -703,22 +874,21 @@ void searchJavaInstallationFolder(LauncherProperties * props) {
     // to be able to delete jvm in installation folder
     WCHAR * tempJreFolder = NULL;
     tempJreFolder = appendStringW(tempJreFolder, props->testJVMFile->resolved); 
-    tempJreFolder = appendStringW(tempJreFolder, L"\\_jvm\\");    
-    
-    WCHAR * command = NULL;
-    appendCommandLineArgument(&command, L"xcopy");
-    appendCommandLineArgument(&command, nestedJreFolder);
-    appendCommandLineArgument(&command, tempJreFolder);
-    appendCommandLineArgument(&command, L"/e");
-    appendCommandLineArgument(&command, L"/y");
+    tempJreFolder = appendStringW(tempJreFolder, L"\\_jvm");    
     
-    writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "Copying nested JRE to temp folder", 0);
+    writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "Copying nested JRE to temp folder", 1);
     
-    executeCommand(props, command, NULL, JVM_EXTRACTION_TIMEOUT, props->stdoutHandle, props->stderrHandle, NORMAL_PRIORITY_CLASS);
+    copyDirectoryTree(props, nestedJreFolder, tempJreFolder);
     
-    if (fileExists(tempJreFolder)) {    
+    if (isOK(props)) {    
         trySetCompatibleJava(tempJreFolder, props);
+    } else {
+        // not fatal, continue with other locations
+        writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "... could not copy nested JRE", 1);
+        props->status = ERROR_OK;
     }
+    FREE(tempJreFolder);
+    FREE(nestedJreFolder);
 }
 void searchJavaSystemLocations(LauncherProperties * props) {
     if ( props->jvms->size > 0 ) {
@@ -825,3 +995,453 @@ void printJavaProperties(LauncherProperties * props, JavaProperties * javaProps)
         FREE(jv);
     }
 }
+
+DWORD writeBytesToFile(LauncherProperties * props, WCHAR * path, char * bytes, DWORD length) {
+    DWORD written = 0;
+    DWORD result;
+    HANDLE hFile = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(hFile==INVALID_HANDLE_VALUE) {
+        writeErrorA(props, OUTPUT_LEVEL_DEBUG, 1, "Error! Can`t create file : ", path, GetLastError());
+        return 0;
+    }
+    result = WriteFile(hFile, bytes, length, &written, NULL) && written==length;
+    CloseHandle(hFile);
+    if(!result) {
+        DeleteFileW(path);
+    }
+    return result;
+}
+
+// the @argfile of java 9+ : one quoted argument per line, \ and " escaped.
+// It is read in the ANSI code page, so 0 is returned if an argument can`t be represented
+DWORD writeJavaArgumentsFile(LauncherProperties * props, WCHAR * path, WCHAR ** args, DWORD number) {
+    StringBuilderW content;
+    char * bytes = NULL;
+    BOOL lossy = FALSE;
+    DWORD length = 0;
+    DWORD result = 0;
+    DWORD i, j;
+    
+    initStringBuilderW(&content, 4096);
+    for(i=0;i<number;i++) {
+        WCHAR * arg = args[i];
+        DWORD argLength = getLengthW(arg);
+        reserveStringBuilderW(&content, argLength * 2 + 4);
+        appendToBuilderNW(&content, L"\"", 1);
+        for(j=0;j<argLength;j++) {
+            if(arg[j]==L'\\' || arg[j]==L'"') {
+                appendToBuilderNW(&content, L"\\", 1);
+            }
+            appendToBuilderNW(&content, arg + j, 1);
+        }
+        appendToBuilderNW(&content, L"\"\r\n", 3);
+    }
+    
+    if(content.length > 0) {
+        length = WideCharToMultiByte(CP_ACP, WC_NO_BEST_FIT_CHARS, content.buffer, content.length, NULL, 0, NULL, &lossy);
+    }
+    if(length > 0 && !lossy) {
+        bytes = newpChar(length);
+        WideCharToMultiByte(CP_ACP, WC_NO_BEST_FIT_CHARS, content.buffer, content.length, bytes, length, NULL, NULL);
+        result = writeBytesToFile(props, path, bytes, length);
+        FREE(bytes);
+    } else {
+        writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... arguments can`t be written in the ANSI code page", 1);
+    }
+    freeStringBuilderW(&content);
+    return result;
+}
+
+void appendFileURL(StringBuilder * sb, WCHAR * path, DWORD length, DWORD isDir) {
+    static const char * HEX = "0123456789ABCDEF";
+    DWORD utf8Length = WideCharToMultiByte(CP_UTF8, 0, path, length, NULL, 0, NULL, NULL);
+    char * utf8 = newpChar(utf8Length + 1);
+    DWORD i;
+    
+    WideCharToMultiByte(CP_UTF8, 0, path, length, utf8, utf8Length, NULL, NULL);
+    // C:\dir -> file:/C:/dir, \\server\share -> file://server/share
+    appendToBuilderN(sb, "file:", 5);
+    if(!(length > 1 && path[0]==L'\\' && path[1]==L'\\')) {
+        appendToBuilderN(sb, "/", 1);
+    }
+    reserveStringBuilder(sb, utf8Length * 3 + 1);
+    for(i=0;i<utf8Length;i++) {
+        char c = utf8[i];
+        if((c>='a' && c<='z') || (c>='A' && c<='Z') || (c>='0' && c<='9') ||
+                c=='-' || c=='.' || c=='_' || c=='~' || c==':' || c=='/') {
+            appendToBuilderN(sb, &c, 1);
+        } else if(c=='\\') {
+            appendToBuilderN(sb, "/", 1);
+        } else {
+            char escaped[3];
+            escaped[0] = '%';
+            escaped[1] = HEX[((BYTE) c) >> 4];
+            escaped[2] = HEX[((BYTE) c) & 0xF];
+            appendToBuilderN(sb, escaped, 3);
+        }
+    }
+    if(isDir && (sb->length == 0 || sb->buffer[sb->length - 1]!='/')) {
+        appendToBuilderN(sb, "/", 1);
+    }
+    FREE(utf8);
+}
+
+void appendZipNumber(StringBuilder * sb, DWORD value, DWORD bytes) {
+    char buf[4];
+    DWORD i;
+    for(i=0;i<bytes;i++) {
+        buf[i] = (char) ((value >> (i * 8)) & 0xFF);
+    }
+    appendToBuilderN(sb, buf, bytes);
+}
+
+// zip headers of the single stored entry, local one if offset is (DWORD) -1
+void appendZipHeader(StringBuilder * sb, const char * name, DWORD crc, DWORD size, DWORD offset) {
+    DWORD isLocal = (offset == (DWORD) -1);
+    appendZipNumber(sb, isLocal ? 0x04034b50 : 0x02014b50, 4);
+    if(!isLocal) {
+        appendZipNumber(sb, 20, 2);      // version made by
+    }
+    appendZipNumber(sb, 20, 2);          // version needed
+    appendZipNumber(sb, 0, 2);           // flags
+    appendZipNumber(sb, 0, 2);           // stored
+    appendZipNumber(sb, 0, 2);           // time
+    appendZipNumber(sb, 0x21, 2);        // date : 1980-01-01
+    appendZipNumber(sb, crc, 4);
+    appendZipNumber(sb, size, 4);
+    appendZipNumber(sb, size, 4);
+    appendZipNumber(sb, getLengthA(name), 2);
+    appendZipNumber(sb, 0, 2);           // extra
+    if(!isLocal) {
+        appendZipNumber(sb, 0, 2);       // comment
+        appendZipNumber(sb, 0, 2);       // disk
+        appendZipNumber(sb, 0, 2);       // internal attributes
+        appendZipNumber(sb, 0, 4);       // external attributes
+        appendZipNumber(sb, offset, 4);
+    }
+    appendToBuilder(sb, name);
+}
+
+// a jar with just a manifest, its Class-Path lists the classpath entries as URLs.
+// It works with every JVM and has no length limit
+DWORD writePathingJar(LauncherProperties * props, WCHAR * path, WCHAR * classpath) {
+    static const char * MANIFEST_NAME = "META-INF/MANIFEST.MF";
+    StringBuilder value;
+    StringBuilder manifest;
+    StringBuilder jar;
+    WCHAR * entry = classpath;
+    DWORD crc = -1L;
+    DWORD centralOffset;
+    DWORD centralSize;
+    DWORD i;
+    DWORD result;
+    
+    initStringBuilder(&value, getLengthW(classpath) * 2 + 64);
+    appendToBuilder(&value, "Class-Path:");
+    while(entry!=NULL && *entry!=0) {
+        WCHAR * end = searchW(entry, CLASSPATH_SEPARATOR);
+        DWORD length = (end!=NULL) ? (DWORD) (end - entry) : getLengthW(entry);
+        if(length > 0) {
+            WCHAR * element = appendStringNW(NULL, 0, entry, length);
+            appendToBuilderN(&value, " ", 1);
+            appendFileURL(&value, element, length, isDirectory(element));
+            FREE(element);
+        }
+        entry = (end!=NULL) ? end + 1 : NULL;
+    }
+    
+    // manifest lines are at most 72 bytes, continuation lines start with a space
+    initStringBuilder(&manifest, value.length + value.length / 70 * 3 + 64);
+    appendToBuilder(&manifest, "Manifest-Version: 1.0\r\n");
+    for(i=0;i<value.length;) {
+        DWORD chunk = (i==0) ? 72 : 71;
+        if(chunk > value.length - i) {
+            chunk = value.length - i;
+        }
+        if(i > 0) {
+            appendToBuilderN(&manifest, " ", 1);
+        }
+        appendToBuilderN(&manifest, value.buffer + i, chunk);
+        appendToBuilderN(&manifest, "\r\n", 2);
+        i += chunk;
+    }
+    appendToBuilderN(&manifest, "\r\n", 2);
+    freeStringBuilder(&value);
+    
+    update_crc32(&crc, manifest.buffer, manifest.length);
+    crc = ~crc;
+    
+    initStringBuilder(&jar, manifest.length + 256);
+    appendZipHeader(&jar, MANIFEST_NAME, crc, manifest.length, (DWORD) -1);
+    appendToBuilderN(&jar, manifest.buffer, manifest.length);
+    centralOffset = jar.length;
+    appendZipHeader(&jar, MANIFEST_NAME, crc, manifest.length, 0);
+    centralSize = jar.length - centralOffset;
+    // end of central directory
+    appendZipNumber(&jar, 0x06054b50, 4);
+    appendZipNumber(&jar, 0, 2);
+    appendZipNumber(&jar, 0, 2);
+    appendZipNumber(&jar, 1, 2);
+    appendZipNumber(&jar, 1, 2);
+    appendZipNumber(&jar, centralSize, 4);
+    appendZipNumber(&jar, centralOffset, 4);
+    appendZipNumber(&jar, 0, 2);
+    freeStringBuilder(&manifest);
+    
+    result = writeBytesToFile(props, path, jar.buffer, jar.length);
+    freeStringBuilder(&jar);
+    return result;
+}
+
+// Part of the JNI invocation API needed to run the main class in the launcher
+// process. jni.h is not available to the launcher build, the slots of the
+// function tables are fixed by the JNI specification.
+#define JNI_OK          0
+#define JNI_VERSION_1_2 0x00010002
+#define JNICALL __stdcall
+
+typedef long jint;
+typedef void * jobject;
+typedef void * jmethodID;
+typedef void * const * JNIEnv;
+typedef void * const * JavaVM;
+typedef union {
+    jobject l;
+    __int64 j;
+} jvalue;
+typedef struct {
+    char * optionString;
+    void * extraInfo;
+} JavaVMOption;
+typedef struct {
+    jint version;
+    jint nOptions;
+    JavaVMOption * options;
+    unsigned char ignoreUnrecognized;
+} JavaVMInitArgs;
+
+#define JNI_FIND_CLASS               6
+#define JNI_EXCEPTION_OCCURRED      15
+#define JNI_EXCEPTION_DESCRIBE      16
+#define JNI_GET_STATIC_METHOD_ID   113
+#define JNI_CALL_STATIC_VOID_METHOD 143
+#define JNI_NEW_STRING             163
+#define JNI_NEW_OBJECT_ARRAY       172
+#define JNI_SET_OBJECT_ARRAY_ELEMENT 174
+#define JVM_DESTROY_JAVA_VM          3
+#define JVM_DETACH_CURRENT_THREAD    5
+
+typedef jint (JNICALL * CreateJavaVMFunction)(JavaVM **, void **, void *);
+typedef jobject (JNICALL * FindClassFunction)(JNIEnv *, const char *);
+typedef jobject (JNICALL * ExceptionOccurredFunction)(JNIEnv *);
+typedef void (JNICALL * ExceptionDescribeFunction)(JNIEnv *);
+typedef jmethodID (JNICALL * GetStaticMethodIDFunction)(JNIEnv *, jobject, const char *, const char *);
+typedef void (JNICALL * CallStaticVoidMethodFunction)(JNIEnv *, jobject, jmethodID, const jvalue *);
+typedef jobject (JNICALL * NewStringFunction)(JNIEnv *, const WCHAR *, jint);
+typedef jobject (JNICALL * NewObjectArrayFunction)(JNIEnv *, jint, jobject, jobject);
+typedef void (JNICALL * SetObjectArrayElementFunction)(JNIEnv *, jobject, jint, jobject);
+typedef jint (JNICALL * JavaVMFunction)(JavaVM *);
+
+#define JNI_FUNCTION(env, type, slot) ((type) (*(env))[slot])
+
+const WCHAR * JVM_DLL_SUFFIXES [] = {
+    L"\\bin\\server\\jvm.dll",
+    L"\\bin\\client\\jvm.dll",
+    L"\\jre\\bin\\server\\jvm.dll",
+    L"\\jre\\bin\\client\\jvm.dll",
+};
+
+typedef struct _inProcessJava {
+    LauncherProperties * props;
+    HMODULE jvm;
+    JavaVMInitArgs args;
+    char * mainClass;
+    DWORD attempted;
+    DWORD created;
+} InProcessJava;
+
+static HANDLE inProcessExitEvent = NULL;
+static volatile LONG inProcessExitCode = 0;
+
+static void JNICALL exitInProcessJava(jint code) {
+    // System.exit() : the VM is stopped and waits here while the launcher
+    // cleans up, the process exits when the launcher has finished
+    inProcessExitCode = code;
+    SetEvent(inProcessExitEvent);
+    Sleep(INFINITE);
+}
+
+static char * toJavaOption(const WCHAR * name, const WCHAR * value) {
+    WCHAR * option = appendStringW(appendStringW(NULL, name), value);
+    DWORD length = getLengthW(option);
+    BOOL lossy = FALSE;
+    char * result = NULL;
+    DWORD size = WideCharToMultiByte(CP_ACP, WC_NO_BEST_FIT_CHARS, option, length, NULL, 0, NULL, &lossy);
+    if(!lossy) {
+        // the VM expects options in the platform encoding
+        result = newpChar(size + 1);
+        WideCharToMultiByte(CP_ACP, WC_NO_BEST_FIT_CHARS, option, length, result, size, NULL, NULL);
+    }
+    FREE(option);
+    return result;
+}
+
+static HMODULE loadJVMLibrary(LauncherProperties * props, WCHAR * javaHome) {
+    DWORD number = sizeof(JVM_DLL_SUFFIXES)/sizeof(WCHAR*);
+    HMODULE jvm = NULL;
+    DWORD i;
+    
+    for(i=0;i<number && jvm==NULL;i++) {
+        WCHAR * path = getJavaResource(javaHome, JVM_DLL_SUFFIXES[i]);
+        if(fileExists(path)) {
+            // runtime libraries the VM depends on are placed in the bin directory
+            WCHAR * typeDir = getParentDirectory(path);
+            WCHAR * binDir = getParentDirectory(typeDir);
+            writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... loading ", 0);
+            writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, path, 1);
+            SetDllDirectoryW(binDir);
+            jvm = LoadLibraryExW(path, NULL, LOAD_WITH_ALTERED_SEARCH_PATH);
+            if(jvm==NULL) {
+                // e.g. a 64-bit VM can`t be loaded to the 32-bit launcher
+                writeErrorA(props, OUTPUT_LEVEL_DEBUG, 1, "... can`t load ", path, GetLastError());
+            }
+            SetDllDirectoryW(NULL);
+            FREE(typeDir);
+            FREE(binDir);
+        }
+        FREE(path);
+    }
+    return jvm;
+}
+
+static DWORD WINAPI runInProcessJava(LPVOID param) {
+    InProcessJava * java = (InProcessJava *) param;
+    LauncherProperties * props = java->props;
+    CreateJavaVMFunction createJavaVM = (CreateJavaVMFunction) GetProcAddress(java->jvm, "JNI_CreateJavaVM");
+    JavaVM * vm = NULL;
+    JNIEnv * env = NULL;
+    jobject mainClass = NULL;
+    jmethodID mainMethod = NULL;
+    DWORD exitCode = 1;
+    
+    if(createJavaVM==NULL) {
+        return exitCode;
+    }
+    java->attempted = 1;
+    if(createJavaVM(&vm, (void **) &env, &java->args)!=JNI_OK) {
+        return exitCode;
+    }
+    java->created = 1;
+    
+    mainClass = JNI_FUNCTION(env, FindClassFunction, JNI_FIND_CLASS)(env, java->mainClass);
+    if(mainClass!=NULL) {
+        mainMethod = JNI_FUNCTION(env, GetStaticMethodIDFunction, JNI_GET_STATIC_METHOD_ID)(env, mainClass, "main", "([Ljava/lang/String;)V");
+    }
+    if(mainMethod!=NULL) {
+        jobject stringClass = JNI_FUNCTION(env, FindClassFunction, JNI_FIND_CLASS)(env, "java/lang/String");
+        jobject arguments = (stringClass==NULL) ? NULL :
+            JNI_FUNCTION(env, NewObjectArrayFunction, JNI_NEW_OBJECT_ARRAY)(env, props->appArguments->size, stringClass, NULL);
+        DWORD i;
+        for(i=0;arguments!=NULL && i<props->appArguments->size;i++) {
+            WCHAR * arg = props->appArguments->items[i];
+            jobject string = JNI_FUNCTION(env, NewStringFunction, JNI_NEW_STRING)(env, arg, getLengthW(arg));
+            if(string==NULL) {
+                arguments = NULL;
+                break;
+            }
+            JNI_FUNCTION(env, SetObjectArrayElementFunction, JNI_SET_OBJECT_ARRAY_ELEMENT)(env, arguments, i, string);
+        }
+        if(arguments!=NULL) {
+            jvalue value;
+            value.l = arguments;
+            JNI_FUNCTION(env, CallStaticVoidMethodFunction, JNI_CALL_STATIC_VOID_METHOD)(env, mainClass, mainMethod, &value);
+        }
+    }
+    if(JNI_FUNCTION(env, ExceptionOccurredFunction, JNI_EXCEPTION_OCCURRED)(env)!=NULL) {
+        JNI_FUNCTION(env, ExceptionDescribeFunction, JNI_EXCEPTION_DESCRIBE)(env);
+    } else if(mainMethod!=NULL) {
+        exitCode = 0;
+    }
+    
+    // waits for all non-daemon threads of the application
+    JNI_FUNCTION(vm, JavaVMFunction, JVM_DETACH_CURRENT_THREAD)(vm);
+    JNI_FUNCTION(vm, JavaVMFunction, JVM_DESTROY_JAVA_VM)(vm);
+    return exitCode;
+}
+
+DWORD executeMainClassInProcess(LauncherProperties * props) {
+    InProcessJava java;
+    JavaVMOption * options;
+    WCHAR * javaIOTmpdir;
+    DWORD number = props->jvmArguments->size + 3;
+    DWORD result = 0;
+    DWORD i;
+    
+    ZERO(&java, sizeof(InProcessJava));
+    java.props = props;
+    java.jvm = loadJVMLibrary(props, props->java->javaHome);
+    if(java.jvm==NULL) {
+        return 0;
+    }
+    
+    options = (JavaVMOption *) LocalAlloc(LPTR, sizeof(JavaVMOption) * number);
+    javaIOTmpdir = getParentDirectory(props->tmpDir);
+    options[0].optionString = toJavaOption(L"-Djava.io.tmpdir=", javaIOTmpdir);
+    for(i=0;i<props->jvmArguments->size;i++) {
+        options[i + 1].optionString = toJavaOption(props->jvmArguments->items[i], L"");
+    }
+    options[i + 1].optionString = toJavaOption(L"-Djava.class.path=", props->classpath);
+    options[i + 2].optionString = appendString(NULL, "exit");
+    options[i + 2].extraInfo = (void *) exitInProcessJava;
+    FREE(javaIOTmpdir);
+    
+    java.args.version = JNI_VERSION_1_2;
+    java.args.nOptions = number;
+    java.args.options = options;
+    java.args.ignoreUnrecognized = 0;
+    java.mainClass = toChar(props->mainClass);
+    for(i=0;java.mainClass[i]!='\0';i++) {
+        if(java.mainClass[i]=='.') java.mainClass[i] = '/';
+    }
+    
+    for(i=0;i<number;i++) {
+        if(options[i].optionString==NULL) {
+            writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... JVM options can`t be passed in the ANSI code page", 1);
+            break;
+        }
+    }
+    if(i==number) {
+        HANDLE thread;
+        DWORD threadId;
+        hideLauncherWindows(props);
+        inProcessExitEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+        thread = CreateThread(NULL, 0, &runInProcessJava, (LPVOID) &java, 0, &threadId);
+        if(thread!=NULL) {
+            HANDLE handles [2];
+            handles[0] = thread;
+            handles[1] = inProcessExitEvent;
+            if(WaitForMultipleObjects(2, handles, FALSE, INFINITE)==WAIT_OBJECT_0 + 1) {
+                props->exitCode = (DWORD) inProcessExitCode;
+            } else {
+                GetExitCodeThread(thread, &props->exitCode);
+            }
+            CloseHandle(thread);
+            // the java command is executed instead only if the VM could not be tried : a VM
+            // refusing its options has already reported why and java would report it again
+            result = java.attempted;
+            if(java.attempted && !java.created) {
+                writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "... JVM was not created, see its error output", 1);
+            }
+        }
+        CloseHandle(inProcessExitEvent);
+    } else {
+        FreeLibrary(java.jvm);
+    }
+    
+    for(i=0;i<number;i++) {
+        FREE(options[i].optionString);
+    }
+    FREE(options);
+    FREE(java.mainClass);
+    return result;
+}
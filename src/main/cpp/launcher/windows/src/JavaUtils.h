@@ -37,12 +37,34 @@ extern "C" {
 #define TEST_JAVA_PARAMETERS 5    
 #define MAX_LEN_VALUE_NAME 16383
 
+typedef struct _unpackJarsJobs {
+    LauncherProperties * props;
+    WCHAR ** files;
+    DWORD number;
+    WCHAR * unpack200exe;
+    volatile LONG next;
+    volatile LONG failed;
+    DWORD status;
+    DWORD exitCode;
+} UnpackJarsJobs;
+
+// a worker has its own properties, messages go to its buffers and are
+// written by the main thread after the join
+typedef struct _unpackJarsWorker {
+    UnpackJarsJobs * jobs;
+    LauncherProperties props;
+    StringBuilder output;
+    StringBuilder errors;
+} UnpackJarsWorker;
+
 WCHAR * getJavaResource(WCHAR * location, const WCHAR * suffix);
 
 void getJavaProperties(WCHAR * location, LauncherProperties * props, JavaProperties ** javaProps);
 
 void findSystemJava(LauncherProperties * props);
 
+DWORD hasBundledJVMs(LauncherProperties * props);
+
 JavaVersion * getJavaVersionFromString(char * string, DWORD * result);
 
 char compareJavaVersion(JavaVersion * first, JavaVersion * second);
@@ -55,7 +77,13 @@ void freeJavaProperties(JavaProperties ** props);
 
 void installJVM(LauncherProperties * props, LauncherResource *jvm);
 
-JavaCompatible * newJavaCompatible();
+JavaCompatible * newJavaCompatible(Arena * arena);
+
+DWORD writeJavaArgumentsFile(LauncherProperties * props, WCHAR * path, WCHAR ** args, DWORD number);
+
+DWORD writePathingJar(LauncherProperties * props, WCHAR * path, WCHAR * classpath);
+
+DWORD executeMainClassInProcess(LauncherProperties * props);
 
 #ifdef	__cplusplus
 }
@@ -28,8 +28,10 @@
 #include "RegistryUtils.h"
 #include "Launcher.h"
 #include "ProcessUtils.h"
+#include "SystemUtils.h"
 #include "StringUtils.h"
 #include "ExtractUtils.h"
+#include "Arena.h"
 #include "Main.h"
 #include "shlobj.h"
 
@@ -47,6 +49,8 @@ const WCHAR * helpOtherArg        = L"/?";
 const WCHAR * silentArg           = L"--silent";
 const WCHAR * nospaceCheckArg     = L"--nospacecheck";
 const WCHAR * localeArg           = L"--locale";
+const WCHAR * inProcessJavaArg    = L"--in-process-jvm";
+const WCHAR * deleteAfterExitArg  = L"--delete-after-exit"; // internal : <process handle> <directory>
 
 const WCHAR * javaParameterPrefix = L"-J";
 
@@ -54,6 +58,22 @@ const WCHAR * NEW_LINE            = L"\n";
 
 const WCHAR * CLASSPATH_SEPARATOR = L";";
 const WCHAR * CLASS_SUFFIX = L".class";
+const DWORD CLASSPATH_FILE_THRESHOLD = 8192;
+const WCHAR * JAVA_ARGUMENTS_FILE = L"\\java.args";
+const WCHAR * PATHING_JAR_FILE = L"\\classpath.jar";
+const long SHARED_ARCHIVE_MIN_JAVA = 13; // -XX:ArchiveClassesAtExit
+const long SHARED_ARCHIVE_AUTO_JAVA = 19; // -XX:+AutoCreateSharedArchive
+const WCHAR * SHARED_ARCHIVE_DIR = L"\\nbi-cds\\";
+const WCHAR * SHARED_ARCHIVE_SUFFIX = L".jsa";
+const DWORD SHARED_ARCHIVE_MAX_AGE = 30; // days since the last use of an archive directory
+const WCHAR * MEMORY_RULE_HEAP_PERCENT = L"-Dnbi.launcher.jvm.heap.percent=";
+const WCHAR * MEMORY_RULE_HEAP_MIN = L"-Dnbi.launcher.jvm.heap.min=";
+const WCHAR * MEMORY_RULE_HEAP_MAX = L"-Dnbi.launcher.jvm.heap.max=";
+const WCHAR * MEMORY_RULE_PROCESSORS = L"-Dnbi.launcher.jvm.processors=";
+const WCHAR * MEMORY_RULE_GC = L"-Dnbi.launcher.jvm.gc=";
+const DWORD SMALL_MACHINE_MEMORY = 1792; // MB
+const DWORD SMALL_MACHINE_PROCESSORS = 2;
+const DWORD MAX_HEAP_32BIT = 1200; // MB, what a 32-bit JVM can still reserve in one piece
 
 
 DWORD isLauncherArgument(LauncherProperties * props, WCHAR * value) {
@@ -72,7 +92,7 @@ DWORD getArgumentIndex(LauncherProperties * props, const WCHAR *arg, DWORD remov
     for(i=0;i<cmd->size;i++) {
         if(cmd->items[i]!=NULL) { // argument has not been cleaned yet
             if(lstrcmpW(arg, cmd->items[i])==0) { //argument is the same as the desired
-                if(removeArgument) FREE(cmd->items[i]); // free it .. we don`t need it anymore
+                if(removeArgument) cmd->items[i] = NULL; // clean it .. we don`t need it anymore
                 return i;
             }
         }
@@ -93,7 +113,7 @@ WCHAR * getArgumentValue(LauncherProperties * props, const WCHAR *arg, DWORD rem
         //we have at least one more argument
         if(mandatory || !isLauncherArgument(props, cmd->items[i+1])) {
             result = appendStringW(NULL, cmd->items[i+1]);
-            if(removeArgument) FREE(cmd->items[i+1]);
+            if(removeArgument) cmd->items[i+1] = NULL;
         }
     }
     return result;
@@ -210,18 +230,24 @@ void checkExtractionStatus(LauncherProperties *props) {
 }
 
 
+// mark the location as checked, return 1 if it (or another name of the same directory) was checked before
+DWORD isLocationChecked(LauncherProperties * props, WCHAR * location) {
+    WCHAR * key = getLocationKey(location);
+    DWORD added = addStringToSet(props->alreadyCheckedJava, key);
+    FREE(key);
+    return !added;
+}
+
 void trySetCompatibleJava(WCHAR * location, LauncherProperties * props) {
     if(isTerminated(props)) return;
     if(location!=NULL) {
         JavaProperties * javaProps = NULL;
         
-        if(inList(props->alreadyCheckedJava, location)) {
+        if(isLocationChecked(props, location)) {
             writeMessageA(props, OUTPUT_LEVEL_NORMAL, 0, "... already checked location ", 0);
             writeMessageW(props, OUTPUT_LEVEL_NORMAL, 0, location, 1);
             // return here and don`t proceed with private jre checking since it`s already checked as well
             return;
-        } else {
-            props->alreadyCheckedJava = addStringToList(props->alreadyCheckedJava, location);
         }
         
         getJavaProperties(location, props, &javaProps);
@@ -255,12 +281,10 @@ void trySetCompatibleJava(WCHAR * location, LauncherProperties * props) {
             writeMessageA(props, OUTPUT_LEVEL_NORMAL, 0, "... check private jre at ", 0);
             writeMessageW(props, OUTPUT_LEVEL_NORMAL, 0, privateJre, 1);
             
-            if(inList(props->alreadyCheckedJava, privateJre)) {
+            if(isLocationChecked(props, privateJre)) {
                 writeMessageA(props, OUTPUT_LEVEL_NORMAL, 0, "... already checked location ", 0);
                 writeMessageW(props, OUTPUT_LEVEL_NORMAL, 0, privateJre, 1);
             } else {
-                props->alreadyCheckedJava = addStringToList(props->alreadyCheckedJava, privateJre);
-                
                 getJavaProperties(privateJre, props, &javaProps);
                 if(isOK(props)) {
                     writeMessageA(props, OUTPUT_LEVEL_NORMAL, 0, "... checking compatibility of private jre : ", 0);
@@ -321,14 +345,16 @@ void resolveTestJVM(LauncherProperties * props) {
         FREE(dir);
     }
     
-    FREE(props->testJVMFile->resolved);
-    props->testJVMFile->resolved = testJVMClassPath;
+    props->testJVMFile->resolved = moveToArenaW(props->arena, testJVMClassPath);
     writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... resolved   : ", 0);
     writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, props->testJVMFile->resolved, 1);
 }
 
-void findSuitableJava(LauncherProperties * props) {
-    if(!isOK(props)) return;
+// the error to show is returned in error and parameter, 0 if there is none.
+// Nothing is shown here so that the search can run out of the main thread
+DWORD searchSuitableJava(LauncherProperties * props, DWORD * error, const WCHAR ** parameter) {
+    DWORD failed = 0;
+    if(!isOK(props)) return 0;
     
     //resolve testJVM file
     resolveTestJVM(props);
@@ -336,9 +362,10 @@ void findSuitableJava(LauncherProperties * props) {
     if(!fileExists(props->testJVMFile->resolved)) {
         writeMessageA(props, OUTPUT_LEVEL_NORMAL, 1, "Can`t find TestJVM classpath : ", 0);
         writeMessageW(props, OUTPUT_LEVEL_NORMAL, 1, props->testJVMFile->resolved, 1);
-        showErrorW(props, JVM_NOT_FOUND_PROP, 1, javaArg);
+        * error = JVM_NOT_FOUND_PROP;
+        * parameter = javaArg;
         props->status = ERROR_JVM_NOT_FOUND;
-        return;
+        return 1;
     } else if(!isTerminated(props)) {
         
         // try to get java location from command line arguments
@@ -353,23 +380,26 @@ void findSuitableJava(LauncherProperties * props) {
             
             trySetCompatibleJava(props->userDefinedJavaHome, props);
             if( props->status == ERROR_JVM_NOT_FOUND || props->status == ERROR_JVM_UNCOMPATIBLE) {
-                const char * prop = (props->status == ERROR_JVM_NOT_FOUND) ?
+                * error = (props->status == ERROR_JVM_NOT_FOUND) ?
                     JVM_USER_DEFINED_ERROR_PROP :
                     JVM_UNSUPPORTED_VERSION_PROP;
-                    showErrorW(props, prop, 1, props->userDefinedJavaHome);
+                * parameter = props->userDefinedJavaHome;
+                failed = 1;
             }
         } else { // no user-specified java argument
             findSystemJava(props);
             if( props->java ==NULL) {
                 writeMessageA(props, OUTPUT_LEVEL_DEBUG, 1, "... no java was found", 1);
                 if(props->status == ERROR_BUNDLED_JVM_EXTRACTION) {
-                    showErrorW(props, BUNDLED_JVM_EXTRACT_ERROR_PROP, 1, javaArg);
+                    * error = BUNDLED_JVM_EXTRACT_ERROR_PROP;
                 } else if(props->status == ERROR_BUNDLED_JVM_VERIFICATION) {
-                    showErrorW(props, BUNDLED_JVM_VERIFY_ERROR_PROP, 1, javaArg);
+                    * error = BUNDLED_JVM_VERIFY_ERROR_PROP;
                 } else {
-                    showErrorW(props, JVM_NOT_FOUND_PROP, 1, javaArg);
+                    * error = JVM_NOT_FOUND_PROP;
                     props->status = ERROR_JVM_NOT_FOUND;
-                }                
+                }
+                * parameter = javaArg;
+                failed = 1;
             }
         }
         
@@ -380,118 +410,162 @@ void findSuitableJava(LauncherProperties * props) {
             writeMessageA(props, OUTPUT_LEVEL_NORMAL, 1, "No compatible jvm was found on the system", 1);
         }
     }
-    return;
+    return failed;
 }
 
+void findSuitableJava(LauncherProperties * props) {
+    DWORD error;
+    const WCHAR * parameter;
+    if(searchSuitableJava(props, &error, &parameter)) {
+        showErrorW(props, error, 1, parameter);
+    }
+}
 
 
-void resolveLauncherStringProperty(LauncherProperties * props, WCHAR ** result) {
-    if(*result!=NULL) {
-        WCHAR * propStart = searchW(*result, L"$P{");
-        if(propStart!=NULL) {
-            WCHAR * propEnd = searchW(propStart + 3, L"}");
-            if(propEnd!=NULL) {
-                WCHAR * propName;
-                writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... resolving string property", 1);
-                propName = appendStringNW(NULL, 0, propStart + 3 ,
-                        getLengthW(propStart + 3) - getLengthW(propEnd));
-                writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... property name is : ", 0);
-                writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, propName, 1);
-                
-                if(propName!=NULL) {
-                    char * name = toChar(propName);
-                    const WCHAR * propValue = getI18nProperty(props, name);
-                    if(propValue!=NULL) {
-                        WCHAR * tmp = appendStringNW(NULL, 0, *result, getLengthW(*result) - getLengthW(propStart));
-                        tmp = appendStringW(tmp, propValue); 
-                        tmp = appendStringW(tmp, propEnd + 1);
-                        FREE(*result);
-                        *result = tmp;
-                    }
-                    FREE(name);
-                    FREE(propName);
-                }
+
+DWORD isPropertyName(const WCHAR * name, DWORD length, const WCHAR * expected) {
+    DWORD i;
+    for(i=0;i<length;i++) {
+        if(expected[i]!=name[i]) return 0;
+    }
+    return expected[length]==0;
+}
+
+// $L{...} : values known by the launcher, not copied
+const WCHAR * getLauncherPropertyValue(LauncherProperties * props, const WCHAR * name, DWORD length) {
+    if(isPropertyName(name, length, L"nbi.launcher.tmp.dir")) {
+        return props->tmpDir; // launcher tmpdir
+    } else if(isPropertyName(name, length, L"nbi.launcher.java.home")) {
+        // relative to javahome
+        return (props->java!=NULL) ? props->java->javaHome : NULL;
+    } else if(isPropertyName(name, length, L"nbi.launcher.user.home")) {
+        // asking the system once is enough
+        if(props->userHome==NULL) {
+            props->userHome = getCurrentUserHome();
+        }
+        return props->userHome;
+    } else if(isPropertyName(name, length, L"nbi.launcher.parent.dir")) {
+        return props->exeDir; // launcher parent
+    }
+    return NULL;
+}
+
+// $P{...} : i18n strings
+const WCHAR * getStringPropertyValue(LauncherProperties * props, const WCHAR * name, DWORD length) {
+    char * propName = toCharN(name, length);
+    const WCHAR * value = getI18nPropertyByName(props, propName);
+    FREE(propName);
+    return value;
+}
+
+// placeholder being expanded, the chain goes to the outermost one
+typedef struct _resolvingName {
+    WCHAR type;
+    const WCHAR * name;
+    DWORD length;
+    struct _resolvingName * outer;
+} ResolvingName;
+
+DWORD isBeingResolved(ResolvingName * resolving, WCHAR type, const WCHAR * name, DWORD length) {
+    for(; resolving!=NULL; resolving = resolving->outer) {
+        if(resolving->type==type && resolving->length==length) {
+            DWORD i = 0;
+            while(i < length && resolving->name[i]==name[i]) {
+                i++;
+            }
+            if(i==length) {
+                return 1;
             }
         }
     }
+    return 0;
 }
 
-void resolveLauncherProperties(LauncherProperties * props, WCHAR **result) {
-    if(*result != NULL) {
-        WCHAR * propStart = searchW(*result, L"$L{");
-        if(propStart!=NULL) {
-            WCHAR * propEnd = searchW(propStart + 3, L"}");
-            if(propEnd!=NULL) {
-                WCHAR * propName = appendStringNW(NULL, 0, propStart + 3 , getLengthW(propStart + 3) - getLengthW(propEnd));
-                if(propName!=NULL) {
-                    WCHAR * propValue = NULL;
-                    
-                    if(lstrcmpW(propName, L"nbi.launcher.tmp.dir")==0) {
-                        propValue = appendStringW(NULL, props->tmpDir); // launcher tmpdir
-                    } else if(lstrcmpW(propName, L"nbi.launcher.java.home")==0) {
-                        if(props->java!=NULL) {
-                            propValue  = appendStringW(NULL, props->java->javaHome); // relative to javahome
-                        }
-                    } else if(lstrcmpW(propName, L"nbi.launcher.user.home")==0) {
-                        propValue = getCurrentUserHome();
-                    } else if(lstrcmpW(propName, L"nbi.launcher.parent.dir")==0) {
-                        propValue = appendStringW(NULL, props->exeDir); // launcher parent
-                    }
-                    
-                    
-                    if(propValue!=NULL) {
-                        WCHAR * tmp = appendStringNW(NULL, 0, *result, getLengthW(*result) - getLengthW(propStart));
-                        tmp = appendStringW(tmp, propValue);
-                        tmp = appendStringW(tmp, propEnd + 1);                        
-                        FREE(*result);
-                        FREE(propValue);
-                        *result = tmp;
-                    }
+// expands the placeholders in one pass, the values are expanded recursively;
+// a placeholder met again within its own value is kept as written
+void appendResolvedString(LauncherProperties * props, StringBuilderW * sb, const WCHAR * str, ResolvingName * resolving) {
+    const WCHAR * ptr = str;
+    while(ptr!=NULL && *ptr!=0) {
+        const WCHAR * run = ptr + 1;
+        if(ptr[0]==L'$' && (ptr[1]==L'L' || ptr[1]==L'P') && ptr[2]==L'{') {
+            const WCHAR * name = ptr + 3;
+            const WCHAR * end = name;
+            while(*end!=0 && *end!=L'}') {
+                end++;
+            }
+            if(*end==L'}') {
+                DWORD length = (DWORD) (end - name);
+                const WCHAR * value = NULL;
+                if(!isBeingResolved(resolving, ptr[1], name, length)) {
+                    value = (ptr[1]==L'L') ?
+                        getLauncherPropertyValue(props, name, length) :
+                        getStringPropertyValue(props, name, length);
+                }
+                if(value!=NULL) {
+                    ResolvingName current;
+                    current.type = ptr[1];
+                    current.name = name;
+                    current.length = length;
+                    current.outer = resolving;
+                    appendResolvedString(props, sb, value, &current);
+                    ptr = end + 1;
+                    continue;
                 }
             }
         }
+        // unknown and recursive placeholders are kept as is
+        while(*run!=0 && *run!=L'$') {
+            run++;
+        }
+        appendToBuilderNW(sb, ptr, (DWORD) (run - ptr));
+        ptr = run;
     }
-    
 }
 
 void resolveString(LauncherProperties * props, WCHAR ** result) {
-    WCHAR * tmp = NULL;
+    StringBuilderW sb;
     
+    if(*result==NULL || searchW(*result, L"$")==NULL) {
+        return; // nothing to resolve, keep the string
+    }
     writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "Resolving string : ", 0);
     writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, *result, 1);
-    do {
-        FREE(tmp);
-        tmp = appendStringW(NULL, *result);
-        //writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... step 1 : ", 0);
-        //writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, *result, 1);
-        resolveLauncherProperties(props, result);
-        //writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... step 2 : ", 0);
-        //writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, *result, 1);
-        resolveLauncherStringProperty(props, result);
-        //writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... step 3 : ", 0);
-        //writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, *result, 1);
-    } while(lstrcmpW(tmp, *result)!=0);
-    
-    FREE(tmp);
+    
+    initStringBuilderW(&sb, getLengthW(*result) + MAX_PATH);
+    appendResolvedString(props, &sb, *result, NULL);
+    FREE(*result);
+    *result = finishStringBuilderW(&sb);
     
     writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, ".... resolved : ", 0);
     writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, *result, 1);
 }
 
+// for the strings of the launcher arena, the resolved string is put there too
+void resolveArenaString(LauncherProperties * props, WCHAR ** str) {
+    WCHAR * resolved;
+    
+    if(*str==NULL || searchW(*str, L"$")==NULL) return;
+    resolved = appendStringW(NULL, *str);
+    resolveString(props, &resolved);
+    *str = moveToArenaW(props->arena, resolved);
+}
+
 void resolvePath(LauncherProperties * props, LauncherResource * file) {
+    WCHAR * resolved;
     DWORD i;
     
     if(file==NULL) return;
     if(file->resolved!=NULL) return;
     
-    file->resolved = appendStringW(NULL, file->path);
-    resolveString(props, & (file->resolved));
+    resolved = appendStringW(NULL, file->path);
+    resolveString(props, &resolved);
     
-    for(i=0;i<getLengthW(file->resolved);i++) {
-        if(file->resolved[i]==L'/') {
-            file->resolved[i]=L'\\';
+    for(i=0;i<getLengthW(resolved);i++) {
+        if(resolved[i]==L'/') {
+            resolved[i]=L'\\';
         }
     }
+    file->resolved = moveToArenaW(props->arena, resolved);
 }
 
 void setClasspathElements(LauncherProperties * props) {
@@ -499,6 +573,8 @@ void setClasspathElements(LauncherProperties * props) {
         WCHAR * preCP = NULL;
         WCHAR * appCP = NULL;
         WCHAR *tmp = NULL;
+        StringBuilderW classpath;
+        DirectoryListing * listing = NULL;
         DWORD i = 0 ;
         
         writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "Modifying classpath ...", 1);
@@ -517,32 +593,41 @@ void setClasspathElements(LauncherProperties * props) {
         }
         
         
+        initStringBuilderW(&classpath, 0);
+        appendToBuilderW(&classpath, props->classpath);
+        FREE(props->classpath);
+        
+        listing = newDirectoryListing();
         for(i=0;i<props->jars->size;i++) {
             WCHAR * resolvedCpEntry = NULL;
             resolvePath(props, props->jars->items[i]);
             resolvedCpEntry = props->jars->items[i]->resolved;
-            if(!fileExists(resolvedCpEntry)) {
+            if(!fileExistsInListing(listing, resolvedCpEntry)) {
                 props->status = EXTERNAL_RESOURCE_MISSING;
                 showErrorW(props, EXTERNAL_RESOURE_LACK_PROP, 1, resolvedCpEntry);
+                props->classpath = finishStringBuilderW(&classpath);
+                freeDirectoryListing(&listing);
                 return;
             }
-            if (props->classpath != NULL) {
-                props->classpath = appendStringW(props->classpath, CLASSPATH_SEPARATOR);
+            if (classpath.length > 0) {
+                appendToBuilderW(&classpath, CLASSPATH_SEPARATOR);
             }
-            props->classpath = appendStringW(props->classpath, resolvedCpEntry);
+            appendToBuilderW(&classpath, resolvedCpEntry);
         }
+        freeDirectoryListing(&listing);
         
         // add some libraries to the end of the classpath
         while((appCP = getArgumentValue(props, classPathAppend, 1, 1))!=NULL) {
             writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... adding entry to the end of classpath : ", 0);
             writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, appCP, 1);
-            if (props->classpath != NULL) {
-                props->classpath = appendStringW(props->classpath, CLASSPATH_SEPARATOR);
+            if (classpath.length > 0) {
+                appendToBuilderW(&classpath, CLASSPATH_SEPARATOR);
             }
             resolveString(props, &appCP);
-            props->classpath = appendStringW(props->classpath, appCP);
+            appendToBuilderW(&classpath, appCP);
             FREE(appCP);
         }
+        props->classpath = finishStringBuilderW(&classpath);
         
         writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... finished", 1);
     }
@@ -578,20 +663,24 @@ void setAdditionalArguments(LauncherProperties * props) {
         if(jArg>0) {
             int size = jArg + props->jvmArguments->size;
             writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, DWORDtoCHAR(size), 1);
-            javaArgs = newppWCHAR(jArg + props->jvmArguments->size);
+            javaArgs = (WCHAR **) arenaAlloc(props->arena, sizeof(WCHAR *) * (jArg + props->jvmArguments->size));
+            if(javaArgs==NULL) {
+                props->status = EXIT_CODE_SYSTEM_ERROR;
+                return;
+            }
             for (i=0;i<props->jvmArguments->size;i++) {
                 javaArgs[i] = props->jvmArguments->items[i];
             }
-            FREE(props->jvmArguments->items);
+            props->jvmArguments->items = NULL;
             
             // cont. handle DefaultUserDirRoot, DefaultCacheDirRoot
             // * add -Dnetbeans.default_userdir_root
             // * add -Dnetbeans.default_cachedir_root
-            javaArgs[i-2] = appendStringW(toWCHAR("-Dnetbeans.default_userdir_root="), props->defaultUserDirRoot);
+            javaArgs[i-2] = moveToArenaW(props->arena, appendStringW(toWCHAR("-Dnetbeans.default_userdir_root="), props->defaultUserDirRoot));
             writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "Added an JVM argument: ", 0);
             writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, javaArgs[i-2], 1);
             
-            javaArgs[i-1] = appendStringW(toWCHAR("-Dnetbeans.default_cachedir_root="), props->defaultCacheDirRoot);
+            javaArgs[i-1] = moveToArenaW(props->arena, appendStringW(toWCHAR("-Dnetbeans.default_cachedir_root="), props->defaultCacheDirRoot));
             writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "Added an JVM argument: ", 0);
             writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, javaArgs[i-1], 1);
         } else {
@@ -599,11 +688,15 @@ void setAdditionalArguments(LauncherProperties * props) {
         }
         
         if(aArg>0) {
-            appArgs = newppWCHAR(aArg + props->appArguments->size);
+            appArgs = (WCHAR **) arenaAlloc(props->arena, sizeof(WCHAR *) * (aArg + props->appArguments->size));
+            if(appArgs==NULL) {
+                props->status = EXIT_CODE_SYSTEM_ERROR;
+                return;
+            }
             for (i=0; i < props->appArguments->size; i++) {
                 appArgs [i]= props->appArguments->items[i];
             }
-            FREE(props->appArguments->items);
+            props->appArguments->items = NULL;
         } else {
             appArgs = NULL;
         }
@@ -612,17 +705,17 @@ void setAdditionalArguments(LauncherProperties * props) {
         for(i=0;i<cmd->size;i++) {
             if(cmd->items[i]!=NULL) {
                 if(searchW(cmd->items[i], javaParameterPrefix)!=NULL) {
-                    javaArgs [ props->jvmArguments->size + jArg] = appendStringW(NULL, cmd->items[i] + getLengthW(javaParameterPrefix));
+                    javaArgs [ props->jvmArguments->size + jArg] = arenaCopyW(props->arena, cmd->items[i] + getLengthW(javaParameterPrefix));
                     writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... adding JVM argument : ", 0);
                     writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, javaArgs [ props->jvmArguments->size + jArg], 1);
                     jArg ++ ;
                 } else {
-                    appArgs  [ props->appArguments->size + aArg] = appendStringW(NULL, cmd->items[i]);
+                    appArgs  [ props->appArguments->size + aArg] = arenaCopyW(props->arena, cmd->items[i]);
                     writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... adding APP argument : ", 0);
                     writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, appArgs  [ props->appArguments->size + aArg], 1);
                     aArg++;
                 }
-                FREE(cmd->items[i]);
+                cmd->items[i] = NULL;
             }
         }
         props->appArguments->size  = props->appArguments->size + aArg;
@@ -631,20 +724,400 @@ void setAdditionalArguments(LauncherProperties * props) {
         if(props->appArguments->items==NULL) props->appArguments->items = appArgs;
         writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... resolving jvm arguments", 1);
         for(i=0;i<props->jvmArguments->size;i++) {
-            resolveString(props, &props->jvmArguments->items[i]);
+            resolveArenaString(props, &props->jvmArguments->items[i]);
         }
         writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... resolving app arguments", 1);
         for(i=0;i<props->appArguments->size;i++) {
-            resolveString(props, &props->appArguments->items[i]);
+            resolveArenaString(props, &props->appArguments->items[i]);
         }
         writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... finished parsing parameters", 1);
     }
 }
-void appendCommandLineArgument( WCHAR ** command, const WCHAR * arg) {    
-    WCHAR * escapedString = escapeString(arg);
-    *command = appendStringW(*command, escapedString);
-    FREE(escapedString);
-    *command = appendStringW(*command, L" ");    
+// arg is moved to the launcher arena with the list
+void addJvmArgument(LauncherProperties * props, WCHAR * arg) {
+    WCHARList * list = props->jvmArguments;
+    WCHAR ** items = (WCHAR **) arenaAlloc(props->arena, sizeof(WCHAR *) * (list->size + 1));
+    DWORD i;
+    if(items==NULL) {
+        props->status = EXIT_CODE_SYSTEM_ERROR;
+        FREE(arg);
+        return;
+    }
+    for(i=0;i<list->size;i++) {
+        items[i] = list->items[i];
+    }
+    items[list->size] = moveToArenaW(props->arena, arg);
+    list->items = items;
+    list->size++;
+    writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "Added an JVM argument: ", 0);
+    writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, items[list->size - 1], 1);
+}
+
+DWORD hasSharedArchiveOption(WCHARList * list) {
+    DWORD i;
+    for(i=0;i<list->size;i++) {
+        WCHAR * item = list->items[i];
+        if(item!=NULL && (searchW(item, L"SharedArchiveFile")!=NULL ||
+                searchW(item, L"ArchiveClassesAtExit")!=NULL ||
+                searchW(item, L"-Xshare:off")!=NULL)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+WCHAR * getJvmArgumentValue(LauncherProperties * props, const WCHAR * prefix) {
+    DWORD length = getLengthW(prefix);
+    DWORD i;
+    for(i=0;i<props->jvmArguments->size;i++) {
+        WCHAR * item = props->jvmArguments->items[i];
+        if(item!=NULL && getLengthW(item) >= length && CompareStringW(LOCALE_INVARIANT, 0, item, length, prefix, length)==CSTR_EQUAL) {
+            return item + length;
+        }
+    }
+    return NULL;
+}
+
+DWORD getJvmArgumentNumber(LauncherProperties * props, const WCHAR * prefix, DWORD defaultValue) {
+    WCHAR * value = getJvmArgumentValue(props, prefix);
+    DWORD result = 0;
+    if(value==NULL || *value==0) {
+        return defaultValue;
+    }
+    for(;*value>=L'0' && *value<=L'9';value++) {
+        result = result * 10 + (*value - L'0');
+    }
+    return result;
+}
+
+DWORD hasGCArgument(LauncherProperties * props) {
+    DWORD i;
+    for(i=0;i<props->jvmArguments->size;i++) {
+        WCHAR * item = props->jvmArguments->items[i];
+        DWORD length = getLengthW(item);
+        if(length > 2 && searchW(item, L"-XX:+Use")==item && lstrcmpW(item + length - 2, L"GC")==0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// -XX:ActiveProcessorCount exists since 10 and was backported to 8u191,
+// older JVMs refuse to start with it
+DWORD isActiveProcessorCountSupported(JavaVersion * version) {
+    JavaVersion java8u191 = {1, 8, 0, 191, ""};
+    if(version==NULL) return 0;
+    if(version->major >= 10) return 1;
+    return version->major==1 && version->minor==8 && compareJavaVersion(version, &java8u191) >= 0;
+}
+
+DWORD is32BitJava(JavaProperties * java) {
+    // x86, i386 ... i686, but not x86_64 or amd64
+    return java!=NULL && java->osArch!=NULL &&
+            searchA(java->osArch, "86")!=NULL && searchA(java->osArch, "64")==NULL;
+}
+
+// The payload declares the heap, processors and GC rules as system properties,
+// the options are computed from the memory and processors this process may use.
+// JVM options set by the payload itself or by the user with -J are kept as they are.
+void setMemoryArguments(LauncherProperties * props) {
+    DWORD percent;
+    DWORD heapMin;
+    DWORD heapMax;
+    DWORD memory;
+    DWORD processors;
+    WCHAR * gc;
+    
+    if(!isOK(props)) return;
+    
+    percent = getJvmArgumentNumber(props, MEMORY_RULE_HEAP_PERCENT, 0);
+    heapMin = getJvmArgumentNumber(props, MEMORY_RULE_HEAP_MIN, 0);
+    heapMax = getJvmArgumentNumber(props, MEMORY_RULE_HEAP_MAX, 0);
+    gc = getJvmArgumentValue(props, MEMORY_RULE_GC);
+    if(percent==0 && heapMin==0 && heapMax==0 && gc==NULL && getJvmArgumentValue(props, MEMORY_RULE_PROCESSORS)==NULL) {
+        return;
+    }
+    
+    memory = getAvailableMemory();
+    processors = getAvailableProcessors();
+    writeDWORD(props, OUTPUT_LEVEL_DEBUG, 0, "Available memory, MB : ", memory, 1);
+    writeDWORD(props, OUTPUT_LEVEL_DEBUG, 0, "Available processors : ", processors, 1);
+    
+    if(getJvmArgumentValue(props, L"-Xmx")==NULL && getJvmArgumentValue(props, L"-XX:MaxRAMPercentage")==NULL) {
+        DWORD heap = (DWORD) (((DWORDLONG) memory * percent) / 100);
+        if(heapMax > 0 && (heap==0 || heap > heapMax)) {
+            heap = heapMax;
+        }
+        if(heap > 0 && heap < heapMin) {
+            heap = heapMin;
+        }
+        if(heap > MAX_HEAP_32BIT && is32BitJava(props->java)) {
+            writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... maximum heap limited for a 32-bit JVM", 1);
+            heap = MAX_HEAP_32BIT;
+        }
+        if(heap > 0) {
+            WCHAR * value = DWORDtoWCHAR(heap);
+            addJvmArgument(props, appendStringW(appendStringW(appendStringW(NULL, L"-Xmx"), value), L"m"));
+            FREE(value);
+            if(heapMin > heap) {
+                heapMin = heap;
+            }
+        }
+    } else {
+        // the initial heap could exceed the maximum one set there
+        heapMin = 0;
+    }
+    if(heapMin > 0 && getJvmArgumentValue(props, L"-Xms")==NULL) {
+        WCHAR * value = DWORDtoWCHAR(heapMin);
+        addJvmArgument(props, appendStringW(appendStringW(appendStringW(NULL, L"-Xms"), value), L"m"));
+        FREE(value);
+    }
+    
+    if(getJvmArgumentValue(props, MEMORY_RULE_PROCESSORS)!=NULL && getJvmArgumentValue(props, L"-XX:ActiveProcessorCount")==NULL) {
+        if(isActiveProcessorCountSupported(props->java->version)) {
+            // 0 means all available processors
+            DWORD max = getJvmArgumentNumber(props, MEMORY_RULE_PROCESSORS, 0);
+            WCHAR * value = DWORDtoWCHAR((max > 0 && max < processors) ? max : processors);
+            addJvmArgument(props, appendStringW(appendStringW(NULL, L"-XX:ActiveProcessorCount="), value));
+            FREE(value);
+        } else {
+            writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... no -XX:ActiveProcessorCount in this JVM, processors rule skipped", 1);
+        }
+    }
+    
+    if(gc!=NULL && !hasGCArgument(props)) {
+        // <gc for a small machine>,<gc otherwise>, the JVM draws the same line for a server class machine
+        WCHAR * separator = searchW(gc, L",");
+        DWORD smallMachine = (memory < SMALL_MACHINE_MEMORY || processors < SMALL_MACHINE_PROCESSORS);
+        WCHAR * name = (separator==NULL) ? appendStringW(NULL, gc) :
+            (smallMachine ? appendStringNW(NULL, 0, gc, (DWORD) (separator - gc)) : appendStringW(NULL, separator + 1));
+        if(getLengthW(name) > 0) {
+            addJvmArgument(props, appendStringW(appendStringW(NULL, L"-XX:+Use"), name));
+        }
+        FREE(name);
+    }
+}
+
+// Removes the archive directories of the previous payloads of this installer and
+// those of any installer not used for SHARED_ARCHIVE_MAX_AGE days, then marks the
+// directory of this payload as used now.
+void evictSharedArchives(LauncherProperties * props, WCHAR * parent, WCHAR * exeBase, WCHAR * current) {
+    WIN32_FIND_DATAW data;
+    WCHAR * mask = appendStringW(appendStringW(NULL, parent), L"*");
+    HANDLE find = FindFirstFileW(mask, &data);
+    DWORD prefixLength = getLengthW(exeBase);
+    ULARGE_INTEGER now;
+    FILETIME time;
+    HANDLE dir;
+    
+    GetSystemTimeAsFileTime(&time);
+    now.LowPart = time.dwLowDateTime;
+    now.HighPart = time.dwHighDateTime;
+    if(find!=INVALID_HANDLE_VALUE) {
+        do {
+            // only <exe name>-<payload hash> directories
+            WCHAR * ptr = data.cFileName + getLengthW(data.cFileName);
+            WCHAR * end = ptr;
+            ULARGE_INTEGER used;
+            DWORD obsolete;
+            
+            if(!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) continue;
+            while(ptr > data.cFileName && *(ptr - 1)>=L'0' && *(ptr - 1)<=L'9') ptr--;
+            if(ptr==end || ptr - 1 <= data.cFileName || *(ptr - 1)!=L'-' ||
+                    lstrcmpiW(data.cFileName, current + getLengthW(parent))==0) {
+                continue;
+            }
+            used.LowPart = data.ftLastWriteTime.dwLowDateTime;
+            used.HighPart = data.ftLastWriteTime.dwHighDateTime;
+            obsolete = (ptr - 1 == data.cFileName + prefixLength &&
+                    CompareStringW(LOCALE_INVARIANT, NORM_IGNORECASE, data.cFileName, prefixLength, exeBase, prefixLength)==CSTR_EQUAL);
+            // file times are in 100 ns
+            if(obsolete || (now.QuadPart > used.QuadPart &&
+                    (now.QuadPart - used.QuadPart) / 10000000 / 86400 >= SHARED_ARCHIVE_MAX_AGE)) {
+                WCHAR * path = appendStringW(appendStringW(NULL, parent), data.cFileName);
+                writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... removing unused shared archive directory ", 0);
+                writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, path, 1);
+                deleteDirectory(props, path);
+                FREE(path);
+            }
+        } while(FindNextFileW(find, &data));
+        FindClose(find);
+    }
+    FREE(mask);
+    
+    dir = CreateFileW(current, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    if(dir!=INVALID_HANDLE_VALUE) {
+        SetFileTime(dir, NULL, NULL, &time);
+        CloseHandle(dir);
+    }
+}
+
+// Installer classes are the same on every run, so they are dumped to a CDS archive
+// in the cache root on the first run and mapped from it on the next ones. Archived
+// classes are used only if the classpath jars have the same paths and timestamps,
+// so the extracted jars are copied to a directory of this payload first.
+// The copies are checked against the payload on every run, and not used at all
+// by an elevated installer as the cache is writable by the user.
+void setSharedArchiveJars(LauncherProperties * props) {
+    JavaVersion * version = props->java->version;
+    WCHAR * exeBase;
+    WCHAR * hash;
+    WCHAR * parent;
+    DWORD tmpDirLength = getLengthW(props->tmpDir);
+    DWORD i;
+    
+    if(version==NULL || version->major < SHARED_ARCHIVE_MIN_JAVA || props->defaultCacheDirRoot==NULL ||
+            props->tmpDir==NULL || hasSharedArchiveOption(props->jvmArguments) || hasSharedArchiveOption(props->commandLine)) {
+        return;
+    }
+    if(isElevatedProcess()) {
+        writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... class data sharing archive is not used by an elevated installer", 1);
+        return;
+    }
+    
+    exeBase = appendStringW(NULL, props->exeName);
+    for(i=getLengthW(exeBase);i>0;i--) {
+        if(exeBase[i - 1]==L'.') {
+            exeBase[i - 1] = 0;
+            break;
+        }
+    }
+    parent = appendStringW(appendStringW(NULL, props->defaultCacheDirRoot), SHARED_ARCHIVE_DIR);
+    hash = DWORDtoWCHAR(props->payloadHash);
+    props->sharedArchiveDir = appendStringW(appendStringW(appendStringW(appendStringW(NULL, parent), exeBase), L"-"), hash);
+    
+    if(!isDirectory(props->sharedArchiveDir)) {
+        createDirectory(props, props->sharedArchiveDir);
+    }
+    if(isOK(props)) {
+        evictSharedArchives(props, parent, exeBase, props->sharedArchiveDir);
+    }
+    
+    for(i=0;isOK(props) && i<props->jars->size;i++) {
+        LauncherResource * jar = props->jars->items[i];
+        resolvePath(props, jar);
+        if(getLengthW(jar->resolved) > tmpDirLength && jar->resolved[tmpDirLength]==L'\\' &&
+                CompareStringW(LOCALE_INVARIANT, NORM_IGNORECASE, jar->resolved, tmpDirLength, props->tmpDir, tmpDirLength)==CSTR_EQUAL) {
+            WCHAR * cached = appendStringW(appendStringW(NULL, props->sharedArchiveDir), jar->resolved + tmpDirLength);
+            DWORD exists = fileExists(cached);
+            if(exists && (jar->type!=0 || !isFileIntact(cached, &jar->length, jar->crc))) {
+                writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... cached jar differs from the payload, copying it again : ", 0);
+                writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, cached, 1);
+                exists = 0;
+            }
+            if(!exists) {
+                // copied under a temporary name, so an interrupted copy is never used
+                WCHAR * part = appendStringW(appendStringW(NULL, cached), L".part");
+                WCHAR * dir = getParentDirectory(cached);
+                if(!fileExists(dir)) {
+                    createDirectory(props, dir);
+                }
+                if(!isOK(props) || !CopyFileW(jar->resolved, part, FALSE) ||
+                        !MoveFileExW(part, cached, MOVEFILE_REPLACE_EXISTING)) {
+                    writeErrorA(props, OUTPUT_LEVEL_DEBUG, 1, "... can`t copy jar to the shared archive directory : ", cached, GetLastError());
+                    props->status = ERROR_INPUTOUPUT;
+                    DeleteFileW(part);
+                }
+                FREE(part);
+                FREE(dir);
+            }
+            if(isOK(props)) {
+                jar->resolved = moveToArenaW(props->arena, cached);
+            } else {
+                FREE(cached);
+            }
+        }
+    }
+    
+    if(!isOK(props)) {
+        // the archive is optional, jars which were not copied are used from the tmp dir
+        writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... class data sharing archive won`t be used", 1);
+        props->status = ERROR_OK;
+        FREE(props->sharedArchiveDir);
+    }
+    FREE(exeBase);
+    FREE(parent);
+    FREE(hash);
+}
+
+void setSharedArchiveArguments(LauncherProperties * props) {
+    JavaProperties * java = props->java;
+    JavaVersion * version = java->version;
+    DWORD key = HASH_INITIAL_VALUE;
+    WCHAR * keyString;
+    WCHAR * archive;
+    
+    if(!isOK(props) || props->sharedArchiveDir==NULL || hasSharedArchiveOption(props->jvmArguments)) {
+        return;
+    }
+    
+    // an archive can be used only by the same JVM and with the same classpath
+    key = updateHash(key, java->javaHome, getLengthW(java->javaHome) * sizeof(WCHAR));
+    key = updateHash(key, java->vendor, getLengthA(java->vendor));
+    key = updateHash(key, &version->major, sizeof(long));
+    key = updateHash(key, &version->minor, sizeof(long));
+    key = updateHash(key, &version->micro, sizeof(long));
+    key = updateHash(key, &version->update, sizeof(long));
+    key = updateHash(key, version->build, getLengthA(version->build));
+    key = updateHash(key, props->classpath, getLengthW(props->classpath) * sizeof(WCHAR));
+    keyString = DWORDtoWCHAR(key);
+    archive = appendStringW(appendStringW(appendStringW(appendStringW(NULL, props->sharedArchiveDir), FILE_SEP), keyString), SHARED_ARCHIVE_SUFFIX);
+    
+    if(version->major >= SHARED_ARCHIVE_AUTO_JAVA) {
+        // the JVM validates the archive itself and recreates it if needed
+        addJvmArgument(props, appendStringW(NULL, L"-XX:+AutoCreateSharedArchive"));
+        addJvmArgument(props, appendStringW(appendStringW(NULL, L"-XX:SharedArchiveFile="), archive));
+    } else if(fileExists(archive)) {
+        addJvmArgument(props, appendStringW(appendStringW(NULL, L"-XX:SharedArchiveFile="), archive));
+    } else {
+        addJvmArgument(props, appendStringW(appendStringW(NULL, L"-XX:ArchiveClassesAtExit="), archive));
+    }
+    // a mismatched archive is just not used, without warnings in the installer output
+    addJvmArgument(props, appendStringW(NULL, L"-Xlog:cds*=off"));
+    FREE(keyString);
+    FREE(archive);
+}
+
+void appendCommandLineArgument( StringBuilderW * command, const WCHAR * arg) {    
+    appendEscapedToBuilderW(command, arg);
+    appendToBuilderNW(command, L" ", 1);
+}
+
+// long classpaths are passed in a file, see setLauncherCommand
+void shortenJavaArguments(LauncherProperties * props, WCHAR * tmpdirOption, WCHAR ** argumentsFile, WCHAR ** pathingJar) {
+    JavaVersion * version = props->java->version;
+    
+    if(version!=NULL && version->major >= 9) {
+        WCHAR ** args = newppWCHAR(props->jvmArguments->size + 3);
+        DWORD number = 0;
+        DWORD i;
+        
+        args[number++] = tmpdirOption;
+        for(i=0;i<props->jvmArguments->size;i++) {
+            args[number++] = props->jvmArguments->items[i];
+        }
+        args[number++] = (WCHAR *) L"-classpath";
+        args[number++] = props->classpath;
+        
+        *argumentsFile = appendStringW(appendStringW(NULL, props->tmpDir), JAVA_ARGUMENTS_FILE);
+        if(writeJavaArgumentsFile(props, *argumentsFile, args, number)) {
+            writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... java arguments are in ", 0);
+            writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, *argumentsFile, 1);
+        } else {
+            FREE(*argumentsFile);
+        }
+        FREE(args);
+    }
+    if(*argumentsFile==NULL) {
+        *pathingJar = appendStringW(appendStringW(NULL, props->tmpDir), PATHING_JAR_FILE);
+        if(writePathingJar(props, *pathingJar, props->classpath)) {
+            writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... classpath is in ", 0);
+            writeMessageW(props, OUTPUT_LEVEL_DEBUG, 0, *pathingJar, 1);
+        } else {
+            FREE(*pathingJar);
+        }
+    }
 }
 
 void setLauncherCommand(LauncherProperties *props) {
@@ -654,29 +1127,44 @@ void setLauncherCommand(LauncherProperties *props) {
         props->status = ERROR_JVM_NOT_FOUND;
         return;
     } else {
-        WCHAR * command = NULL;
-        WCHAR * javaIOTmpdir = NULL;
+        StringBuilderW command;
+        WCHAR * javaIOTmpdir = getParentDirectory(props->tmpDir);
+        WCHAR * tmpdirOption = appendStringW(appendStringW(NULL, L"-Djava.io.tmpdir="), javaIOTmpdir);
+        WCHAR * argumentsFile = NULL;
+        WCHAR * pathingJar = NULL;
         DWORD i = 0;
         
-        appendCommandLineArgument(&command, props->java->javaExe);
-        command = appendStringW(command, L"-Djava.io.tmpdir=");
-        javaIOTmpdir = getParentDirectory(props->tmpDir);
-        appendCommandLineArgument(&command, javaIOTmpdir);
-        FREE(javaIOTmpdir);
-        
-        
-        for(i=0;i<props->jvmArguments->size;i++) {
-            appendCommandLineArgument(&command, props->jvmArguments->items[i]);
+        // a command line is limited to 32K characters, so a long classpath is passed
+        // in an @argfile for java 9+ or in a pathing jar for the older ones
+        if(getLengthW(props->classpath) > CLASSPATH_FILE_THRESHOLD && props->tmpDir!=NULL) {
+            shortenJavaArguments(props, tmpdirOption, &argumentsFile, &pathingJar);
         }
         
-        appendCommandLineArgument(&command, L"-classpath");
-        appendCommandLineArgument(&command, props->classpath);
+        initStringBuilderW(&command, ((pathingJar!=NULL || argumentsFile!=NULL) ? 0 : getLengthW(props->classpath)) + 1024);
+        appendCommandLineArgument(&command, props->java->javaExe);
+        if(argumentsFile!=NULL) {
+            appendToBuilderNW(&command, L"@", 1);
+            appendCommandLineArgument(&command, argumentsFile);
+        } else {
+            appendCommandLineArgument(&command, tmpdirOption);
+            
+            for(i=0;i<props->jvmArguments->size;i++) {
+                appendCommandLineArgument(&command, props->jvmArguments->items[i]);
+            }
+            
+            appendCommandLineArgument(&command, L"-classpath");
+            appendCommandLineArgument(&command, (pathingJar!=NULL) ? pathingJar : props->classpath);
+        }
         appendCommandLineArgument(&command, props->mainClass);
         
         for(i=0;i<props->appArguments->size; i++) {
             appendCommandLineArgument(&command, props->appArguments->items[i]);
         }
-        props->command = command;
+        props->command = finishStringBuilderW(&command);
+        FREE(javaIOTmpdir);
+        FREE(tmpdirOption);
+        FREE(argumentsFile);
+        FREE(pathingJar);
     }
 }
 
@@ -685,7 +1173,13 @@ void executeMainClass(LauncherProperties * props) {
         int64t * minSize = newint64_t(0, 0);
         writeMessageA(props, OUTPUT_LEVEL_NORMAL, 0, "Executing main class", 1);
         checkFreeSpace(props, props->tmpDir, minSize);
-        if(isOK(props)) {
+        if(isOK(props) && props->inProcessJava && executeMainClassInProcess(props)) {
+            // output of the VM goes directly to the launcher output handles
+            char * s = DWORDtoCHAR(props->exitCode);
+            writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... main class has finished its work in the launcher process. Exit code is ", 0);
+            writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, s, 1);
+            FREE(s);
+        } else if(isOK(props)) {
             HANDLE hErrorRead;
             HANDLE hErrorWrite;
             char * error = NULL;
@@ -741,27 +1235,32 @@ void executeMainClass(LauncherProperties * props) {
 DWORD isOnlyHelp(LauncherProperties * props) {
     if(argumentExists(props, helpArg, 1) || argumentExists(props, helpOtherArg, 1)) {
         
-        WCHARList * help = newWCHARList(NUMBER_OF_HELP_ARGUMENTS);
+        // the help is built in the scratch arena
+        WCHARList * help = newWCHARList(props->scratch, NUMBER_OF_HELP_ARGUMENTS);
         DWORD counter = 0;
         WCHAR * helpString = NULL;
         
-        help->items[counter++] = formatMessageW(getI18nProperty(props, ARG_JAVA_PROP), 1, javaArg);
-        help->items[counter++] = formatMessageW(getI18nProperty(props, ARG_TMP_PROP), 1, tempdirArg);
-        help->items[counter++] = formatMessageW(getI18nProperty(props, ARG_EXTRACT_PROP), 1, extractArg);
-        help->items[counter++] = formatMessageW(getI18nProperty(props, ARG_OUTPUT_PROPERTY), 1, outputFileArg);
-        help->items[counter++] = formatMessageW(getI18nProperty(props, ARG_DEBUG_PROP), 1, debugArg);
-        help->items[counter++] = formatMessageW(getI18nProperty(props, ARG_CPA_PROP), 1, classPathAppend);
-        help->items[counter++] = formatMessageW(getI18nProperty(props, ARG_CPP_PROP), 1, classPathPrepend);
-        help->items[counter++] = formatMessageW(getI18nProperty(props, ARG_DISABLE_SPACE_CHECK), 1, nospaceCheckArg);
-        help->items[counter++] = formatMessageW(getI18nProperty(props, ARG_LOCALE_PROP), 1, localeArg);
-        help->items[counter++] = formatMessageW(getI18nProperty(props, ARG_SILENT_PROP), 1, silentArg);
-        help->items[counter++] = formatMessageW(getI18nProperty(props, ARG_HELP_PROP), 1, helpArg);
+        if(help==NULL) {
+            props->status = EXIT_CODE_SYSTEM_ERROR;
+            return 1;
+        }
+        help->items[counter++] = moveToArenaW(props->scratch, formatMessageW(getI18nProperty(props, ARG_JAVA_PROP), 1, javaArg));
+        help->items[counter++] = moveToArenaW(props->scratch, formatMessageW(getI18nProperty(props, ARG_TMP_PROP), 1, tempdirArg));
+        help->items[counter++] = moveToArenaW(props->scratch, formatMessageW(getI18nProperty(props, ARG_EXTRACT_PROP), 1, extractArg));
+        help->items[counter++] = moveToArenaW(props->scratch, formatMessageW(getI18nProperty(props, ARG_OUTPUT_PROPERTY), 1, outputFileArg));
+        help->items[counter++] = moveToArenaW(props->scratch, formatMessageW(getI18nProperty(props, ARG_DEBUG_PROP), 1, debugArg));
+        help->items[counter++] = moveToArenaW(props->scratch, formatMessageW(getI18nProperty(props, ARG_CPA_PROP), 1, classPathAppend));
+        help->items[counter++] = moveToArenaW(props->scratch, formatMessageW(getI18nProperty(props, ARG_CPP_PROP), 1, classPathPrepend));
+        help->items[counter++] = moveToArenaW(props->scratch, formatMessageW(getI18nProperty(props, ARG_DISABLE_SPACE_CHECK), 1, nospaceCheckArg));
+        help->items[counter++] = moveToArenaW(props->scratch, formatMessageW(getI18nProperty(props, ARG_LOCALE_PROP), 1, localeArg));
+        help->items[counter++] = moveToArenaW(props->scratch, formatMessageW(getI18nProperty(props, ARG_SILENT_PROP), 1, silentArg));
+        help->items[counter++] = moveToArenaW(props->scratch, formatMessageW(getI18nProperty(props, ARG_HELP_PROP), 1, helpArg));
         
         
         for(counter=0;counter<NUMBER_OF_HELP_ARGUMENTS;counter++) {
             helpString = appendStringW(appendStringW(helpString, help->items[counter]), NEW_LINE);
         }
-        freeWCHARList(&help);
+        resetArena(props->scratch);
         showMessageW(props, helpString, 0);
         FREE(helpString);
         return 1;
@@ -773,15 +1272,16 @@ DWORD isSilent(LauncherProperties * props) {
     return props->silentMode;
 }
 
-WCHARList * getCommandlineArguments() {
+// the arguments are cleaned from the list once they are used, see getArgumentIndex
+WCHARList * getCommandlineArguments(Arena * arena) {
     int argumentsNumber = 0;
     int i=0;
     WCHAR ** commandLine = CommandLineToArgvW(GetCommandLineW(), &argumentsNumber);
     // the first is always the running program..  we don`t need it
     // it is that same as GetModuleFileNameW says
-    WCHARList * commandsList = newWCHARList((DWORD) (argumentsNumber - 1) );
-    for(i=0;i<argumentsNumber - 1;i++) {
-        commandsList->items[i] = appendStringW(NULL, commandLine[i + 1]);
+    WCHARList * commandsList = newWCHARList(arena, (DWORD) (argumentsNumber - 1) );
+    for(i=0;commandsList!=NULL && i<argumentsNumber - 1;i++) {
+        commandsList->items[i] = arenaCopyW(arena, commandLine[i + 1]);
     }
     
     LocalFree(commandLine);
@@ -789,21 +1289,37 @@ WCHARList * getCommandlineArguments() {
 }
 
 
+// empty lists for a launcher without memory for its arena, it stops then
+static WCHARList noArguments = {NULL, 0};
+
 LauncherProperties * createLauncherProperties() {
     LauncherProperties *props = (LauncherProperties*)LocalAlloc(LPTR, sizeof(LauncherProperties));
     DWORD c = 0;
-    props->launcherCommandArguments = newWCHARList(11);
-    props->launcherCommandArguments->items[c++] = appendStringW(NULL, outputFileArg);
-    props->launcherCommandArguments->items[c++] = appendStringW(NULL, javaArg);
-    props->launcherCommandArguments->items[c++] = appendStringW(NULL, debugArg);
-    props->launcherCommandArguments->items[c++] = appendStringW(NULL, tempdirArg);
-    props->launcherCommandArguments->items[c++] = appendStringW(NULL, classPathPrepend);
-    props->launcherCommandArguments->items[c++] = appendStringW(NULL, classPathAppend);
-    props->launcherCommandArguments->items[c++] = appendStringW(NULL, extractArg);
-    props->launcherCommandArguments->items[c++] = appendStringW(NULL, helpArg);
-    props->launcherCommandArguments->items[c++] = appendStringW(NULL, helpOtherArg);
-    props->launcherCommandArguments->items[c++] = appendStringW(NULL, silentArg);
-    props->launcherCommandArguments->items[c++] = appendStringW(NULL, nospaceCheckArg);
+    // everything living until exit is in the launcher arena : the arguments,
+    // the resource lists and the compatible java, see freeLauncherProperties
+    props->arena = newArena(ARENA_BLOCK_SIZE);
+    props->scratch = newArena(ARENA_SCRATCH_SIZE);
+    props->status = ERROR_OK;
+    props->launcherCommandArguments = newWCHARList(props->arena, 12);
+    props->commandLine   = getCommandlineArguments(props->arena);
+    if(props->launcherCommandArguments==NULL || props->commandLine==NULL || props->scratch==NULL) {
+        props->launcherCommandArguments = &noArguments;
+        props->commandLine = &noArguments;
+        props->status = EXIT_CODE_SYSTEM_ERROR;
+    } else {
+        props->launcherCommandArguments->items[c++] = arenaCopyW(props->arena, outputFileArg);
+        props->launcherCommandArguments->items[c++] = arenaCopyW(props->arena, javaArg);
+        props->launcherCommandArguments->items[c++] = arenaCopyW(props->arena, debugArg);
+        props->launcherCommandArguments->items[c++] = arenaCopyW(props->arena, tempdirArg);
+        props->launcherCommandArguments->items[c++] = arenaCopyW(props->arena, classPathPrepend);
+        props->launcherCommandArguments->items[c++] = arenaCopyW(props->arena, classPathAppend);
+        props->launcherCommandArguments->items[c++] = arenaCopyW(props->arena, extractArg);
+        props->launcherCommandArguments->items[c++] = arenaCopyW(props->arena, helpArg);
+        props->launcherCommandArguments->items[c++] = arenaCopyW(props->arena, helpOtherArg);
+        props->launcherCommandArguments->items[c++] = arenaCopyW(props->arena, silentArg);
+        props->launcherCommandArguments->items[c++] = arenaCopyW(props->arena, nospaceCheckArg);
+        props->launcherCommandArguments->items[c++] = arenaCopyW(props->arena, inProcessJavaArg);
+    }
     
     props->jvmArguments = NULL;
     props->appArguments = NULL;
@@ -821,19 +1337,22 @@ LauncherProperties * createLauncherProperties() {
     props->command = NULL;
     props->jvms    = NULL;
     props->other   = NULL;
-    props->alreadyCheckedJava = NULL;
+    props->alreadyCheckedJava = newStringSet(64);
     props->exePath = getExePath();
     props->exeName = getExeName();
     props->exeDir  = getExeDirectory();
+    props->userHome = NULL;
+    props->sharedArchiveDir = NULL;
+    props->payloadHash = HASH_INITIAL_VALUE;
     props->handler = CreateFileW(props->exePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
     props->bundledSize = newint64_t(0, 0);
     props->bundledNumber = 0;
-    props->commandLine   = getCommandlineArguments();
-    props->status       = ERROR_OK;
     props->exitCode     = 0;
     props->outputLevel  = argumentExists(props, debugArg, 1) ? OUTPUT_LEVEL_DEBUG : OUTPUT_LEVEL_NORMAL;
     props->stdoutHandle = GetStdHandle(STD_OUTPUT_HANDLE);
     props->stderrHandle = GetStdHandle(STD_ERROR_HANDLE);
+    props->deferredOutput = NULL;
+    props->deferredErrors = NULL;
     props->bufsize = READ_WRITE_BUFSIZE;
     props->restOfBytes = createSizedString();
     props->I18N_PROPERTIES_NUMBER = 0;
@@ -854,56 +1373,22 @@ LauncherProperties * createLauncherProperties() {
     props->userDefinedOutput      = getArgumentValue(props, outputFileArg, 1, 1);
     props->checkForFreeSpace      = !argumentExists(props, nospaceCheckArg, 0);
     props->silentMode             = argumentExists(props, silentArg, 0);
+    props->inProcessJava          = argumentExists(props, inProcessJavaArg, 1);
     props->launcherSize = getFileSize(props->exePath);
     props->isOnlyStub = (compare(props->launcherSize, STUB_FILL_SIZE) < 0);
     return props;
 }
-void freeLauncherResourceList(LauncherResourceList ** list) {
-    if(*list!=NULL) {
-        if((*list)->items!=NULL) {
-            DWORD i=0;
-            for(i=0;i<(*list)->size;i++) {
-                freeLauncherResource(&((*list)->items[i]));
-            }
-            FREE((*list)->items);
-        }
-        FREE((*list));
-    }
-}
 
 
 void freeLauncherProperties(LauncherProperties **props) {
     if((*props)!=NULL) {
-        DWORD i=0;
         writeMessageA(*props, OUTPUT_LEVEL_DEBUG, 0, "Closing launcher properties", 1);
-        freeWCHARList(& ( (*props)->appArguments));
-        freeWCHARList(& ( (*props)->jvmArguments));
         
         FREE((*props)->mainClass);
         FREE((*props)->testJVMClass);
         FREE((*props)->classpath);
-        freeLauncherResourceList(&((*props)->jars));
-        
-        freeLauncherResourceList(&((*props)->jvms));
-        
-        freeLauncherResourceList(&((*props)->other));
-        
-        freeLauncherResource(&((*props)->testJVMFile));
-        
         FREE((*props)->tmpDir);
-        for(i=0;i<(*props)->compatibleJavaNumber;i++) {
-            JavaCompatible * jc = (*props)->compatibleJava[i];
-            if(jc!=NULL) {
-                FREE(jc->minVersion);
-                FREE(jc->maxVersion);
-                FREE(jc->vendor);
-                FREE(jc->osName);
-                FREE(jc->osArch);
-                FREE((*props)->compatibleJava[i]);
-            }
-        }
-        freeStringList(&((*props)->alreadyCheckedJava));
-        FREE((*props)->compatibleJava);
+        freeStringSet(&((*props)->alreadyCheckedJava));
         freeJavaProperties(&((*props)->java));
         FREE((*props)->userDefinedJavaHome);
         FREE((*props)->userDefinedTempDir);
@@ -914,6 +1399,8 @@ void freeLauncherProperties(LauncherProperties **props) {
         FREE((*props)->exePath);
         FREE((*props)->exeDir);
         FREE((*props)->exeName);
+        FREE((*props)->userHome);
+        FREE((*props)->sharedArchiveDir);
         FREE((*props)->bundledSize);
         FREE((*props)->launcherSize);
         freeSizedString(&((*props)->restOfBytes));
@@ -923,9 +1410,10 @@ void freeLauncherProperties(LauncherProperties **props) {
         CloseHandle((*props)->stdoutHandle);
         CloseHandle((*props)->stderrHandle);
         
+        // the arguments, the resources, the compatible java and the i18n strings
         freeI18NMessages((*props));
-        freeWCHARList(& ((*props)->launcherCommandArguments));
-        freeWCHARList(& ((*props)->commandLine));
+        freeArena(& ((*props)->arena));
+        freeArena(& ((*props)->scratch));
         CloseHandle((*props)->handler);
         
         FREE((*props));
@@ -943,6 +1431,171 @@ void printStatus(LauncherProperties * props) {
     FREE(s);
 }
 
+typedef struct _javaSearch {
+    LauncherProperties * props;
+    DWORD failed;
+    DWORD error;
+    const WCHAR * parameter;
+} JavaSearch;
+
+DWORD WINAPI findSuitableJavaThread(void * ptr) {
+    JavaSearch * search = (JavaSearch *) ptr;
+    search->failed = searchSuitableJava(search->props, &search->error, &search->parameter);
+    return 0;
+}
+
+// JVM search needs only the testJVM file which is already extracted so it runs in parallel
+// with the extraction of the bundled data. The search works on a copy of props to have its own
+// status. It doesn`t touch the windows : its messages are buffered and written after the join
+// and its error is shown by this thread. Installing a bundled JVM reports progress and runs
+// processes, so with bundled JVMs everything stays sequential.
+// The copy shares the pointers of props, until the join the search may only
+//  - read compatibleJava, userDefinedJavaHome and outputLevel
+//  - set the resolved paths of testJVMFile and jvms, the extraction doesn`t use them
+//  - update alreadyCheckedJava, userHome, java, status and exitCode of the copy
+// Its strings go to its own arena, merged into the launcher arena after the join. It has no
+// scratch arena, the one of props is reset by the extraction.
+void findJavaAndExtractData(LauncherProperties * props) {
+    LauncherProperties * searchProps = NULL;
+    HANDLE searchThread = NULL;
+    JavaSearch search;
+    DWORD threadId;
+    
+    if(props->extractOnly) {
+        extractData(props);
+        checkExtractionStatus(props);
+        return;
+    }
+    if(props->userDefinedJavaHome==NULL && hasBundledJVMs(props)) {
+        writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... bundled JVM to install, searching sequentially", 1);
+    } else {
+        StringBuilder output;
+        StringBuilder errors;
+        
+        initStringBuilder(&output, 0);
+        initStringBuilder(&errors, 0);
+        searchProps = (LauncherProperties *) LocalAlloc(LPTR, sizeof(LauncherProperties));
+        CopyMemory(searchProps, props, sizeof(LauncherProperties));
+        searchProps->deferredOutput = &output;
+        searchProps->deferredErrors = &errors;
+        searchProps->arena = (props->arena!=NULL) ? newArena(ARENA_SCRATCH_SIZE) : NULL;
+        searchProps->scratch = NULL;
+        ZERO(&search, sizeof(JavaSearch));
+        search.props = searchProps;
+        searchThread = CreateThread(NULL, 0, &findSuitableJavaThread, (LPVOID) &search, 0, &threadId);
+        if(searchThread!=NULL) {
+            extractData(props);
+            checkExtractionStatus(props);
+            
+            WaitForSingleObject(searchThread, INFINITE);
+            CloseHandle(searchThread);
+            writeDeferredOutput(props, &output, 0);
+            writeDeferredOutput(props, &errors, 1);
+        }
+        freeStringBuilder(&output);
+        freeStringBuilder(&errors);
+        if(searchThread==NULL) {
+            writeErrorA(props, OUTPUT_LEVEL_DEBUG, 1, "Can`t create thread for JVM search, searching sequentially", NULL, GetLastError());
+            freeArena(&(searchProps->arena));
+            FREE(searchProps);
+        } else {
+            // values resolved lazily by the search
+            if(props->userHome==NULL) {
+                props->userHome = searchProps->userHome;
+            } else if(searchProps->userHome!=props->userHome) {
+                FREE(searchProps->userHome);
+            }
+            props->java = searchProps->java;
+            mergeArena(props->arena, &(searchProps->arena));
+            if(isOK(props) && !isTerminated(props)) {
+                // extraction error has priority
+                props->status   = searchProps->status;
+                props->exitCode = searchProps->exitCode;
+                if(search.failed) {
+                    showErrorW(props, search.error, 1, search.parameter);
+                }
+            }
+            FREE(searchProps);
+            return;
+        }
+    }
+    
+    findSuitableJava(props);
+    if(!isOK(props) || isTerminated(props)) return;
+    extractData(props);
+    checkExtractionStatus(props);
+}
+
+// The in-process VM keeps the extracted jars open until the launcher exits, so a copy of
+// the launcher waits for this process to exit and deletes the directory then
+DWORD deleteDirectoryAfterExit(LauncherProperties * props, WCHAR * dir) {
+    HANDLE self = NULL;
+    STARTUPINFOW si;
+    PROCESS_INFORMATION pi;
+    StringBuilderW commandBuilder;
+    WCHAR * command;
+    WCHAR * handleString;
+    DWORD result = 0;
+    
+    // inherited by the copy, it can`t be mistaken for another process with a reused id
+    if(!DuplicateHandle(GetCurrentProcess(), GetCurrentProcess(), GetCurrentProcess(), &self, SYNCHRONIZE, TRUE, 0)) {
+        writeErrorA(props, OUTPUT_LEVEL_DEBUG, 1, "... can`t duplicate the process handle", NULL, GetLastError());
+        return 0;
+    }
+    handleString = DWORDtoWCHAR((DWORD) (DWORD_PTR) self);
+    initStringBuilderW(&commandBuilder, MAX_PATH);
+    appendCommandLineArgument(&commandBuilder, props->exePath);
+    appendCommandLineArgument(&commandBuilder, deleteAfterExitArg);
+    appendCommandLineArgument(&commandBuilder, handleString);
+    appendCommandLineArgument(&commandBuilder, dir);
+    command = finishStringBuilderW(&commandBuilder);
+    
+    ZERO(&si, sizeof(STARTUPINFOW));
+    si.cb = sizeof(STARTUPINFOW);
+    if(CreateProcessW(NULL, command, NULL, NULL, TRUE, DETACHED_PROCESS | CREATE_DEFAULT_ERROR_MODE, NULL, NULL, &si, &pi)) {
+        writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... the directory is deleted when the launcher exits", 1);
+        CloseHandle(pi.hThread);
+        CloseHandle(pi.hProcess);
+        result = 1;
+    } else {
+        writeErrorA(props, OUTPUT_LEVEL_DEBUG, 1, "... can`t run ", command, GetLastError());
+    }
+    CloseHandle(self);
+    FREE(handleString);
+    FREE(command);
+    return result;
+}
+
+// the launcher started by deleteDirectoryAfterExit, 1 if this process is one
+DWORD runDeleteAfterExit() {
+    int number = 0;
+    WCHAR ** args = CommandLineToArgvW(GetCommandLineW(), &number);
+    DWORD result = 0;
+    
+    if(args!=NULL && number==4 && lstrcmpW(args[1], deleteAfterExitArg)==0) {
+        LauncherProperties props;
+        DWORD_PTR value = 0;
+        WCHAR * ptr = args[2];
+        while(*ptr>=L'0' && *ptr<=L'9') {
+            value = value * 10 + (*ptr - L'0');
+            ptr++;
+        }
+        if(*ptr==0 && value!=0) {
+            HANDLE parent = (HANDLE) value;
+            WaitForSingleObject(parent, INFINITE);
+            CloseHandle(parent);
+            // there is no output for this process
+            ZERO(&props, sizeof(LauncherProperties));
+            props.outputLevel = OUTPUT_LEVEL_NORMAL + 1;
+            props.status = ERROR_OK;
+            deleteDirectory(&props, args[3]);
+        }
+        result = 1;
+    }
+    LocalFree(args);
+    return result;
+}
+
 void processLauncher(LauncherProperties * props) {
     setOutput(props);
     if(!isOK(props) || isTerminated(props)) return;
@@ -967,6 +1620,7 @@ void processLauncher(LauncherProperties * props) {
     if(!isOK(props) || isTerminated(props)) return;
     
     readLauncherProperties(props);
+    resetArena(props->scratch);
     checkExtractionStatus(props);
     if(!isOK(props) || isTerminated(props)) return;
     
@@ -981,17 +1635,16 @@ void processLauncher(LauncherProperties * props) {
     if (isOK(props) ){
         extractJVMData(props);
         checkExtractionStatus(props);
-        if (isOK(props) && !props->extractOnly && !isTerminated(props)) {
-            findSuitableJava(props);
-        }
         
         if (isOK(props) && !isTerminated(props)) {
-            extractData(props);
-            checkExtractionStatus(props);
+            findJavaAndExtractData(props);
             if (isOK(props) && (props->java!=NULL)  && !isTerminated(props)) {
+                setSharedArchiveJars(props);
                 setClasspathElements(props);
                 if(isOK(props) && (props->java!=NULL)  && !isTerminated(props)) {
                     setAdditionalArguments(props);
+                    setMemoryArguments(props);
+                    setSharedArchiveArguments(props);
                     setLauncherCommand(props);
                     Sleep(500);
                     executeMainClass(props);
@@ -1002,7 +1655,9 @@ void processLauncher(LauncherProperties * props) {
     
     if(!props->extractOnly && props->tmpDirCreated) {
         writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... deleting temporary directory ", 1);
-        deleteDirectory(props, props->tmpDir);
+        if(!props->inProcessJava || props->java==NULL || !deleteDirectoryAfterExit(props, props->tmpDir)) {
+            deleteDirectory(props, props->tmpDir);
+        }
     }
     
 }
@@ -31,6 +31,7 @@ extern "C" {
 #endif
     
     extern const WCHAR * NEW_LINE;
+    extern const WCHAR * CLASSPATH_SEPARATOR;
     
     LauncherProperties * createLauncherProperties();
     void freeLauncherProperties(LauncherProperties ** props);
@@ -40,11 +41,11 @@ extern "C" {
     DWORD isSilent(LauncherProperties * props);
     DWORD isLauncherArgument(LauncherProperties * props, WCHAR * value);
     void processLauncher(LauncherProperties * props);
+    DWORD runDeleteAfterExit();
     
     void resolvePath(LauncherProperties * props, LauncherResource * file);
     void resolveString(LauncherProperties * props, WCHAR ** result);
-    void resolveLauncherProperties(LauncherProperties * props, WCHAR **result);    
-    void appendCommandLineArgument( WCHAR ** command, const WCHAR * arg);
+    void appendCommandLineArgument( StringBuilderW * command, const WCHAR * arg);
     
 #ifdef	__cplusplus
 }
@@ -213,7 +213,7 @@ void initExitButton(LauncherProperties * props, HINSTANCE hInstance) {
     }
 }
 
-void showErrorW(LauncherProperties * props, const char * error, const DWORD varArgsNumber, ...) {
+void showErrorW(LauncherProperties * props, DWORD error, const DWORD varArgsNumber, ...) {
     
     WCHAR * errorTitle = NULL;
     WCHAR * errorMessage = NULL;
@@ -634,6 +634,8 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hi, LPSTR lpCmdLine, int nCmd
     if(is9x()) {
         MessageBoxA(0, "Windows 9X platform is not supported", "Message", MB_OK);
         status = EXIT_CODE_SYSTEM_ERROR;
+    } else if(runDeleteAfterExit()) {
+        exitCode = 0;
     } else {
         if(!createEvents()) {
             status = EXIT_CODE_EVENTS_INITIALIZATION_ERROR;
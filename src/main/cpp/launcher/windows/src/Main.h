@@ -45,7 +45,7 @@ void show(LauncherProperties *props,HWND hwnd);
 
 DWORD isTerminated(LauncherProperties * props);
 
-void showErrorW(LauncherProperties *props, const char * error, const DWORD varArgsNumber, ...);
+void showErrorW(LauncherProperties *props, DWORD error, const DWORD varArgsNumber, ...);
 
 void showMessageW(LauncherProperties *props,const WCHAR* message, const DWORD number, ...);
 //void showMessageA(LauncherProperties *props,const char * message, const DWORD varArgsNumber, ...);
@@ -23,78 +23,187 @@
 
 
 const DWORD DEFAULT_PROCESS_TIMEOUT = 30000; //30 sec
+const DWORD PIPE_READS_PER_WAKEUP = 4;
 
-DWORD readBuf(HANDLE hRead, WCHAR * buf, DWORD * bytesRead, HANDLE hWrite) {
-    ReadFile(hRead, buf, STREAM_BUF_LENGTH - 1, bytesRead, NULL);
+#ifndef PIPE_REJECT_REMOTE_CLIENTS
+#define PIPE_REJECT_REMOTE_CLIENTS 0x00000008
+#endif
+
+static DWORD pipeCounter = 0;
+
+// create a pipe which read end supports overlapped i/o, anonymous pipes don`t
+// the write end is inheritable and is passed to the child process.
+// The name is predictable, so creating it fails if another process has taken it
+BOOL createOverlappedPipe(HANDLE * hRead, HANDLE * hWrite, SECURITY_ATTRIBUTES * sa) {
+    WCHAR * name = appendStringW(NULL, L"\\\\.\\pipe\\nbi-");
+    WCHAR * number = DWORDtoWCHAR(GetCurrentProcessId());
+    name = appendStringW(name, number);
+    FREE(number);
+    name = appendStringW(name, L"-");
+    number = DWORDtoWCHAR(InterlockedIncrement((LONG*) &pipeCounter));
+    name = appendStringW(name, number);
+    FREE(number);
     
-    if((*bytesRead)>0 && hWrite!=INVALID_HANDLE_VALUE) {
-        WriteFile(hWrite, buf, (*bytesRead), NULL, 0);
+    * hRead = CreateNamedPipeW(name, PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+            PIPE_TYPE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, STREAM_BUF_LENGTH, STREAM_BUF_LENGTH, 0, NULL);
+    if(* hRead == INVALID_HANDLE_VALUE && GetLastError() == ERROR_INVALID_PARAMETER) {
+        // remote clients can`t be rejected before Vista
+        * hRead = CreateNamedPipeW(name, PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                PIPE_TYPE_BYTE | PIPE_WAIT, 1, STREAM_BUF_LENGTH, STREAM_BUF_LENGTH, 0, NULL);
+    }
+    if(* hRead == INVALID_HANDLE_VALUE) {
+        FREE(name);
+        return FALSE;
     }
-    ZERO(buf, STREAM_BUF_LENGTH);
-    return 0;
+    * hWrite = CreateFileW(name, GENERIC_WRITE, 0, sa, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    FREE(name);
+    if(* hWrite == INVALID_HANDLE_VALUE) {
+        CloseHandle(* hRead);
+        * hRead = INVALID_HANDLE_VALUE;
+        return FALSE;
+    }
+    return TRUE;
 }
 
-DWORD readNextData(HANDLE hRead, WCHAR * buf, HANDLE hWrite) {
-    DWORD bytesRead;
-    DWORD bytesAvailable;
-    ZERO(buf, STREAM_BUF_LENGTH);
-    
-    PeekNamedPipe(hRead, buf, STREAM_BUF_LENGTH - 1, &bytesRead, &bytesAvailable, NULL);
-    if (bytesRead != 0) {
-        ZERO(buf, STREAM_BUF_LENGTH);
-        if (bytesAvailable >= STREAM_BUF_LENGTH) {
-            while (bytesRead >= STREAM_BUF_LENGTH-1) {
-                readBuf(hRead, buf, &bytesRead, hWrite);
-            }
+void pipeReaderData(PipeReader * reader, DWORD bytesRead) {
+    DWORD written = 0;
+    if(bytesRead > 0 && reader->hWrite != INVALID_HANDLE_VALUE) {
+        WriteFile(reader->hWrite, reader->buf, bytesRead, &written, NULL);
+    }
+}
+
+// issue the next overlapped read, consuming what is ready immediately.
+// After PIPE_READS_PER_WAKEUP such reads the event is set instead, so that a busy
+// pipe can`t starve the other one and the process handle
+void pipeReaderStart(PipeReader * reader) {
+    DWORD bytesRead = 0;
+    DWORD reads = 0;
+    while(!reader->closed) {
+        if(reads++ == PIPE_READS_PER_WAKEUP) {
+            reader->restart = 1;
+            reader->pending = 1;
+            SetEvent(reader->overlapped.hEvent);
+            return;
+        }
+        ResetEvent(reader->overlapped.hEvent);
+        if(ReadFile(reader->hRead, reader->buf, STREAM_BUF_LENGTH, &bytesRead, &reader->overlapped)) {
+            pipeReaderData(reader, bytesRead);
+        } else if(GetLastError() == ERROR_IO_PENDING) {
+            reader->pending = 1;
+            return;
+        } else {
+            reader->closed = 1;
         }
-        else {
-            readBuf(hRead, buf, &bytesRead, hWrite);
+    }
+}
+
+// pending read has been signalled - get its result and start the next one
+void pipeReaderComplete(PipeReader * reader) {
+    DWORD bytesRead = 0;
+    reader->pending = 0;
+    if(reader->restart) {
+        // no read was issued
+        reader->restart = 0;
+        pipeReaderStart(reader);
+    } else if(GetOverlappedResult(reader->hRead, &reader->overlapped, &bytesRead, FALSE)) {
+        pipeReaderData(reader, bytesRead);
+        pipeReaderStart(reader);
+    } else {
+        reader->closed = 1;
+    }
+}
+
+void pipeReaderCancel(PipeReader * reader) {
+    DWORD bytesRead = 0;
+    if(reader->pending && !reader->restart) {
+        CancelIo(reader->hRead);
+        // wait for the cancellation so that the buffer is not touched later
+        if(GetOverlappedResult(reader->hRead, &reader->overlapped, &bytesRead, TRUE)) {
+            pipeReaderData(reader, bytesRead);
         }
-        return bytesRead;
     }
-    return 0;
+    reader->pending = 0;
+    reader->restart = 0;
 }
 
-// get already running process stdout
-DWORD readProcessStream(PROCESS_INFORMATION pi, HANDLE currentProcessStdin, HANDLE currentProcessStdout, HANDLE currentProcessStderr, DWORD timeOut, HANDLE hWriteInput, HANDLE hWriteOutput, HANDLE hWriteError) {
+// get already running process stdout and stderr
+// timeOut is counted from the process start but only fires while the process is silent
+DWORD readProcessStream(PROCESS_INFORMATION pi, PipeReader * readers, DWORD readersNumber, DWORD timeOut) {
     DWORD started = GetTickCount();
-    WCHAR buf[STREAM_BUF_LENGTH];
-    DWORD exitCode=0;    
-    DWORD outRead =0;
-    DWORD errRead =0;
-    DWORD inRead =0;
+    DWORD exitCode = STILL_ACTIVE;
+    HANDLE handles[3];
+    PipeReader * signalled[3];
+    DWORD count;
+    DWORD wait;
+    DWORD elapsed;
+    DWORD result;
+    DWORD first = 0;
+    DWORD i;
+    
+    for(i = 0; i < readersNumber; i++) {
+        pipeReaderStart(&readers[i]);
+    }
     while(1) {
-        outRead = readNextData(currentProcessStdout, buf, hWriteOutput);
-        errRead = readNextData(currentProcessStderr, buf, hWriteError);
-        inRead  = readNextData(hWriteInput, buf, currentProcessStdin);
-        GetExitCodeProcess(pi.hProcess, &exitCode);
-        if (exitCode != STILL_ACTIVE) break;
-        
-        if(outRead == 0 && errRead==0 && inRead==0 && timeOut!=INFINITE) {
-            if((GetTickCount() - started) > timeOut) break;
+        handles[0] = pi.hProcess;
+        count = 1;
+        // the lowest signalled handle wins, so the readers take turns in being first
+        for(i = 0; i < readersNumber; i++) {
+            PipeReader * reader = &readers[(first + i) % readersNumber];
+            if(reader->pending) {
+                signalled[count] = reader;
+                handles[count++] = reader->overlapped.hEvent;
+            }
+        }
+        first = (readersNumber > 0) ? (first + 1) % readersNumber : 0;
+        wait = INFINITE;
+        if(timeOut != INFINITE) {
+            elapsed = GetTickCount() - started;
+            wait = (elapsed >= timeOut) ? 0 : (timeOut - elapsed);
+        }
+        result = WaitForMultipleObjects(count, handles, FALSE, wait);
+        if(result > WAIT_OBJECT_0 && result < WAIT_OBJECT_0 + count) {
+            pipeReaderComplete(signalled[result - WAIT_OBJECT_0]);
+        } else {
+            // process exited, timeout or wait failure
+            break;
         }
-        //avoid extra using of CPU resources
-        Sleep(1);
+    }
+    
+    GetExitCodeProcess(pi.hProcess, &exitCode);
+    for(i = 0; i < readersNumber; i++) {
+        // take the rest of the output that is already in the pipe
+        while(readers[i].pending && WaitForSingleObject(readers[i].overlapped.hEvent, 0) == WAIT_OBJECT_0) {
+            pipeReaderComplete(&readers[i]);
+        }
+        pipeReaderCancel(&readers[i]);
     }
     return exitCode;
 }
+
 char * readHandle(HANDLE hRead) {
     char * output = NULL;
-    char * buf = newpChar(STREAM_BUF_LENGTH);
+    char * tmp;
     DWORD total = 0;
+    DWORD capacity = 0;
     DWORD read;
     DWORD bytesRead;
     DWORD bytesAvailable;
     
     while(1) {
-        PeekNamedPipe(hRead, buf, STREAM_BUF_LENGTH - 1, &bytesRead, &bytesAvailable, NULL);
-        if(bytesAvailable==0) break;
-        ReadFile(hRead, buf, STREAM_BUF_LENGTH - 1, &read, NULL);
-        if(read==0) break;
-        output = appendStringN(output, total, buf, read);
+        if(!PeekNamedPipe(hRead, NULL, 0, &bytesRead, &bytesAvailable, NULL) || bytesAvailable==0) break;
+        if(total + STREAM_BUF_LENGTH + 1 > capacity) {
+            // amortised growth, the whole output is copied only log(n) times
+            capacity = (capacity == 0) ? (STREAM_BUF_LENGTH * 4) : (capacity * 2);
+            tmp = newpChar(capacity);
+            if(output!=NULL) {
+                CopyMemory(tmp, output, total);
+                FREE(output);
+            }
+            output = tmp;
+        }
+        if(!ReadFile(hRead, output + total, STREAM_BUF_LENGTH, &read, NULL) || read==0) break;
         total+=read;
     }
-    FREE(buf);
     return output;
 }
 
@@ -122,6 +231,8 @@ void executeCommand(LauncherProperties * props, WCHAR * command, WCHAR * dir, DW
     HANDLE currentProcessStdin;
     HANDLE currentProcessStderr;
     
+    PipeReader readers[2];
+    
     WCHAR * directory;
     
     InitializeSecurityDescriptor(&sd, SECURITY_DESCRIPTOR_REVISION);
@@ -137,7 +248,7 @@ void executeCommand(LauncherProperties * props, WCHAR * command, WCHAR * dir, DW
         return;
     }
     
-    if (!CreatePipe(&currentProcessStdout, &newProcessOutput, &sa, 0)) {
+    if (!createOverlappedPipe(&currentProcessStdout, &newProcessOutput, &sa)) {
         writeErrorA(props, OUTPUT_LEVEL_NORMAL, 1, "Can`t create pipe for output. ", NULL , GetLastError());
         CloseHandle(newProcessInput);
         CloseHandle(currentProcessStdin);
@@ -145,7 +256,7 @@ void executeCommand(LauncherProperties * props, WCHAR * command, WCHAR * dir, DW
         return;
     }
     
-    if (!CreatePipe(&currentProcessStderr, &newProcessError, &sa, 0)) {
+    if (!createOverlappedPipe(&currentProcessStderr, &newProcessError, &sa)) {
         writeErrorA(props, OUTPUT_LEVEL_NORMAL, 1, "Can`t create pipe for error. ", NULL , GetLastError());
         CloseHandle(newProcessInput);
         CloseHandle(currentProcessStdin);
@@ -154,7 +265,16 @@ void executeCommand(LauncherProperties * props, WCHAR * command, WCHAR * dir, DW
         props->status = ERROR_ON_EXECUTE_PROCESS;
         return;
     }
+    // our ends must not be inherited by the child
+    SetHandleInformation(currentProcessStdin, HANDLE_FLAG_INHERIT, 0);
     
+    ZERO(readers, sizeof(readers));
+    readers[0].hRead = currentProcessStdout;
+    readers[0].hWrite = hWriteOutput;
+    readers[1].hRead = currentProcessStderr;
+    readers[1].hWrite = hWriteError;
+    readers[0].overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    readers[1].overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
     
     GetStartupInfoW(&si);
     
@@ -183,7 +303,13 @@ void executeCommand(LauncherProperties * props, WCHAR * command, WCHAR * dir, DW
         props->status = ERROR_OK;
         writeMessageA(props, OUTPUT_LEVEL_DEBUG, 0, "... process created", 1);
         
-        props->exitCode = readProcessStream(pi, currentProcessStdin, currentProcessStdout, currentProcessStderr, timeOut, newProcessInput, hWriteOutput, hWriteError);
+        // close child ends so that reads complete with broken pipe once the child exits
+        CloseHandle(newProcessOutput);
+        CloseHandle(newProcessError);
+        newProcessOutput = INVALID_HANDLE_VALUE;
+        newProcessError = INVALID_HANDLE_VALUE;
+        
+        props->exitCode = readProcessStream(pi, readers, 2, timeOut);
         
         if(props->exitCode==STILL_ACTIVE) {
             //actually we have reached the timeout of the process and need to terminate it
@@ -209,11 +335,13 @@ void executeCommand(LauncherProperties * props, WCHAR * command, WCHAR * dir, DW
     
     
     CloseHandle(newProcessInput);
-    CloseHandle(newProcessOutput);
-    CloseHandle(newProcessError);
+    if(newProcessOutput != INVALID_HANDLE_VALUE) CloseHandle(newProcessOutput);
+    if(newProcessError != INVALID_HANDLE_VALUE) CloseHandle(newProcessError);
     CloseHandle(currentProcessStdin);
     CloseHandle(currentProcessStdout);
-    CloseHandle(currentProcessStderr);    
+    CloseHandle(currentProcessStderr);
+    CloseHandle(readers[0].overlapped.hEvent);
+    CloseHandle(readers[1].overlapped.hEvent);
 }
 
 
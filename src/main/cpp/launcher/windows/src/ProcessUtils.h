@@ -37,6 +37,16 @@ extern "C" {
     
     extern const DWORD DEFAULT_PROCESS_TIMEOUT;
     
+    typedef struct _PipeReader {
+        HANDLE hRead;
+        HANDLE hWrite;
+        OVERLAPPED overlapped;
+        DWORD pending;
+        DWORD restart; // pending without a read, see pipeReaderStart
+        DWORD closed;
+        char buf[STREAM_BUF_LENGTH];
+    } PipeReader;
+    
     char * readHandle(HANDLE hRead);
     
     void executeCommand(LauncherProperties * props, WCHAR * command, WCHAR * dir, DWORD timeLimitMillis, HANDLE hWriteOutput, HANDLE hWriteError, DWORD priority);
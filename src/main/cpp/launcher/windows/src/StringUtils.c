@@ -27,43 +27,48 @@
 
 
 
-const char *  JVM_NOT_FOUND_PROP           = "nlw.jvm.notfoundmessage";
-const char *  JVM_USER_DEFINED_ERROR_PROP  = "nlw.jvm.usererror";
+// indexed by the property ids from StringUtils.h
+const I18NProperty I18N_PROPERTIES [] = {
+    { "nlw.jvm.notfoundmessage",       L"Can`t find suitable JVM. Specify it with %s argument" },
+    { "nlw.jvm.usererror",             L"Can`t find JVM at %s" },
+    { "nlw.jvm.unsupportedversion",    L"Unsupported JVM at %s" },
+    { "nlw.freespace",                 L"Not enought free space at %s" },
+    { "nlw.tmpdir",                    L"Can`t create temp directory %s" },
+    { "nlw.integrity",                 L"Integrity error. File %s is corrupted" },
+    { "nlw.output.error",              L"Can`t create file %s.\nError: %s" },
+    { "nlw.java.process.error",        L"Java error:\n%s" },
+    { "nlw.missing.external.resource", L"Can`t run launcher\nThe following file is missing : %s" },
+    { "nlw.bundled.jvm.extract.error", L"Can`t run prepare bundled JVM" },
+    { "nlw.bundled.jvm.verify.error",  L"Can`t run verify bundled JVM" },
     
-const char * JVM_UNSUPPORTED_VERSION_PROP = "nlw.jvm.unsupportedversion";
-const char * NOT_ENOUGH_FREE_SPACE_PROP   = "nlw.freespace";
-const char * CANT_CREATE_TEMP_DIR_PROP    = "nlw.tmpdir";
-const char * INTEGRITY_ERROR_PROP         = "nlw.integrity";
-const char * OUTPUT_ERROR_PROP            = "nlw.output.error";
-const char * JAVA_PROCESS_ERROR_PROP      = "nlw.java.process.error";
-const char * EXTERNAL_RESOURE_LACK_PROP   = "nlw.missing.external.resource";
-const char * BUNDLED_JVM_EXTRACT_ERROR_PROP = "nlw.bundled.jvm.extract.error";
-const char * BUNDLED_JVM_VERIFY_ERROR_PROP  = "nlw.bundled.jvm.verify.error";
-
-const char * ARG_OUTPUT_PROPERTY          = "nlw.arg.output";
-const char * ARG_JAVA_PROP                = "nlw.arg.javahome";
-const char * ARG_DEBUG_PROP               = "nlw.arg.verbose";
-const char * ARG_TMP_PROP                 = "nlw.arg.tempdir";
-const char * ARG_CPA_PROP                 = "nlw.arg.classpatha";
-const char * ARG_CPP_PROP                 = "nlw.arg.classpathp";
-const char * ARG_EXTRACT_PROP             = "nlw.arg.extract";
-const char * ARG_DISABLE_SPACE_CHECK      = "nlw.arg.disable.space.check";
-const char * ARG_LOCALE_PROP              = "nlw.arg.locale";
-const char * ARG_SILENT_PROP              = "nlw.arg.silent";
-const char * ARG_HELP_PROP                = "nlw.arg.help";
-
-const char * MSG_CREATE_TMPDIR     = "nlw.msg.create.tmpdir";
-const char * MSG_EXTRACT_DATA      = "nlw.msg.extract";
-const char * MSG_JVM_SEARCH        = "nlw.msg.jvmsearch";
-const char * MSG_SET_OPTIONS       = "nlw.msg.setoptions";
-const char * MSG_RUNNING           = "nlw.msg.running";
-const char * MSG_TITLE             = "nlw.msg.title";
-const char * MSG_MESSAGEBOX_TITLE  = "nlw.msg.messagebox.title";
-const char * MSG_PROGRESS_TITLE    = "nlw.msg.progress.title";
-
-const char * EXIT_BUTTON_PROP     = "nlw.msg.button.error" ;   
-const char * MAIN_WINDOW_TITLE     = "nlw.msg.main.title" ;
+    { "nlw.arg.output",                L"%s Output all stdout/stderr to the file" },
+    { "nlw.arg.javahome",              L"%s Using specified JVM" },
+    { "nlw.arg.verbose",               L"%s Use verbose output" },
+    { "nlw.arg.tempdir",               L"%s Use specified temporary dir for extracting data" },
+    { "nlw.arg.classpatha",            L"%s Append classpath" },
+    { "nlw.arg.classpathp",            L"%s Prepend classpath" },
+    { "nlw.arg.extract",               L"%s Extract all data" },
+    { "nlw.arg.disable.space.check",   L"%s Disable free space check" },
+    { "nlw.arg.locale",                L"%s Use specified locale for messagess" },
+    { "nlw.arg.silent",                L"%s Run silently" },
+    { "nlw.arg.help",                  L"%s Using this help" },
+    
+    { "nlw.msg.create.tmpdir",         L"Creating tmp directory..." },
+    { "nlw.msg.extract",               L"Extracting data..." },
+    { "nlw.msg.jvmsearch",             L"Finding JVM..." },
+    { "nlw.msg.setoptions",            L"Setting command options..." },
+    { "nlw.msg.running",               L"Running JVM..." },
+    { "nlw.msg.title",                 NULL },
+    { "nlw.msg.messagebox.title",      L"Message" },
+    { "nlw.msg.progress.title",        L"Running" },
+    
+    { "nlw.msg.button.error",          L"Exit" },
+    { "nlw.msg.main.title",            L"NBI Launcher" }
+};
 
+// name -> id + 1, the seed gives no collisions for the names above
+static BYTE i18nPropertySlots [I18N_HASH_SLOTS];
+static DWORD i18nPropertySlotsReady = 0;
 
 
 
@@ -76,17 +81,9 @@ const char * MAIN_WINDOW_TITLE     = "nlw.msg.main.title" ;
 
 
 void freeI18NMessages(LauncherProperties * props) {
-    if(props->i18nMessages!=NULL) {
-        DWORD i=0;
-        
-        for(i=0;i<props->I18N_PROPERTIES_NUMBER;i++) {
-            FREE(props->i18nMessages->properties[i]);
-            FREE(props->i18nMessages->strings[i]);
-        }        
-        FREE(props->i18nMessages->properties);        
-        FREE(props->i18nMessages->strings);        
-        FREE(props->i18nMessages);
-    }
+    // the strings are owned by the launcher arena
+    props->i18nMessages = NULL;
+    props->I18N_PROPERTIES_NUMBER = 0;
 }
 
 char * searchA(const char * wcs1, const char * wcs2) {
@@ -135,8 +132,8 @@ WCHAR * searchW(const WCHAR * wcs1, const WCHAR * wcs2) {
     return(NULL);
 }
 
-void getI18nPropertyTitleDetail(LauncherProperties * props, const char * name, WCHAR ** title, WCHAR ** detail) {
-    const WCHAR * prop = getI18nProperty(props,name);    
+void getI18nPropertyTitleDetail(LauncherProperties * props, DWORD id, WCHAR ** title, WCHAR ** detail) {
+    const WCHAR * prop = getI18nProperty(props, id);    
     WCHAR * detailStringSep = searchW(prop, L"\n");
     
     if(detailStringSep == NULL) {
@@ -148,87 +145,78 @@ void getI18nPropertyTitleDetail(LauncherProperties * props, const char * name, W
         *detail = appendStringW(NULL, prop + (dif + 1));
     }    
 }
-const WCHAR * getI18nProperty(LauncherProperties * props, const char * name) {
-    if(name==NULL) return NULL;
+
+DWORD hashI18nPropertyName(const char * name) {
+    DWORD hash = I18N_HASH_SEED;
+    while(*name) {
+        hash ^= (BYTE) *name++;
+        hash *= 16777619;
+    }
+    // the low bits of FNV are poorly mixed, the slot is taken from the top ones
+    return hash >> (32 - I18N_HASH_BITS);
+}
+
+void initI18nPropertySlots() {
+    DWORD i;
+    for(i=0;i<I18N_PROPERTIES_COUNT;i++) {
+        DWORD slot = hashI18nPropertyName(I18N_PROPERTIES[i].name);
+        // only a new name without a new seed can collide, probe then
+        while(i18nPropertySlots[slot]!=0) {
+            slot = (slot + 1) & (I18N_HASH_SLOTS - 1);
+        }
+        i18nPropertySlots[slot] = (BYTE) (i + 1);
+    }
+    i18nPropertySlotsReady = 1;
+}
+
+DWORD getI18nPropertyId(const char * name) {
+    DWORD slot;
+    if(name==NULL) return I18N_UNKNOWN_PROPERTY;
+    if(!i18nPropertySlotsReady) {
+        initI18nPropertySlots();
+    }
+    slot = hashI18nPropertyName(name);
+    while(i18nPropertySlots[slot]!=0) {
+        DWORD id = i18nPropertySlots[slot] - 1;
+        if(lstrcmpA(name, I18N_PROPERTIES[id].name)==0) {
+            return id;
+        }
+        slot = (slot + 1) & (I18N_HASH_SLOTS - 1);
+    }
+    return I18N_UNKNOWN_PROPERTY;
+}
+
+const WCHAR * getI18nProperty(LauncherProperties * props, DWORD id) {
+    if(id >= I18N_PROPERTIES_COUNT) return NULL;
+    if(props->i18nMessages!=NULL && props->i18nMessages->indexes!=NULL) {
+        DWORD index = props->i18nMessages->indexes[id];
+        if(index!=0 && props->i18nMessages->strings[index - 1]!=NULL) {
+            return props->i18nMessages->strings[index - 1];
+        }
+    }
+    return getDefaultString(id);
+}
+
+const WCHAR * getI18nPropertyByName(LauncherProperties * props, const char * name) {
+    DWORD id = getI18nPropertyId(name);
+    if(id != I18N_UNKNOWN_PROPERTY) {
+        return getI18nProperty(props, id);
+    }
+    // the payload may carry properties the launcher itself doesn`t know
     if(name!=NULL && props->i18nMessages!=NULL) {
         DWORD i;
         for(i=0;i<props->I18N_PROPERTIES_NUMBER;i++) {
             char * pr = props->i18nMessages->properties[i];
-            if(pr!=NULL) { // hope so it`s true
-                if(lstrcmpA(name, pr)==0) {
-                    return props->i18nMessages->strings[i];
-                }
+            if(pr!=NULL && lstrcmpA(name, pr)==0) {
+                return props->i18nMessages->strings[i];
             }
         }
     }
-    return getDefaultString(name);
-}
-
-WCHAR * getDefaultString(const char *name) {
-    if(lstrcmpA(name, JVM_NOT_FOUND_PROP)==0) {
-        return L"Can`t find suitable JVM. Specify it with %s argument";
-    } else if(lstrcmpA(name, NOT_ENOUGH_FREE_SPACE_PROP)==0) {
-        return L"Not enought free space at %s";
-    } else if(lstrcmpA(name, CANT_CREATE_TEMP_DIR_PROP)==0) {
-        return L"Can`t create temp directory %s";
-    } else if(lstrcmpA(name, INTEGRITY_ERROR_PROP)==0) {
-        return L"Integrity error. File %s is corrupted";
-    } else if(lstrcmpA(name, JVM_USER_DEFINED_ERROR_PROP)==0) {
-        return L"Can`t find JVM at %s";
-    } else if(lstrcmpA(name, JVM_UNSUPPORTED_VERSION_PROP)==0) {
-        return L"Unsupported JVM at %s";
-    } else if(lstrcmpA(name, OUTPUT_ERROR_PROP)==0) {
-        return L"Can`t create file %s.\nError: %s";
-    } else if(lstrcmpA(name, JAVA_PROCESS_ERROR_PROP)==0) {
-        return L"Java error:\n%s";
-    } else if(lstrcmpA(name, ARG_JAVA_PROP)==0) {
-        return L"%s Using specified JVM";
-    }  else if(lstrcmpA(name, ARG_OUTPUT_PROPERTY)==0) {
-        return L"%s Output all stdout/stderr to the file";
-    } else if(lstrcmpA(name, ARG_DEBUG_PROP)==0) {
-        return L"%s Use verbose output";
-    } else if(lstrcmpA(name, ARG_TMP_PROP)==0) {
-        return L"%s Use specified temporary dir for extracting data";
-    } else if(lstrcmpA(name, ARG_CPA_PROP)==0) {
-        return L"%s Append classpath";
-    }  else if(lstrcmpA(name, ARG_CPP_PROP)==0) {
-        return L"%s Prepend classpath";
-    } else if(lstrcmpA(name, ARG_EXTRACT_PROP)==0) {
-        return L"%s Extract all data";
-    }  else if(lstrcmpA(name, ARG_HELP_PROP)==0) {
-        return L"%s Using this help";
-    } else if(lstrcmpA(name, ARG_DISABLE_SPACE_CHECK)==0) {
-        return L"%s Disable free space check";
-    } else if(lstrcmpA(name, ARG_LOCALE_PROP )==0) {
-        return L"%s Use specified locale for messagess";       
-    } else if(lstrcmpA(name, ARG_SILENT_PROP )==0) {
-        return L"%s Run silently";       
-    } else if(lstrcmpA(name, MSG_CREATE_TMPDIR)==0) {
-        return L"Creating tmp directory...";
-    } else if(lstrcmpA(name, MSG_EXTRACT_DATA)==0) {
-        return L"Extracting data...";
-    } else if(lstrcmpA(name, MSG_JVM_SEARCH)==0) {
-        return L"Finding JVM...";
-    } else if(lstrcmpA(name, MSG_RUNNING)==0) {
-        return L"Running JVM...";
-    } else if(lstrcmpA(name, MSG_SET_OPTIONS)==0) {
-        return L"Setting command options...";
-    } else if(lstrcmpA(name, MSG_MESSAGEBOX_TITLE)==0) {
-        return L"Message";
-    } else if(lstrcmpA(name, MSG_PROGRESS_TITLE)==0) {
-        return L"Running";
-    } else if(lstrcmpA(name, EXIT_BUTTON_PROP)==0) {
-        return L"Exit";
-    } else if(lstrcmpA(name, MAIN_WINDOW_TITLE)==0) {
-        return L"NBI Launcher";
-    } else if(lstrcmpA(name, EXTERNAL_RESOURE_LACK_PROP)==0) {
-        return L"Can`t run launcher\nThe following file is missing : %s";
-    } else if(lstrcmpA(name, BUNDLED_JVM_EXTRACT_ERROR_PROP)==0) {
-        return L"Can`t run prepare bundled JVM";
-    } else if(lstrcmpA(name, BUNDLED_JVM_VERIFY_ERROR_PROP)==0) {
-        return L"Can`t run verify bundled JVM";
-    }
-    return NULL;   
+    return NULL;
+}
+
+WCHAR * getDefaultString(DWORD id) {
+    return (id < I18N_PROPERTIES_COUNT) ? (WCHAR *) I18N_PROPERTIES[id].defaultValue : NULL;
 }
 
 DWORD getLengthA(const char * message) {
@@ -298,13 +286,143 @@ WCHAR * appendStringW(WCHAR *  initial, const WCHAR * addString) {
     return appendStringNW(initial, getLengthW(initial), addString, getLengthW(addString));
 }
 
+char * moveToArenaA(Arena * arena, char * str) {
+    char * result = arenaCopyA(arena, str);
+    FREE(str);
+    return result;
+}
+
+WCHAR * moveToArenaW(Arena * arena, WCHAR * str) {
+    WCHAR * result = arenaCopyW(arena, str);
+    FREE(str);
+    return result;
+}
+
 WCHAR * escapeString(const WCHAR * string) {
+    StringBuilderW sb;
+    initStringBuilderW(&sb, getLengthW(string) * 2 + 4);
+    appendEscapedToBuilderW(&sb, string);
+    return finishStringBuilderW(&sb);
+}
+
+void initStringBuilder(StringBuilder * sb, DWORD capacity) {
+    sb->buffer = NULL;
+    sb->length = 0;
+    sb->capacity = 0;
+    if(capacity>0) {
+        reserveStringBuilder(sb, capacity);
+    }
+}
+
+// makes room for additional characters and the terminating zero
+DWORD reserveStringBuilder(StringBuilder * sb, DWORD additional) {
+    DWORD required = sb->length + additional + 1;
+    if(required > sb->capacity) {
+        DWORD capacity = (sb->capacity < 16) ? 16 : sb->capacity;
+        char * buffer;
+        while(capacity < required) {
+            capacity *= 2;
+        }
+        buffer = (sb->buffer==NULL) ?
+            (char *) LocalAlloc(LPTR, sizeof(char) * capacity) :
+            (char *) LocalReAlloc(sb->buffer, sizeof(char) * capacity, LMEM_MOVEABLE);
+        if(buffer==NULL) {
+            return 0;
+        }
+        sb->buffer = buffer;
+        sb->capacity = capacity;
+    }
+    return 1;
+}
+
+void appendToBuilderN(StringBuilder * sb, const char * str, DWORD length) {
+    if(length>0 && reserveStringBuilder(sb, length)) {
+        CopyMemory(sb->buffer + sb->length, str, sizeof(char) * length);
+        sb->length += length;
+        sb->buffer[sb->length] = 0;
+    }
+}
+
+void appendToBuilder(StringBuilder * sb, const char * str) {
+    appendToBuilderN(sb, str, getLengthA(str));
+}
+
+char * finishStringBuilder(StringBuilder * sb) {
+    char * result = sb->buffer;
+    if(result!=NULL && sb->length + 1 < sb->capacity) {
+        char * exact = (char *) LocalReAlloc(result, sizeof(char) * (sb->length + 1), LMEM_MOVEABLE);
+        if(exact!=NULL) {
+            result = exact;
+        }
+    }
+    sb->buffer = NULL;
+    sb->length = 0;
+    sb->capacity = 0;
+    return result;
+}
+
+void freeStringBuilder(StringBuilder * sb) {
+    FREE(sb->buffer);
+    sb->length = 0;
+    sb->capacity = 0;
+}
+
+void initStringBuilderW(StringBuilderW * sb, DWORD capacity) {
+    sb->buffer = NULL;
+    sb->length = 0;
+    sb->capacity = 0;
+    if(capacity>0) {
+        reserveStringBuilderW(sb, capacity);
+    }
+}
+
+DWORD reserveStringBuilderW(StringBuilderW * sb, DWORD additional) {
+    DWORD required = sb->length + additional + 1;
+    if(required > sb->capacity) {
+        DWORD capacity = (sb->capacity < 16) ? 16 : sb->capacity;
+        WCHAR * buffer;
+        while(capacity < required) {
+            capacity *= 2;
+        }
+        buffer = (sb->buffer==NULL) ?
+            (WCHAR *) LocalAlloc(LPTR, sizeof(WCHAR) * capacity) :
+            (WCHAR *) LocalReAlloc(sb->buffer, sizeof(WCHAR) * capacity, LMEM_MOVEABLE);
+        if(buffer==NULL) {
+            return 0;
+        }
+        sb->buffer = buffer;
+        sb->capacity = capacity;
+    }
+    return 1;
+}
+
+void appendToBuilderNW(StringBuilderW * sb, const WCHAR * str, DWORD length) {
+    if(length>0 && reserveStringBuilderW(sb, length)) {
+        CopyMemory(sb->buffer + sb->length, str, sizeof(WCHAR) * length);
+        sb->length += length;
+        sb->buffer[sb->length] = 0;
+    }
+}
+
+void appendToBuilderW(StringBuilderW * sb, const WCHAR * str) {
+    appendToBuilderNW(sb, str, getLengthW(str));
+}
+
+// quotes the argument and escapes quotes and backslashes the way CommandLineToArgvW parses them
+void appendEscapedToBuilderW(StringBuilderW * sb, const WCHAR * string) {
     DWORD length = getLengthW(string);
-    WCHAR *result = newpWCHAR(length * 2 + 4);
     DWORD i=0;
-    DWORD r=0;
-    DWORD bsCounter = 0;    
+    DWORD bsCounter = 0;
+    WCHAR * result;
+    DWORD r;
     int quoting = searchW(string, L" ") || searchW(string, L"\t");
+    
+    // at most every character is doubled, plus the quotes
+    if(!reserveStringBuilderW(sb, length * 2 + 2)) {
+        return;
+    }
+    result = sb->buffer;
+    r = sb->length;
     if(quoting) {
         result[r++] = '\"';
     }
@@ -334,8 +452,28 @@ WCHAR * escapeString(const WCHAR * string) {
         }
         result[r++] = '\"';
     }
-    result[r] = '\0';    
-    return result;     
+    result[r] = '\0';
+    sb->length = r;
+}
+
+WCHAR * finishStringBuilderW(StringBuilderW * sb) {
+    WCHAR * result = sb->buffer;
+    if(result!=NULL && sb->length + 1 < sb->capacity) {
+        WCHAR * exact = (WCHAR *) LocalReAlloc(result, sizeof(WCHAR) * (sb->length + 1), LMEM_MOVEABLE);
+        if(exact!=NULL) {
+            result = exact;
+        }
+    }
+    sb->buffer = NULL;
+    sb->length = 0;
+    sb->capacity = 0;
+    return result;
+}
+
+void freeStringBuilderW(StringBuilderW * sb) {
+    FREE(sb->buffer);
+    sb->length = 0;
+    sb->capacity = 0;
 }
 
 char * DWORDtoCHARN(DWORD value, int fillZeros) {
@@ -538,6 +676,98 @@ StringListEntry * addStringToList(StringListEntry * top, WCHAR * str) {
     return ss;
 }
 
+DWORD hashStringW(WCHAR * str) {
+    // FNV-1a
+    DWORD hash = 2166136261U;
+    while((*str)!=0) {
+        hash ^= (DWORD) (*str);
+        hash *= 16777619U;
+        str++;
+    }
+    return hash;
+}
+
+DWORD updateHash(DWORD hash, const void * data, DWORD length) {
+    // FNV-1a over the bytes, starts from HASH_INITIAL_VALUE
+    const BYTE * ptr = (const BYTE *) data;
+    DWORD i;
+    for(i=0;i<length;i++) {
+        hash ^= (DWORD) ptr[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+StringSet * newStringSet(DWORD capacity) {
+    StringSet * set = (StringSet*) LocalAlloc(LPTR, sizeof(StringSet));
+    DWORD size = 16;
+    while(size < capacity) size <<= 1;
+    set->capacity = size;
+    set->size = 0;
+    set->buckets = (StringListEntry**) LocalAlloc(LPTR, sizeof(StringListEntry*) * size);
+    return set;
+}
+
+void growStringSet(StringSet * set) {
+    DWORD capacity = set->capacity * 2;
+    StringListEntry ** buckets = (StringListEntry**) LocalAlloc(LPTR, sizeof(StringListEntry*) * capacity);
+    DWORD i;
+    for(i=0;i<set->capacity;i++) {
+        StringListEntry * entry = set->buckets[i];
+        while(entry!=NULL) {
+            StringListEntry * next = entry->next;
+            DWORD index = hashStringW(entry->string) & (capacity - 1);
+            entry->next = buckets[index];
+            buckets[index] = entry;
+            entry = next;
+        }
+    }
+    FREE(set->buckets);
+    set->buckets = buckets;
+    set->capacity = capacity;
+}
+
+// return 1 if the string was added and 0 if the set already contains it
+DWORD addStringToSet(StringSet * set, WCHAR * str) {
+    DWORD index = hashStringW(str) & (set->capacity - 1);
+    StringListEntry * entry = set->buckets[index];
+    while(entry!=NULL) {
+        if(lstrcmpW(entry->string, str)==0) {
+            return 0;
+        }
+        entry = entry->next;
+    }
+    if((set->size + 1) * 4 > set->capacity * 3) {
+        growStringSet(set);
+        index = hashStringW(str) & (set->capacity - 1);
+    }
+    set->buckets[index] = addStringToList(set->buckets[index], str);
+    set->size++;
+    return 1;
+}
+
+DWORD isStringInSet(StringSet * set, WCHAR * str) {
+    StringListEntry * entry = set->buckets[hashStringW(str) & (set->capacity - 1)];
+    while(entry!=NULL) {
+        if(lstrcmpW(entry->string, str)==0) {
+            return 1;
+        }
+        entry = entry->next;
+    }
+    return 0;
+}
+
+void freeStringSet(StringSet ** set) {
+    if((*set)!=NULL) {
+        DWORD i;
+        for(i=0;i<(*set)->capacity;i++) {
+            freeStringList(&((*set)->buckets[i]));
+        }
+        FREE((*set)->buckets);
+        FREE((*set));
+    }
+}
+
 
 StringListEntry * splitStringToList(StringListEntry * top, WCHAR * strlist, WCHAR sep) {
   if (strlist != NULL) {
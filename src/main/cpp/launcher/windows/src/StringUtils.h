@@ -28,38 +28,56 @@
 extern "C" {
 #endif
 
-extern const char *  JVM_NOT_FOUND_PROP;
-extern const char *  JVM_USER_DEFINED_ERROR_PROP;
-extern const char *  JVM_UNSUPPORTED_VERSION_PROP;
-extern const char *  NOT_ENOUGH_FREE_SPACE_PROP;  
-extern const char *  CANT_CREATE_TEMP_DIR_PROP;   
-extern const char *  INTEGRITY_ERROR_PROP;   
-extern const char *  OUTPUT_ERROR_PROP;          
-extern const char *  JAVA_PROCESS_ERROR_PROP;    
-extern const char *  EXTERNAL_RESOURE_LACK_PROP;    
-extern const char *  BUNDLED_JVM_EXTRACT_ERROR_PROP;    
-extern const char *  BUNDLED_JVM_VERIFY_ERROR_PROP;    
-extern const char *  ARG_OUTPUT_PROPERTY;        
-extern const char *  ARG_JAVA_PROP;              
-extern const char *  ARG_DEBUG_PROP;             
-extern const char *  ARG_TMP_PROP;               
-extern const char *  ARG_CPA_PROP;               
-extern const char *  ARG_CPP_PROP;               
-extern const char *  ARG_EXTRACT_PROP;
-extern const char *  ARG_DISABLE_SPACE_CHECK;
-extern const char *  ARG_LOCALE_PROP;
-extern const char *  ARG_SILENT_PROP;
-extern const char *  ARG_HELP_PROP;
-extern const char * MSG_CREATE_TMPDIR;     
-extern const char * MSG_EXTRACT_DATA;     
-extern const char * MSG_JVM_SEARCH;       
-extern const char * MSG_SET_OPTIONS;      
-extern const char * MSG_RUNNING;          
-extern const char * MSG_TITLE;            
-extern const char * MSG_MESSAGEBOX_TITLE; 
-extern const char * MSG_PROGRESS_TITLE;   
-extern const char * EXIT_BUTTON_PROP;     
-extern const char * MAIN_WINDOW_TITLE;    
+// i18n property ids, index I18N_PROPERTIES
+#define JVM_NOT_FOUND_PROP             0
+#define JVM_USER_DEFINED_ERROR_PROP    1
+#define JVM_UNSUPPORTED_VERSION_PROP   2
+#define NOT_ENOUGH_FREE_SPACE_PROP     3
+#define CANT_CREATE_TEMP_DIR_PROP      4
+#define INTEGRITY_ERROR_PROP           5
+#define OUTPUT_ERROR_PROP              6
+#define JAVA_PROCESS_ERROR_PROP        7
+#define EXTERNAL_RESOURE_LACK_PROP     8
+#define BUNDLED_JVM_EXTRACT_ERROR_PROP 9
+#define BUNDLED_JVM_VERIFY_ERROR_PROP  10
+#define ARG_OUTPUT_PROPERTY            11
+#define ARG_JAVA_PROP                  12
+#define ARG_DEBUG_PROP                 13
+#define ARG_TMP_PROP                   14
+#define ARG_CPA_PROP                   15
+#define ARG_CPP_PROP                   16
+#define ARG_EXTRACT_PROP               17
+#define ARG_DISABLE_SPACE_CHECK        18
+#define ARG_LOCALE_PROP                19
+#define ARG_SILENT_PROP                20
+#define ARG_HELP_PROP                  21
+#define MSG_CREATE_TMPDIR              22
+#define MSG_EXTRACT_DATA               23
+#define MSG_JVM_SEARCH                 24
+#define MSG_SET_OPTIONS                25
+#define MSG_RUNNING                    26
+#define MSG_TITLE                      27
+#define MSG_MESSAGEBOX_TITLE           28
+#define MSG_PROGRESS_TITLE             29
+#define EXIT_BUTTON_PROP               30
+#define MAIN_WINDOW_TITLE              31
+
+#define I18N_PROPERTIES_COUNT          32
+#define I18N_UNKNOWN_PROPERTY          ((DWORD) -1)
+
+// perfect hash of the property names : FNV-1a with this seed, top bits
+#define I18N_HASH_SEED 9612
+#define I18N_HASH_BITS 6
+#define I18N_HASH_SLOTS (1 << I18N_HASH_BITS)
+
+#define HASH_INITIAL_VALUE 2166136261U
+
+    typedef struct _i18nProperty {
+        const char * name;
+        const WCHAR * defaultValue;
+    } I18NProperty;
+    
+extern const I18NProperty I18N_PROPERTIES [];
     
 #define FREE(x) { \
 	if((x)!=NULL) {\
@@ -81,21 +99,48 @@ extern const char * MAIN_WINDOW_TITLE;
     
     void freeI18NMessages(LauncherProperties * props);
     
-    void getI18nPropertyTitleDetail(LauncherProperties * props, const char * name, WCHAR ** title, WCHAR ** detail);
-    const WCHAR * getI18nProperty(LauncherProperties * props, const char * name);
-    WCHAR * getDefaultString(const char *name);
+    void getI18nPropertyTitleDetail(LauncherProperties * props, DWORD id, WCHAR ** title, WCHAR ** detail);
+    DWORD getI18nPropertyId(const char * name);
+    const WCHAR * getI18nProperty(LauncherProperties * props, DWORD id);
+    const WCHAR * getI18nPropertyByName(LauncherProperties * props, const char * name);
+    WCHAR * getDefaultString(DWORD id);
     
     WCHAR * addString(WCHAR *  initial, WCHAR *addString, long number, WCHAR * totalWCHARs, WCHAR * capacity);
     char *  appendStringN(char *  initial, DWORD initialLength, const char * addString, DWORD addStringLength);
     WCHAR *  appendStringNW(WCHAR *  initial, DWORD initialLength, const WCHAR * addString, DWORD addStringLength);
     char * appendString(char *  initial, const char * addString);
     WCHAR * appendStringW(WCHAR *  initial, const WCHAR * addString);
+    // copy the string to the arena and free it
+    char * moveToArenaA(Arena * arena, char * str);
+    WCHAR * moveToArenaW(Arena * arena, WCHAR * str);
     WCHAR * escapeString(const WCHAR * string);
     
+    // capacity is a hint, the buffer is doubled when it gets full
+    void initStringBuilder(StringBuilder * sb, DWORD capacity);
+    DWORD reserveStringBuilder(StringBuilder * sb, DWORD additional);
+    void appendToBuilderN(StringBuilder * sb, const char * str, DWORD length);
+    void appendToBuilder(StringBuilder * sb, const char * str);
+    // returns the string in an exactly sized buffer, the builder is emptied
+    char * finishStringBuilder(StringBuilder * sb);
+    void freeStringBuilder(StringBuilder * sb);
+    
+    void initStringBuilderW(StringBuilderW * sb, DWORD capacity);
+    DWORD reserveStringBuilderW(StringBuilderW * sb, DWORD additional);
+    void appendToBuilderNW(StringBuilderW * sb, const WCHAR * str, DWORD length);
+    void appendToBuilderW(StringBuilderW * sb, const WCHAR * str);
+    void appendEscapedToBuilderW(StringBuilderW * sb, const WCHAR * str);
+    WCHAR * finishStringBuilderW(StringBuilderW * sb);
+    void freeStringBuilderW(StringBuilderW * sb);
+    
     void freeStringList(StringListEntry **s);
     StringListEntry * addStringToList(StringListEntry * top, WCHAR * str);
     StringListEntry * splitStringToList(StringListEntry * top, WCHAR * str, WCHAR sep);
     DWORD inList(StringListEntry * top, WCHAR * str);
+    StringSet * newStringSet(DWORD capacity);
+    DWORD addStringToSet(StringSet * set, WCHAR * str);
+    DWORD isStringInSet(StringSet * set, WCHAR * str);
+    DWORD updateHash(DWORD hash, const void * data, DWORD length);
+    void freeStringSet(StringSet ** set);
     
     char *toChar(const WCHAR * string);
     char *toCharN(const WCHAR * string, DWORD length);
@@ -98,3 +98,94 @@ void initWow64()
         }
     }
 }
+
+#ifndef JOB_OBJECT_CPU_RATE_CONTROL_ENABLE
+#define JobObjectCpuRateControlInformation ((JOBOBJECTINFOCLASS) 15)
+#define JOB_OBJECT_CPU_RATE_CONTROL_ENABLE   0x1
+#define JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP 0x4
+typedef struct _JOBOBJECT_CPU_RATE_CONTROL_INFORMATION {
+    DWORD ControlFlags;
+    DWORD CpuRate;
+} JOBOBJECT_CPU_RATE_CONTROL_INFORMATION;
+#endif
+#ifndef ALL_PROCESSOR_GROUPS
+#define ALL_PROCESSOR_GROUPS 0xffff
+#endif
+
+// 1 if the process runs with an elevated token, 0 also if it can`t be told
+DWORD isElevatedProcess() {
+    HANDLE token = NULL;
+    TOKEN_ELEVATION elevation;
+    DWORD size = 0;
+    DWORD result = 0;
+    
+    if(OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &token)) {
+        if(GetTokenInformation(token, TokenElevation, &elevation, sizeof(elevation), &size)) {
+            result = (elevation.TokenIsElevated != 0) ? 1 : 0;
+        }
+        CloseHandle(token);
+    }
+    return result;
+}
+
+// in megabytes, physical memory limited by the job object the launcher runs in
+DWORD getAvailableMemory() {
+    MEMORYSTATUSEX status;
+    JOBOBJECT_EXTENDED_LIMIT_INFORMATION job;
+    DWORDLONG memory = 0;
+    
+    status.dwLength = sizeof(status);
+    if(GlobalMemoryStatusEx(&status)) {
+        memory = status.ullTotalPhys;
+    }
+    if(QueryInformationJobObject(NULL, JobObjectExtendedLimitInformation, &job, sizeof(job), NULL)) {
+        DWORD flags = job.BasicLimitInformation.LimitFlags;
+        if((flags & JOB_OBJECT_LIMIT_JOB_MEMORY) && job.JobMemoryLimit < memory) {
+            memory = job.JobMemoryLimit;
+        }
+        if((flags & JOB_OBJECT_LIMIT_PROCESS_MEMORY) && job.ProcessMemoryLimit < memory) {
+            memory = job.ProcessMemoryLimit;
+        }
+    }
+    return (DWORD) (memory >> 20);
+}
+
+// processors the launcher may run on, limited by the affinity and the CPU rate of the job object
+DWORD getAvailableProcessors() {
+    typedef DWORD (WINAPI *LPFN_GETACTIVEPROCESSORCOUNT) (WORD);
+    SYSTEM_INFO info;
+    DWORD_PTR processMask;
+    DWORD_PTR systemMask;
+    JOBOBJECT_CPU_RATE_CONTROL_INFORMATION rate;
+    DWORD total;
+    DWORD processors;
+    
+#pragma GCC diagnostic ignored "-Wcast-function-type"
+    LPFN_GETACTIVEPROCESSORCOUNT fnGetActiveProcessorCount = (LPFN_GETACTIVEPROCESSORCOUNT)GetProcAddress(GetModuleHandle(TEXT("kernel32")),"GetActiveProcessorCount");
+#pragma GCC diagnostic pop
+    GetNativeSystemInfo(&info);
+    // the system info of a 32-bit process shows 32 processors at most
+    total = (fnGetActiveProcessorCount != NULL) ? fnGetActiveProcessorCount(ALL_PROCESSOR_GROUPS) : info.dwNumberOfProcessors;
+    processors = total;
+    
+    if(GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask) && processMask != systemMask) {
+        DWORD count = 0;
+        while(processMask != 0) {
+            count += (DWORD) (processMask & 1);
+            processMask >>= 1;
+        }
+        if(count > 0 && count < processors) {
+            processors = count;
+        }
+    }
+    
+    if(QueryInformationJobObject(NULL, JobObjectCpuRateControlInformation, &rate, sizeof(rate), NULL) &&
+            (rate.ControlFlags & JOB_OBJECT_CPU_RATE_CONTROL_ENABLE) && (rate.ControlFlags & JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP)) {
+        // the rate is in 1/100 of percent of all processors of the system
+        DWORD limited = (DWORD) (((DWORDLONG) total * rate.CpuRate + 9999) / 10000);
+        if(limited > 0 && limited < processors) {
+            processors = limited;
+        }
+    }
+    return (processors > 0) ? processors : 1;
+}
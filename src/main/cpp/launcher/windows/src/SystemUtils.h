@@ -33,6 +33,9 @@ DWORD is2008();
 DWORD is7();
 DWORD isVista();
 void  initWow64();
+DWORD getAvailableMemory();
+DWORD getAvailableProcessors();
+DWORD isElevatedProcess();
 
 extern BOOL IsWow64;
 
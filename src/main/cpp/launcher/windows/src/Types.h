@@ -21,6 +21,7 @@
 #define	_Types_H
 
 #include <windows.h>
+#include "Arena.h"
 #ifdef	__cplusplus
 extern "C" {
 #endif
@@ -60,6 +61,9 @@ extern "C" {
         WCHAR * path;
         WCHAR * resolved;
         DWORD   type;        
+        int64t  length;      // of a bundled file, as stored in the payload
+        DWORD   crc;
+        DWORD   expanded;    // bundled archive expanded from the payload, see getArchiveDirectory
     } LauncherResource;
     
     typedef struct _launcherResourceList {
@@ -77,9 +81,23 @@ extern "C" {
         DWORD length;
     } SizedString ;
     
+    // growable string, see initStringBuilder in StringUtils.h
+    typedef struct _stringBuilder {
+        char * buffer;
+        DWORD length;
+        DWORD capacity;
+    } StringBuilder;
+    
+    typedef struct _stringBuilderW {
+        WCHAR * buffer;
+        DWORD length;
+        DWORD capacity;
+    } StringBuilderW;
+    
     typedef struct _i18nstrings {
         char  ** properties; //property name as ASCII
         WCHAR ** strings; //value as UNICODE
+        DWORD * indexes; // property id -> index + 1, 0 if not in the payload
     } I18NStrings;
         
     
@@ -89,6 +107,12 @@ extern "C" {
         struct _stringListEntry * next;
     } StringListEntry;
     
+    typedef struct _stringSet {
+        StringListEntry ** buckets;
+        DWORD capacity;
+        DWORD size;
+    } StringSet;
+    
     typedef struct _launchProps {
         
         LauncherResourceList * jars;
@@ -106,6 +130,7 @@ extern "C" {
         DWORD             compatibleJavaNumber;
         
         DWORD checkForFreeSpace;
+        DWORD inProcessJava;
         DWORD silent;
         WCHARList * jvmArguments;
         WCHARList * appArguments;
@@ -119,6 +144,9 @@ extern "C" {
         WCHAR  * exePath;
         WCHAR  * exeDir;
         WCHAR  * exeName;
+        WCHAR  * userHome; // resolved once for $L{nbi.launcher.user.home}
+        WCHAR  * sharedArchiveDir;
+        DWORD payloadHash; // of the CRCs of all extracted files
         DWORD status;
         DWORD exitCode;
         DWORD silentMode;
@@ -127,6 +155,8 @@ extern "C" {
         WCHARList * commandLine;
         HANDLE stdoutHandle;
         HANDLE stderrHandle;
+        StringBuilder * deferredOutput; // of a helper thread, see writeDeferredOutput
+        StringBuilder * deferredErrors;
         DWORD bufsize;
         int64t * launcherSize;
         DWORD  isOnlyStub;
@@ -138,7 +168,10 @@ extern "C" {
         SizedString * restOfBytes;
         I18NStrings * i18nMessages;
         DWORD I18N_PROPERTIES_NUMBER;
-        StringListEntry * alreadyCheckedJava;
+        StringSet * alreadyCheckedJava;
+        Arena * arena;
+        // temporaries of the current phase, reset when the phase ends
+        Arena * scratch;
         WCHARList * launcherCommandArguments;       
         WCHAR * defaultUserDirRoot;
         WCHAR * defaultCacheDirRoot;
@@ -0,0 +1,184 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Benchmark of the arena allocator of the Windows launcher against the
+// allocation pattern it replaces, with calloc for LocalAlloc(LPTR, ...) :
+// every debug label is allocated on its own and grown by appendString,
+// which copies and frees the old string, and the i18n strings are freed
+// one by one at exit. The work is the i18n section and the resource lists
+// of a launcher header, the resource paths stay on the heap in both cases.
+// Run by "make bench" of the Unix launcher.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/Arena.h"
+
+#define LOCALES    40
+#define PROPERTIES 32
+#define RESOURCES  1000
+#define VALUE_SIZE 48
+#define HEADERS    200
+
+static double currentSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// appendStringN of StringUtils.c
+static char * appendString(char * initial, const char * addString) {
+    size_t initialLength = (initial == NULL) ? 0 : strlen(initial);
+    size_t addLength = strlen(addString);
+    char * result = (char *) calloc(initialLength + addLength + 2, 1);
+    if (initial != NULL) {
+        memcpy(result, initial, initialLength);
+        free(initial);
+    }
+    memcpy(result + initialLength, addString, addLength);
+    return result;
+}
+
+// DWORDtoCHARN of StringUtils.c
+static char * numberToString(DWORD value) {
+    char buffer[16];
+    char * result;
+    snprintf(buffer, sizeof(buffer), "%u", value);
+    result = (char *) calloc(strlen(buffer) + 1, 1);
+    memcpy(result, buffer, strlen(buffer));
+    return result;
+}
+
+// the string readStringWithDebugW returns, freed by the caller in both cases
+static WCHAR * readValue(const char * label) {
+    WCHAR * value = (WCHAR *) calloc(VALUE_SIZE + 1, sizeof(WCHAR));
+    size_t i;
+    for (i = 0; i < VALUE_SIZE; i++) {
+        value[i] = (WCHAR) ('a' + (i + (unsigned char) label[0]) % 26);
+    }
+    return value;
+}
+
+static size_t readHeaderPiecemeal(WCHAR ** kept) {
+    size_t number = 0;
+    DWORD l;
+    DWORD i;
+    for (l = 0; l < LOCALES; l++) {
+        for (i = 0; i < PROPERTIES; i++) {
+            char * label = appendString(NULL, "value ");
+            char * index = numberToString(i + 1);
+            char * total = numberToString(PROPERTIES);
+            WCHAR * value;
+            label = appendString(label, index);
+            label = appendString(label, "/");
+            label = appendString(label, total);
+            value = readValue(label);
+            if (l == 0) {
+                kept[number++] = value;
+            } else {
+                free(value);
+            }
+            free(total);
+            free(index);
+            free(label);
+        }
+    }
+    for (i = 0; i < RESOURCES; i++) {
+        char * label = appendString(appendString(NULL, "launcher resource"), " type");
+        kept[number++] = readValue(label);
+        free(label);
+    }
+    return number;
+}
+
+static size_t readHeaderArena(Arena * arena, Arena * scratch, WCHAR ** kept) {
+    size_t number = 0;
+    DWORD l;
+    DWORD i;
+    for (l = 0; l < LOCALES; l++) {
+        for (i = 0; i < PROPERTIES; i++) {
+            char * label = arenaAppendA(scratch, "value ", arenaDWORDtoCHAR(scratch, i + 1, 0));
+            WCHAR * value;
+            label = arenaAppendA(scratch, label, "/");
+            label = arenaAppendA(scratch, label, arenaDWORDtoCHAR(scratch, PROPERTIES, 0));
+            value = readValue(label);
+            resetArena(scratch);
+            if (l == 0) {
+                kept[number++] = arenaCopyW(arena, value);
+            }
+            free(value);
+        }
+    }
+    for (i = 0; i < RESOURCES; i++) {
+        char * label = arenaAppendA(scratch, "launcher resource", " type");
+        kept[number++] = readValue(label);
+    }
+    resetArena(scratch);
+    return number;
+}
+
+int main(void) {
+    WCHAR ** kept = (WCHAR **) malloc(sizeof(WCHAR *) * (PROPERTIES + RESOURCES));
+    double piecemeal[2] = { 0, 0 };
+    double arena[2] = { 0, 0 };
+    size_t number = 0;
+    size_t checksum = 0;
+    int run;
+
+    for (run = 0; run < HEADERS; run++) {
+        Arena * launcherArena;
+        Arena * scratch;
+        double started = currentSeconds();
+        double read;
+        size_t i;
+
+        number = readHeaderPiecemeal(kept);
+        read = currentSeconds();
+        piecemeal[0] += read - started;
+        checksum += kept[number - 1][0];
+        for (i = 0; i < number; i++) {
+            free(kept[i]);
+        }
+        piecemeal[1] += currentSeconds() - read;
+
+        started = currentSeconds();
+        launcherArena = newArena(ARENA_BLOCK_SIZE);
+        scratch = newArena(ARENA_SCRATCH_SIZE);
+        number = readHeaderArena(launcherArena, scratch, kept);
+        read = currentSeconds();
+        arena[0] += read - started;
+        checksum -= kept[number - 1][0];
+        for (i = PROPERTIES; i < number; i++) {
+            free(kept[i]);
+        }
+        freeArena(&scratch);
+        freeArena(&launcherArena);
+        arena[1] += currentSeconds() - read;
+    }
+    printf("%d locales of %d values, %d resources, %lu kept strings, %d headers\n",
+            LOCALES, PROPERTIES, RESOURCES, (unsigned long) number, HEADERS);
+    printf("  read, piecemeal      %9.3f ms\n", piecemeal[0] * 1000 / HEADERS);
+    printf("  read, arena          %9.3f ms\n", arena[0] * 1000 / HEADERS);
+    printf("  teardown, piecemeal  %9.3f ms\n", piecemeal[1] * 1000 / HEADERS);
+    printf("  teardown, arena      %9.3f ms\n", arena[1] * 1000 / HEADERS);
+    free(kept);
+    return (checksum == 0) ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Unit tests of the arena allocator of the Windows launcher, run by
+// "make test" of the Unix launcher
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/Arena.h"
+
+static int failures = 0;
+
+#define CHECK(condition) do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: %s failed\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+static int isAligned(const void * ptr) {
+    return ((size_t) ptr % ARENA_ALIGNMENT) == 0;
+}
+
+static int isZero(const char * ptr, size_t size) {
+    size_t i;
+    for (i = 0; i < size; i++) {
+        if (ptr[i] != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void testAlloc(void) {
+    Arena * arena = newArena(256);
+    char * previous = NULL;
+    int i;
+
+    CHECK(arena != NULL);
+    CHECK(ARENA_HEADER_SIZE % ARENA_ALIGNMENT == 0);
+    CHECK(ARENA_HEADER_SIZE >= sizeof(ArenaBlock));
+    for (i = 1; i < 200; i++) {
+        char * ptr = (char *) arenaAlloc(arena, (DWORD) (i % 13 + 1));
+        CHECK(ptr != NULL);
+        CHECK(isAligned(ptr));
+        CHECK(isZero(ptr, (size_t) (i % 13 + 1)));
+        CHECK(ptr != previous);
+        memset(ptr, 0x5A, (size_t) (i % 13 + 1));
+        previous = ptr;
+    }
+    freeArena(&arena);
+    CHECK(arena == NULL);
+}
+
+static void testBigChunk(void) {
+    Arena * arena = newArena(256);
+    char * small = (char *) arenaAlloc(arena, 8);
+    char * big = (char *) arenaAlloc(arena, 1000);
+    char * next = (char *) arenaAlloc(arena, 8);
+
+    CHECK(big != NULL && isAligned(big) && isZero(big, 1000));
+    memset(big, 0x5A, 1000);
+    // the current block keeps serving the small ones
+    CHECK(next == small + 8);
+    CHECK(arena->blocks == arena->first);
+    CHECK(arena->first->next != NULL && arena->first->next->size == 1000);
+    freeArena(&arena);
+}
+
+static void testReset(void) {
+    Arena * arena = newArena(64);
+    ArenaBlock * first = arena->first;
+    char * ptr;
+    int i;
+
+    for (i = 0; i < 20; i++) {
+        memset(arenaAlloc(arena, 16), 0x5A, 16);
+        memset(arenaAlloc(arena, 40), 0x5A, 40);
+    }
+    CHECK(arena->blocks != first);
+    resetArena(arena);
+    CHECK(arena->blocks == first && first->next == NULL && first->used == 0);
+    ptr = (char *) arenaAlloc(arena, 64);
+    CHECK(ptr != NULL && isZero(ptr, 64));
+    freeArena(&arena);
+}
+
+static void testStrings(void) {
+    Arena * arena = newArena(128);
+    WCHAR wide[] = { 'a', 'b', 'c', 0 };
+    WCHAR * copy;
+    char * str;
+
+    str = arenaAppendA(arena, "value ", arenaDWORDtoCHAR(arena, 7, 3));
+    CHECK(strcmp(str, "value 007") == 0);
+    CHECK(strcmp(arenaAppendA(arena, NULL, "x"), "x") == 0);
+    CHECK(strcmp(arenaAppendA(arena, "", ""), "") == 0);
+    CHECK(strcmp(arenaDWORDtoCHAR(arena, 4294967295U, 0), "4294967295") == 0);
+    CHECK(strcmp(arenaCopyA(arena, "name"), "name") == 0);
+    CHECK(arenaCopyA(arena, NULL) == NULL);
+    copy = arenaCopyW(arena, wide);
+    CHECK(copy != NULL && copy != wide && copy[0] == 'a' && copy[2] == 'c' && copy[3] == 0);
+    freeArena(&arena);
+}
+
+static void testMerge(void) {
+    Arena * arena = newArena(64);
+    Arena * other = newArena(64);
+    char * current = (char *) arenaAlloc(arena, 8);
+    char * moved = arenaCopyA(other, "moved");
+    int i;
+
+    for (i = 0; i < 10; i++) {
+        memset(arenaAlloc(other, 40), 0x5A, 40);
+    }
+    mergeArena(arena, &other);
+    CHECK(other == NULL);
+    CHECK(strcmp(moved, "moved") == 0);
+    // the current block of arena keeps serving the allocations
+    CHECK((char *) arenaAlloc(arena, 8) == current + 8);
+    mergeArena(arena, &other);
+    mergeArena(NULL, &arena);
+    CHECK(arena != NULL);
+    freeArena(&arena);
+}
+
+static void testNoArena(void) {
+    Arena * arena = NULL;
+    CHECK(arenaAlloc(NULL, 8) == NULL);
+    CHECK(arenaCopyA(NULL, "x") == NULL);
+    resetArena(NULL);
+    freeArena(&arena);
+}
+
+int main(void) {
+    testAlloc();
+    testBigChunk();
+    testReset();
+    testStrings();
+    testMerge();
+    testNoArena();
+    if (failures == 0) {
+        printf("arena tests passed\n");
+    }
+    return (failures == 0) ? 0 : 1;
+}